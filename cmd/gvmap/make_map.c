@@ -27,6 +27,7 @@
 #include <util/agxbuf.h>
 #include <util/alloc.h>
 #include <util/prisize_t.h>
+#include <util/random.h>
 
 #include <edgepaint/lab.h>
 #include <edgepaint/node_distinct_coloring.h>
@@ -1067,7 +1068,7 @@ static int make_map_internal(bool include_OK_points, int n, int dim, double *x0,
       const double n2 = n * floor(area2 / area);
       nrandom = fmax(n1, n2);
     }
-    srand(123);
+    gv_srand(123);
     xran = gv_calloc((nrandom + 4) * dim2, sizeof(double));
     int nz = 0;
     if (INCLUDE_OK_POINTS){
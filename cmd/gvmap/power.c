@@ -9,6 +9,7 @@
  *************************************************************************/
 
 #include <util/alloc.h>
+#include <util/random.h>
 #include "power.h"
 #include <sparse/SparseMatrix.h>
 
@@ -55,7 +56,7 @@ double *power_method(void *A, int n, int random_seed) {
   vv = gv_calloc(n, sizeof(double));
   u = gv_calloc(n, sizeof(double));
 
-  srand((unsigned)random_seed);
+  gv_srand((unsigned)random_seed);
 
   v = eigv;
   for (i = 0; i < n; i++) u[i] = drand();
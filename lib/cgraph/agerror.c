@@ -22,11 +22,11 @@
 #include <util/gv_math.h>
 #include <util/streq.h>
 
-static agerrlevel_t agerrno;             /* Last error level */
+static TLS agerrlevel_t agerrno;             /* Last error level */
 static agerrlevel_t agerrlevel = AGWARN; /* Report errors >= agerrlevel */
-static int agmaxerr;
+static TLS int agmaxerr;
 
-static agxbuf last;         ///< last message
+static TLS agxbuf last;         ///< last message
 static agusererrf usererrf; /* User-set error function */
 
 agusererrf agseterrf(agusererrf newf) {
@@ -0,0 +1,207 @@
+/**
+ * @file
+ * @brief per root graph memory arena
+ * @ingroup cgraph_core
+ *
+ * Nodes, edges, subgraphs, records and attribute tables of a graph opened
+ * with an @ref Agdisc_s.arena "arena" discipline are carved out of large
+ * chunks instead of being allocated one by one. Allocations are rounded up to
+ * a number of alignment units, and each such size class has a free list that
+ * deleted objects go on for reuse. Every allocation is preceded by a header
+ * recording its class, so it can be freed without knowing its size. The rare
+ * allocation bigger than the largest class gets its own block, kept in a list.
+ *
+ * Closing the root graph releases all of this at once.
+ */
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include <assert.h>
+#include <cgraph/cghdr.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/exit.h>
+
+/// header before every allocation
+///
+/// The members other than `cls` are only there to give allocations following
+/// a header the alignment `malloc` would.
+typedef union {
+  size_t cls; ///< size class, or `LARGE`
+  void *p;
+  double d;
+  long double ld;
+  uint64_t u;
+} header_t;
+
+enum {
+  UNIT = sizeof(header_t), ///< allocation granularity and alignment
+  CLASSES = 64,            ///< number of size classes, up to `CLASSES * UNIT`
+  MIN_CHUNK = 1 << 14,     ///< size of the first chunk, in bytes
+  MAX_CHUNK = 1 << 22,     ///< size chunks grow to, in bytes
+};
+
+/// size class of allocations too big for any class
+#define LARGE SIZE_MAX
+
+/// a chunk allocations are carved from
+typedef struct chunk_s {
+  struct chunk_s *prev; ///< previously filled chunk
+  header_t align;       ///< space for the chunk header, and its alignment
+} chunk_t;
+
+/// an allocation too big for the size classes
+typedef struct large_s {
+  struct large_s *prev, *next;
+  header_t h; ///< must be last, to immediately precede the allocation
+} large_t;
+
+/// an allocation on a free list
+typedef struct free_s {
+  struct free_s *next;
+} free_t;
+
+struct agarena_s {
+  char *next;            ///< start of unused space in the current chunk
+  char *end;             ///< end of the current chunk
+  size_t chunk_size;     ///< size of the next chunk to allocate
+  chunk_t *chunks;       ///< most recent chunk
+  free_t *free[CLASSES]; ///< freed allocations per size class
+  large_t *large;        ///< allocations too big for a class
+};
+
+agarena_t *agarena_new(void) {
+  agarena_t *a = gv_alloc(sizeof(agarena_t));
+  a->chunk_size = MIN_CHUNK;
+  return a;
+}
+
+void agarena_free(agarena_t *a) {
+  if (a == NULL) {
+    return;
+  }
+  for (chunk_t *c = a->chunks, *prev; c != NULL; c = prev) {
+    prev = c->prev;
+    free(c);
+  }
+  for (large_t *l = a->large, *next; l != NULL; l = next) {
+    next = l->next;
+    free(l);
+  }
+  free(a);
+}
+
+/// start a new chunk with room for at least `need` bytes
+static void new_chunk(agarena_t *a, size_t need) {
+  size_t size = a->chunk_size;
+  if (a->chunk_size < MAX_CHUNK) {
+    a->chunk_size *= 2;
+  }
+  if (size < sizeof(chunk_t) + need) {
+    size = sizeof(chunk_t) + need;
+  }
+  chunk_t *c = gv_alloc(size);
+  c->prev = a->chunks;
+  a->chunks = c;
+  a->next = (char *)c + sizeof(chunk_t);
+  a->end = (char *)c + size;
+}
+
+void *agarena_alloc(agarena_t *a, size_t size) {
+  const size_t units = size == 0 ? 1 : (size - 1) / UNIT + 1;
+
+  if (units > CLASSES) {
+    if (size > SIZE_MAX - sizeof(large_t)) {
+      fprintf(stderr, "integer overflow when calculating allocation size\n");
+      graphviz_exit(EXIT_FAILURE);
+    }
+    large_t *l = gv_alloc(sizeof(large_t) + size);
+    l->h.cls = LARGE;
+    l->next = a->large;
+    if (a->large != NULL) {
+      a->large->prev = l;
+    }
+    a->large = l;
+    return l + 1;
+  }
+
+  const size_t cls = units - 1;
+  if (a->free[cls] != NULL) {
+    free_t *f = a->free[cls];
+    a->free[cls] = f->next;
+    memset(f, 0, units * UNIT);
+    return f;
+  }
+
+  // chunks are zeroed when allocated, so fresh space need not be cleared
+  const size_t need = (units + 1) * UNIT;
+  if ((size_t)(a->end - a->next) < need) {
+    new_chunk(a, need);
+  }
+  header_t *h = (header_t *)a->next;
+  a->next += need;
+  h->cls = cls;
+  return h + 1;
+}
+
+void agarena_release(agarena_t *a, void *ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+  header_t *h = (header_t *)ptr - 1;
+  if (h->cls == LARGE) {
+    large_t *l = (large_t *)((char *)h - offsetof(large_t, h));
+    if (l->prev != NULL) {
+      l->prev->next = l->next;
+    } else {
+      a->large = l->next;
+    }
+    if (l->next != NULL) {
+      l->next->prev = l->prev;
+    }
+    free(l);
+    return;
+  }
+  assert(h->cls < CLASSES && "corrupted arena allocation header");
+  free_t *f = ptr;
+  f->next = a->free[h->cls];
+  a->free[h->cls] = f;
+}
+
+void *agobjalloc(Agraph_t *g, size_t size) {
+  agarena_t *a = g->clos->arena;
+  return a != NULL ? agarena_alloc(a, size) : gv_alloc(size);
+}
+
+void agobjfree(Agraph_t *g, void *ptr) {
+  agarena_t *a = g->clos->arena;
+  if (a != NULL) {
+    agarena_release(a, ptr);
+  } else {
+    free(ptr);
+  }
+}
+
+void *agobjresize(Agraph_t *g, void *ptr, size_t old_size, size_t new_size) {
+  agarena_t *a = g->clos->arena;
+  if (a == NULL) {
+    return gv_recalloc(ptr, old_size, new_size, 1);
+  }
+  void *p = agarena_alloc(a, new_size);
+  if (ptr != NULL) {
+    memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    agarena_release(a, ptr);
+  }
+  return p;
+}
@@ -18,9 +18,18 @@
 #include	<stdbool.h>
 #include	<stdlib.h>
 #include	<util/alloc.h>
+#include	<util/gv_ctype.h>
+#include	<util/strcasecmp.h>
 #include	<util/streq.h>
 #include	<util/unreachable.h>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include	<windows.h>
+#else
+#include	<pthread.h>
+#endif
+
 /*
  * dynamic attributes
  */
@@ -46,6 +55,38 @@ static Agdesc_t ProtoDesc = {.directed = true, .no_loop = true,
                              .no_write = true};
 static Agraph_t *ProtoGraph;
 
+/* ProtoGraph is shared by every thread, and even looking up one of its
+ * attributes reorganizes its dictionaries, so all uses of it are serialized.
+ * The lock is reentrant, as creating or updating ProtoGraph makes further
+ * uses of it.
+ */
+#ifdef _WIN32
+static SRWLOCK ProtoLock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t ProtoLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+static TLS int ProtoLockDepth;
+
+static void proto_lock(void) {
+    if (ProtoLockDepth++ == 0) {
+#ifdef _WIN32
+	AcquireSRWLockExclusive(&ProtoLock);
+#else
+	pthread_mutex_lock(&ProtoLock);
+#endif
+    }
+}
+
+static void proto_unlock(void) {
+    if (--ProtoLockDepth == 0) {
+#ifdef _WIN32
+	ReleaseSRWLockExclusive(&ProtoLock);
+#else
+	pthread_mutex_unlock(&ProtoLock);
+#endif
+    }
+}
+
 Agdatadict_t *agdatadict(Agraph_t *g, bool cflag) {
     Agdatadict_t *rv = (Agdatadict_t *) aggetrec(g, DataDictName, 0);
     if (rv || !cflag)
@@ -121,6 +162,7 @@ static Agdatadict_t *agmakedatadict(Agraph_t * g)
 	dtview(dd->dict.e, parent_dd->dict.e);
 	dtview(dd->dict.g, parent_dd->dict.g);
     } else {
+	proto_lock();
 	if (ProtoGraph && g != ProtoGraph) {
 	    /* it's not ok to dtview here for several reasons. the proto
 	       graph could change, and the sym indices don't match */
@@ -129,6 +171,7 @@ static Agdatadict_t *agmakedatadict(Agraph_t * g)
 	    agcopydict(parent_dd->dict.e, dd->dict.e, g, AGEDGE);
 	    agcopydict(parent_dd->dict.g, dd->dict.g, g, AGRAPH);
 	}
+	proto_unlock();
     }
     return dd;
 }
@@ -159,9 +202,11 @@ Agsym_t *agattrsym(void *obj, char *name)
     Agsym_t *rv;
 
     data = agattrrec(obj);
-    if (data)
+    if (data) {
+	agreadlock(agraphof(obj));
 	rv = agdictsym(data->dict, name);
-    else
+	agreadunlock(agraphof(obj));
+    } else
 	rv = NULL;
     return rv;
 }
@@ -195,7 +240,7 @@ static Agrec_t *agmakeattrs(Agraph_t * context, void *obj)
 	sz = topdictsize(obj);
 	if (sz < MINATTR)
 	    sz = MINATTR;
-	rec->str = gv_calloc((size_t)sz, sizeof(char *));
+	rec->str = agobjalloc(agraphof(obj), (size_t)sz * sizeof(char *));
 	/* doesn't call agxset() so no obj-modified callbacks occur */
 	for (sym = dtfirst(datadict); sym; sym = dtnext(datadict, sym))
 	    rec->str[sym->id] = agstrdup(agraphof(obj), sym->defval);
@@ -214,7 +259,8 @@ static void freeattr(Agobj_t * obj, Agattr_t * attr)
     sz = topdictsize(obj);
     for (i = 0; i < sz; i++)
 	agstrfree(g, attr->str[i]);
-    free(attr->str);
+    agobjfree(g, attr->str);
+    agobjfree(g, attr->val);
 }
 
 static void freesym(void *obj) {
@@ -231,15 +277,70 @@ Agattr_t *agattrrec(void *obj)
   return (Agattr_t *)aggetrec(obj, AgDataRecName, 0);
 }
 
+/* Parsed attribute values
+ *
+ * Layout reads the same numeric attributes of every node and edge over and
+ * over. The first typed read of an attribute parses its string and keeps the
+ * result alongside it, in an array indexed like Agattr_t.str that is only
+ * allocated once an object has such a read. Every change of a string resets
+ * its entry.
+ */
+
+enum { VAL_NONE = 0, VAL_DOUBLE, VAL_INT, VAL_BOOL };
+
+struct agattrval_s {
+    unsigned char type;	/* what u holds, VAL_NONE if nothing */
+    bool ok;		/* did the string parse as type? */
+    union {
+	double d;
+	long i;
+	bool b;
+    } u;
+};
+
+static void invalidate(Agattr_t *attr, Agsym_t *sym)
+{
+    if (sym->id < attr->nval)
+	attr->val[sym->id].type = VAL_NONE;
+}
+
+/* the parsed value of an attribute of obj, to be filled in if its type
+ * differs from the one wanted. While the graph is shared, several threads may
+ * be reading it, so the cache is left alone and <scratch> returned, holding
+ * whatever the cache had.
+ */
+static struct agattrval_s *attrval(void *obj, Agattr_t *attr, Agsym_t *sym,
+                                   struct agattrval_s *scratch)
+{
+    assert(sym->id >= 0 && sym->id < topdictsize(obj));
+    if (agshared(agraphof(obj))) {
+	if (sym->id < attr->nval)
+	    *scratch = attr->val[sym->id];
+	else
+	    scratch->type = VAL_NONE;
+	return scratch;
+    }
+    if (sym->id >= attr->nval) {
+	const int n = topdictsize(obj);
+	attr->val = agobjresize(agraphof(obj), attr->val,
+	                        (size_t)attr->nval * sizeof(struct agattrval_s),
+	                        (size_t)n * sizeof(struct agattrval_s));
+	attr->nval = n;
+    }
+    return &attr->val[sym->id];
+}
+
 
 static void addattr(Agraph_t * g, Agobj_t * obj, Agsym_t * sym)
 {
     Agattr_t *attr = agattrrec(obj);
     assert(attr != NULL);
     if (sym->id >= MINATTR)
-	attr->str = gv_recalloc(attr->str, (size_t)sym->id, (size_t)sym->id + 1,
-	                        sizeof(char *));
+	attr->str = agobjresize(agraphof(obj), attr->str,
+	                        (size_t)sym->id * sizeof(char *),
+	                        ((size_t)sym->id + 1) * sizeof(char *));
     attr->str[sym->id] = agstrdup(g, sym->defval);
+    invalidate(attr, sym);
 }
 
 static Agsym_t *getattr(Agraph_t *g, int kind, char *name) {
@@ -247,7 +348,9 @@ static Agsym_t *getattr(Agraph_t *g, int kind, char *name) {
   Dict_t *dict;
   dict = agdictof(g, kind);
   if (dict) {
+    agreadlock(g);
     rv = agdictsym(dict, name); // viewpath up to root
+    agreadunlock(g);
   }
   return rv;
 }
@@ -339,9 +442,15 @@ Agsym_t *agattr(Agraph_t * g, int kind, char *name, const char *value) {
     Agsym_t *rv;
 
     if (g == 0) {
+	proto_lock();
 	if (ProtoGraph == 0)
 	    ProtoGraph = agopen(0, ProtoDesc, 0);
-	g = ProtoGraph;
+	if (value)
+	    rv = setattr(ProtoGraph, kind, name, value);
+	else
+	    rv = getattr(ProtoGraph, kind, name);
+	proto_unlock();
+	return rv;
     }
     if (value)
 	rv = setattr(g, kind, name, value);
@@ -488,6 +597,7 @@ int agxset(void *obj, Agsym_t * sym, const char *value)
     assert(sym->id >= 0 && sym->id < topdictsize(obj));
     agstrfree(g, data->str[sym->id]);
     data->str[sym->id] = agstrdup(g, value);
+    invalidate(data, sym);
     if (hdr->tag.objtype == AGRAPH) {
 	/* also update dict default */
 	Dict_t *dict;
@@ -513,6 +623,69 @@ int agsafeset(void *obj, char *name, const char *value, const char *def) {
     return agxset(obj, a, value);
 }
 
+bool agxgetdouble(void *obj, Agsym_t *sym, double *value)
+{
+    Agattr_t *data = agattrrec(obj);
+    struct agattrval_s scratch;
+    struct agattrval_s *v = attrval(obj, data, sym, &scratch);
+    if (v->type != VAL_DOUBLE) {
+	const char *s = data->str[sym->id];
+	char *end = NULL;
+	v->u.d = s ? strtod(s, &end) : 0;
+	v->ok = s && end != s;
+	v->type = VAL_DOUBLE;
+    }
+    if (v->ok)
+	*value = v->u.d;
+    return v->ok;
+}
+
+bool agxgetint(void *obj, Agsym_t *sym, long *value)
+{
+    Agattr_t *data = agattrrec(obj);
+    struct agattrval_s scratch;
+    struct agattrval_s *v = attrval(obj, data, sym, &scratch);
+    if (v->type != VAL_INT) {
+	const char *s = data->str[sym->id];
+	char *end = NULL;
+	v->u.i = s ? strtol(s, &end, 10) : 0;
+	v->ok = s && end != s;
+	v->type = VAL_INT;
+    }
+    if (v->ok)
+	*value = v->u.i;
+    return v->ok;
+}
+
+static bool parsebool(const char *s, bool *value)
+{
+    if (!s || *s == '\0')
+	return false;
+    if (!strcasecmp(s, "false") || !strcasecmp(s, "no"))
+	*value = false;
+    else if (!strcasecmp(s, "true") || !strcasecmp(s, "yes"))
+	*value = true;
+    else if (gv_isdigit(*s))
+	*value = atoi(s) != 0;
+    else
+	return false;
+    return true;
+}
+
+bool agxgetbool(void *obj, Agsym_t *sym, bool *value)
+{
+    Agattr_t *data = agattrrec(obj);
+    struct agattrval_s scratch;
+    struct agattrval_s *v = attrval(obj, data, sym, &scratch);
+    if (v->type != VAL_BOOL) {
+	v->ok = parsebool(data->str[sym->id], &v->u.b);
+	v->type = VAL_BOOL;
+    }
+    if (v->ok)
+	*value = v->u.b;
+    return v->ok;
+}
+
 static void agraphattr_init_wrapper(Agraph_t *g, Agobj_t *ignored1,
                                     void *ignored2) {
   (void)ignored1;
@@ -0,0 +1,199 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+/* Benchmark of string interning.
+ *
+ * Interns a number of distinct strings like the names and labels of a large
+ * graph, takes further references to them, looks them up and frees them
+ * again, through agstrdup/agstrfree and through a cdt dictionary of reference
+ * counted strings like the one they used before, and reports the time each
+ * took:
+ *
+ *   bench_refstr [-r repetitions] [-n strings]
+ */
+
+#include <cdt/cdt.h>
+#include <cgraph/cgraph.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/parallel.h>
+
+/// a reference counted string, as the cdt based table kept them
+typedef struct {
+  Dtlink_t link;
+  uint64_t refcnt;
+  const char *s;
+  char store[1];
+} refstr_t;
+
+static Dtdisc_t Refstrdisc = {
+    offsetof(refstr_t, s), -1, 0, NULL, free, NULL,
+};
+
+static char *cdt_strdup(Dict_t *d, const char *s) {
+  refstr_t key = {.s = s};
+  refstr_t *r = dtsearch(d, &key);
+  if (r != NULL) {
+    r->refcnt++;
+    return r->store;
+  }
+  r = gv_alloc(sizeof(refstr_t) + strlen(s));
+  r->refcnt = 1;
+  strcpy(r->store, s);
+  r->s = r->store;
+  dtinsert(d, r);
+  return r->store;
+}
+
+static char *cdt_strbind(Dict_t *d, const char *s) {
+  refstr_t key = {.s = s};
+  refstr_t *r = dtsearch(d, &key);
+  return r != NULL ? r->store : NULL;
+}
+
+static void cdt_strfree(Dict_t *d, const char *s) {
+  refstr_t key = {.s = s};
+  refstr_t *r = dtsearch(d, &key);
+  if (r != NULL && r->s == s && --r->refcnt == 0) {
+    dtdelete(d, r);
+  }
+}
+
+/// strings like those of a graph read from a file
+static char **generate(int n) {
+  char **strs = gv_calloc((size_t)n, sizeof(char *));
+  char buf[128];
+  srand(1);
+  for (int i = 0; i < n; i++) {
+    switch (i % 4) {
+    case 0:
+      snprintf(buf, sizeof(buf), "n%d", i);
+      break;
+    case 1:
+      snprintf(buf, sizeof(buf), "%d,%d", rand() % 100000, rand() % 100000);
+      break;
+    case 2:
+      snprintf(buf, sizeof(buf), "node label %d of the generated graph", i);
+      break;
+    default:
+      snprintf(buf, sizeof(buf), "e,%d,%d %d,%d %d,%d %d,%d", rand() % 10000,
+               rand() % 10000, rand() % 10000, rand() % 10000,
+               rand() % 10000, rand() % 10000, rand() % 10000,
+               rand() % 10000);
+      break;
+    }
+    strs[i] = gv_strdup(buf);
+  }
+  return strs;
+}
+
+typedef struct {
+  double intern, dup, bind, free;
+} times_t;
+
+static void report(const char *name, times_t t, int reps, int n) {
+  const double per = 1e9 / ((double)reps * n);
+  printf("  %-8s intern %6.1f ns  dup %6.1f ns  bind %6.1f ns  free %6.1f ns\n",
+         name, t.intern * per, t.dup * per, t.bind * per, t.free * per);
+}
+
+int main(int argc, char **argv) {
+  int reps = 5;
+  int n = 1000000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-r") == 0) {
+      reps = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-n") == 0) {
+      n = atoi(argv[i + 1]);
+    } else {
+      reps = 0;
+    }
+  }
+  if (reps < 1 || n < 1) {
+    fprintf(stderr, "usage: %s [-r repetitions] [-n strings]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  char **strs = generate(n);
+  char **interned = gv_calloc((size_t)n, sizeof(char *));
+  times_t cdt = {0}, refstr = {0};
+  size_t found = 0;
+
+  for (int r = 0; r < reps; r++) {
+    Dict_t *d = dtopen(&Refstrdisc, Dttree);
+    double start = gv_wtime();
+    for (int i = 0; i < n; i++) {
+      interned[i] = cdt_strdup(d, strs[i]);
+    }
+    cdt.intern += gv_wtime() - start;
+    start = gv_wtime();
+    for (int i = 0; i < n; i++) {
+      (void)cdt_strdup(d, strs[n - 1 - i]);
+    }
+    cdt.dup += gv_wtime() - start;
+    start = gv_wtime();
+    for (int i = 0; i < n; i++) {
+      found += cdt_strbind(d, strs[(i * 13) % n]) != NULL;
+    }
+    cdt.bind += gv_wtime() - start;
+    start = gv_wtime();
+    for (int i = 0; i < n; i++) {
+      cdt_strfree(d, interned[n - 1 - i]);
+      cdt_strfree(d, interned[i]);
+    }
+    cdt.free += gv_wtime() - start;
+    dtclose(d);
+
+    Agraph_t *g = agopen("strings", Agdirected, NULL);
+    start = gv_wtime();
+    for (int i = 0; i < n; i++) {
+      interned[i] = agstrdup(g, strs[i]);
+    }
+    refstr.intern += gv_wtime() - start;
+    start = gv_wtime();
+    for (int i = 0; i < n; i++) {
+      (void)agstrdup(g, strs[n - 1 - i]);
+    }
+    refstr.dup += gv_wtime() - start;
+    start = gv_wtime();
+    for (int i = 0; i < n; i++) {
+      found += agstrbind(g, strs[(i * 13) % n]) != NULL;
+    }
+    refstr.bind += gv_wtime() - start;
+    start = gv_wtime();
+    for (int i = 0; i < n; i++) {
+      agstrfree(g, interned[n - 1 - i]);
+      agstrfree(g, interned[i]);
+    }
+    refstr.free += gv_wtime() - start;
+    agclose(g);
+  }
+
+  if (found != 2 * (size_t)n * (size_t)reps) {
+    fprintf(stderr, "lookups found %zu strings instead of %zu\n", found,
+            2 * (size_t)n * (size_t)reps);
+    return EXIT_FAILURE;
+  }
+
+  printf("%d strings, time per string:\n", n);
+  report("cdt", cdt, reps, n);
+  report("agstrdup", refstr, reps, n);
+
+  for (int i = 0; i < n; i++) {
+    free(strs[i]);
+  }
+  free(strs);
+  free(interned);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,155 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+/* Benchmark of reading and writing DOT.
+ *
+ * Round-trips each graph given on the command line, or a generated one of
+ * the given number of nodes with -n, through agwrite and agread, checking
+ * what is read back is the same size, and reports the throughput of both:
+ *
+ *   bench_write [-r repetitions] [-n nodes | file.gv ...]
+ */
+
+#include <cgraph/cgraph.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/parallel.h>
+
+/// a graph like a large layout result, with attributes on most objects
+static Agraph_t *generate(int n) {
+  Agraph_t *g = agopen("generated", Agdirected, NULL);
+  agattr(g, AGNODE, "label", "\\N");
+  agattr(g, AGNODE, "pos", "");
+  agattr(g, AGEDGE, "weight", "1");
+  agattr(g, AGEDGE, "pos", "");
+  Agnode_t **nodes = gv_calloc((size_t)n, sizeof(Agnode_t *));
+  char name[64], value[128];
+  srand(1);
+  for (int i = 0; i < n; i++) {
+    snprintf(name, sizeof(name), i % 10 == 0 ? "node %d" : "n%d", i);
+    nodes[i] = agnode(g, name, 1);
+    snprintf(value, sizeof(value), "%d,%d", rand() % 10000, rand() % 10000);
+    agset(nodes[i], "pos", value);
+  }
+  for (int i = 0; i < 5 * n; i++) {
+    Agedge_t *e = agedge(g, nodes[rand() % n], nodes[rand() % n], NULL, 1);
+    snprintf(value, sizeof(value), "e,%d,%d %d,%d %d,%d", rand() % 10000,
+             rand() % 10000, rand() % 10000, rand() % 10000, rand() % 10000,
+             rand() % 10000);
+    agset(e, "pos", value);
+    if (i % 3 == 0) {
+      agset(e, "weight", "2");
+    }
+  }
+  free(nodes);
+  return g;
+}
+
+/// write a graph to a temporary file, returning its size
+static long write_out(Agraph_t *g, FILE *f) {
+  rewind(f);
+  if (agwrite(g, f) != 0) {
+    fprintf(stderr, "agwrite failed\n");
+    exit(EXIT_FAILURE);
+  }
+  fflush(f);
+  return ftell(f);
+}
+
+static void bench(const char *name, Agraph_t *g, int reps) {
+  FILE *f = tmpfile();
+  if (f == NULL) {
+    fprintf(stderr, "could not create a temporary file\n");
+    exit(EXIT_FAILURE);
+  }
+
+  long size = 0;
+  double start = gv_wtime();
+  for (int r = 0; r < reps; r++) {
+    size = write_out(g, f);
+  }
+  const double write_time = (gv_wtime() - start) / reps;
+
+  Agraph_t *h = NULL;
+  start = gv_wtime();
+  for (int r = 0; r < reps; r++) {
+    if (h != NULL) {
+      agclose(h);
+    }
+    rewind(f);
+    h = agread(f, NULL);
+    if (h == NULL) {
+      fprintf(stderr, "%s: could not read back written graph\n", name);
+      exit(EXIT_FAILURE);
+    }
+  }
+  const double read_time = (gv_wtime() - start) / reps;
+
+  if (agnnodes(h) != agnnodes(g) || agnedges(h) != agnedges(g)) {
+    fprintf(stderr, "%s: read back %d nodes and %d edges instead of %d and %d\n",
+            name, agnnodes(h), agnedges(h), agnnodes(g), agnedges(g));
+    exit(EXIT_FAILURE);
+  }
+
+  const double mb = (double)size / (1024 * 1024);
+  printf("%s: %d nodes, %d edges, %.1f MiB\n", name, agnnodes(g), agnedges(g),
+         mb);
+  printf("  agwrite %8.4fs %8.1f MiB/s\n", write_time, mb / write_time);
+  printf("  agread  %8.4fs %8.1f MiB/s\n", read_time, mb / read_time);
+
+  fclose(f);
+  agclose(h);
+}
+
+int main(int argc, char **argv) {
+  int reps = 5;
+  int nodes = 0;
+  int i = 1;
+  for (; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-r") == 0) {
+      reps = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-n") == 0) {
+      nodes = atoi(argv[i + 1]);
+    } else {
+      break;
+    }
+  }
+  if (reps < 1 || (nodes < 1 && i >= argc)) {
+    fprintf(stderr, "usage: %s [-r repetitions] [-n nodes | file.gv ...]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (nodes > 0) {
+    Agraph_t *g = generate(nodes);
+    bench("generated", g, reps);
+    agclose(g);
+  }
+
+  for (; i < argc; i++) {
+    FILE *f = fopen(argv[i], "r");
+    if (f == NULL) {
+      fprintf(stderr, "could not open %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+    Agraph_t *g = agread(f, NULL);
+    fclose(f);
+    if (g == NULL) {
+      fprintf(stderr, "could not read a graph from %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+    bench(argv[i], g, reps);
+    agclose(g);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -40,6 +40,7 @@
 #include		<string.h>
 #include <assert.h>
 #include <stdint.h>
+#include <util/tls.h>
 
 #define	SUCCESS				0
 #define FAILURE				-1
@@ -54,7 +55,7 @@ CGHDR_API int agapply(Agraph_t * g, Agobj_t * obj, agobjfn_t fn, void *arg,
 	    int preorder);
 
 	/* global variables */
-extern Agraph_t *Ag_G_global;
+extern TLS Agraph_t *Ag_G_global; ///< graph being parsed or freed by this thread
 extern char *AgDataRecName;
 
 	/* set ordering disciplines */
@@ -80,12 +81,43 @@ enum { SEQ_MASK = (1 << (sizeof(unsigned) * 8 - 4)) - 1 };
 Agnode_t *agfindnode_by_id(Agraph_t * g, IDTYPE id);
 uint64_t agnextseq(Agraph_t * g, int objtype);
 
+/* read-only traversal cache of a graph, see agfreeze */
+struct agadj_s {
+    /* out-edges and then in-edges of each node, every run of edges followed
+     * by NULL */
+    Agedge_t **edges;
+    int *out_pos, *in_pos; /* where in <edges> each edge is, by sequence */
+    uint64_t size;         /* length of <out_pos> and <in_pos> */
+    Agsubnode_t *first, *last; /* ends of the nodes, linked in sequence */
+    bool shared; /* between agbeginshared and agendshared, of a root */
+};
+
+/* is the root of <g> being read by several threads at once? */
+bool agshared(Agraph_t * g);
+
+/* serialize dictionary lookups, which reorganize the dictionary, while the
+ * root of <g> is shared */
+void agreadlock(Agraph_t * g);
+void agreadunlock(Agraph_t * g);
+
 /* dict helper functions */
 Dict_t *agdtopen(Agraph_t * g, Dtdisc_t * disc, Dtmethod_t * method);
 void agdtdisc(Agraph_t * g, Dict_t * dict, Dtdisc_t * disc);
 int agdtdelete(Agraph_t * g, Dict_t * dict, void *obj);
 int agdtclose(Agraph_t * g, Dict_t * dict);
 
+/* object memory, from the root graph's arena if it has one (see arena.c) */
+typedef struct agarena_s agarena_t;
+agarena_t *agarena_new(void);
+void *agarena_alloc(agarena_t *arena, size_t size);
+void agarena_release(agarena_t *arena, void *ptr);
+void agarena_free(agarena_t *arena);
+/// allocate zeroed memory for an object of `g`, to be freed by `agobjfree`
+void *agobjalloc(Agraph_t *g, size_t size);
+void agobjfree(Agraph_t *g, void *ptr);
+/// resize memory from `agobjalloc`, zeroing any extension
+void *agobjresize(Agraph_t *g, void *ptr, size_t old_size, size_t new_size);
+
 /** @addtogroup cgraph_attr
  *  @{
  */
@@ -110,11 +142,12 @@ void agedgeattr_delete(Agedge_t * e);
 typedef void *aagscan_t;
 typedef struct aagextra_s aagextra_t;
 
-int aagparse(void);
-void aglexinit(Agdisc_t * disc, void *ifile);
-int aaglex(void);
-void aglexeof(void);
-void aglexbad(void);
+int aagparse(aagscan_t scanner);
+int aaglex_init_extra(aagextra_t *extra, aagscan_t *scanner);
+int aaglex_destroy(aagscan_t scanner);
+aagextra_t *aagget_extra(aagscan_t scanner);
+int aaglex_unscanned_lines(aagscan_t scanner);
+void aglexeof(aagscan_t scanner);
 
 	/* ID management */
 int agmapnametoid(Agraph_t *g, int objtype, char *str, IDTYPE *result,
@@ -251,6 +251,9 @@ struct Agsubnode_s { /* the node-per-graph-or-subgraph record */
   Agnode_t *node;             /* the object */
   Dtlink_t *in_id, *out_id;   /* by node/ID for random access */
   Dtlink_t *in_seq, *out_seq; /* by node/sequence for serial access */
+  Agedge_t **in_adj, **out_adj; /* NULL terminated, if graph is frozen */
+  int in_deg, out_deg;          /* lengths of in_adj and out_adj */
+  Agsubnode_t *seq_prev, *seq_next; /* neighbors in sequence, if frozen */
 };
 
 struct Agnode_s {
@@ -334,6 +337,12 @@ struct Agiodisc_s {
 struct Agdisc_s {
   Agiddisc_t *id;
   Agiodisc_t *io;
+  /// Allocate the nodes, edges, subgraphs and records of the graph from an
+  /// arena owned by its root graph. This makes building large graphs cheaper
+  /// and, unless callbacks or a custom ID discipline are in use, lets
+  /// @ref agclose of the root graph release them all at once instead of
+  /// deleting them one by one.
+  bool arena;
 };
 
 /* default resource disciplines */
@@ -408,11 +417,12 @@ CGRAPH_API int agpopdisc(Agraph_t *g, Agcbdisc_t *disc);
 struct Agclos_s {
   Agdisc_t disc;    /* resource discipline functions */
   Agdstate_t state; /* resource closures */
-  Dict_t *strdict;  /* shared string dict */
+  struct agstrdict_s *strdict; /* shared string table */
   uint64_t seq[3];  /* local object sequence number counter */
   Agcbstack_t *cb;  /* user and system callback function stacks */
   Dict_t *lookup_by_name[3];
   Dict_t *lookup_by_id[3];
+  struct agarena_s *arena; ///< object memory, if `disc.arena`
 };
 
 /// opaque type; the definition of this is internal to Graphviz
@@ -430,6 +440,7 @@ struct Agraph_s {
   Dict_t *g_seq, *g_id;           ///< subgraphs - descendants
   Agraph_t *parent, *root;        ///< subgraphs - ancestors
   Agclos_t *clos;                 ///< shared resources
+  struct agadj_s *adj;            ///< traversal cache, see @ref agfreeze
 };
 
 /* graphs */
@@ -458,6 +469,9 @@ CGRAPH_API Agraph_t *agmemconcat(Agraph_t *g, const char *cp);
 
 CGRAPH_API void agsetfile(const char *);
 ///< sets the current file name for subsequent error reporting
+///
+/// This applies to graphs read by the calling thread, and also restarts line
+/// numbering.
 
 CGRAPH_API Agraph_t *agconcat(Agraph_t *g, void *chan, Agdisc_t *disc);
 /**< @brief merges the file contents with a pre-existing graph
@@ -525,6 +539,48 @@ CGRAPH_API Agedge_t *agnxtout(Agraph_t *g, Agedge_t *e);
 CGRAPH_API Agedge_t *agfstedge(Agraph_t *g, Agnode_t *n);
 CGRAPH_API Agedge_t *agnxtedge(Agraph_t *g, Agedge_t *e, Agnode_t *n);
 CGRAPH_API int agdeledge(Agraph_t *g, Agedge_t *arg_e);
+
+CGRAPH_API void agfreeze(Agraph_t *g);
+/**<
+ * @brief build a read-only traversal cache of a graph
+ *
+ * Copies the in- and out-edges of every node of @p g into contiguous arrays
+ * that @ref agfstout, @ref agnxtout, @ref agfstin, @ref agnxtin (and so
+ * @ref agfstedge and @ref agnxtedge) and @ref agdegree use from then on, and
+ * links the nodes of @p g in sequence for @ref agfstnode, @ref agnxtnode,
+ * @ref aglstnode and @ref agprvnode. This is worth it for a finished graph
+ * that will be traversed many times, as by a layout. Traversal order is
+ * unchanged and, unlike for a graph that is not frozen, does not modify the
+ * graph, so several threads can traverse a frozen graph at once. To read its
+ * attributes from several threads too, see @ref agbeginshared.
+ *
+ * The cache is kept alongside the node and edge sets of @p g, not instead of
+ * them, so it costs memory, about 24 bytes per edge, rather than saving it.
+ * Any change to the nodes or edges of @p g thaws it again, as does
+ * @ref agthaw. Subgraphs of @p g are frozen separately.
+ */
+
+CGRAPH_API void agthaw(Agraph_t *g);
+///< drop the traversal cache built by @ref agfreeze
+
+CGRAPH_API void agbeginshared(Agraph_t *g);
+/**<
+ * @brief start reading a frozen root graph from several threads at once
+ *
+ * Until @ref agendshared, or until @p g is thawed, reading attributes with
+ * @ref agget, @ref agattrsym, @ref agattr given no value or the typed getters
+ * like @ref agxgetdouble, and names with @ref agnameof, does not modify @p g
+ * or its subgraphs, so several threads can do it at once. The typed getters
+ * then parse values without caching them, and searches of the dictionaries
+ * of the graph, which reorganize them, take a lock shared by all graphs.
+ * Writing to the graph from one thread while others read it still needs the
+ * caller's own synchronization.
+ *
+ * @p g must be a root graph frozen with @ref agfreeze.
+ */
+
+CGRAPH_API void agendshared(Agraph_t *g);
+///< go back to reading @p g from one thread, see @ref agbeginshared
 /// @}
 
 /// @addtogroup cgraph_object
@@ -627,6 +683,8 @@ struct Agattr_s { /* dynamic string attributes */
   Agrec_t h;      /* common data header */
   Dict_t *dict;   ///< shared dict of Agsym_s to interpret Agattr_s.str
   char **str;     ///< the attribute string values indexed by Agsym_s.id
+  struct agattrval_s *val; ///< parsed values, see @ref agxgetdouble
+  int nval;                ///< number of entries in `val`
 };
 
 /// @brief string attribute descriptor
@@ -717,6 +775,26 @@ CGRAPH_API int agsafeset(void *obj, char *name, const char *value,
 ///< @brief ensures the given attribute is declared
 ///  before setting it locally on an object
 
+CGRAPH_API bool agxgetdouble(void *obj, Agsym_t *sym, double *value);
+/**< @brief reads an attribute as a number, as parsed by `strtod`
+ *
+ * The parsed value is kept with the object, so reading it again does not
+ * parse it again until it is changed with @ref agxset.
+ *
+ * @return false, leaving `*value` unchanged, if the attribute does not start
+ *   with a number
+ */
+
+CGRAPH_API bool agxgetint(void *obj, Agsym_t *sym, long *value);
+///< reads an attribute as a base 10 integer, as parsed by `strtol`, likewise
+
+CGRAPH_API bool agxgetbool(void *obj, Agsym_t *sym, bool *value);
+/**< @brief reads an attribute as a boolean, likewise
+ *
+ * `true` and `yes` are true, `false` and `no` false, regardless of case, and
+ * a value starting with a digit is true if that integer is not 0.
+ */
+
 /// @}
 
 /** @defgroup cgraph_subgraph subgraphs
@@ -841,6 +919,13 @@ CGRAPH_API void aginternalmapclearlocalnames(Agraph_t *g);
  *
  * The function @ref agerrors returns non-zero if errors have been reported.
  *
+ * What is recorded about reported messages is kept per thread: the type of
+ * the last message, which @ref AGPREV continues, the highest type returned by
+ * @ref agerrors and @ref agreseterrors, and the message returned by
+ * @ref aglasterr all concern the calling thread only. The minimum set by
+ * @ref agseterr and the function set by @ref agseterrf are settings of the
+ * process and apply to all threads.
+ *
  * @{
  */
 typedef enum { AGWARN, AGERR, AGMAX, AGPREV } agerrlevel_t;
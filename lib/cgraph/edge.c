@@ -16,10 +16,30 @@
 #include <assert.h>
 #include <cgraph/cghdr.h>
 #include <cgraph/node_set.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <util/alloc.h>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/* the frozen edge after <e>, <pos> being where to find edges like it */
+static Agedge_t *adjnext(const struct agadj_s *adj, const int *pos,
+                         Agedge_t * e)
+{
+    const uint64_t seq = AGSEQ(e);
+    if (seq >= adj->size || adj->edges[pos[seq]] != e)
+	return NULL; /* not an edge of this graph */
+    return adj->edges[pos[seq] + 1];
+}
+
 /* return first outedge of <n> */
 Agedge_t *agfstout(Agraph_t * g, Agnode_t * n)
 {
@@ -27,7 +47,9 @@ Agedge_t *agfstout(Agraph_t * g, Agnode_t * n)
     Agedge_t *e = NULL;
 
     sn = agsubrep(g, n);
-    if (sn) {
+    if (sn && g->adj) {
+	e = sn->out_adj[0];
+    } else if (sn) {
 		dtrestore(g->e_seq, sn->out_seq);
 		e = dtfirst(g->e_seq);
 		sn->out_seq = dtextract(g->e_seq);
@@ -42,6 +64,8 @@ Agedge_t *agnxtout(Agraph_t * g, Agedge_t * e)
     Agsubnode_t *sn;
     Agedge_t *f = NULL;
 
+    if (g->adj)
+	return adjnext(g->adj, g->adj->out_pos, e);
     n = AGTAIL(e);
     sn = agsubrep(g, n);
     if (sn) {
@@ -58,7 +82,9 @@ Agedge_t *agfstin(Agraph_t * g, Agnode_t * n)
     Agedge_t *e = NULL;
 
     sn = agsubrep(g, n);
-	if (sn) {
+    if (sn && g->adj) {
+	e = sn->in_adj[0];
+    } else if (sn) {
 		dtrestore(g->e_seq, sn->in_seq);
 		e = dtfirst(g->e_seq);
 		sn->in_seq = dtextract(g->e_seq);
@@ -72,9 +98,11 @@ Agedge_t *agnxtin(Agraph_t * g, Agedge_t * e)
     Agsubnode_t *sn;
     Agedge_t *f = NULL;
 
+    if (g->adj)
+	return adjnext(g->adj, g->adj->in_pos, e);
     n = AGHEAD(e);
     sn = agsubrep(g, n);
-	if (sn) {
+    if (sn) {
 		dtrestore(g->e_seq, sn->in_seq);
 		f = dtnext(g->e_seq, e);
 		sn->in_seq = dtextract(g->e_seq);
@@ -176,6 +204,7 @@ static void installedge(Agraph_t * g, Agedge_t * e)
     h = aghead(e);
     while (g) {
 	if (agfindedge_by_key(g, t, h, AGTAG(e))) break;
+	agthaw(g);
 	sn = agsubrep(g, t);
 	ins(g->e_seq, &sn->out_seq, out);
 	ins(g->e_id, &sn->out_id, out);
@@ -199,7 +228,7 @@ static Agedge_t *newedge(Agraph_t * g, Agnode_t * t, Agnode_t * h,
 
     (void)agsubnode(g, t, 1);
     (void)agsubnode(g, h, 1);
-    Agedgepair_t *e2 = gv_alloc(sizeof(Agedgepair_t));
+    Agedgepair_t *e2 = agobjalloc(g, sizeof(Agedgepair_t));
     in = &(e2->in);
     out = &(e2->out);
     uint64_t seq = agnextseq(g, AGEDGE);
@@ -317,6 +346,7 @@ void agdeledgeimage(Agraph_t * g, Agedge_t * e, void *ignored)
     }
     t = in->node;
     h = out->node;
+    agthaw(g);
     sn = agsubrep(g, t);
     del(g->e_seq, &sn->out_seq, out);
     del(g->e_id, &sn->out_id, out);
@@ -346,7 +376,7 @@ int agdeledge(Agraph_t * g, Agedge_t * e)
     }
     if (agapply(g, (Agobj_t *)e, (agobjfn_t)agdeledgeimage, NULL, false) == SUCCESS) {
 	if (g == agroot(g))
-		free(e);
+		agobjfree(g, e);
 	return SUCCESS;
     } else
 	return FAILURE;
@@ -374,6 +404,124 @@ Agedge_t *agsubedge(Agraph_t * g, Agedge_t * e, int cflag)
     return rv;
 }
 
+/* append the edge set <set> to <adj> at <*next>, followed by NULL, returning
+ * how many edges there were */
+static int adjfill(Agraph_t * g, Dtlink_t ** set, struct agadj_s *adj,
+                   int *pos, size_t *next)
+{
+    int deg = 0;
+    dtrestore(g->e_seq, *set);
+    for (Agedge_t *e = dtfirst(g->e_seq); e; e = dtnext(g->e_seq, e)) {
+	pos[AGSEQ(e)] = (int)*next;
+	adj->edges[(*next)++] = e;
+	++deg;
+    }
+    *set = dtextract(g->e_seq);
+    adj->edges[(*next)++] = NULL;
+    return deg;
+}
+
+void agfreeze(Agraph_t * g)
+{
+    agthaw(g);
+
+    /* every edge of g is both an out-edge and an in-edge of a node of g */
+    const size_t n_nodes = (size_t)agnnodes(g);
+    const size_t n_edges = (size_t)agnedges(g);
+    const size_t length = 2 * (n_edges + n_nodes);
+    if (length > INT_MAX) {
+	agerrorf("graph %s too big to freeze\n", agnameof(g));
+	return;
+    }
+
+    struct agadj_s *adj = gv_alloc(sizeof(struct agadj_s));
+    adj->edges = gv_calloc(length, sizeof(Agedge_t *));
+    adj->size = g->clos->seq[AGEDGE] + 1;
+    adj->out_pos = gv_calloc(adj->size, sizeof(int));
+    adj->in_pos = gv_calloc(adj->size, sizeof(int));
+
+    size_t next = 0;
+    Agsubnode_t *prev = NULL;
+    for (Agsubnode_t *sn = dtfirst(g->n_seq); sn; sn = dtnext(g->n_seq, sn)) {
+	sn->out_adj = &adj->edges[next];
+	sn->out_deg = adjfill(g, &sn->out_seq, adj, adj->out_pos, &next);
+	sn->in_adj = &adj->edges[next];
+	sn->in_deg = adjfill(g, &sn->in_seq, adj, adj->in_pos, &next);
+	sn->seq_prev = prev;
+	sn->seq_next = NULL;
+	if (prev)
+	    prev->seq_next = sn;
+	else
+	    adj->first = sn;
+	prev = sn;
+    }
+    adj->last = prev;
+    assert(next == length);
+    g->adj = adj;
+}
+
+void agthaw(Agraph_t * g)
+{
+    if (g->adj == NULL)
+	return;
+    free(g->adj->in_pos);
+    free(g->adj->out_pos);
+    free(g->adj->edges);
+    free(g->adj);
+    g->adj = NULL;
+}
+
+void agbeginshared(Agraph_t * g)
+{
+    assert(g == agroot(g) && g->adj != NULL);
+    if (g->adj)
+	g->adj->shared = true;
+}
+
+void agendshared(Agraph_t * g)
+{
+    if (g->adj)
+	g->adj->shared = false;
+}
+
+bool agshared(Agraph_t * g)
+{
+    const Agraph_t *root = agroot(g);
+    return root->adj != NULL && root->adj->shared;
+}
+
+/* Lookups in the dictionaries of a shared graph are serialized by one lock
+ * for all graphs. Only the threads reading a shared graph take it, and they
+ * hold it for the length of a single search.
+ */
+#ifdef _WIN32
+static SRWLOCK ReadLock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t ReadLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+void agreadlock(Agraph_t * g)
+{
+    if (!agshared(g))
+	return;
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&ReadLock);
+#else
+    pthread_mutex_lock(&ReadLock);
+#endif
+}
+
+void agreadunlock(Agraph_t * g)
+{
+    if (!agshared(g))
+	return;
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&ReadLock);
+#else
+    pthread_mutex_unlock(&ReadLock);
+#endif
+}
+
 /* edge comparison.  AGTYPE(e) == 0 means ID is a wildcard. */
 static int agedgeidcmpf(void *arg_e0, void *arg_e1) {
     Agedge_t *e0 = arg_e0;
@@ -19,21 +19,43 @@
    * symbol clashes.
    */
 %define api.prefix {aag}
+
+  /* Generate a reentrant parser with no global state */
+%define api.pure full
+%param { aagscan_t scanner }
+
 %code requires {
 #include <cghdr.h>
+#include <stddef.h>
 #include <util/agxbuf.h>
 
 struct gstack_s;
 
 struct aagextra_s {
-	int dummy; /* struct must not be empty */
 	/* Common */
+	Agdisc_t *Disc;		/* discipline passed to agread or agconcat */
+	void *Ifile;		/* channel being read */
 	/* Parser */
+	Agraph_t *G;		/* top level graph */
+	int SubgraphDepth;
+	struct gstack_s *S;
 	/* Lexer */
+	int line_num;
+	int html_nest;		/* nesting level for html strings */
+	const char *InputFile;
+	int graphType;
+	agxbuf Sbuf;		/* buffer for arbitrary length strings (longer than BUFSIZ) */
+	char *FileName;		/* file name set by a #line directive */
+	size_t FileNameSize;
 };
 
 }
 
+%code provides {
+int aaglex(AAGSTYPE *, aagscan_t);
+void aagerror(aagscan_t, const char *);
+}
+
 %{
 
 #include <stdbool.h>
@@ -42,12 +64,10 @@ struct aagextra_s {
 #include <stdlib.h>
 #include <util/alloc.h>
 #include <util/streq.h>
+#include <util/tls.h>
 #include <util/unreachable.h>
 
-extern void aagerror(const char*);
-
 static const char Key[] = "key";
-static int SubgraphDepth = 0;
 
 typedef union s {					/* possible items in generic list */
 		Agnode_t		*n;
@@ -78,29 +98,24 @@ typedef struct gstack_s {
 } gstack_t;
 
 /* functions */
-static void appendnode(char *name, char *port, char *sport);
-static void attrstmt(int tkind, char *macroname);
-static void startgraph(char *name, bool directed, bool strict);
-static void getedgeitems(void);
-static void newedge(Agnode_t *t, char *tport, Agnode_t *h, char *hport, char *key);
-static void edgerhs(Agnode_t *n, char *tport, item *hlist, char *key);
-static void appendattr(char *name, char *value);
-static void bindattrs(int kind);
-static void applyattrs(void *obj);
-static void endgraph(void);
-static void endnode(void);
-static void endedge(void);
-static void freestack(void);
-static char* concat(char*, char*);
-static char* concatPort(char*, char*);
-
-static void opensubg(char *name);
-static void closesubg(void);
-
-/* global */
-static Agraph_t *G;				/* top level graph */
-static	Agdisc_t	*Disc;		/* discipline passed to agread or agconcat */
-static gstack_t *S;
+static void appendnode(aagscan_t scanner, char *name, char *port, char *sport);
+static void attrstmt(aagscan_t scanner, int tkind, char *macroname);
+static void startgraph(aagscan_t scanner, char *name, bool directed, bool strict);
+static void getedgeitems(aagscan_t scanner);
+static void newedge(aagextra_t *ctx, Agnode_t *t, char *tport, Agnode_t *h, char *hport, char *key);
+static void edgerhs(aagextra_t *ctx, Agnode_t *n, char *tport, item *hlist, char *key);
+static void appendattr(aagscan_t scanner, char *name, char *value);
+static void bindattrs(aagextra_t *ctx, int kind);
+static void applyattrs(aagextra_t *ctx, void *obj);
+static void endgraph(aagscan_t scanner);
+static void endnode(aagscan_t scanner);
+static void endedge(aagscan_t scanner);
+static void freestack(aagscan_t scanner);
+static char* concat(aagscan_t scanner, char*, char*);
+static char* concatPort(aagextra_t *ctx, char*, char*);
+
+static void opensubg(aagscan_t scanner, char *name);
+static void closesubg(aagscan_t scanner);
 
 %}
 
@@ -121,14 +136,15 @@ static gstack_t *S;
 
 %%
 
-graph		:  hdr body {freestack(); endgraph();}
-			|  error	{if (G) {freestack(); endgraph(); agclose(G); G = Ag_G_global = NULL;}}
+graph		:  hdr body {freestack(scanner); endgraph(scanner);}
+			|  error	{aagextra_t *ctx = aagget_extra(scanner);
+						 if (ctx->G) {freestack(scanner); endgraph(scanner); agclose(ctx->G); ctx->G = Ag_G_global = NULL;}}
 			|  /* empty */
 			;
 
 body		: '{' optstmtlist '}' ;
 
-hdr			:	optstrict graphtype optgraphname {startgraph($3,$2 != 0,$1 != 0);}
+hdr			:	optstrict graphtype optgraphname {startgraph(scanner,$3,$2 != 0,$1 != 0);}
 			;
 
 optgraphname:	atom {$$=$1;} | /* empty */ {$$=0;} ;
@@ -148,25 +164,25 @@ stmt		:  attrstmt  optsemi
 			;
 
 compound 	:	simple rcompound optattr
-					{if ($2) endedge(); else endnode();}
+					{if ($2) endedge(scanner); else endnode(scanner);}
 			;
 
 simple		:	nodelist | subgraph ;
 
-rcompound	:	T_edgeop {getedgeitems();} simple {getedgeitems();} rcompound {$$ = 1;}
+rcompound	:	T_edgeop {getedgeitems(scanner);} simple {getedgeitems(scanner);} rcompound {$$ = 1;}
 			|	/* empty */ {$$ = 0;}
 			;
 
 
 nodelist	: node | nodelist ',' node ;
 
-node		: atom {appendnode($1,NULL,NULL);}
-            | atom ':' atom {appendnode($1,$3,NULL);}
-            | atom ':' atom ':' atom {appendnode($1,$3,$5);}
+node		: atom {appendnode(scanner,$1,NULL,NULL);}
+            | atom ':' atom {appendnode(scanner,$1,$3,NULL);}
+            | atom ':' atom ':' atom {appendnode(scanner,$1,$3,$5);}
             ;
 
-attrstmt	:  attrtype optmacroname attrlist {attrstmt($1,$2);}
-			|  graphattrdefs {attrstmt(T_graph,NULL);}
+attrstmt	:  attrtype optmacroname attrlist {attrstmt(scanner,$1,$2);}
+			|  graphattrdefs {attrstmt(scanner,T_graph,NULL);}
 			;
 
 attrtype :	T_graph {$$ = T_graph;}
@@ -188,13 +204,13 @@ optattrdefs	: optattrdefs attrdefs
 attrdefs	:  attrassignment optseparator
 			;
 
-attrassignment	:  atom '=' atom {appendattr($1,$3);}
+attrassignment	:  atom '=' atom {appendattr(scanner,$1,$3);}
 			;
 
 graphattrdefs : attrassignment
 			;
 
-subgraph	:  optsubghdr {opensubg($1);} body {closesubg();}
+subgraph	:  optsubghdr {opensubg(scanner,$1);} body {closesubg(scanner);}
 			;
 
 optsubghdr	: T_subgraph atom {$$=$2;}
@@ -209,7 +225,7 @@ atom	:  T_atom {$$ = $1;}
 			;
 
 qatom	:  T_qatom {$$ = $1;}
-			|  qatom '+' T_qatom {$$ = concat($1,$3);}
+			|  qatom '+' T_qatom {$$ = concat(scanner,$1,$3);}
 			;
 %%
 
@@ -249,21 +265,21 @@ static gstack_t *pop(gstack_t *s)
 	return rv;
 }
 
-static void delete_items(item *ilist)
+static void delete_items(aagextra_t *ctx, item *ilist)
 {
 	item	*p,*pn;
 
 	for (p = ilist; p; p = pn) {
 		pn = p->next;
-		if (p->tag == T_list) delete_items(p->u.list);
-		if (p->tag == T_atom) agstrfree(G,p->str);
+		if (p->tag == T_list) delete_items(ctx, p->u.list);
+		if (p->tag == T_atom) agstrfree(ctx->G,p->str);
 		free(p);
 	}
 }
 
-static void deletelist(list_t *list)
+static void deletelist(aagextra_t *ctx, list_t *list)
 {
-	delete_items(list->first);
+	delete_items(ctx, list->first);
 	list->first = list->last = NULL;
 }
 
@@ -276,17 +292,19 @@ static void listapp(list_t *list, item *v)
 
 
 /* attrs */
-static void appendattr(char *name, char *value)
+static void appendattr(aagscan_t scanner, char *name, char *value)
 {
+	aagextra_t *ctx = aagget_extra(scanner);
 	item		*v;
 
 	assert(value != NULL);
 	v = cons_attr(name,value);
-	listapp(&S->attrlist, v);
+	listapp(&ctx->S->attrlist, v);
 }
 
-static void bindattrs(int kind)
+static void bindattrs(aagextra_t *ctx, int kind)
 {
+	gstack_t	*S = ctx->S;
 	item		*aptr;
 	char		*name;
 
@@ -297,16 +315,16 @@ static void bindattrs(int kind)
 		if ((aptr->u.asym = agattr(S->g,kind,name,NULL)) == NULL)
 			aptr->u.asym = agattr(S->g,kind,name,"");
 		aptr->tag = T_attr;				/* signifies bound attr */
-		agstrfree(G,name);
+		agstrfree(ctx->G,name);
 	}
 }
 
 /* attach node/edge specific attributes */
-static void applyattrs(void *obj)
+static void applyattrs(aagextra_t *ctx, void *obj)
 {
 	item		*aptr;
 
-	for (aptr = S->attrlist.first; aptr; aptr = aptr->next) {
+	for (aptr = ctx->S->attrlist.first; aptr; aptr = aptr->next) {
 		if (aptr->tag == T_attr) {
 			if (aptr->u.asym) {
 				agxset(obj,aptr->u.asym,aptr->str);
@@ -329,8 +347,10 @@ static void nomacros(void)
  * First argument is always attrtype, so switch covers all cases.
  * This function is used to handle default attribute value assignment.
  */
-static void attrstmt(int tkind, char *macroname)
+static void attrstmt(aagscan_t scanner, int tkind, char *macroname)
 {
+	aagextra_t *ctx = aagget_extra(scanner);
+	gstack_t		*S = ctx->S;
 	item			*aptr;
 	int				kind = 0;
 	Agsym_t*  sym;
@@ -347,32 +367,33 @@ static void attrstmt(int tkind, char *macroname)
 		case T_edge: kind = AGEDGE; break;
 		default: UNREACHABLE();
 	}
-	bindattrs(kind);	/* set up defaults for new attributes */
+	bindattrs(ctx, kind);	/* set up defaults for new attributes */
 	for (aptr = S->attrlist.first; aptr; aptr = aptr->next) {
 		/* If the tag is still T_atom, aptr->u.asym has not been set */
 		if (aptr->tag == T_atom) continue;
-		if (!aptr->u.asym->fixed || S->g != G)
+		if (!aptr->u.asym->fixed || S->g != ctx->G)
 			sym = agattr(S->g,kind,aptr->u.asym->name,aptr->str);
 		else
 			sym = aptr->u.asym;
-		if (S->g == G)
+		if (S->g == ctx->G)
 			sym->print = true;
 	}
-	deletelist(&S->attrlist);
+	deletelist(ctx, &S->attrlist);
 }
 
 /* nodes */
 
-static void appendnode(char *name, char *port, char *sport)
+static void appendnode(aagscan_t scanner, char *name, char *port, char *sport)
 {
+	aagextra_t *ctx = aagget_extra(scanner);
 	item		*elt;
 
 	if (sport) {
-		port = concatPort (port, sport);
+		port = concatPort(ctx, port, sport);
 	}
-	elt = cons_node(agnode(S->g, name, 1), port);
-	listapp(&S->nodelist, elt);
-	agstrfree(G,name);
+	elt = cons_node(agnode(ctx->S->g, name, 1), port);
+	listapp(&ctx->S->nodelist, elt);
+	agstrfree(ctx->G,name);
 }
 
 /* apply current optional attrs to nodelist and clean up lists */
@@ -380,23 +401,26 @@ static void appendnode(char *name, char *port, char *sport)
 clean up S->subg in closesubg() because S->subg might be needed
 to construct edges.  these are the sort of notes you write to yourself
 in the future. */
-static void endnode(void)
+static void endnode(aagscan_t scanner)
 {
+	aagextra_t *ctx = aagget_extra(scanner);
+	gstack_t	*S = ctx->S;
 	item	*ptr;
 
-	bindattrs(AGNODE);
+	bindattrs(ctx, AGNODE);
 	for (ptr = S->nodelist.first; ptr; ptr = ptr->next)
-		applyattrs(ptr->u.n);
-	deletelist(&S->nodelist);
-	deletelist(&S->attrlist);
-	deletelist(&S->edgelist);
+		applyattrs(ctx, ptr->u.n);
+	deletelist(ctx, &S->nodelist);
+	deletelist(ctx, &S->attrlist);
+	deletelist(ctx, &S->edgelist);
 	S->subg = 0;  /* notice a pattern here? :-( */
 }
 
 /* edges - store up node/subg lists until optional edge key can be seen */
 
-static void getedgeitems(void)
+static void getedgeitems(aagscan_t scanner)
 {
+	gstack_t	*S = aagget_extra(scanner)->S;
 	item	*v = 0;
 
 	if (S->nodelist.first) {
@@ -408,15 +432,17 @@ static void getedgeitems(void)
 	if (v) listapp(&S->edgelist, v);
 }
 
-static void endedge(void)
+static void endedge(aagscan_t scanner)
 {
+	aagextra_t *ctx = aagget_extra(scanner);
+	gstack_t		*S = ctx->S;
 	char			*key;
 	item			*aptr,*tptr,*p;
 
 	Agnode_t		*t;
 	Agraph_t		*subg;
 
-	bindattrs(AGEDGE);
+	bindattrs(ctx, AGEDGE);
 
 	/* look for "key" pseudo-attribute */
 	key = NULL;
@@ -430,24 +456,25 @@ static void endedge(void)
 		if (p->tag == T_subgraph) {
 			subg = p->u.subg;
 			for (t = agfstnode(subg); t; t = agnxtnode(subg,t))
-				edgerhs(agsubnode(S->g, t, 0), NULL, p->next, key);
+				edgerhs(ctx, agsubnode(S->g, t, 0), NULL, p->next, key);
 		}
 		else {
 			for (tptr = p->u.list; tptr; tptr = tptr->next)
-				edgerhs(tptr->u.n,tptr->str,p->next,key);
+				edgerhs(ctx, tptr->u.n,tptr->str,p->next,key);
 		}
 	}
-	deletelist(&S->nodelist);
-	deletelist(&S->edgelist);
-	deletelist(&S->attrlist);
+	deletelist(ctx, &S->nodelist);
+	deletelist(ctx, &S->edgelist);
+	deletelist(ctx, &S->attrlist);
 	S->subg = 0;
 }
 
 /* concat:
  */
 static char*
-concat (char* s1, char* s2)
+concat (aagscan_t scanner, char* s1, char* s2)
 {
+  Agraph_t *G = aagget_extra(scanner)->G;
   char*  s;
   char   buf[BUFSIZ];
   char*  sym;
@@ -465,20 +492,20 @@ concat (char* s1, char* s2)
 }
 
 static char*
-concatPort (char* s1, char* s2)
+concatPort (aagextra_t *ctx, char* s1, char* s2)
 {
   agxbuf buf = {0};
 
   agxbprint(&buf, "%s:%s", s1, s2);
-  char *s = agstrdup(G, agxbuse(&buf));
-  agstrfree (G,s1);
-  agstrfree (G,s2);
+  char *s = agstrdup(ctx->G, agxbuse(&buf));
+  agstrfree (ctx->G,s1);
+  agstrfree (ctx->G,s2);
   agxbfree(&buf);
   return s;
 }
 
 
-static void edgerhs(Agnode_t *tail, char *tport, item *hlist, char *key)
+static void edgerhs(aagextra_t *ctx, Agnode_t *tail, char *tport, item *hlist, char *key)
 {
 	Agnode_t		*head;
 	Agraph_t		*subg;
@@ -487,29 +514,29 @@ static void edgerhs(Agnode_t *tail, char *tport, item *hlist, char *key)
 	if (hlist->tag == T_subgraph) {
 		subg = hlist->u.subg;
 		for (head = agfstnode(subg); head; head = agnxtnode(subg,head))
-			newedge(tail, tport, agsubnode(S->g, head, 0), NULL, key);
+			newedge(ctx, tail, tport, agsubnode(ctx->S->g, head, 0), NULL, key);
 	}
 	else {
 		for (hptr = hlist->u.list; hptr; hptr = hptr->next)
-			newedge(tail, tport, agsubnode(S->g, hptr->u.n, 0), hptr->str, key);
+			newedge(ctx, tail, tport, agsubnode(ctx->S->g, hptr->u.n, 0), hptr->str, key);
 	}
 }
 
-static void mkport(Agedge_t *e, char *name, char *val)
+static void mkport(aagextra_t *ctx, Agedge_t *e, char *name, char *val)
 {
 	Agsym_t *attr;
 	if (val) {
-		if ((attr = agattr(S->g,AGEDGE,name,NULL)) == NULL)
-			attr = agattr(S->g,AGEDGE,name,"");
+		if ((attr = agattr(ctx->S->g,AGEDGE,name,NULL)) == NULL)
+			attr = agattr(ctx->S->g,AGEDGE,name,"");
 		agxset(e,attr,val);
 	}
 }
 
-static void newedge(Agnode_t *t, char *tport, Agnode_t *h, char *hport, char *key)
+static void newedge(aagextra_t *ctx, Agnode_t *t, char *tport, Agnode_t *h, char *hport, char *key)
 {
 	Agedge_t 	*e;
 
-	e = agedge(S->g, t, h, key, 1);
+	e = agedge(ctx->S->g, t, h, key, 1);
 	if (e) {		/* can fail if graph is strict and t==h */
 		char    *tp = tport;
 		char    *hp = hport;
@@ -518,74 +545,107 @@ static void newedge(Agnode_t *t, char *tport, Agnode_t *h, char *hport, char *ke
 			char    *temp;
 			temp = tp; tp = hp; hp = temp;
 		}
-		mkport(e,TAILPORT_ID,tp);
-		mkport(e,HEADPORT_ID,hp);
-		applyattrs(e);
+		mkport(ctx,e,TAILPORT_ID,tp);
+		mkport(ctx,e,HEADPORT_ID,hp);
+		applyattrs(ctx, e);
 	}
 }
 
 /* graphs and subgraphs */
 
 
-static void startgraph(char *name, bool directed, bool strict)
+static void startgraph(aagscan_t scanner, char *name, bool directed, bool strict)
 {
-	if (G == NULL) {
-		SubgraphDepth = 0;
+	aagextra_t *ctx = aagget_extra(scanner);
+
+	if (ctx->G == NULL) {
+		ctx->SubgraphDepth = 0;
 		Agdesc_t req = {.directed = directed, .strict = strict, .maingraph = true};
-		Ag_G_global = G = agopen(name,req,Disc);
+		Ag_G_global = ctx->G = agopen(name,req,ctx->Disc);
 	}
 	else {
-		Ag_G_global = G;
+		Ag_G_global = ctx->G;
 	}
-	S = push(S,G);
+	ctx->S = push(ctx->S,ctx->G);
 	agstrfree(NULL,name);
 }
 
-static void endgraph(void)
+static void endgraph(aagscan_t scanner)
 {
-	aglexeof();
-	aginternalmapclearlocalnames(G);
+	aglexeof(scanner);
+	aginternalmapclearlocalnames(aagget_extra(scanner)->G);
 }
 
-static void opensubg(char *name)
+static void opensubg(aagscan_t scanner, char *name)
 {
-  if (++SubgraphDepth >= YYMAXDEPTH/2) {
+  aagextra_t *ctx = aagget_extra(scanner);
+
+  if (++ctx->SubgraphDepth >= YYMAXDEPTH/2) {
     agerrorf("subgraphs nested more than %d deep", YYMAXDEPTH);
   }
-	S = push(S, agsubg(S->g, name, 1));
-	agstrfree(G,name);
+	ctx->S = push(ctx->S, agsubg(ctx->S->g, name, 1));
+	agstrfree(ctx->G,name);
 }
 
-static void closesubg(void)
+static void closesubg(aagscan_t scanner)
 {
-	Agraph_t *subg = S->g;
-  --SubgraphDepth;
-	S = pop(S);
-	S->subg = subg;
+	aagextra_t *ctx = aagget_extra(scanner);
+	Agraph_t *subg = ctx->S->g;
+  --ctx->SubgraphDepth;
+	ctx->S = pop(ctx->S);
+	ctx->S->subg = subg;
 	assert(subg);
 }
 
-static void freestack(void)
+static void freestack(aagscan_t scanner)
 {
-	while (S) {
-		deletelist(&S->nodelist);
-		deletelist(&S->attrlist);
-		deletelist(&S->edgelist);
-		S = pop(S);
+	aagextra_t *ctx = aagget_extra(scanner);
+
+	while (ctx->S) {
+		deletelist(ctx, &ctx->S->nodelist);
+		deletelist(ctx, &ctx->S->attrlist);
+		deletelist(ctx, &ctx->S->edgelist);
+		ctx->S = pop(ctx->S);
 	}
 }
 
-extern FILE *aagin;
+/* Line numbers continue across the graphs read from one input, until
+ * agsetfile names the next. Everything else a parse needs lives in the scanner
+ * created for it, so threads can parse concurrently.
+ */
+static TLS const char *InputFile;
+static TLS int LineNum = 1;
+
+  /* (Re)set file:
+   */
+void agsetfile(const char* f)
+{
+	InputFile = f;
+	LineNum = 1;
+}
+
+/* The scanner is dropped once the graph is read, so any input flex read past
+ * its end, such as the rest of its last line, is not seen by the next call.
+ * Its lines are still counted.
+ */
 Agraph_t *agconcat(Agraph_t *g, void *chan, Agdisc_t *disc)
 {
-	aagin = chan;
-	G = g;
+	aagextra_t ctx = {.Disc = disc ? disc : &AgDefaultDisc, .Ifile = chan,
+	                  .G = g, .line_num = LineNum, .InputFile = InputFile};
+	aagscan_t scanner;
+
+	if (aaglex_init_extra(&ctx, &scanner)) {
+		agerrorf("failed to create scanner");
+		return NULL;
+	}
 	Ag_G_global = NULL;
-	Disc = (disc? disc :  &AgDefaultDisc);
-	aglexinit(Disc, chan);
-	aagparse();
-	if (Ag_G_global == NULL) aglexbad();
-	return Ag_G_global;
+	aagparse(scanner);
+	Agraph_t *const rv = Ag_G_global;
+	LineNum = ctx.line_num + aaglex_unscanned_lines(scanner);
+	aaglex_destroy(scanner);
+	agxbfree(&ctx.Sbuf);
+	free(ctx.FileName);
+	return rv;
 }
 
 Agraph_t *agread(void *fp, Agdisc_t *disc) {return agconcat(NULL,fp,disc); }
@@ -21,7 +21,7 @@
 #include <stdlib.h>
 #include <util/alloc.h>
 
-Agraph_t *Ag_G_global;
+TLS Agraph_t *Ag_G_global;
 
 /*
  * this code sets up the resource management discipline
@@ -35,6 +35,9 @@ static Agclos_t *agclos(Agdisc_t * proto)
     rv = gv_calloc(1, sizeof(Agclos_t));
     rv->disc.id = ((proto && proto->id) ? proto->id : &AgIdDisc);
     rv->disc.io = ((proto && proto->io) ? proto->io : &AgIoDisc);
+    rv->disc.arena = proto && proto->arena;
+    if (rv->disc.arena)
+	rv->arena = agarena_new();
     return rv;
 }
 
@@ -96,6 +99,17 @@ Agraph_t *agopen1(Agraph_t * g)
     return g;
 }
 
+/* Can the nodes and edges of root graph g be dropped without deleting them one
+ * by one? Their memory, records and attribute tables all live in the arena and
+ * their strings in the string dictionary, so this is possible unless someone
+ * is to be told about each deletion.
+ */
+static bool close_in_bulk(Agraph_t *g)
+{
+    return g->clos->arena && g->clos->cb == NULL &&
+	   AGDISC(g, id) == &AgIdDisc;
+}
+
 /*
  * Close a graph or subgraph, freeing its storage.
  */
@@ -105,21 +119,27 @@ int agclose(Agraph_t * g)
     Agnode_t *n, *next_n;
 
     par = agparent(g);
+    const bool bulk = par == NULL && close_in_bulk(g);
 
     for (subg = agfstsubg(g); subg; subg = next_subg) {
 	next_subg = agnxtsubg(subg);
 	agclose(subg);
     }
+    agthaw(g);
 
-    for (n = agfstnode(g); n; n = next_n) {
-	next_n = agnxtnode(g, n);
-	agdelnode(g, n);
+    if (bulk) {
+	(void)dtextract(g->n_seq);
+    } else {
+	for (n = agfstnode(g); n; n = next_n) {
+	    next_n = agnxtnode(g, n);
+	    agdelnode(g, n);
+	}
     }
 
     aginternalmapclose(g);
     agmethod_delete(g, g);
 
-    assert(node_set_is_empty(g->n_id));
+    assert(bulk || node_set_is_empty(g->n_id));
     node_set_free(&g->n_id);
     assert(dtsize(g->n_seq) == 0);
     if (agdtclose(g, g->n_seq)) return FAILURE;
@@ -147,15 +167,16 @@ int agclose(Agraph_t * g)
 
     if (par) {
 	agdelsubg(par, g);
-	free(g);
+	agobjfree(par, g);
     } else {
-	void *clos;
+	Agclos_t *clos;
 	while (g->clos->cb)
 	    agpopdisc(g, g->clos->cb->f);
 	AGDISC(g, id)->close(AGCLOS(g, id));
 	if (agstrclose(g)) return FAILURE;
 	clos = g->clos;
 	free(g);
+	agarena_free(clos->arena);
 	free(clos);
     }
     return SUCCESS;
@@ -223,9 +244,9 @@ int agcountuniqedges(Agraph_t * g, Agnode_t * n, int want_in, int want_out)
     int rv = 0;
 
     sn = agsubrep(g, n);
-    if (want_out) rv = cnt(g->e_seq,&(sn->out_seq));
+    if (want_out) rv = g->adj ? sn->out_deg : cnt(g->e_seq,&(sn->out_seq));
     if (want_in) {
-		if (!want_out) rv += cnt(g->e_seq,&(sn->in_seq));	/* cheap */
+		if (!want_out) rv += g->adj ? sn->in_deg : cnt(g->e_seq,&(sn->in_seq));	/* cheap */
 		else {	/* less cheap */
 			for (e = agfstin(g, n); e; e = agnxtin(g, e))
 				if (e->node != n) rv++;  /* don't double count loops */
@@ -240,7 +261,10 @@ int agdegree(Agraph_t * g, Agnode_t * n, int want_in, int want_out)
     int rv = 0;
 
     sn = agsubrep(g, n);
-    if (sn) {
+    if (sn && g->adj) {
+	if (want_out) rv += sn->out_deg;
+	if (want_in) rv += sn->in_deg;
+    } else if (sn) {
 	if (want_out) rv += cnt(g->e_seq,&(sn->out_seq));
 	if (want_in) rv += cnt(g->e_seq,&(sn->in_seq));
     }
@@ -286,7 +310,7 @@ Agdesc_t Agstrictdirected = {.directed = true, .strict = true, .maingraph = true
 Agdesc_t Agundirected = {.maingraph = true};
 Agdesc_t Agstrictundirected = {.strict = true, .maingraph = true};
 
-Agdisc_t AgDefaultDisc = { &AgIdDisc, &AgIoDisc };
+Agdisc_t AgDefaultDisc = {.id = &AgIdDisc, .io = &AgIoDisc};
 
 /**
  * @dir lib/cgraph
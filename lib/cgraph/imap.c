@@ -130,7 +130,9 @@ static IMapEntry_t *find_isym(Agraph_t * g, int objtype, IDTYPE id)
 	objtype = AGEDGE;
     if ((d = g->clos->lookup_by_id[objtype])) {
 	itemplate.id = id;
+	agreadlock(g);
 	isym = dtsearch(d, &itemplate);
+	agreadunlock(g);
     } else
 	isym = NULL;
     return isym;
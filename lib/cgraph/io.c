@@ -68,22 +68,18 @@ memiofread(void *chan, char *buf, int bufsize)
     return l;
 }
 
-static Agiodisc_t memIoDisc = {memiofread, 0, 0};
+static Agiodisc_t memIoDisc = {memiofread, ioputstr, ioflush};
 
 static Agraph_t *agmemread0(Agraph_t *arg_g, const char *cp)
 {
     Agraph_t* g;
     rdr_t rdr;
-    Agdisc_t disc;
+    Agdisc_t disc = {.id = &AgIdDisc, .io = &memIoDisc};
 
-    memIoDisc.putstr = AgIoDisc.putstr;
-    memIoDisc.flush = AgIoDisc.flush;
     rdr.data = cp;
     rdr.len = strlen(cp);
     rdr.cur = 0;
 
-    disc.id = &AgIdDisc;
-    disc.io = &memIoDisc;  
     if (arg_g) g = agconcat(arg_g, &rdr, &disc);
     else g = agread (&rdr, &disc);
     /* Null out filename and reset line number 
@@ -40,7 +40,10 @@ static Agnode_t *agfindnode_by_name(Agraph_t * g, char *name)
 Agnode_t *agfstnode(Agraph_t * g)
 {
     Agsubnode_t *sn;
-    sn = dtfirst(g->n_seq);
+    if (g->adj)
+	sn = g->adj->first;
+    else
+	sn = dtfirst(g->n_seq);
     return sn ? sn->node : NULL;
 }
 
@@ -48,14 +51,18 @@ Agnode_t *agnxtnode(Agraph_t * g, Agnode_t * n)
 {
     Agsubnode_t *sn;
     sn = agsubrep(g, n);
-    if (sn) sn = dtnext(g->n_seq, sn);
+    if (sn && g->adj) sn = sn->seq_next;
+    else if (sn) sn = dtnext(g->n_seq, sn);
     return sn ? sn->node : NULL;
 }
 
 Agnode_t *aglstnode(Agraph_t * g)
 {
     Agsubnode_t *sn;
-    sn = dtlast(g->n_seq);
+    if (g->adj)
+	sn = g->adj->last;
+    else
+	sn = dtlast(g->n_seq);
     return sn ? sn->node : NULL;
 }
 
@@ -63,7 +70,8 @@ Agnode_t *agprvnode(Agraph_t * g, Agnode_t * n)
 {
     Agsubnode_t *sn;
     sn = agsubrep(g, n);
-    if (sn) sn = dtprev(g->n_seq, sn);
+    if (sn && g->adj) sn = sn->seq_prev;
+    else if (sn) sn = dtprev(g->n_seq, sn);
     return sn ? sn->node : NULL;
 }
 
@@ -73,7 +81,7 @@ static Agnode_t *newnode(Agraph_t * g, IDTYPE id, uint64_t seq)
 {
     assert((seq & SEQ_MASK) == seq && "sequence ID overflow");
 
-    Agnode_t *n = gv_alloc(sizeof(Agnode_t));
+    Agnode_t *n = agobjalloc(g, sizeof(Agnode_t));
     AGTYPE(n) = AGNODE;
     AGID(n) = id;
     AGSEQ(n) = seq & SEQ_MASK;
@@ -94,8 +102,9 @@ static void installnode(Agraph_t * g, Agnode_t * n)
 
     assert(node_set_size(g->n_id) == (size_t)dtsize(g->n_seq));
     osize = node_set_size(g->n_id);
+    agthaw(g);
     if (g == agroot(g)) sn = &(n->mainsub);
-    else sn = gv_alloc(sizeof(Agsubnode_t));
+    else sn = agobjalloc(g, sizeof(Agsubnode_t));
     sn->node = n;
     node_set_add(g->n_id, sn);
     dtinsert(g->n_seq, sn);
@@ -185,6 +194,7 @@ void agdelnodeimage(Agraph_t * g, Agnode_t * n, void *ignored)
 	f = agnxtedge(g, e, n);
 	agdeledgeimage(g, e, 0);
     }
+    agthaw(g);
     /* If the following lines are switched, switch the discpline using
      * free_subnode below.
      */ 
@@ -211,7 +221,7 @@ int agdelnode(Agraph_t * g, Agnode_t * n)
     }
     if (agapply(g, (Agobj_t *)n, (agobjfn_t)agdelnodeimage, NULL, false) == SUCCESS) {
 	if (g == agroot(g))
-	    free(n);
+	    agobjfree(g, n);
 	return SUCCESS;
     } else
 	return FAILURE;
@@ -305,7 +315,7 @@ static int agsubnodeseqcmpf(void *arg0, void *arg1) {
 static void free_subnode(void *subnode) {
    Agsubnode_t *sn = subnode;
    if (!AGSNMAIN(sn)) 
-	free(sn);
+	agobjfree(sn->node->root, sn);
 }
 
 Dtdisc_t Ag_subnode_seq_disc = {
@@ -324,6 +334,7 @@ static void agnodesetfinger(Agraph_t * g, Agnode_t * n, void *ignored)
 
 static void agnoderenew(Agraph_t * g, Agnode_t * n, void *ignored)
 {
+    agthaw(g); // edges are ordered by node sequence, which is changing
     dtrenew(g->n_seq, dtfinger(g->n_seq));
     (void)n;
     (void)ignored;
@@ -15,117 +15,335 @@
 
 #include <cgraph/cghdr.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <util/alloc.h>
+#include <util/exit.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 /*
  * reference counted strings.
+ *
+ * Each graph interns its strings in an open addressing hash table with linear
+ * probing, whose slots hold the hash of the string they point to so probing
+ * rarely touches the strings themselves. Short strings are packed one after
+ * another into chunks. The space of a released string goes on a free list of
+ * its size, to be reused by the next string of that size, so the chunks of a
+ * table hold at most as many strings of each size as were ever in use at once.
+ * Chunks are released with the table. Longer strings are allocated and freed
+ * one by one.
  */
 
-typedef struct {
-    Dtlink_t link;
-    uint64_t refcnt: sizeof(uint64_t) * 8 - 1;
+typedef struct refstr_s {
+    struct refstr_s *next;	/* next free string of the same size */
+    uint64_t refcnt: sizeof(uint64_t) * 8 - 2;
     uint64_t is_html: 1;
-    char *s;
+    uint64_t is_big: 1;		/* allocated on its own, not in a chunk */
     char store[1];		/* this is actually a dynamic array */
 } refstr_t;
 
-static Dtdisc_t Refstrdisc = {
-    offsetof(refstr_t, s),	/* key */
-    -1,				/* size */
-    0,				/* link offset */
-    NULL,
-    free,
-    NULL,
+typedef struct chunk_s {
+    struct chunk_s *next;
+    size_t used, size;		/* bytes of data used and available */
+    uint64_t data[];		/* refstr_t members are no more aligned */
+} chunk_t;
+
+enum {
+    ALIGN = sizeof(uint64_t),	/* granularity of space in chunks */
+    MAX_PACKED = 256,		/* size of the largest string kept in chunks */
+    MIN_CHUNK = 1 << 10,	/* data size of a table's first chunk */
+    MAX_CHUNK = 1 << 16,	/* data size chunks grow to */
+    MIN_SLOTS = 16,
 };
 
-static Dict_t *Refdict_default;
+typedef struct {
+    uint64_t hash;
+    refstr_t *r;		/* NULL if free */
+} slot_t;
+
+struct agstrdict_s {
+    slot_t *slots;
+    size_t capacity;		/* number of slots, a power of 2 */
+    size_t size;		/* slots in use, at most half of them */
+    chunk_t *chunks;		/* the chunk being filled, first in the list */
+    size_t chunk_size;		/* size of the next chunk */
+    refstr_t *recycled[MAX_PACKED / ALIGN + 1]; /* free space, by size */
+};
+
+typedef struct agstrdict_s strdict_t;
+
+/* strings not owned by any graph, such as names seen by the parser before the
+ * graph they belong to exists, are shared by all threads, as a string may be
+ * released by another thread than the one that created it. Every use of this
+ * dictionary is serialized by a lock.
+ */
+static strdict_t *Refdict_default;
+#ifdef _WIN32
+static SRWLOCK Refdict_lock = SRWLOCK_INIT;
+#else
+static pthread_mutex_t Refdict_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* refdict_lock:
+ * Take the lock of the dictionary of strings of no graph, if g is NULL.
+ */
+static void refdict_lock(Agraph_t *g)
+{
+    if (g)
+	return;
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&Refdict_lock);
+#else
+    pthread_mutex_lock(&Refdict_lock);
+#endif
+}
+
+static void refdict_unlock(Agraph_t *g)
+{
+    if (g)
+	return;
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&Refdict_lock);
+#else
+    pthread_mutex_unlock(&Refdict_lock);
+#endif
+}
 
 /* refdict:
  * Return the string dictionary associated with g.
- * If necessary, create it.
- * As a side-effect, set html masks. This assumes 8-bit bytes.
+ * If necessary, create it. For g NULL, the caller holds refdict_lock(g).
  */
-static Dict_t *refdict(Agraph_t * g)
+static strdict_t *refdict(Agraph_t * g)
 {
-    Dict_t **dictref;
+    strdict_t **dictref;
 
     if (g)
 	dictref = &(g->clos->strdict);
     else
 	dictref = &Refdict_default;
     if (*dictref == NULL) {
-	*dictref = agdtopen(g, &Refstrdisc, Dttree);
+	strdict_t *d = gv_alloc(sizeof(strdict_t));
+	d->capacity = MIN_SLOTS;
+	d->slots = gv_calloc(d->capacity, sizeof(slot_t));
+	d->chunk_size = MIN_CHUNK;
+	*dictref = d;
     }
     return *dictref;
 }
 
 int agstrclose(Agraph_t * g)
 {
-    return agdtclose(g, refdict(g));
+    refdict_lock(g);
+    strdict_t *d = refdict(g);
+    for (size_t i = 0; i < d->capacity; i++) {
+	if (d->slots[i].r && d->slots[i].r->is_big)
+	    free(d->slots[i].r);
+    }
+    for (chunk_t *c = d->chunks, *next; c; c = next) {
+	next = c->next;
+	free(c);
+    }
+    free(d->slots);
+    free(d);
+    if (g)
+	g->clos->strdict = NULL;
+    else
+	Refdict_default = NULL;
+    refdict_unlock(g);
+    return 0;
 }
 
-static refstr_t *refsymbind(Dict_t * strdict, const char *s)
+/* hash a string, also finding its length */
+static uint64_t strhash(const char *s, size_t *len)
 {
-    refstr_t key, *r;
-// Suppress Clang/GCC -Wcast-qual warning. Casting away const here is acceptable
-// as dtsearch does not modify its input key.
-#ifdef __GNUC__
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wcast-qual"
-#endif
-    key.s = (char*)s;
-#ifdef __GNUC__
-#pragma GCC diagnostic pop
-#endif
-    r = dtsearch(strdict, &key);
-    return r;
+    const size_t n = strlen(s);
+    uint64_t h = n * 0x9e3779b97f4a7c15ull;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+	uint64_t w;
+	memcpy(&w, s + i, sizeof(w));
+	h = (h ^ w) * 0xff51afd7ed558ccdull;
+	h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, s + i, n - i);
+    h = (h ^ tail) * 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 29;
+    *len = n;
+    return h;
+}
+
+/* index of the slot holding s, or of the free slot where it would go */
+static size_t lookup(const strdict_t *d, const char *s, uint64_t hash)
+{
+    const size_t mask = d->capacity - 1;
+    size_t i = (size_t)hash & mask;
+    for (; d->slots[i].r; i = (i + 1) & mask) {
+	const slot_t *slot = &d->slots[i];
+	if (slot->hash == hash && (slot->r->store == s ||
+	                           strcmp(slot->r->store, s) == 0))
+	    break;
+    }
+    return i;
+}
+
+static void grow(strdict_t *d)
+{
+    slot_t *old = d->slots;
+    const size_t old_capacity = d->capacity;
+    d->capacity *= 2;
+    d->slots = gv_calloc(d->capacity, sizeof(slot_t));
+    const size_t mask = d->capacity - 1;
+    for (size_t i = 0; i < old_capacity; i++) {
+	if (old[i].r) {
+	    size_t j = (size_t)old[i].hash & mask;
+	    while (d->slots[j].r)
+		j = (j + 1) & mask;
+	    d->slots[j] = old[i];
+	}
+    }
+    free(old);
+}
+
+/* empty slot i, moving later slots of its cluster back to fill the hole */
+static void vacate(strdict_t *d, size_t i)
+{
+    const size_t mask = d->capacity - 1;
+    for (size_t j = (i + 1) & mask; d->slots[j].r; j = (j + 1) & mask) {
+	const size_t home = (size_t)d->slots[j].hash & mask;
+	/* can the entry at j move to i, not before its home slot? */
+	if (((j - home) & mask) >= ((j - i) & mask)) {
+	    d->slots[i] = d->slots[j];
+	    i = j;
+	}
+    }
+    d->slots[i].r = NULL;
+    d->size--;
 }
 
-static char *refstrbind(Dict_t * strdict, const char *s)
+/* space a string of length len takes up, header included */
+static size_t blocksize(size_t len)
 {
+    return (offsetof(refstr_t, store) + len + 1 + ALIGN - 1) / ALIGN * ALIGN;
+}
+
+/* find space for a string of length len: reuse that of a released string of
+ * the same size, or else carve it out of the current chunk
+ */
+static refstr_t *stralloc(strdict_t *d, size_t len)
+{
+    const size_t need = blocksize(len);
     refstr_t *r;
-    r = refsymbind(strdict, s);
-    if (r)
-	return r->s;
-    else
-	return NULL;
+    if (need > MAX_PACKED) {
+	if ((r = malloc(need)) == NULL)
+	    return NULL;
+	r->is_big = 1;
+	return r;
+    }
+    if ((r = d->recycled[need / ALIGN])) {
+	d->recycled[need / ALIGN] = r->next;
+	r->is_big = 0;
+	return r;
+    }
+    chunk_t *c = d->chunks;
+    if (c == NULL || c->size - c->used < need) {
+	c = malloc(sizeof(chunk_t) + d->chunk_size);
+	if (c == NULL)
+	    return NULL;
+	/* what is left of the previous chunk is free space too */
+	if (d->chunks) {
+	    chunk_t *prev = d->chunks;
+	    const size_t rest = prev->size - prev->used;
+	    if (rest >= blocksize(0)) {
+		refstr_t *tail = (refstr_t *)((char *)prev->data + prev->used);
+		tail->next = d->recycled[rest / ALIGN];
+		d->recycled[rest / ALIGN] = tail;
+	    }
+	    prev->used = prev->size;
+	}
+	c->used = 0;
+	c->size = d->chunk_size;
+	c->next = d->chunks;
+	d->chunks = c;
+	if (d->chunk_size < MAX_CHUNK)
+	    d->chunk_size *= 2;
+    }
+    r = (refstr_t *)((char *)c->data + c->used);
+    c->used += need;
+    r->is_big = 0;
+    return r;
+}
+
+/* give back the space of a string of length len */
+static void strrelease(strdict_t *d, refstr_t *r, size_t len)
+{
+    if (r->is_big) {
+	free(r);
+	return;
+    }
+    const size_t size = blocksize(len);
+    r->next = d->recycled[size / ALIGN];
+    d->recycled[size / ALIGN] = r;
 }
 
 char *agstrbind(Agraph_t * g, const char *s)
 {
-    return refstrbind(refdict(g), s);
+    refdict_lock(g);
+    strdict_t *d = refdict(g);
+    size_t len;
+    const size_t i = lookup(d, s, strhash(s, &len));
+    char *rv = d->slots[i].r ? d->slots[i].r->store : NULL;
+    refdict_unlock(g);
+    return rv;
 }
 
-static char *agstrdup_internal(Agraph_t *g, const char *s, bool is_html) {
-    refstr_t *r;
-    Dict_t *strdict;
-    size_t sz;
+static char *strdup_locked(Agraph_t *g, const char *s, bool is_html) {
+    strdict_t *d = refdict(g);
+    size_t len;
+    const uint64_t hash = strhash(s, &len);
+    size_t i = lookup(d, s, hash);
+    refstr_t *r = d->slots[i].r;
+    if (r) {
+	r->refcnt++;
+	return r->store;
+    }
 
+    if ((r = stralloc(d, len)) == NULL) {
+	/* strings of no graph have always been allowed to fail */
+	if (g == NULL)
+	    return NULL;
+	fprintf(stderr, "out of memory\n");
+	graphviz_exit(EXIT_FAILURE);
+    }
+    r->refcnt = 1;
+    r->is_html = is_html;
+    memcpy(r->store, s, len + 1);
+    if (2 * (d->size + 1) > d->capacity) {
+	grow(d);
+	i = lookup(d, s, hash);
+    }
+    d->slots[i].hash = hash;
+    d->slots[i].r = r;
+    d->size++;
+    return r->store;
+}
+
+static char *agstrdup_internal(Agraph_t *g, const char *s, bool is_html) {
     if (s == NULL)
 	 return NULL;
-    strdict = refdict(g);
-    r = refsymbind(strdict, s);
-    if (r)
-	r->refcnt++;
-    else {
-	sz = sizeof(refstr_t) + strlen(s);
-	if (g)
-	    r = gv_calloc(sz, sizeof(char));
-	else {
-	    r = malloc(sz);
-	    if (sz > 0 && r == NULL) {
-	        return NULL;
-	    }
-	}
-	r->refcnt = 1;
-	r->is_html = is_html;
-	strcpy(r->store, s);
-	r->s = r->store;
-	dtinsert(strdict, r);
-    }
-    return r->s;
+    refdict_lock(g);
+    char *rv = strdup_locked(g, s, is_html);
+    refdict_unlock(g);
+    return rv;
 }
 
 char *agstrdup(Agraph_t *g, const char *s) {
@@ -138,23 +356,27 @@ char *agstrdup_html(Agraph_t *g, const char *s) {
 
 int agstrfree(Agraph_t * g, const char *s)
 {
-    refstr_t *r;
-    Dict_t *strdict;
-
     if (s == NULL)
 	 return FAILURE;
 
-    strdict = refdict(g);
-    r = refsymbind(strdict, s);
-    if (r && r->s == s) {
-	r->refcnt--;
-	if (r->refcnt == 0) {
-	    agdtdelete(g, strdict, r);
+    refdict_lock(g);
+    strdict_t *d = refdict(g);
+    size_t len;
+    const size_t i = lookup(d, s, strhash(s, &len));
+    refstr_t *r = d->slots[i].r;
+    int rv = FAILURE;
+    if (r) {
+	if (r->store == s) {
+	    r->refcnt--;
+	    if (r->refcnt == 0) {
+		vacate(d, i);
+		strrelease(d, r, len);
+	    }
 	}
+	rv = SUCCESS;
     }
-    if (r == NULL)
-	return FAILURE;
-    return SUCCESS;
+    refdict_unlock(g);
+    return rv;
 }
 
 /* aghtmlstr:
@@ -182,15 +404,14 @@ void agmarkhtmlstr(char *s)
 }
 
 #ifdef DEBUG
-static int refstrprint(void *ptr, void *user) {
-    refstr_t *r = ptr;
-    (void)user;
-    fprintf(stderr, "%s\n", r->s);
-    return 0;
-}
-
 void agrefstrdump(Agraph_t * g)
 {
-    dtwalk(refdict(g), refstrprint, 0);
+    refdict_lock(g);
+    const strdict_t *d = refdict(g);
+    for (size_t i = 0; i < d->capacity; i++) {
+	if (d->slots[i].r)
+	    fprintf(stderr, "%s\n", d->slots[i].r->store);
+    }
+    refdict_unlock(g);
 }
 #endif
@@ -36,7 +36,7 @@ static Agraph_t *localsubg(Agraph_t * g, IDTYPE id)
     if (subg)
 	return subg;
 
-    subg = gv_alloc(sizeof(Agraph_t));
+    subg = agobjalloc(g, sizeof(Agraph_t));
     subg->clos = g->clos;
     subg->desc = g->desc;
     subg->desc.maingraph = false;
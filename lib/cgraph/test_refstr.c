@@ -0,0 +1,121 @@
+// basic unit tester for refstr.c
+
+#ifdef NDEBUG
+#error this is not intended to be compiled with assertions off
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// include the implementation itself, to reach its internals
+#include "refstr.c"
+
+enum { WINDOW = 2000, PINNED = 256, STEPS = 400000 };
+
+// bytes held in the chunks of the dictionary of strings of no graph
+static size_t chunk_bytes(void) {
+  size_t total = 0;
+  for (const chunk_t *c = Refdict_default->chunks; c; c = c->next) {
+    total += c->size;
+  }
+  return total;
+}
+
+// bytes a string takes up in a chunk, or 0 if it is allocated on its own
+static size_t packed_size(const char *s) {
+  const size_t size = blocksize(strlen(s));
+  return size > MAX_PACKED ? 0 : size;
+}
+
+// a new string, of a length between 0 and somewhat over MAX_PACKED
+static char *make(size_t serial) {
+  const size_t len = (size_t)rand() % (MAX_PACKED + 64);
+  char *s = malloc(len + 1);
+  assert(s != NULL);
+  const int prefix = snprintf(s, len + 1, "%zu", serial);
+  for (size_t i = prefix > 0 ? (size_t)prefix : 0; i < len; i++) {
+    s[i] = 'a' + (char)(i % 26);
+  }
+  s[len] = '\0';
+  return s;
+}
+
+// strings should come and go many times without their dictionary growing
+// beyond a small multiple of the most it held at once, even when some strings
+// live much longer than others and pin the space around them
+static void test_churn(void) {
+  char *live[WINDOW] = {0};
+  char *pinned[PINNED] = {0};
+  size_t live_bytes = 0, peak = 0;
+
+  for (size_t step = 0; step < STEPS; step++) {
+    char *text = make(step);
+    char *s = agstrdup(NULL, text);
+    assert(s != NULL && strcmp(s, text) == 0);
+    free(text);
+    live_bytes += packed_size(s);
+
+    // every 64th string lives about 64 times as long as the others
+    char **slot = step % 64 == 0 ? &pinned[(step / 64) % PINNED]
+                                 : &live[(size_t)rand() % WINDOW];
+    if (*slot != NULL) {
+      live_bytes -= packed_size(*slot);
+      assert(agstrfree(NULL, *slot) == SUCCESS);
+    }
+    *slot = s;
+
+    if (live_bytes > peak) {
+      peak = live_bytes;
+    }
+  }
+
+  const size_t held = chunk_bytes();
+  fprintf(stderr, "peak of %zu bytes in use, %zu bytes held\n", peak, held);
+  assert(held <= 2 * peak + 2 * MAX_CHUNK);
+
+  for (size_t i = 0; i < WINDOW; i++) {
+    if (live[i] != NULL) {
+      assert(agstrfree(NULL, live[i]) == SUCCESS);
+    }
+  }
+  for (size_t i = 0; i < PINNED; i++) {
+    if (pinned[i] != NULL) {
+      assert(agstrfree(NULL, pinned[i]) == SUCCESS);
+    }
+  }
+  assert(Refdict_default->size == 0);
+  agstrclose(NULL);
+}
+
+// reference counts and HTML marks should survive reuse of space
+static void test_reuse(void) {
+  char *a = agstrdup(NULL, "hello");
+  char *b = agstrdup_html(NULL, "world");
+  assert(agstrdup(NULL, "hello") == a);
+  assert(aghtmlstr(b));
+  assert(!aghtmlstr(a));
+
+  assert(agstrfree(NULL, b) == SUCCESS);
+  assert(agstrbind(NULL, "world") == NULL);
+
+  // a string of the same size should land where the last one was
+  char *c = agstrdup(NULL, "there");
+  assert(c == b);
+  assert(!aghtmlstr(c));
+
+  assert(agstrfree(NULL, a) == SUCCESS);
+  assert(agstrbind(NULL, "hello") == a);
+  assert(agstrfree(NULL, a) == SUCCESS);
+  assert(agstrbind(NULL, "hello") == NULL);
+  assert(agstrfree(NULL, c) == SUCCESS);
+  agstrclose(NULL);
+}
+
+int main(void) {
+  test_reuse();
+  test_churn();
+
+  return EXIT_SUCCESS;
+}
@@ -16,8 +16,6 @@
 #include <cgraph/cghdr.h>
 #include <stdlib.h>
 
-static Agraph_t *Ag_dictop_G;
-
 Dict_t *agdtopen(Agraph_t * g, Dtdisc_t * disc, Dtmethod_t * method)
 {
     return dtopen(disc, method);
@@ -25,17 +23,16 @@ Dict_t *agdtopen(Agraph_t * g, Dtdisc_t * disc, Dtmethod_t * method)
 
 int agdtdelete(Agraph_t * g, Dict_t * dict, void *obj)
 {
-    Ag_dictop_G = g;
+    (void)g; /* unused */
     return dtdelete(dict, obj) != NULL;
 }
 
 int agdtclose(Agraph_t * g, Dict_t * dict)
 {
+    (void)g; /* unused */
     dtdisc(dict, NULL);
-    Ag_dictop_G = g;
     if (dtclose(dict))
 	return 1;
-    Ag_dictop_G = NULL;
     return 0;
 }
 
@@ -24,6 +24,8 @@
 #include <ctype.h>
 #include <cgraph/cghdr.h>
 #include <inttypes.h>
+#include <util/agxbuf.h>
+#include <util/alloc.h>
 #include <util/gv_ctype.h>
 #include <util/strcasecmp.h>
 
@@ -31,29 +33,59 @@
 #define MAX(a,b)     ((a)>(b)?(a):(b))
 #define CHKRV(v)     {if ((v) == EOF) return EOF;}
 
-typedef void iochan_t;
+#define MAX_OUTPUTLINE		128
+#define MIN_OUTPUTLINE		 60
 
-static int ioput(Agraph_t * g, iochan_t * ofile, char *str)
+/// how much output to collect before handing it to the I/O discipline
+enum { OUTPUT_CHUNK = 1 << 16 };
+
+/// state of one call to @ref agwrite
+typedef struct {
+    Agiodisc_t *io;
+    void *ofile;
+    agxbuf out;             ///< output not yet passed to `io->putstr`
+    char *canon;            ///< scratch space for quoting strings
+    size_t canon_size;      ///< allocated bytes of `canon`
+    int level;              ///< indentation
+    int max_outputline;     ///< length to break long strings at, or 0
+    Agsym_t *tailport, *headport;
+} writer_t;
+
+static int write_body(Agraph_t * g, writer_t *w);
+
+/// pass on collected output
+static int flush_out(writer_t *w)
 {
-    return AGDISC(g, io)->putstr(ofile, str);
+    if (agxblen(&w->out) == 0)
+	return 0;
+    return w->io->putstr(w->ofile, agxbuse(&w->out)) == EOF ? EOF : 0;
+}
 
+static int ioput_n(writer_t *w, const char *str, size_t len)
+{
+    agxbput_n(&w->out, str, len);
+    if (agxblen(&w->out) >= OUTPUT_CHUNK)
+	return flush_out(w);
+    return 0;
 }
 
-#define MAX_OUTPUTLINE		128
-#define MIN_OUTPUTLINE		 60
-static int write_body(Agraph_t * g, iochan_t * ofile);
-static int Level;
-static int Max_outputline = MAX_OUTPUTLINE;
-static Agsym_t *Tailport, *Headport;
+static int ioput(writer_t *w, const char *str)
+{
+    return ioput_n(w, str, strlen(str));
+}
 
-static int indent(Agraph_t * g, iochan_t * ofile)
+static int indent(writer_t *w)
 {
-    int i;
-    for (i = Level; i > 0; i--)
-	CHKRV(ioput(g, ofile, "\t"));
+    for (int i = w->level; i > 0; i--)
+	CHKRV(ioput_n(w, "\t", 1));
     return 0;
 }
 
+static const char *tokenlist[]	/* must agree with scan.l */
+    = { "node", "edge", "strict", "graph", "digraph", "subgraph",
+    NULL
+};
+
 // alphanumeric, '.', '-', or non-ascii; basically, chars used in unquoted ids
 static bool is_id_char(char c) {
   return gv_isalnum(c) || c == '.' || c == '-' || !isascii(c);
@@ -96,10 +128,11 @@ static bool is_escape(const char *str) {
   return false;
 }
 
-/* Canonicalize ordinary strings. 
+/* Canonicalize ordinary strings, breaking lines longer than max_outputline
+ * unless it is 0.
  * Assumes buf is large enough to hold output.
  */
-static char *_agstrcanon(char *arg, char *buf)
+static char *_agstrcanon(char *arg, char *buf, int max_outputline)
 {
     char *s, *p;
     char uc;
@@ -108,10 +141,6 @@ static char *_agstrcanon(char *arg, char *buf)
     bool part_of_escape = false;
     bool maybe_num;
     bool backslash_pending = false;
-    static const char *tokenlist[]	/* must agree with scan.l */
-	= { "node", "edge", "strict", "graph", "digraph", "subgraph",
-	NULL
-    };
     const char **tok;
 
     if (EMPTY(arg))
@@ -160,14 +189,14 @@ static char *_agstrcanon(char *arg, char *buf)
 	/* If breaking long strings into multiple lines, only allow breaks after a non-id char, not a backslash, where the next char is an
  	 * id char.
 	 */
-	if (Max_outputline) {
+	if (max_outputline) {
             if (uc && backslash_pending && !(is_id_char(p[-1]) || p[-1] == '\\') && is_id_char(uc)) {
         	*p++ = '\\';
         	*p++ = '\n';
         	needs_quotes = true;
         	backslash_pending = false;
 		cnt = 0;
-            } else if (uc && (cnt >= Max_outputline)) {
+            } else if (uc && (cnt >= max_outputline)) {
         	if (!(is_id_char(p[-1]) || p[-1] == '\\') && is_id_char(uc)) {
 	            *p++ = '\\';
     	            *p++ = '\n';
@@ -211,13 +240,13 @@ char *agstrcanon(char *arg, char *buf)
     if (aghtmlstr(arg))
 	return agcanonhtmlstr(arg, buf);
     else
-	return _agstrcanon(arg, buf);
+	return _agstrcanon(arg, buf, MAX_OUTPUTLINE);
 }
 
 static char *getoutputbuffer(const char *str)
 {
-    static char *rv;
-    static size_t len = 0;
+    static TLS char *rv;
+    static TLS size_t len = 0;
     size_t req;
 
     req = MAX(2 * strlen(str) + 2, BUFSIZ);
@@ -257,22 +286,59 @@ char *agcanon(char *str, int html)
     if (html)
 	return agcanonhtmlstr(str, buf);
     else
-	return _agstrcanon(str, buf);
+	return _agstrcanon(str, buf, MAX_OUTPUTLINE);
 }
 
-static int _write_canonstr(Agraph_t *g, iochan_t *ofile, char *str, bool chk) {
-    if (chk) {
-	str = agcanonStr(str);
-    } else {
-	char *buffer = getoutputbuffer(str);
-	if (buffer == NULL)
-	    return EOF;
-	str = _agstrcanon(str, buffer);
+/// does this string need no quoting or escaping?
+///
+/// This is a quick check for the common case of identifiers and integers,
+/// which @ref _agstrcanon would return unchanged.
+static bool is_plain_id(const char *str)
+{
+    size_t len = 0;
+
+    if (gv_isdigit(*str)) {
+	while (gv_isdigit(str[len]))
+	    len++;
+	return str[len] == '\0';
+    }
+    while (gv_isalnum(str[len]) || str[len] == '_' || !isascii(str[len]))
+	len++;
+    if (len == 0 || str[len] != '\0')
+	return false;
+    if (len >= sizeof("node") - 1 && len <= sizeof("subgraph") - 1) {
+	for (const char **tok = tokenlist; *tok; tok++)
+	    if (!strcasecmp(*tok, str))
+		return false;
+    }
+    return true;
+}
+
+static int write_canon(writer_t *w, char *str, bool html)
+{
+    if (html) {
+	CHKRV(ioput(w, "<"));
+	CHKRV(ioput(w, str));
+	return ioput(w, ">");
+    }
+    if (is_plain_id(str))
+	return ioput(w, str);
+
+    const size_t req = MAX(2 * strlen(str) + 2, BUFSIZ);
+    if (req > w->canon_size) {
+	w->canon = gv_recalloc(w->canon, w->canon_size, req, sizeof(char));
+	w->canon_size = req;
     }
-    return ioput(g, ofile, str);
+    return ioput(w, _agstrcanon(str, w->canon, w->max_outputline));
 }
 
-static int write_canonstr(Agraph_t * g, iochan_t * ofile, char *str)
+/// write a string known to be a reference counted string of the graph
+static int write_refstr(writer_t *w, char *str)
+{
+    return write_canon(w, str, aghtmlstr(str));
+}
+
+static int write_canonstr(Agraph_t * g, writer_t *w, char *str)
 {
     char *s;
 
@@ -281,14 +347,23 @@ static int write_canonstr(Agraph_t * g, iochan_t * ofile, char *str)
      */
     s = agstrdup(g, str);
 
-    int r = _write_canonstr(g, ofile, s, true);
+    int r = write_refstr(w, s);
 
     agstrfree(g, s);
     return r;
 }
 
-static int write_dict(Agraph_t * g, iochan_t * ofile, char *name,
-                      Dict_t * dict, bool top) {
+/// name of an object, if it is known to be a reference counted string
+static char *refstr_name(Agraph_t *g, void *obj)
+{
+    // replicate `idprint`, for which names are the strings of even IDs; the
+    // internal map only names anonymous objects, which get odd IDs
+    if (AGDISC(g, id) != &AgIdDisc || AGID(obj) % 2 != 0)
+	return NULL;
+    return (char *)(uintptr_t)AGID(obj);
+}
+
+static int write_dict(writer_t *w, char *name, Dict_t * dict, bool top) {
     int cnt = 0;
     Dict_t *view;
     Agsym_t *sym, *psym;
@@ -307,42 +382,42 @@ static int write_dict(Agraph_t * g, iochan_t * ofile, char *name,
 		continue;	/* also empty in parent */
 	}
 	if (cnt++ == 0) {
-	    CHKRV(indent(g, ofile));
-	    CHKRV(ioput(g, ofile, name));
-	    CHKRV(ioput(g, ofile, " ["));
-	    Level++;
+	    CHKRV(indent(w));
+	    CHKRV(ioput(w, name));
+	    CHKRV(ioput(w, " ["));
+	    w->level++;
 	} else {
-	    CHKRV(ioput(g, ofile, ",\n"));
-	    CHKRV(indent(g, ofile));
+	    CHKRV(ioput(w, ",\n"));
+	    CHKRV(indent(w));
 	}
-	CHKRV(write_canonstr(g, ofile, sym->name));
-	CHKRV(ioput(g, ofile, "="));
-	CHKRV(write_canonstr(g, ofile, sym->defval));
+	CHKRV(write_refstr(w, sym->name));
+	CHKRV(ioput(w, "="));
+	CHKRV(write_refstr(w, sym->defval));
     }
     if (cnt > 0) {
-	Level--;
+	w->level--;
 	if (cnt > 1) {
-	    CHKRV(ioput(g, ofile, "\n"));
-	    CHKRV(indent(g, ofile));
+	    CHKRV(ioput(w, "\n"));
+	    CHKRV(indent(w));
 	}
-	CHKRV(ioput(g, ofile, "];\n"));
+	CHKRV(ioput(w, "];\n"));
     }
     if (!top)
 	dtview(dict, view);	/* restore previous view */
     return 0;
 }
 
-static int write_dicts(Agraph_t *g, iochan_t *ofile, bool top) {
+static int write_dicts(Agraph_t *g, writer_t *w, bool top) {
     Agdatadict_t *def;
     if ((def = agdatadict(g, false))) {
-	CHKRV(write_dict(g, ofile, "graph", def->dict.g, top));
-	CHKRV(write_dict(g, ofile, "node", def->dict.n, top));
-	CHKRV(write_dict(g, ofile, "edge", def->dict.e, top));
+	CHKRV(write_dict(w, "graph", def->dict.g, top));
+	CHKRV(write_dict(w, "node", def->dict.n, top));
+	CHKRV(write_dict(w, "edge", def->dict.e, top));
     }
     return 0;
 }
 
-static int write_hdr(Agraph_t *g, iochan_t *ofile, bool top) {
+static int write_hdr(Agraph_t *g, writer_t *w, bool top) {
     char *name, *sep, *kind, *strict;
     bool root = false;
     bool hasName = true;
@@ -358,8 +433,8 @@ static int write_hdr(Agraph_t *g, iochan_t *ofile, bool top) {
 	    kind = "";
 	if (agisstrict(g))
 	    strict = "strict ";
-	Tailport = agattr(g, AGEDGE, TAILPORT_ID, NULL);
-	Headport = agattr(g, AGEDGE, HEADPORT_ID, NULL);
+	w->tailport = agattr(g, AGEDGE, TAILPORT_ID, NULL);
+	w->headport = agattr(g, AGEDGE, HEADPORT_ID, NULL);
     }
     name = agnameof(g);
     sep = " ";
@@ -367,30 +442,29 @@ static int write_hdr(Agraph_t *g, iochan_t *ofile, bool top) {
 	sep = name = "";
 	hasName = false;
     }
-    CHKRV(indent(g, ofile));
-    CHKRV(ioput(g, ofile, strict));
+    CHKRV(indent(w));
+    CHKRV(ioput(w, strict));
 
     /* output "<kind>graph" only for root graphs or graphs with names */
     if (root || hasName) {
-	CHKRV(ioput(g, ofile, kind));
-	CHKRV(ioput(g, ofile, "graph "));
+	CHKRV(ioput(w, kind));
+	CHKRV(ioput(w, "graph "));
     }
     if (hasName)
-	CHKRV(write_canonstr(g, ofile, name));
-    CHKRV(ioput(g, ofile, sep));
-    CHKRV(ioput(g, ofile, "{\n"));
-    Level++;
-    CHKRV(write_dicts(g, ofile, top));
+	CHKRV(write_canonstr(g, w, name));
+    CHKRV(ioput(w, sep));
+    CHKRV(ioput(w, "{\n"));
+    w->level++;
+    CHKRV(write_dicts(g, w, top));
     AGATTRWF(g) = true;
     return 0;
 }
 
-static int write_trl(Agraph_t * g, iochan_t * ofile)
+static int write_trl(writer_t *w)
 {
-    (void)g;
-    Level--;
-    CHKRV(indent(g, ofile));
-    CHKRV(ioput(g, ofile, "}\n"));
+    w->level--;
+    CHKRV(indent(w));
+    CHKRV(ioput(w, "}\n"));
     return 0;
 }
 
@@ -486,101 +560,106 @@ static bool not_default_attrs(Agraph_t * g, Agnode_t * n)
     return false;
 }
 
-static int write_subgs(Agraph_t * g, iochan_t * ofile)
+static int write_subgs(Agraph_t * g, writer_t *w)
 {
     Agraph_t *subg;
 
     for (subg = agfstsubg(g); subg; subg = agnxtsubg(subg)) {
 	if (irrelevant_subgraph(subg)) {
-	    write_subgs(subg, ofile);
+	    write_subgs(subg, w);
 	}
 	else {
-	    CHKRV(write_hdr(subg, ofile, false));
-	    CHKRV(write_body(subg, ofile));
-	    CHKRV(write_trl(subg, ofile));
+	    CHKRV(write_hdr(subg, w, false));
+	    CHKRV(write_body(subg, w));
+	    CHKRV(write_trl(w));
 	}
     }
     return 0;
 }
 
-static int write_edge_name(Agedge_t *e, iochan_t *ofile, bool terminate) {
+static int write_edge_name(Agedge_t *e, writer_t *w, bool terminate) {
     char *p;
     Agraph_t *g;
 
-    p = agnameof(e);
     g = agraphof(e);
+    p = refstr_name(g, e);
+    const bool is_refstr = p != NULL;
+    if (!is_refstr)
+	p = agnameof(e);
     if (!EMPTY(p)) {
 	if (!terminate) {
-	    Level++;
+	    w->level++;
+	}
+	CHKRV(ioput(w, "\t[key="));
+	if (is_refstr) {
+	    CHKRV(write_refstr(w, p));
+	} else {
+	    CHKRV(write_canonstr(g, w, p));
 	}
-	CHKRV(ioput(g, ofile, "\t[key="));
-	CHKRV(write_canonstr(g, ofile, p));
 	if (terminate)
-	    CHKRV(ioput(g, ofile, "]"));
+	    CHKRV(ioput(w, "]"));
 	return 1;
     }
     return 0;
 }
 
 
-static int write_nondefault_attrs(void *obj, iochan_t * ofile,
-				  Dict_t * defdict)
+static int write_nondefault_attrs(void *obj, writer_t *w, Dict_t * defdict)
 {
     Agattr_t *data;
     Agsym_t *sym;
-    Agraph_t *g;
     int cnt = 0;
     int rv;
 
     if (AGTYPE(obj) == AGINEDGE || AGTYPE(obj) == AGOUTEDGE) {
-	CHKRV(rv = write_edge_name(obj, ofile, false));
+	CHKRV(rv = write_edge_name(obj, w, false));
 	if (rv)
 	    cnt++;
     }
     data = agattrrec(obj);
-    g = agraphof(obj);
     if (data)
 	for (sym = dtfirst(defdict); sym; sym = dtnext(defdict, sym)) {
 	    if (AGTYPE(obj) == AGINEDGE || AGTYPE(obj) == AGOUTEDGE) {
-		if (Tailport && sym->id == Tailport->id)
+		if (w->tailport && sym->id == w->tailport->id)
 		    continue;
-		if (Headport && sym->id == Headport->id)
+		if (w->headport && sym->id == w->headport->id)
 		    continue;
 	    }
 	    if (data->str[sym->id] != sym->defval) {
 		if (cnt++ == 0) {
-		    CHKRV(ioput(g, ofile, "\t["));
-		    Level++;
+		    CHKRV(ioput(w, "\t["));
+		    w->level++;
 		} else {
-		    CHKRV(ioput(g, ofile, ",\n"));
-		    CHKRV(indent(g, ofile));
+		    CHKRV(ioput(w, ",\n"));
+		    CHKRV(indent(w));
 		}
-		CHKRV(write_canonstr(g, ofile, sym->name));
-		CHKRV(ioput(g, ofile, "="));
-		CHKRV(write_canonstr(g, ofile, data->str[sym->id]));
+		CHKRV(write_refstr(w, sym->name));
+		CHKRV(ioput(w, "="));
+		CHKRV(write_refstr(w, data->str[sym->id]));
 	    }
 	}
     if (cnt > 0) {
-	CHKRV(ioput(g, ofile, "]"));
-	Level--;
+	CHKRV(ioput(w, "]"));
+	w->level--;
     }
     AGATTRWF(obj) = true;
     return 0;
 }
 
-static int write_nodename(Agnode_t * n, iochan_t * ofile)
+static int write_nodename(Agnode_t * n, writer_t *w)
 {
     char *name;
     Agraph_t *g;
 
-    name = agnameof(n);
     g = agraphof(n);
-    if (name) {
-	CHKRV(write_canonstr(g, ofile, name));
+    if ((name = refstr_name(g, n))) {
+	CHKRV(write_refstr(w, name));
+    } else if ((name = agnameof(n))) {
+	CHKRV(write_canonstr(g, w, name));
     } else {
 	char buf[sizeof("__SUSPECT") + 20];
 	snprintf(buf, sizeof(buf), "_%" PRIu64 "_SUSPECT", AGID(n));	/* could be deadly wrong */
-	CHKRV(ioput(g, ofile, buf));
+	CHKRV(ioput(w, buf));
     }
     return 0;
 }
@@ -590,16 +669,13 @@ static int attrs_written(void *obj)
     return AGATTRWF(obj);
 }
 
-static int write_node(Agnode_t * n, iochan_t * ofile, Dict_t * d)
+static int write_node(Agnode_t * n, writer_t *w, Dict_t * d)
 {
-    Agraph_t *g;
-
-    g = agraphof(n);
-    CHKRV(indent(g, ofile));
-    CHKRV(write_nodename(n, ofile));
+    CHKRV(indent(w));
+    CHKRV(write_nodename(n, w));
     if (!attrs_written(n))
-	CHKRV(write_nondefault_attrs(n, ofile, d));
-    return ioput(g, ofile, ";\n");
+	CHKRV(write_nondefault_attrs(n, w, d));
+    return ioput(w, ";\n");
 }
 
 /* node must be written if it wasn't already emitted because of
@@ -616,31 +692,29 @@ static bool write_node_test(Agraph_t * g, Agnode_t * n,
     return false;
 }
 
-static int write_port(Agedge_t * e, iochan_t * ofile, Agsym_t * port)
+static int write_port(Agedge_t * e, writer_t *w, Agsym_t * port)
 {
     char *val;
-    Agraph_t *g;
 
     if (!port)
 	return 0;
-    g = agraphof(e);
     val = agxget(e, port);
     if (val[0] == '\0')
 	return 0;
 
-    CHKRV(ioput(g, ofile, ":"));
+    CHKRV(ioput(w, ":"));
     if (aghtmlstr(val)) {
-	CHKRV(write_canonstr(g, ofile, val));
+	CHKRV(write_canon(w, val, true));
     } else {
 	char *s = strchr(val, ':');
 	if (s) {
 	    *s = '\0';
-	    CHKRV(_write_canonstr(g, ofile, val, false));
-	    CHKRV(ioput(g, ofile, ":"));
-	    CHKRV(_write_canonstr(g, ofile, s + 1, false));
+	    CHKRV(write_canon(w, val, false));
+	    CHKRV(ioput(w, ":"));
+	    CHKRV(write_canon(w, s + 1, false));
 	    *s = ':';
 	} else {
-	    CHKRV(_write_canonstr(g, ofile, val, false));
+	    CHKRV(write_canon(w, val, false));
 	}
     }
     return 0;
@@ -660,47 +734,45 @@ static bool write_edge_test(Agraph_t *g, Agedge_t *e) {
     return true;
 }
 
-static int write_edge(Agedge_t * e, iochan_t * ofile, Dict_t * d)
+static int write_edge(Agedge_t * e, writer_t *w, Dict_t * d)
 {
     Agnode_t *t, *h;
-    Agraph_t *g;
 
     t = AGTAIL(e);
     h = AGHEAD(e);
-    g = agraphof(t);
-    CHKRV(indent(g, ofile));
-    CHKRV(write_nodename(t, ofile));
-    CHKRV(write_port(e, ofile, Tailport));
-    CHKRV(ioput(g, ofile, (agisdirected(agraphof(t)) ? " -> " : " -- ")));
-    CHKRV(write_nodename(h, ofile));
-    CHKRV(write_port(e, ofile, Headport));
+    CHKRV(indent(w));
+    CHKRV(write_nodename(t, w));
+    CHKRV(write_port(e, w, w->tailport));
+    CHKRV(ioput(w, (agisdirected(agraphof(t)) ? " -> " : " -- ")));
+    CHKRV(write_nodename(h, w));
+    CHKRV(write_port(e, w, w->headport));
     if (!attrs_written(e)) {
-	CHKRV(write_nondefault_attrs(e, ofile, d));
+	CHKRV(write_nondefault_attrs(e, w, d));
     } else {
-	CHKRV(write_edge_name(e, ofile, true));
+	CHKRV(write_edge_name(e, w, true));
     }
-    return ioput(g, ofile, ";\n");
+    return ioput(w, ";\n");
 }
 
-static int write_body(Agraph_t * g, iochan_t * ofile)
+static int write_body(Agraph_t * g, writer_t *w)
 {
     Agnode_t *n, *prev;
     Agedge_t *e;
     Agdatadict_t *dd;
 
-    CHKRV(write_subgs(g, ofile));
+    CHKRV(write_subgs(g, w));
     dd = agdatadict(g, false);
     for (n = agfstnode(g); n; n = agnxtnode(g, n)) {
 	if (write_node_test(g, n, AGSEQ(n)))
-	    CHKRV(write_node(n, ofile, dd ? dd->dict.n : 0));
+	    CHKRV(write_node(n, w, dd ? dd->dict.n : 0));
 	prev = n;
 	for (e = agfstout(g, n); e; e = agnxtout(g, e)) {
 	    if (prev != aghead(e) && write_node_test(g, aghead(e), AGSEQ(n))) {
-		CHKRV(write_node(aghead(e), ofile, dd ? dd->dict.n : 0));
+		CHKRV(write_node(aghead(e), w, dd ? dd->dict.n : 0));
 		prev = aghead(e);
 	    }
 	    if (write_edge_test(g, e))
-		CHKRV(write_edge(e, ofile, dd ? dd->dict.e : 0));
+		CHKRV(write_edge(e, w, dd ? dd->dict.e : 0));
 	}
 
 	}
@@ -730,17 +802,25 @@ static void set_attrwf(Agraph_t * g, bool toplevel, bool value)
 int agwrite(Agraph_t * g, void *ofile)
 {
     char* s;
-    Level = 0;			/* re-initialize tab level */
+    writer_t w = {.io = AGDISC(g, io), .ofile = ofile,
+                  .max_outputline = MAX_OUTPUTLINE};
     s = agget(g, "linelength");
     if (s != NULL && gv_isdigit(*s)) {
 	unsigned long len = strtoul(s, NULL, 10);
 	if ((len == 0 || len >= MIN_OUTPUTLINE) && len <= (unsigned long)INT_MAX)
-	    Max_outputline = (int)len;
+	    w.max_outputline = (int)len;
     }
     set_attrwf(g, true, false);
-    CHKRV(write_hdr(g, ofile, true));
-    CHKRV(write_body(g, ofile));
-    CHKRV(write_trl(g, ofile));
-    Max_outputline = MAX_OUTPUTLINE;
-    return AGDISC(g, io)->flush(ofile);
+    int rc = write_hdr(g, &w, true);
+    if (rc != EOF)
+	rc = write_body(g, &w);
+    if (rc != EOF)
+	rc = write_trl(&w);
+    if (rc != EOF)
+	rc = flush_out(&w);
+    agxbfree(&w.out);
+    free(w.canon);
+    if (rc == EOF)
+	return EOF;
+    return w.io->flush(ofile);
 }
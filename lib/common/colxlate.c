@@ -28,9 +28,10 @@
 #include <util/gv_ctype.h>
 #include <util/gv_math.h>
 #include <util/strcasecmp.h>
+#include <util/tls.h>
 #include <util/unreachable.h>
 
-static char* colorscheme;
+static TLS char* colorscheme;
 
 static void hsv2rgb(double h, double s, double v,
 			double *r, double *g, double *b)
@@ -29,14 +29,20 @@
 #include <cgraph/tokenize.h>
 #include <common/htmltable.h>
 #include <gvc/gvc.h>
+#include <gvc/gvio.h>
+#include <label/index.h>
 #include <cdt/cdt.h>
 #include <pathplan/pathgeom.h>
 #include <util/agxbuf.h>
 #include <util/alloc.h>
+#include <util/bitarray.h>
 #include <util/gv_ctype.h>
 #include <util/gv_math.h>
+#include <util/lock.h>
+#include <util/parallel.h>
 #include <util/streq.h>
 #include <util/strview.h>
+#include <util/tls.h>
 #include <util/unreachable.h>
 #include <util/unused.h>
 #include <xdot/xdot.h>
@@ -462,7 +468,7 @@ static double getSegLen(strview_t *s) {
 static int parseSegs(const char *clrs, colorsegs_t *psegs) {
     colorsegs_t segs = {0};
     double v, left = 1;
-    static int doWarn = 1;
+    static TLS int doWarn = 1;
     int rval = 0;
 
     for (tok_t t = tok(clrs, ":"); !tok_end(&t); tok_next(&t)) {
@@ -1697,7 +1703,7 @@ static bool node_in_box(node_t *n, boxf b)
   return boxf_overlap(ND_bb(n), b);
 }
 
-static char *saved_color_scheme;
+static TLS char *saved_color_scheme;
 
 static void emit_begin_node(GVJ_t * job, node_t * n)
 {
@@ -1853,9 +1859,30 @@ static void emit_end_node(GVJ_t * job)
     pop_obj_state(job);
 }
 
+/* nodes drawn on the page this thread is emitting, by sequence number */
+static TLS bitarray_t *Drawn;
+
+/* whether n was already drawn on the current page, marking it drawn */
+static bool mark_drawn(node_t *n)
+{
+    if (Drawn == NULL) /* not emitting a page */
+	return false;
+    const bool drawn = bitarray_get(*Drawn, AGSEQ(n));
+    bitarray_set(Drawn, AGSEQ(n), true);
+    return drawn;
+}
+
+/* the extent of a record of the nodes of g by sequence number */
+static size_t node_seqs(graph_t *g)
+{
+    size_t seqs = 0;
+    for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n))
+	seqs = MAX(seqs, (size_t)AGSEQ(n) + 1);
+    return seqs;
+}
+
 static void emit_node(GVJ_t * job, node_t * n)
 {
-    GVC_t *gvc = job->gvc;
     char *s;
     char *style;
     char **styles = NULL;
@@ -1865,10 +1892,8 @@ static void emit_node(GVJ_t * job, node_t * n)
     if (ND_shape(n) 				     /* node has a shape */
 	    && node_in_layer(job, agraphof(n), n)    /* and is in layer */
 	    && node_in_box(n, job->clip)             /* and is in page/view */
-	    && ND_state(n) != gvc->common.viewNum) /* and not already drawn */
+	    && !mark_drawn(n))			     /* and not already drawn */
     {
-	ND_state(n) = gvc->common.viewNum; 	     /* mark node as drawn */
-
         gvrender_comment(job, agnameof(n));
 	s = late_string(n, N_comment, "");
 	if (s[0])
@@ -3206,17 +3231,241 @@ static void emit_colors(GVJ_t * job, graph_t * g)
     }
 }
 
+/* The nodes and edges of a graph, indexed by the boxes emit_node and
+ * emit_edge test against the page. For paginated and interactive output,
+ * emit_view looks up the objects that may be in a page instead of testing
+ * every one. The index only narrows the search; emit_node and emit_edge still
+ * make their own tests. It is built on first use after a layout is rendered
+ * and kept in the GVC_t until the next render or gvFreeLayout.
+ */
+
+/* a node or edge of the index */
+typedef struct {
+    void *obj;    ///< node_t or edge_t
+    bool is_edge;
+    size_t order; ///< nodes in agfstnode order, edges in agfstout order
+    size_t walk;  ///< in emit_view's breadth first walk
+} emit_item_t;
+
+struct emit_index_s {
+    graph_t *g;
+    RTree_t *tree;
+    emit_item_t *items;
+};
+typedef struct emit_index_s emit_index_t;
+
+DEFINE_LIST(emit_items, const emit_item_t *)
+
+void emit_index_reset(GVC_t *gvc)
+{
+    emit_index_t *index = gvc->emit_index;
+    if (index == NULL)
+	return;
+    RTreeClose(index->tree);
+    free(index->items);
+    free(index);
+    gvc->emit_index = NULL;
+}
+
+/* a box as an index rectangle, rounded outwards and clamped, which keeps any
+ * overlap with another box
+ */
+static Rect_t index_rect(boxf b)
+{
+    const double limit = INT_MAX / 4;
+    Rect_t r;
+    r.boundary[0] = (int)fmax(floor(fmin(b.LL.x, limit)), -limit);
+    r.boundary[1] = (int)fmax(floor(fmin(b.LL.y, limit)), -limit);
+    r.boundary[2] = (int)fmax(ceil(fmin(b.UR.x, limit)), -limit);
+    r.boundary[3] = (int)fmax(ceil(fmin(b.UR.y, limit)), -limit);
+    return r;
+}
+
+static void add_label_box(textlabel_t *lp, boxf *bb, bool *found)
+{
+    const pointf s = {.x = lp->dimen.x / 2.0, .y = lp->dimen.y / 2.0};
+    const boxf b = {.LL = sub_pointf(lp->pos, s), .UR = add_pointf(lp->pos, s)};
+    if (*found)
+	EXPANDBB(*bb, b);
+    else
+	*bb = b;
+    *found = true;
+}
+
+/* the box covering all an object is tested by, false if it is never drawn */
+static bool item_box(const emit_item_t *item, boxf *bb)
+{
+    if (!item->is_edge) {
+	node_t *n = item->obj;
+	*bb = ND_bb(n);
+	return ND_shape(n) != NULL;
+    }
+    edge_t *e = item->obj;
+    bool found = false;
+    if (ED_spl(e)) {
+	*bb = ED_spl(e)->bb;
+	found = true;
+    }
+    if (ED_label(e))
+	add_label_box(ED_label(e), bb, &found);
+    if (ED_xlabel(e) && ED_xlabel(e)->set)
+	add_label_box(ED_xlabel(e), bb, &found);
+    return found;
+}
+
+static emit_index_t *index_objects(graph_t *g)
+{
+    emit_index_t *index = gv_alloc(sizeof(emit_index_t));
+    index->g = g;
+    const size_t size = (size_t)agnnodes(g) + (size_t)agnedges(g);
+    index->items = gv_calloc(size, sizeof(emit_item_t));
+
+    /* nodes first, so that the item of a node is found by sequence number */
+    size_t *node_item = gv_calloc(node_seqs(g), sizeof(size_t));
+    size_t count = 0;
+    for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	node_item[AGSEQ(n)] = count;
+	index->items[count] = (emit_item_t){.obj = n, .order = count,
+	                                    .walk = SIZE_MAX};
+	count++;
+    }
+    size_t walk = 0;
+    size_t edges = 0;
+    for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	emit_item_t *item = &index->items[node_item[AGSEQ(n)]];
+	if (item->walk == SIZE_MAX)
+	    item->walk = walk++;
+	for (edge_t *e = agfstout(g, n); e; e = agnxtout(g, e)) {
+	    item = &index->items[node_item[AGSEQ(aghead(e))]];
+	    if (item->walk == SIZE_MAX)
+		item->walk = walk++;
+	    assert(count < size);
+	    index->items[count++] = (emit_item_t){.obj = e, .is_edge = true,
+	                                          .order = edges++,
+	                                          .walk = walk++};
+	}
+    }
+    free(node_item);
+
+    index->tree = RTreeOpen();
+    for (size_t i = 0; i < count; i++) {
+	boxf bb;
+	if (item_box(&index->items[i], &bb)) {
+	    Rect_t r = index_rect(bb);
+	    RTreeInsert(index->tree, &r, &index->items[i], &index->tree->root, 0);
+	}
+    }
+    return index;
+}
+
+/* the index to emit the pages of a job with, NULL to test every object
+ *
+ * Building it takes longer than testing every object once, so it is only
+ * built for jobs that will emit several pages or redraw the view.
+ */
+static const emit_index_t *view_index(GVJ_t *job, graph_t *g)
+{
+    if (job->numPages <= 1 && !(job->flags & GVDEVICE_EVENTS))
+	return NULL;
+    GVC_t *gvc = job->gvc;
+    if (gvc->emit_index != NULL && gvc->emit_index->g != g)
+	emit_index_reset(gvc);
+    if (gvc->emit_index == NULL)
+	gvc->emit_index = index_objects(g);
+    return gvc->emit_index;
+}
+
+static void add_item(void *data, void *arg)
+{
+    emit_items_append(arg, data);
+}
+
+static int by_order(const emit_item_t **a, const emit_item_t **b)
+{
+    if ((*a)->is_edge != (*b)->is_edge)
+	return (*a)->is_edge ? 1 : -1;
+    return (*a)->order < (*b)->order ? -1 : (*a)->order > (*b)->order;
+}
+
+static int by_walk(const emit_item_t **a, const emit_item_t **b)
+{
+    return (*a)->walk < (*b)->walk ? -1 : (*a)->walk > (*b)->walk;
+}
+
+static void emit_found_nodes(GVJ_t *job, graph_t *g, const emit_items_t *found,
+                             bool test)
+{
+    gvrender_begin_nodes(job);
+    for (size_t i = 0; i < emit_items_size(found); i++) {
+	const emit_item_t *item = emit_items_get(found, i);
+	if (!item->is_edge && (!test || write_node_test(g, item->obj)))
+	    emit_node(job, item->obj);
+    }
+    gvrender_end_nodes(job);
+}
+
+static void emit_found_edges(GVJ_t *job, graph_t *g, const emit_items_t *found,
+                             bool test)
+{
+    gvrender_begin_edges(job);
+    for (size_t i = 0; i < emit_items_size(found); i++) {
+	const emit_item_t *item = emit_items_get(found, i);
+	if (item->is_edge && (!test || write_edge_test(g, item->obj)))
+	    emit_edge(job, item->obj);
+    }
+    gvrender_end_edges(job);
+}
+
+/* emit the nodes and edges of the view that the index finds in the page, in
+ * the order emit_view would have
+ */
+static void emit_found(GVJ_t *job, graph_t *g, const emit_index_t *index,
+                       int flags)
+{
+    emit_items_t found = {0};
+    const Rect_t clip = index_rect(job->clip);
+    RTreeSearchEach(index->tree->root, &clip, add_item, &found);
+
+    if (flags & (EMIT_SORTED | EMIT_EDGE_SORTED | EMIT_PREORDER)) {
+	emit_items_sort(&found, by_order);
+	if (flags & EMIT_SORTED) {
+	    emit_found_nodes(job, g, &found, false);
+	    emit_found_edges(job, g, &found, false);
+	} else if (flags & EMIT_EDGE_SORTED) {
+	    emit_found_edges(job, g, &found, false);
+	    emit_found_nodes(job, g, &found, false);
+	} else {
+	    emit_found_nodes(job, g, &found, true);
+	    emit_found_edges(job, g, &found, true);
+	}
+    } else {
+	/* a node is drawn where the walk first comes to it */
+	emit_items_sort(&found, by_walk);
+	for (size_t i = 0; i < emit_items_size(&found); i++) {
+	    const emit_item_t *item = emit_items_get(&found, i);
+	    if (item->is_edge)
+		emit_edge(job, item->obj);
+	    else
+		emit_node(job, item->obj);
+	}
+    }
+    emit_items_free(&found);
+}
+
 static void emit_view(GVJ_t * job, graph_t * g, int flags)
 {
-    GVC_t * gvc = job->gvc;
     node_t *n;
     edge_t *e;
 
-    gvc->common.viewNum++;
+    job->common->viewNum++;
     /* when drawing, lay clusters down before nodes and edges */
     if (!(flags & EMIT_CLUSTERS_LAST))
 	emit_clusters(job, g, flags);
-    if (flags & EMIT_SORTED) {
+    const emit_index_t *index = view_index(job, g);
+    if (index && !CONTAINS(job->clip, GD_bb(g))) {
+	/* only part of the graph is in view */
+	emit_found(job, g, index, flags);
+    } else if (flags & EMIT_SORTED) {
 	/* output all nodes, then all edges */
 	gvrender_begin_nodes(job);
 	for (n = agfstnode(g); n; n = agnxtnode(g, n))
@@ -3313,6 +3562,7 @@ static void emit_page(GVJ_t * job, graph_t * g)
     else
 	saveid = NULL;
 
+    bitarray_clear(Drawn);
     char *previous_color_scheme = setColorScheme(agget(g, "colorscheme"));
     setup_page(job);
     gvrender_begin_page(job);
@@ -3368,9 +3618,207 @@ static void emit_page(GVJ_t * job, graph_t * g)
     free(previous_color_scheme);
 }
 
+#ifndef GVDLL
+/* Pages, one for each page of the pagination in each layer, can be emitted
+ * concurrently when the graph's `threads` attribute is other than 1 and the
+ * renderer keeps no state from one page to the next. All pages but the last
+ * are then emitted a batch at a time, each by a copy of the job with its own
+ * root object state and view number into a buffer of its own, and the
+ * buffers are written out in order. The job itself emits the last page, so
+ * it ends up as if it had emitted every page, and the output is the same.
+ *
+ * While the pages are emitted, several threads read the graph. Its root, and
+ * its clusters if layers are checked, are frozen and the root shared so that
+ * this does not modify it (see agfreeze and agbeginshared).
+ *
+ * The state emitting a page uses is shared by all threads in Windows DLL
+ * builds, so there the pages are always emitted in turn.
+ */
+
+/* a page of a layer, as emitted concurrently */
+typedef struct {
+    int layerNum;
+    point pagesArrayElem;
+    bool begins_layer; ///< is this the first page of its layer?
+    bool ends_layer;   ///< is this the last page of its layer?
+} emit_unit_t;
+
+DEFINE_LIST(emit_units, emit_unit_t)
+DEFINE_LIST(graphs, graph_t *)
+
+/* the number of threads to emit the pages of a job with, 1 to emit them in
+ * turn
+ */
+static int page_threads(GVJ_t *job, graph_t *g)
+{
+    if (!(job->flags & GVRENDER_DOES_CONCURRENT_PAGES))
+	return 1;
+    if (job->numPages <= 1 && job->gvc->numLayers <= 1)
+	return 1;
+    /* images are loaded into per-thread caches, and styles set by a
+     * background carry over from one page to the next */
+    if (GD_has_images(g) || GD_drawing(g)->xdots)
+	return 1;
+    return gv_threads(late_int(g, agfindgraphattr(g, "threads"), 1, 0));
+}
+
+static void emit_unit(GVJ_t *job, graph_t *g, const emit_unit_t *unit,
+                      bool layers)
+{
+    job->layerNum = unit->layerNum;
+    job->pagesArrayElem = unit->pagesArrayElem;
+    if (layers && unit->begins_layer)
+	gvrender_begin_layer(job);
+    emit_page(job, g);
+    if (layers && unit->ends_layer)
+	gvrender_end_layer(job);
+}
+
+static size_t append_page(void *context, const char *s, size_t len)
+{
+    return agxbput_n(context, s, len);
+}
+
+/* emit a page into <out> by a copy of <job> */
+static void emit_unit_copy(GVJ_t *job, graph_t *g, const emit_unit_t *unit,
+                           bool layers, int viewNum, agxbuf *out)
+{
+    GVCOMMON_t common = *job->common;
+    common.viewNum = viewNum;
+    obj_state_t obj = *job->obj;
+    /* the page goes to <out> even when the context has a write discipline */
+    GVC_t gvc = *job->gvc;
+    gvc.write_fn = NULL;
+
+    GVJ_t copy = *job;
+    copy.gvc = &gvc;
+    copy.common = &common;
+    copy.obj = &obj;
+    copy.flags &= ~GVDEVICE_COMPRESSED_FORMAT;
+    copy.deflate = NULL;
+    /* with no room to collect output in, it all goes straight to the sink */
+    copy.output_data = NULL;
+    copy.output_data_allocated = 0;
+    copy.output_data_position = 0;
+    copy.output_sink = append_page;
+    copy.output_sink_context = out;
+    copy.output_sink_failed = false;
+
+    emit_unit(&copy, g, unit, layers);
+
+    if (obj.url_map_p != job->obj->url_map_p)
+	free(obj.url_map_p);
+}
+
+static void freeze_clusters(graph_t *g, graphs_t *frozen)
+{
+    for (int c = 1; c <= GD_n_cluster(g); c++) {
+	graph_t *sg = GD_clust(g)[c];
+	if (sg->adj == NULL) {
+	    agfreeze(sg);
+	    graphs_append(frozen, sg);
+	}
+	freeze_clusters(sg, frozen);
+    }
+}
+
+static void emit_pages(GVJ_t *job, graph_t *g, int threads, size_t seqs)
+{
+    emit_units_t units = {0};
+    int *lp;
+    for (firstlayer(job, &lp); validlayer(job); nextlayer(job, &lp)) {
+	const size_t first = emit_units_size(&units);
+	for (firstpage(job); validpage(job); nextpage(job)) {
+	    const emit_unit_t unit = {.layerNum = job->layerNum,
+	                              .pagesArrayElem = job->pagesArrayElem};
+	    emit_units_append(&units, unit);
+	}
+	if (emit_units_size(&units) > first) {
+	    emit_units_at(&units, first)->begins_layer = true;
+	    emit_units_back(&units)->ends_layer = true;
+	}
+    }
+    const int end_layerNum = job->layerNum;
+    const point end_pagesArrayElem = job->pagesArrayElem;
+    const bool layers = numPhysicalLayers(job) > 1;
+    const int count = (int)emit_units_size(&units);
+    if (count == 0) {
+	emit_units_free(&units);
+	return;
+    }
+
+    graphs_t frozen = {0};
+    if (g->adj == NULL) {
+	agfreeze(g);
+	graphs_append(&frozen, g);
+    }
+    if (job->numLayers > 1)
+	freeze_clusters(g, &frozen);
+    agbeginshared(g);
+
+    const int viewNum = job->common->viewNum;
+    const int batch = 4 * threads;
+    agxbuf *pages = gv_calloc((size_t)batch, sizeof(agxbuf));
+    gv_layout_state_t *state = gv_layout_state_save();
+
+    for (int start = 0; start < count - 1; start += batch) {
+	const int end = MIN(start + batch, count - 1);
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threads)
+#endif
+	{
+	    gv_layout_state_load(state);
+	    gv_fixLocale(1);
+	    bitarray_t *const saved = Drawn;
+	    bitarray_t drawn = bitarray_new(seqs);
+	    Drawn = &drawn;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+	    for (int k = start; k < end; k++) {
+		emit_unit_copy(job, g, emit_units_at(&units, (size_t)k), layers,
+		               viewNum + k, &pages[k - start]);
+	    }
+	    Drawn = saved;
+	    bitarray_reset(&drawn);
+	    gv_fixLocale(0);
+	}
+
+	for (int k = start; k < end; k++) {
+	    agxbuf *page = &pages[k - start];
+	    const size_t len = agxblen(page);
+	    gvwrite(job, agxbuse(page), len);
+	}
+    }
+
+    /* the job emits the last page as if it had emitted the others, which
+     * would have left this view number and bounding box */
+    if (count > 1) {
+	job->common->viewNum = viewNum + count - 1;
+	if (viewNum == 0)
+	    job->boundingBox = job->pageBoundingBox;
+	else
+	    EXPANDBB(job->boundingBox, job->pageBoundingBox);
+    }
+    emit_unit(job, g, emit_units_back(&units), layers);
+    job->layerNum = end_layerNum;
+    job->pagesArrayElem = end_pagesArrayElem;
+
+    free(state);
+    for (int k = 0; k < batch; k++)
+	agxbfree(&pages[k]);
+    free(pages);
+    agendshared(g);
+    for (size_t i = 0; i < graphs_size(&frozen); i++)
+	agthaw(graphs_get(&frozen, i));
+    graphs_free(&frozen);
+    emit_units_free(&units);
+}
+#endif
+
 void emit_graph(GVJ_t * job, graph_t * g)
 {
-    node_t *n;
     char *s;
     int flags = job->flags;
     int* lp;
@@ -3403,46 +3851,64 @@ void emit_graph(GVJ_t * job, graph_t * g)
     if (flags & EMIT_COLORS)
 	emit_colors(job,g);
 
-    /* reset node state */
-    for (n = agfstnode(g); n; n = agnxtnode(g, n))
-	ND_state(n) = 0;
-    /* iterate layers */
-    for (firstlayer(job,&lp); validlayer(job); nextlayer(job,&lp)) {
-	if (numPhysicalLayers (job) > 1)
-	    gvrender_begin_layer(job);
-
-	/* iterate pages */
-	for (firstpage(job); validpage(job); nextpage(job))
-	    emit_page(job, g);
-
-	if (numPhysicalLayers (job) > 1)
-	    gvrender_end_layer(job);
-    } 
+    const size_t seqs = node_seqs(g);
+    bitarray_t drawn = bitarray_new(seqs);
+    Drawn = &drawn;
+    (void)view_index(job, g); /* build it before any threads look it up */
+#ifndef GVDLL
+    const int threads = page_threads(job, g);
+    if (threads > 1) {
+	emit_pages(job, g, threads, seqs);
+    } else
+#endif
+    {
+	/* iterate layers */
+	for (firstlayer(job,&lp); validlayer(job); nextlayer(job,&lp)) {
+	    if (numPhysicalLayers (job) > 1)
+		gvrender_begin_layer(job);
+
+	    /* iterate pages */
+	    for (firstpage(job); validpage(job); nextpage(job))
+		emit_page(job, g);
+
+	    if (numPhysicalLayers (job) > 1)
+		gvrender_end_layer(job);
+	}
+    }
+    Drawn = NULL;
+    bitarray_reset(&drawn);
     emit_end_graph(job);
 }
 
+/* messages already emitted, shared by all threads */
 static Dict_t *strings;
+static gv_lock_t strings_lock = GV_LOCK_INIT;
 static Dtdisc_t stringdict = {
     .link = -1, // link - allocate separate holder objects
     .freef = free,
 };
 
 bool emit_once(char *str) {
+    bool rv = false;
+    gv_lock(&strings_lock);
     if (strings == 0)
 	strings = dtopen(&stringdict, Dtoset);
     if (!dtsearch(strings, str)) {
 	dtinsert(strings, gv_strdup(str));
-	return true;
+	rv = true;
     }
-    return false;
+    gv_unlock(&strings_lock);
+    return rv;
 }
 
 void emit_once_reset(void)
 {
+    gv_lock(&strings_lock);
     if (strings) {
 	dtclose(strings);
 	strings = 0;
     }
+    gv_unlock(&strings_lock);
 }
 
 static void emit_begin_cluster(GVJ_t * job, Agraph_t * sg)
@@ -3701,12 +4167,12 @@ static token_t style_token(char **s) {
  */
 char **parse_style(char *s)
 {
-    static char *parse[FUNLIMIT];
+    static TLS char *parse[FUNLIMIT];
     size_t parse_offsets[sizeof(parse) / sizeof(parse[0])];
     size_t fun = 0;
     bool in_parens = false;
     char *p;
-    static agxbuf ps_xb;
+    static TLS agxbuf ps_xb;
 
     p = s;
     while (true) {
@@ -3865,15 +4331,49 @@ extern gvdevice_callbacks_t gvdevice_callbacks;
  * If set is non-zero, the "C" locale set;
  * if set is zero, the original locale is reset.
  * Calls to the function can nest.
+ *
+ * Only the locale of the calling thread is changed where that is possible, so
+ * a thread finishing its output does not restore the locale under another.
  */
 void gv_fixLocale (int set)
 {
-    static char* save_locale;
-    static int cnt;
+    static TLS int cnt;
+#if defined(LC_NUMERIC_MASK) && !defined(_WIN32)
+    static TLS locale_t c_locale;
+    static TLS locale_t save_locale;
 
     if (set) {
 	cnt++;
 	if (cnt == 1) {
+	    locale_t base = duplocale(uselocale((locale_t)0));
+	    c_locale = base ? newlocale(LC_NUMERIC_MASK, "C", base) : (locale_t)0;
+	    if (c_locale) {
+		save_locale = uselocale(c_locale);
+	    } else if (base) {
+		freelocale(base);
+	    }
+	}
+    }
+    else if (cnt > 0) {
+	cnt--;
+	if (cnt == 0 && c_locale) {
+	    uselocale(save_locale);
+	    freelocale(c_locale);
+	    c_locale = (locale_t)0;
+	}
+    }
+#else
+    static TLS char* save_locale;
+#ifdef _WIN32
+    static TLS int save_config;
+#endif
+
+    if (set) {
+	cnt++;
+	if (cnt == 1) {
+#ifdef _WIN32
+	    save_config = _configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
+#endif
 	    save_locale = gv_strdup(setlocale (LC_NUMERIC, NULL));
 	    setlocale (LC_NUMERIC, "C");
 	}
@@ -3883,17 +4383,20 @@ void gv_fixLocale (int set)
 	if (cnt == 0) {
 	    setlocale (LC_NUMERIC, save_locale);
 	    free (save_locale);
+#ifdef _WIN32
+	    _configthreadlocale(save_config);
+#endif
 	}
     }
+#endif
 }
 
 
 #define FINISH() if (Verbose) fprintf(stderr,"gvRenderJobs %s: %.2f secs.\n", agnameof(g), elapsed_sec())
 
-int gvRenderJobs (GVC_t * gvc, graph_t * g)
+static int render_jobs(GVC_t * gvc, graph_t * g)
 {
-    static GVJ_t *prevjob;
-    GVJ_t *job, *firstjob;
+    GVJ_t *job, *firstjob, *prevjob;
 
     if (Verbose)
 	start_timer();
@@ -3904,7 +4407,12 @@ int gvRenderJobs (GVC_t * gvc, graph_t * g)
         return -1;
     }
 
+    /* the layout may have been done in another thread */
+    if (GD_layout_state(g))
+	gv_layout_state_load(GD_layout_state(g));
+
     init_bb(g);
+    emit_index_reset(gvc);
     init_gvc(gvc, g);
     init_layering(gvc, g);
 
@@ -3951,6 +4459,7 @@ int gvRenderJobs (GVC_t * gvc, graph_t * g)
 	// multiple output files, or we are about to write to a different output
 	// device
         firstjob = gvc->active_jobs;
+        prevjob = NULL;
         if (firstjob) {
 	    if (! (firstjob->flags & GVDEVICE_DOES_PAGES)
 	      || strcmp(job->output_langname, firstjob->output_langname)) {
@@ -3959,11 +4468,12 @@ int gvRenderJobs (GVC_t * gvc, graph_t * g)
 	    
             	gvc->active_jobs = NULL; /* clear active list */
 	    	gvc->common.viewNum = 0;
-	    	prevjob = NULL;
             }
-        }
-        else {
-	    prevjob = NULL;
+	    else {
+		/* append to the end of the active list */
+		for (prevjob = firstjob; prevjob->next_active;
+		     prevjob = prevjob->next_active);
+	    }
         }
 
 	if (prevjob) {
@@ -3999,13 +4509,20 @@ int gvRenderJobs (GVC_t * gvc, graph_t * g)
         /* the last job, after all input graphs are processed,
          *      is finalized from gvFinalize()
          */
-	prevjob = job;
     }
     gv_fixLocale (0);
     FINISH();
     return 0;
 }
 
+int gvRenderJobs (GVC_t * gvc, graph_t * g)
+{
+    gv_layout_lock();
+    const int rc = render_jobs(gvc, g);
+    gv_layout_unlock();
+    return rc;
+}
+
 /* Check for colon in colorlist. If one exists, and not the first
  * character, store the characters before the colon in clrs[0] and
  * the characters after the colon (and before the next or end-of-string)
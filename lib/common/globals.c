@@ -1,5 +1,5 @@
 /// @file
-/// @brief @ref fdp_parms
+/// @brief @ref fdp_parms, @ref gv_layout_state_save, @ref gv_layout_lock
 /// @ingroup common_render
 /*************************************************************************
  * Copyright (c) 2011 AT&T Intellectual Property 
@@ -17,6 +17,7 @@
 #include <common/types.h>
 #include <common/globals.h>
 #include <fdpgen/fdp.h>
+#include <util/alloc.h>
 
 /* Default layout values, possibly set via command line; -1 indicates unset */
 static fdpParms_t fdpParms = {
@@ -26,8 +27,67 @@ static fdpParms_t fdpParms = {
     50,                         /* unscaled */
     0.0,                        /* C */
     1.0,                        /* Tfact */
-    -1.0,                       /* K - set in initParams; used in init_edge */
     -1.0,                       /* T0 */
 };
 
 struct fdpParms_s* fdp_parms = &fdpParms;
+
+#define SYMS(X)                                                                \
+  X(G_ordering) X(G_peripheries) X(G_penwidth) X(G_gradientangle)              \
+  X(G_margin) X(N_height) X(N_width) X(N_shape) X(N_color) X(N_fillcolor)      \
+  X(N_fontsize) X(N_fontname) X(N_fontcolor) X(N_label) X(N_xlabel)            \
+  X(N_nojustify) X(N_style) X(N_showboxes) X(N_sides) X(N_peripheries)         \
+  X(N_ordering) X(N_orientation) X(N_skew) X(N_distortion) X(N_fixed)          \
+  X(N_imagescale) X(N_imagepos) X(N_layer) X(N_group) X(N_comment)             \
+  X(N_vertices) X(N_z) X(N_penwidth) X(N_gradientangle) X(E_weight)            \
+  X(E_minlen) X(E_color) X(E_fillcolor) X(E_fontsize) X(E_fontname)            \
+  X(E_fontcolor) X(E_label) X(E_xlabel) X(E_dir) X(E_style) X(E_decorate)      \
+  X(E_showboxes) X(E_arrowsz) X(E_constr) X(E_layer) X(E_comment)              \
+  X(E_label_float) X(E_samehead) X(E_sametail) X(E_headlabel) X(E_taillabel)   \
+  X(E_labelfontsize) X(E_labelfontname) X(E_labelfontcolor)                    \
+  X(E_labeldistance) X(E_labelangle) X(E_tailclip) X(E_headclip) X(E_penwidth)
+
+#define SCALARS(X)                                                             \
+  X(char *, Gvimagepath) X(int, Nop) X(double, PSinputscale) X(int, CL_type)   \
+  X(bool, Concentrate) X(double, Epsilon) X(int, MaxIter)                      \
+  X(unsigned short, Ndim) X(int, State) X(int, EdgeLabelsDone)                 \
+  X(double, Initial_dist) X(double, Damping)
+
+struct gv_layout_state_s {
+#define SCALAR(type, name) type name;
+  SCALARS(SCALAR)
+#undef SCALAR
+#define SYM(name) Agsym_t *name;
+  SYMS(SYM)
+#undef SYM
+};
+
+gv_layout_state_t *gv_layout_state_save(void) {
+  gv_layout_state_t *state = gv_alloc(sizeof(*state));
+#define SAVE(name) state->name = name;
+#define SAVE_SCALAR(type, name) SAVE(name)
+  SCALARS(SAVE_SCALAR)
+  SYMS(SAVE)
+#undef SAVE_SCALAR
+#undef SAVE
+  return state;
+}
+
+void gv_layout_state_load(const gv_layout_state_t *state) {
+#define LOAD(name) name = state->name;
+#define LOAD_SCALAR(type, name) LOAD(name)
+  SCALARS(LOAD_SCALAR)
+  SYMS(LOAD)
+#undef LOAD_SCALAR
+#undef LOAD
+}
+
+#ifdef GVDLL
+#include <util/lock.h>
+
+static gv_lock_t layout_lock = GV_LOCK_INIT;
+
+void gv_layout_lock(void) { gv_lock(&layout_lock); }
+
+void gv_layout_unlock(void) { gv_unlock(&layout_lock); }
+#endif
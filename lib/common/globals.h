@@ -18,6 +18,7 @@
 #include <cgraph/list.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <util/tls.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,37 +40,48 @@ extern "C" {
 #ifndef EXTERN
 #define EXTERN extern
 #endif
+
+/* State a layout or render sets up for the graph it works on is kept per
+ * thread, so graphs can be laid out concurrently in different threads. Data
+ * exported from a DLL cannot be thread-local, so builds with GVDLL share it,
+ * and lay out and render one graph at a time instead (see gv_layout_lock).
+ */
+#ifdef GVDLL
+#define GLOBALS_TLS /* nothing */
+#else
+#define GLOBALS_TLS TLS
+#endif
 /// @endcond
 
 DEFINE_LIST_WITH_DTOR(show_boxes, char*, free)
 
     GLOBALS_API EXTERN const char **Lib;		/* from command line */
     GLOBALS_API EXTERN char *Gvfilepath;  /* Per-process path of files allowed in image attributes (also ps libs) */
-    GLOBALS_API EXTERN char *Gvimagepath; /* Per-graph path of files allowed in image attributes  (also ps libs) */
+    GLOBALS_API EXTERN GLOBALS_TLS char *Gvimagepath; /* Per-graph path of files allowed in image attributes  (also ps libs) */
 
     GLOBALS_API EXTERN unsigned char Verbose;
     GLOBALS_API EXTERN bool Reduce;
     GLOBALS_API EXTERN char *HTTPServerEnVar;
     GLOBALS_API EXTERN int graphviz_errors;
-    GLOBALS_API EXTERN int Nop;
-    GLOBALS_API EXTERN double PSinputscale;
+    GLOBALS_API EXTERN GLOBALS_TLS int Nop;
+    GLOBALS_API EXTERN GLOBALS_TLS double PSinputscale;
     GLOBALS_API EXTERN show_boxes_t Show_boxes; // emit code for correct box coordinates
-    GLOBALS_API EXTERN int CL_type;		/* NONE, LOCAL, GLOBAL */
-    GLOBALS_API EXTERN bool Concentrate; /// if parallel edges should be merged
-    GLOBALS_API EXTERN double Epsilon;	/* defined in input_graph */
-    GLOBALS_API EXTERN int MaxIter;
-    GLOBALS_API EXTERN unsigned short Ndim;
-    GLOBALS_API EXTERN int State;		/* last finished phase */
-    GLOBALS_API EXTERN int EdgeLabelsDone;	/* true if edge labels have been positioned */
-    GLOBALS_API EXTERN double Initial_dist;
-    GLOBALS_API EXTERN double Damping;
+    GLOBALS_API EXTERN GLOBALS_TLS int CL_type;		/* NONE, LOCAL, GLOBAL */
+    GLOBALS_API EXTERN GLOBALS_TLS bool Concentrate; /// if parallel edges should be merged
+    GLOBALS_API EXTERN GLOBALS_TLS double Epsilon;	/* defined in input_graph */
+    GLOBALS_API EXTERN GLOBALS_TLS int MaxIter;
+    GLOBALS_API EXTERN GLOBALS_TLS unsigned short Ndim;
+    GLOBALS_API EXTERN GLOBALS_TLS int State;		/* last finished phase */
+    GLOBALS_API EXTERN GLOBALS_TLS int EdgeLabelsDone;	/* true if edge labels have been positioned */
+    GLOBALS_API EXTERN GLOBALS_TLS double Initial_dist;
+    GLOBALS_API EXTERN GLOBALS_TLS double Damping;
     GLOBALS_API EXTERN bool Y_invert; ///< invert y in dot & plain output
     GLOBALS_API EXTERN int GvExitOnUsage;   /* gvParseArgs() should exit on usage or error */
 
-    GLOBALS_API EXTERN Agsym_t
+    GLOBALS_API EXTERN GLOBALS_TLS Agsym_t
 	*G_ordering, *G_peripheries, *G_penwidth,
 	*G_gradientangle, *G_margin;
-    GLOBALS_API EXTERN Agsym_t
+    GLOBALS_API EXTERN GLOBALS_TLS Agsym_t
 	*N_height, *N_width, *N_shape, *N_color, *N_fillcolor,
 	*N_fontsize, *N_fontname, *N_fontcolor,
 	*N_label, *N_xlabel, *N_nojustify, *N_style, *N_showboxes,
@@ -77,7 +89,7 @@ DEFINE_LIST_WITH_DTOR(show_boxes, char*, free)
 	*N_skew, *N_distortion, *N_fixed, *N_imagescale, *N_imagepos, *N_layer,
 	*N_group, *N_comment, *N_vertices, *N_z,
 	*N_penwidth, *N_gradientangle;
-    GLOBALS_API EXTERN Agsym_t
+    GLOBALS_API EXTERN GLOBALS_TLS Agsym_t
 	*E_weight, *E_minlen, *E_color, *E_fillcolor,
 	*E_fontsize, *E_fontname, *E_fontcolor,
 	*E_label, *E_xlabel, *E_dir, *E_style, *E_decorate,
@@ -92,6 +104,43 @@ DEFINE_LIST_WITH_DTOR(show_boxes, char*, free)
 
     GLOBALS_API extern struct fdpParms_s* fdp_parms;
 
+/// a copy of the thread-local state above
+///
+/// A layout saves the state it set up for its graph with the graph, see
+/// @ref GD_layout_state, and rendering or freeing the layout loads it again, so
+/// these can happen in another thread than the layout.
+///
+/// Worker threads of a parallel region within a layout start without the state
+/// of the thread that entered the region. It is saved before the region and
+/// loaded in each worker:
+///
+///   gv_layout_state_t *state = gv_layout_state_save();
+///   #pragma omp parallel
+///   {
+///     gv_layout_state_load(state);
+///     ...
+///   }
+///   free(state);
+///
+/// In Windows DLL builds the state above is shared by all threads, so code that
+/// lays out or renders one graph on several threads is not built there.
+typedef struct gv_layout_state_s gv_layout_state_t;
+GLOBALS_API gv_layout_state_t *gv_layout_state_save(void);
+GLOBALS_API void gv_layout_state_load(const gv_layout_state_t *state);
+
+/// serialize layouts and renderings where their state is shared by all threads
+///
+/// `gvLayoutJobs`, `gvRenderJobs` and `gvFreeLayout` hold this lock in Windows
+/// DLL builds, where the state above cannot be thread-local. Elsewhere it does
+/// nothing.
+#ifdef GVDLL
+void gv_layout_lock(void);
+void gv_layout_unlock(void);
+#else
+static inline void gv_layout_lock(void) {}
+static inline void gv_layout_unlock(void) {}
+#endif
+
 #undef EXTERN
 #undef GLOBALS_API
 
@@ -26,6 +26,7 @@
 #include <util/startswith.h>
 #include <util/strcasecmp.h>
 #include <util/strview.h>
+#include <util/tls.h>
 #include <util/unused.h>
 
 #ifdef HAVE_EXPAT
@@ -765,7 +766,7 @@ int initHTMLlexer(htmlscan_t *scanner, char *src, agxbuf * xb, htmlenv_t *env)
     XML_SetCharacterDataHandler(ctx->parser, characterData);
     return 0;
 #else
-    static int first;
+    static TLS int first;
     if (!first) {
 	agwarningf(
 	      "Not built with libexpat. Table formatting is not available.\n");
@@ -25,9 +25,11 @@
 #include <util/gv_ctype.h>
 #include <util/gv_fopen.h>
 #include <util/gv_math.h>
+#include <util/lock.h>
 #include <util/startswith.h>
 #include <util/strcasecmp.h>
 #include <util/streq.h>
+#include <util/tls.h>
 
 static char *usageFmt =
     "Usage: %s [-Vv?] [-(GNE)name=val] [-(KTlso)<val>] <dot files>\n";
@@ -159,9 +161,15 @@ static char *dotneato_basename(char *pathname) {
     return ret;
 }
 
+/* Lib and the number of entries in it are process-wide, like the other
+ * command line settings, and updated together under a lock.
+ */
+static gv_lock_t LibLock = GV_LOCK_INIT;
+
 static void use_library(GVC_t *gvc, const char *name)
 {
     static size_t cnt = 0;
+    gv_lock(&LibLock);
     if (name) {
 	const size_t old_nmemb = cnt == 0 ? cnt : cnt + 1;
 	Lib = gv_recalloc(Lib, old_nmemb, cnt + 2, sizeof(const char *));
@@ -169,6 +177,7 @@ static void use_library(GVC_t *gvc, const char *name)
 	Lib[cnt] = NULL;
     }
     gvc->common.lib = Lib;
+    gv_unlock(&LibLock);
 }
 
 static void global_def(char *dcl, int kind) {
@@ -203,7 +212,7 @@ static int gvg_init(GVC_t *gvc, graph_t *g, char *fn, int gidx)
     return 0;
 }
 
-static graph_t *P_graph;
+static TLS graph_t *P_graph;
 
 graph_t *gvPluginsGraph(GVC_t *gvc)
 {
@@ -501,10 +510,10 @@ void getdouble(graph_t * g, char *name, double *result)
 graph_t *gvNextInputGraph(GVC_t *gvc)
 {
     graph_t *g = NULL;
-    static char *fn;
-    static FILE *fp;
-    static FILE *oldfp;
-    static int gidx;
+    static TLS char *fn;
+    static TLS FILE *fp;
+    static TLS FILE *oldfp;
+    static TLS int gidx;
 
     while (!g) {
 	if (!fp) {
@@ -615,7 +624,7 @@ void graph_init(graph_t * g, bool use_rankdir)
 #ifdef HAVE_SETENV
 	setenv("GDFONTPATH", p, 1);
 #else
-	static agxbuf buf;
+	static TLS agxbuf buf;
 	agxbprint(&buf, "GDFONTPATH=%s", p);
 	putenv(agxbuse(&buf));
 #endif
@@ -20,9 +20,11 @@
 
 static char *strdup_and_subst_obj0 (char *str, void *obj, int escBackslash);
 
+/* append a line to the spans of lp; it is measured by make_simple_label once
+ * all lines are known
+ */
 static void storeline(GVC_t *gvc, textlabel_t *lp, char *line,
                       char terminator) {
-    pointf size;
     textspan_t *span;
     size_t oldsz = lp->u.txt.nspans + 1;
 
@@ -36,18 +38,33 @@ static void storeline(GVC_t *gvc, textlabel_t *lp, char *line,
 	tf.name = lp->fontname;
 	tf.size = lp->fontsize;
 	span->font = dtinsert(gvc->textfont_dt, &tf);
-        size = textspan_size(gvc, span);
     }
     else {
-	size.x = 0.0;
-	span->size.y = size.y = (int)(lp->fontsize * LINESPACING);
+	span->size.y = (int)(lp->fontsize * LINESPACING);
     }
 
     lp->u.txt.nspans++;
-    /* width = max line width */
-    lp->dimen.x = MAX(lp->dimen.x, size.x);
-    /* accumulate height */
-    lp->dimen.y += size.y;
+}
+
+/* measure the lines of lp together, and size it to fit them */
+static void measure_lines(GVC_t *gvc, textlabel_t *lp) {
+    textspan_t **spans = gv_calloc(lp->u.txt.nspans, sizeof(textspan_t *));
+    size_t n = 0;
+    for (size_t i = 0; i < lp->u.txt.nspans; i++) {
+	if (lp->u.txt.span[i].font)
+	    spans[n++] = &lp->u.txt.span[i];
+    }
+    textspan_size_batch(gvc, spans, n);
+    free(spans);
+
+    for (size_t i = 0; i < lp->u.txt.nspans; i++) {
+	const textspan_t *span = &lp->u.txt.span[i];
+	/* width = max line width */
+	if (span->font)
+	    lp->dimen.x = MAX(lp->dimen.x, span->size.x);
+	/* accumulate height */
+	lp->dimen.y += span->size.y;
+    }
 }
 
 /* compiles <str> into a label <lp> */
@@ -98,6 +115,7 @@ void make_simple_label(GVC_t * gvc, textlabel_t * lp)
     }
 
     agxbfree(&line);
+    measure_lines(gvc, lp);
     lp->space = lp->dimen;
 }
 
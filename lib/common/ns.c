@@ -27,10 +27,11 @@
 #include <util/overflow.h>
 #include <util/prisize_t.h>
 #include <util/streq.h>
+#include <util/tls.h>
 
 static void dfs_cutval(node_t * v, edge_t * par);
-static int dfs_range_init(node_t * v, edge_t * par, int low);
-static int dfs_range(node_t * v, edge_t * par, int low);
+static int dfs_range_init(node_t **node_at, node_t * v, edge_t * par, int low);
+static int dfs_range(node_t **node_at, node_t * v, edge_t * par, int low);
 static int x_val(edge_t * e, node_t * v, int dir);
 #ifdef DEBUG
 static void check_cycles(graph_t * g);
@@ -41,13 +42,57 @@ static void check_cycles(graph_t * g);
 #define SEQ(a,b,c)		((a) <= (b) && (b) <= (c))
 #define TREE_EDGE(e)	(ED_tree_index(e) >= 0)
 
-static graph_t *G;
-static size_t N_nodes, N_edges;
-static size_t S_i;			/* search index for enter_edge */
-static int Search_size;
+static TLS graph_t *G;
+static TLS size_t N_nodes, N_edges;
+static TLS size_t S_i;			/* search index for enter_edge */
+static TLS int Search_size;
 #define SEARCHSIZE 30
-static nlist_t Tree_node;
-static elist Tree_edge;
+static TLS nlist_t Tree_node;
+static TLS elist Tree_edge;
+
+/* bookkeeping of one call to rank2() that speeds up its pivots */
+typedef struct {
+    /* Bit i of negative is set iff Tree_edge.list[i] has a negative cut value,
+     * kept up to date wherever a tree edge's cut value changes once they have
+     * been initialized. This lets leave_edge() skip over runs of tree edges
+     * that are not candidates a word at a time instead of inspecting each of
+     * them.
+     */
+    uint64_t *negative;
+
+    /* the tree node whose ND_lim is i is node_at[i] */
+    node_t **node_at;
+
+    /* shift of all nodes' ranks by the same amount, owed by rerank_side() */
+    int rank_offset;
+} pivots_t;
+
+static void set_negative(pivots_t *ps, edge_t *e) {
+    const size_t i = (size_t)ED_tree_index(e);
+    const uint64_t bit = UINT64_C(1) << (i % 64);
+    if (ED_cutvalue(e) < 0)
+	ps->negative[i / 64] |= bit;
+    else
+	ps->negative[i / 64] &= ~bit;
+}
+
+/* index of the first tree edge in [from, to) with a negative cut value, or
+ * to if there is none
+ */
+static size_t next_negative(const pivots_t *ps, size_t from, size_t to) {
+    size_t i = from;
+    while (i < to) {
+	const uint64_t word = ps->negative[i / 64] >> (i % 64);
+	if (word == 0) {
+	    i = (i / 64 + 1) * 64;
+	    continue;
+	}
+	if (word & 1)
+	    return i;
+	i++;
+    }
+    return to;
+}
 
 static int add_tree_edge(edge_t * e)
 {
@@ -82,35 +127,6 @@ static int add_tree_edge(edge_t * e)
     return 0;
 }
 
-/**
- * Invalidate DFS attributes by walking up the tree from to_node till lca
- * (inclusively). Called when updating tree to improve pruning in dfs_range().
- * Assigns ND_low(n) = -1 for the affected nodes.
- */
-static void invalidate_path(node_t *lca, node_t *to_node) {
-    while (true) {
-        if (ND_low(to_node) == -1)
-          break;
-
-        ND_low(to_node) = -1;
-
-        edge_t *e = ND_par(to_node);
-        if (e == NULL)
-          break;
-
-        if (ND_lim(to_node) >= ND_lim(lca)) {
-          if (to_node != lca)
-            agerrorf("invalidate_path: skipped over LCA\n");
-          break;
-        }
-
-        if (ND_lim(agtail(e)) > ND_lim(aghead(e)))
-          to_node = agtail(e);
-        else
-          to_node = aghead(e);
-    }
-}
-
 static void exchange_tree_edges(edge_t * e, edge_t * f)
 {
     node_t *n;
@@ -181,87 +197,152 @@ void init_rank(void)
     node_queue_free(&Q);
 }
 
-static edge_t *leave_edge(void)
+/* Block search for the leaving edge: starting where the previous search
+ * stopped and wrapping around, look at the next Search_size tree edges with a
+ * negative cut value and take the most negative of them.
+ */
+static edge_t *leave_edge(const pivots_t *ps)
 {
     edge_t *f, *rv = NULL;
     int cnt = 0;
 
     size_t j = S_i;
-    while (S_i < Tree_edge.size) {
-	if (ED_cutvalue(f = Tree_edge.list[S_i]) < 0) {
-	    if (rv) {
-		if (ED_cutvalue(rv) > ED_cutvalue(f))
-		    rv = f;
-	    } else
-		rv = Tree_edge.list[S_i];
-	    if (++cnt >= Search_size)
-		return rv;
-	}
+    while ((S_i = next_negative(ps, S_i, Tree_edge.size)) < Tree_edge.size) {
+	f = Tree_edge.list[S_i];
+	if (rv == NULL || ED_cutvalue(rv) > ED_cutvalue(f))
+	    rv = f;
+	if (++cnt >= Search_size)
+	    return rv;
 	S_i++;
     }
     if (j > 0) {
 	S_i = 0;
-	while (S_i < j) {
-	    if (ED_cutvalue(f = Tree_edge.list[S_i]) < 0) {
-		if (rv) {
-		    if (ED_cutvalue(rv) > ED_cutvalue(f))
-			rv = f;
-		} else
-		    rv = Tree_edge.list[S_i];
-		if (++cnt >= Search_size)
-		    return rv;
-	    }
+	while ((S_i = next_negative(ps, S_i, j)) < j) {
+	    f = Tree_edge.list[S_i];
+	    if (rv == NULL || ED_cutvalue(rv) > ED_cutvalue(f))
+		rv = f;
+	    if (++cnt >= Search_size)
+		return rv;
 	    S_i++;
 	}
     }
     return rv;
 }
 
-static edge_t *Enter;
-static int Low, Lim, Slack;
-
-static void dfs_enter_outedge(node_t * v)
+/* The entering edge is the non-tree edge of least slack crossing the cut,
+ * first in DFS order among equals. Once an edge with slack target has been
+ * found nothing later can replace it, so the searches below stop there rather
+ * than visiting the rest of the component. The tree is feasible, so no slack
+ * is negative and target is 0 unless the least slack is already known.
+ *
+ * The searches also give up, setting cut_short, after visiting budget nodes.
+ * What they found up to then is still the best of a prefix of the DFS order.
+ */
+typedef struct {
+    edge_t *enter;	/* best edge found so far */
+    int slack;		/* and its slack */
+    int low, lim;	/* range of the side of the cut searched from */
+    int target;
+    size_t budget;
+    bool cut_short;
+} enter_search_t;
+
+static void dfs_enter_outedge(enter_search_t *s, node_t * v)
 {
     int i, slack;
     edge_t *e;
 
-    for (i = 0; (e = ND_out(v).list[i]); i++) {
+    if (s->budget == 0) {
+	s->cut_short = true;
+	return;
+    }
+    s->budget--;
+    for (i = 0; (e = ND_out(v).list[i]) && s->slack > s->target && !s->cut_short; i++) {
 	if (!TREE_EDGE(e)) {
-	    if (!SEQ(Low, ND_lim(aghead(e)), Lim)) {
+	    if (!SEQ(s->low, ND_lim(aghead(e)), s->lim)) {
 		slack = SLACK(e);
-		if (slack < Slack || Enter == NULL) {
-		    Enter = e;
-		    Slack = slack;
+		if (slack < s->slack || s->enter == NULL) {
+		    s->enter = e;
+		    s->slack = slack;
 		}
 	    }
 	} else if (ND_lim(aghead(e)) < ND_lim(v))
-	    dfs_enter_outedge(aghead(e));
+	    dfs_enter_outedge(s, aghead(e));
     }
-    for (i = 0; (e = ND_tree_in(v).list[i]) && (Slack > 0); i++)
+    for (i = 0; (e = ND_tree_in(v).list[i]) && s->slack > s->target && !s->cut_short; i++)
 	if (ND_lim(agtail(e)) < ND_lim(v))
-	    dfs_enter_outedge(agtail(e));
+	    dfs_enter_outedge(s, agtail(e));
 }
 
-static void dfs_enter_inedge(node_t * v)
+static void dfs_enter_inedge(enter_search_t *s, node_t * v)
 {
     int i, slack;
     edge_t *e;
 
-    for (i = 0; (e = ND_in(v).list[i]); i++) {
+    if (s->budget == 0) {
+	s->cut_short = true;
+	return;
+    }
+    s->budget--;
+    for (i = 0; (e = ND_in(v).list[i]) && s->slack > s->target && !s->cut_short; i++) {
 	if (!TREE_EDGE(e)) {
-	    if (!SEQ(Low, ND_lim(agtail(e)), Lim)) {
+	    if (!SEQ(s->low, ND_lim(agtail(e)), s->lim)) {
 		slack = SLACK(e);
-		if (slack < Slack || Enter == NULL) {
-		    Enter = e;
-		    Slack = slack;
+		if (slack < s->slack || s->enter == NULL) {
+		    s->enter = e;
+		    s->slack = slack;
 		}
 	    }
 	} else if (ND_lim(agtail(e)) < ND_lim(v))
-	    dfs_enter_inedge(agtail(e));
+	    dfs_enter_inedge(s, agtail(e));
     }
-    for (i = 0; (e = ND_tree_out(v).list[i]) && Slack > 0; i++)
+    for (i = 0; (e = ND_tree_out(v).list[i]) && s->slack > s->target && !s->cut_short; i++)
 	if (ND_lim(aghead(e)) < ND_lim(v))
-	    dfs_enter_inedge(aghead(e));
+	    dfs_enter_inedge(s, aghead(e));
+}
+
+/* Scan the part of the tree on the other side of the cut, reached from v
+ * without crossing par, for the edges the DFS above would consider. Finds
+ * their least slack, how many edges have it and one of them.
+ */
+static void dfs_cut_slack(const enter_search_t *s, node_t *v, edge_t *par,
+			  bool outsearch, int *min, size_t *count, edge_t **some)
+{
+    int i, slack;
+    edge_t *e;
+
+    /* crossing edges point into this side for an out search, out of it
+     * otherwise
+     */
+    const elist edges = outsearch ? ND_in(v) : ND_out(v);
+    for (i = 0; (e = edges.list[i]); i++) {
+	if (TREE_EDGE(e))
+	    continue;
+	node_t *other = outsearch ? agtail(e) : aghead(e);
+	if (SEQ(s->low, ND_lim(other), s->lim)) {
+	    slack = SLACK(e);
+	    if (slack < *min || *some == NULL) {
+		*some = e;
+		*min = slack;
+		*count = 1;
+	    } else if (slack == *min)
+		++*count;
+	}
+    }
+    for (i = 0; (e = ND_tree_out(v).list[i]); i++)
+	if (e != par)
+	    dfs_cut_slack(s, aghead(e), e, outsearch, min, count, some);
+    for (i = 0; (e = ND_tree_in(v).list[i]); i++)
+	if (e != par)
+	    dfs_cut_slack(s, agtail(e), e, outsearch, min, count, some);
+}
+
+static void dfs_enter(enter_search_t *s, node_t *v, bool outsearch)
+{
+    if (outsearch)
+	dfs_enter_outedge(s, v);
+    else
+	dfs_enter_inedge(s, v);
 }
 
 static edge_t *enter_edge(edge_t * e)
@@ -277,21 +358,42 @@ static edge_t *enter_edge(edge_t * e)
 	v = aghead(e);
 	outsearch = true;
     }
-    Enter = NULL;
-    Slack = INT_MAX;
-    Low = ND_low(v);
-    Lim = ND_lim(v);
-    if (outsearch)
-	dfs_enter_outedge(v);
-    else
-	dfs_enter_inedge(v);
-    return Enter;
+    enter_search_t s = {.slack = INT_MAX, .low = ND_low(v), .lim = ND_lim(v)};
+
+    /* The crossing edges and hence their least slack can also be found from
+     * the other side of the cut. If the DFS takes longer than scanning that
+     * would, do so. Unless the DFS had already come across the least slack or
+     * it is unique, the DFS is still needed to know which edge comes first,
+     * but it can stop at the first edge having it.
+     */
+    s.budget = N_nodes - (size_t)(s.lim - s.low + 1);
+    dfs_enter(&s, v, outsearch);
+    if (s.cut_short) {
+	node_t *u = v == agtail(e) ? aghead(e) : agtail(e);
+	int min = INT_MAX;
+	size_t count = 0;
+	edge_t *some = NULL;
+	dfs_cut_slack(&s, u, e, outsearch, &min, &count, &some);
+	if (s.enter != NULL && s.slack == min)
+	    return s.enter;
+	if (count <= 1)
+	    return some;
+	s.enter = NULL;
+	s.slack = INT_MAX;
+	s.target = min;
+	s.budget = SIZE_MAX;
+	s.cut_short = false;
+	dfs_enter(&s, v, outsearch);
+    }
+    return s.enter;
 }
 
-static void init_cutvalues(void)
+static void init_cutvalues(pivots_t *ps)
 {
-    dfs_range_init(GD_nlist(G), NULL, 1);
+    dfs_range_init(ps->node_at, GD_nlist(G), NULL, 1);
     dfs_cutval(GD_nlist(G), NULL);
+    for (size_t i = 0; i < Tree_edge.size; i++)
+	set_negative(ps, Tree_edge.list[i]);
 }
 
 /* functions for initial tight tree construction */
@@ -532,7 +634,7 @@ subtree_t *merge_trees(Agedge_t *e)   /* entering tree edge */
  * Return 1 if input graph is not connected; 0 on success.
  */
 static
-int feasible_tree(void)
+int feasible_tree(pivots_t *ps)
 {
   Agedge_t *ee;
   size_t subtree_count = 0;
@@ -579,12 +681,13 @@ end:
   free(tree);
   if (error) return error;
   assert(Tree_edge.size == N_nodes - 1);
-  init_cutvalues();
+  init_cutvalues(ps);
   return 0;
 }
 
 /* walk up from v to LCA(v,w), setting new cutvalues. */
-static Agnode_t *treeupdate(Agnode_t * v, Agnode_t * w, int cutvalue, int dir)
+static Agnode_t *treeupdate(pivots_t *ps, Agnode_t * v, Agnode_t * w,
+			    int cutvalue, int dir)
 {
     edge_t *e;
     int d;
@@ -599,6 +702,7 @@ static Agnode_t *treeupdate(Agnode_t * v, Agnode_t * w, int cutvalue, int dir)
 	    ED_cutvalue(e) += cutvalue;
 	else
 	    ED_cutvalue(e) -= cutvalue;
+	set_negative(ps, e);
 	if (ND_lim(agtail(e)) > ND_lim(aghead(e)))
 	    v = agtail(e);
 	else
@@ -607,25 +711,135 @@ static Agnode_t *treeupdate(Agnode_t * v, Agnode_t * w, int cutvalue, int dir)
     return v;
 }
 
-static void rerank(Agnode_t * v, int delta)
+static void rerank(Agnode_t * v, edge_t *par, int delta)
 {
     int i;
     edge_t *e;
 
     ND_rank(v) -= delta;
     for (i = 0; (e = ND_tree_out(v).list[i]); i++)
-	if (e != ND_par(v))
-	    rerank(aghead(e), delta);
+	if (e != par)
+	    rerank(aghead(e), e, delta);
     for (i = 0; (e = ND_tree_in(v).list[i]); i++)
-	if (e != ND_par(v))
-	    rerank(agtail(e), delta);
+	if (e != par)
+	    rerank(agtail(e), e, delta);
+}
+
+/* Lower the ranks of v and the nodes below it by delta, where e is a tree
+ * edge at v. Only the difference between the two sides of e matters while
+ * pivoting, so if v's side is the larger one, raise the other side instead
+ * and settle the difference in remove_rank_offset().
+ */
+static void rerank_side(pivots_t *ps, edge_t *e, Agnode_t *v, int delta)
+{
+    if (ND_par(v) == e && (size_t)(ND_lim(v) - ND_low(v) + 1) > N_nodes / 2) {
+	Agnode_t *u = v == agtail(e) ? aghead(e) : agtail(e);
+	rerank(u, e, -delta);
+	ps->rank_offset += delta;
+    } else
+	rerank(v, ND_par(v), delta);
+}
+
+static void remove_rank_offset(pivots_t *ps)
+{
+    if (ps->rank_offset != 0) {
+	for (node_t *n = GD_nlist(G); n; n = ND_next(n))
+	    ND_rank(n) -= ps->rank_offset;
+	ps->rank_offset = 0;
+    }
+}
+
+static node_t *tree_parent(node_t *v)
+{
+    edge_t *e = ND_par(v);
+    return ND_lim(agtail(e)) > ND_lim(aghead(e)) ? agtail(e) : aghead(e);
+}
+
+/* ND_low and ND_lim number the tree in postorder, so the nodes below a tree
+ * edge have consecutive numbers, and the order children are visited in is
+ * ours to choose. After e has been replaced by f in the tree, the nodes below
+ * e hang from the end of f outside them instead. Rather than renumbering
+ * everything below the LCA of e and f, move the range of numbers of the
+ * subtree between two children of its new parent, choosing the place that
+ * leaves the fewest nodes in between. Only those nodes, the subtree and some
+ * of the ancestors of the subtree's old and new parents are renumbered.
+ */
+static void renumber(pivots_t *ps, edge_t *e, edge_t *f)
+{
+    /* the subtree occupies [a, b] and is rooted at v, below u */
+    node_t *v = ND_par(agtail(e)) == e ? agtail(e) : aghead(e);
+    node_t *u = v == agtail(e) ? aghead(e) : agtail(e);
+    const int a = ND_low(v);
+    const int b = ND_lim(v);
+    const int size = b - a + 1;
+
+    /* f joins its node z to w */
+    node_t *w, *z;
+    if (SEQ(a, ND_lim(agtail(f)), b)) {
+	z = agtail(f);
+	w = aghead(f);
+    } else {
+	z = aghead(f);
+	w = agtail(f);
+    }
+
+    /* insert the subtree before number q, at the start of one of w's children
+     * or after the last of them
+     */
+    int q = ND_lim(w);
+    int cost = q > b ? q - b - 1 : a - q;
+    for (int k = 0; k < 2; k++) {
+	const elist children = k == 0 ? ND_tree_out(w) : ND_tree_in(w);
+	edge_t *g;
+	for (int i = 0; (g = children.list[i]); i++) {
+	    if (g == ND_par(w) || g == f)
+		continue;
+	    const int p = ND_low(k == 0 ? aghead(g) : agtail(g));
+	    const int c = p > b ? p - b - 1 : a - p;
+	    if (c < cost) {
+		q = p;
+		cost = c;
+	    }
+	}
+    }
+
+    if (q > b) {
+	/* w and those of its ancestors not above u now start earlier */
+	for (node_t *x = w; ND_low(x) > b; x = tree_parent(x))
+	    ND_low(x) -= size;
+	for (int i = b + 1; i < q; i++) {
+	    node_t *x = ps->node_at[i];
+	    ND_lim(x) = i - size;
+	    if (ND_low(x) > b)
+		ND_low(x) -= size;
+	    ps->node_at[i - size] = x;
+	}
+	dfs_range(ps->node_at, z, f, q - size);
+    } else {
+	/* u and those of its ancestors not above w now start later */
+	for (node_t *x = u; !SEQ(ND_low(x), ND_lim(w), ND_lim(x));
+	     x = tree_parent(x))
+	    if (ND_low(x) >= q)
+		ND_low(x) += size;
+	for (int i = a - 1; i >= q; i--) {
+	    node_t *x = ps->node_at[i];
+	    ND_lim(x) = i + size;
+	    if (ND_low(x) >= q)
+		ND_low(x) += size;
+	    ps->node_at[i + size] = x;
+	}
+	/* except those ancestors of w the subtree is now the start of */
+	for (node_t *x = w; ND_low(x) == q + size; x = tree_parent(x))
+	    ND_low(x) = q;
+	dfs_range(ps->node_at, z, f, q);
+    }
 }
 
 /* e is the tree edge that is leaving and f is the nontree edge that
  * is entering.  compute new cut values, ranks, and exchange e and f.
  */
 static int
-update(edge_t * e, edge_t * f)
+update(pivots_t *ps, edge_t * e, edge_t * f)
 {
     int cutvalue, delta;
     Agnode_t *lca;
@@ -635,36 +849,32 @@ update(edge_t * e, edge_t * f)
     if (delta > 0) {
 	size_t s = ND_tree_in(agtail(e)).size + ND_tree_out(agtail(e)).size;
 	if (s == 1)
-	    rerank(agtail(e), delta);
+	    rerank_side(ps, e, agtail(e), delta);
 	else {
 	    s = ND_tree_in(aghead(e)).size + ND_tree_out(aghead(e)).size;
 	    if (s == 1)
-		rerank(aghead(e), -delta);
+		rerank_side(ps, e, aghead(e), -delta);
 	    else {
 		if (ND_lim(agtail(e)) < ND_lim(aghead(e)))
-		    rerank(agtail(e), delta);
+		    rerank_side(ps, e, agtail(e), delta);
 		else
-		    rerank(aghead(e), -delta);
+		    rerank_side(ps, e, aghead(e), -delta);
 	    }
 	}
     }
 
     cutvalue = ED_cutvalue(e);
-    lca = treeupdate(agtail(f), aghead(f), cutvalue, 1);
-    if (treeupdate(aghead(f), agtail(f), cutvalue, 0) != lca) {
+    lca = treeupdate(ps, agtail(f), aghead(f), cutvalue, 1);
+    if (treeupdate(ps, aghead(f), agtail(f), cutvalue, 0) != lca) {
 	agerrorf("update: mismatched lca in treeupdates\n");
 	return 2;
     }
 
-    // invalidate paths from LCA till affected nodes:
-    int lca_low = ND_low(lca);
-    invalidate_path(lca, aghead(f));
-    invalidate_path(lca, agtail(f));
-
     ED_cutvalue(f) = -cutvalue;
     ED_cutvalue(e) = 0;
     exchange_tree_edges(e, f);
-    dfs_range(lca, ND_par(lca), lca_low);
+    set_negative(ps, f);
+    renumber(ps, e, f);
     return 0;
 }
 
@@ -685,17 +895,23 @@ static int scan_and_normalize(void) {
     return Maxrank;
 }
 
-static void reset_lists(void) {
+static void reset_lists(pivots_t *ps) {
 
   free(Tree_node.list);
   Tree_node = (nlist_t){0};
 
   free(Tree_edge.list);
   Tree_edge = (elist){0};
+
+  free(ps->negative);
+  ps->negative = NULL;
+
+  free(ps->node_at);
+  ps->node_at = NULL;
 }
 
 static void
-freeTreeList (graph_t* g)
+freeTreeList (graph_t* g, pivots_t *ps)
 {
     node_t *n;
     for (n = GD_nlist(g); n; n = ND_next(n)) {
@@ -703,10 +919,10 @@ freeTreeList (graph_t* g)
 	free_list(ND_tree_out(n));
 	ND_mark(n) = false;
     }
-    reset_lists();
+    reset_lists(ps);
 }
 
-static void LR_balance(void)
+static void LR_balance(pivots_t *ps)
 {
     int delta;
     edge_t *e, *f;
@@ -721,12 +937,13 @@ static void LR_balance(void)
 	    if (delta <= 1)
 		continue;
 	    if (ND_lim(agtail(e)) < ND_lim(aghead(e)))
-		rerank(agtail(e), delta / 2);
+		rerank_side(ps, e, agtail(e), delta / 2);
 	    else
-		rerank(aghead(e), -delta / 2);
+		rerank_side(ps, e, aghead(e), -delta / 2);
 	}
     }
-    freeTreeList (G);
+    remove_rank_offset(ps);
+    freeTreeList (G, ps);
 }
 
 static int decreasingrankcmpf(const void *x, const void *y) {
@@ -851,7 +1068,7 @@ static void TB_balance(void)
     free(nrank);
 }
 
-static bool init_graph(graph_t *g) {
+static bool init_graph(graph_t *g, pivots_t *ps) {
     node_t *n;
     edge_t *e;
 
@@ -866,6 +1083,8 @@ static bool init_graph(graph_t *g) {
 
     Tree_node.list = gv_calloc(N_nodes, sizeof(node_t *));
     Tree_edge.list = gv_calloc(N_nodes, sizeof(edge_t *));
+    ps->negative = gv_calloc(N_nodes / 64 + 1, sizeof(uint64_t));
+    ps->node_at = gv_calloc(N_nodes + 1, sizeof(node_t *));
 
     bool feasible = true;
     for (n = GD_nlist(g); n; n = ND_next(n)) {
@@ -925,6 +1144,8 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
     int iter = 0;
     char *ns = "network simplex: ";
     edge_t *e, *f;
+    double tree_sec = 0, iter_sec = 0;
+    pivots_t ps = {0};
 
 #ifdef DEBUG
     check_cycles(g);
@@ -936,7 +1157,7 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
 	    nn, ne, maxiter, balance);
 	start_timer();
     }
-    bool feasible = init_graph(g);
+    bool feasible = init_graph(g, &ps);
     if (!feasible)
 	init_rank();
 
@@ -946,25 +1167,25 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
 	Search_size = SEARCHSIZE;
 
     {
-	int err = feasible_tree();
+	int err = feasible_tree(&ps);
 	if (err != 0) {
-	    freeTreeList (g);
+	    freeTreeList (g, &ps);
 	    return err;
 	}
     }
+    if (Verbose)
+	tree_sec = elapsed_sec();
     if (maxiter <= 0) {
-	freeTreeList (g);
+	freeTreeList (g, &ps);
 	return 0;
     }
 
-    while ((e = leave_edge())) {
-	int err;
+    int err = 0;
+    while ((e = leave_edge(&ps))) {
 	f = enter_edge(e);
-	err = update(e, f);
-	if (err != 0) {
-	    freeTreeList (g);
-	    return err;
-	}
+	err = update(&ps, e, f);
+	if (err != 0)
+	    break;
 	iter++;
 	if (Verbose && iter % 100 == 0) {
 	    if (iter % 1000 == 100)
@@ -976,24 +1197,36 @@ int rank2(graph_t * g, int balance, int maxiter, int search_size)
 	if (iter >= maxiter)
 	    break;
     }
+    remove_rank_offset(&ps);
+    if (err != 0) {
+	freeTreeList (g, &ps);
+	return err;
+    }
+    if (Verbose)
+	iter_sec = elapsed_sec();
     switch (balance) {
     case 1:
 	TB_balance();
-	reset_lists();
+	reset_lists(&ps);
 	break;
     case 2:
-	LR_balance();
+	LR_balance(&ps);
 	break;
     default:
 	(void)scan_and_normalize();
-	freeTreeList (G);
+	freeTreeList (G, &ps);
 	break;
     }
     if (Verbose) {
 	if (iter >= 100)
 	    fputc('\n', stderr);
+	const double total_sec = elapsed_sec();
 	fprintf(stderr, "%s%" PRISIZE_T " nodes %" PRISIZE_T " edges %d iter %.2f sec\n",
-		ns, N_nodes, N_edges, iter, elapsed_sec());
+		ns, N_nodes, N_edges, iter, total_sec);
+	fprintf(stderr, "%sfeasible tree %.2f sec, %d pivots %.2f sec (%.1f usec/pivot), balance %.2f sec\n",
+		ns, tree_sec, iter, iter_sec - tree_sec,
+		iter > 0 ? (iter_sec - tree_sec) * 1e6 / iter : 0.0,
+		total_sec - iter_sec);
     }
     return 0;
 }
@@ -1100,7 +1333,7 @@ static void dfs_cutval(node_t * v, edge_t * par)
 * ND_low(n) - min DFS index for nodes in sub-tree (>= 1)
 * ND_lim(n) - max DFS index for nodes in sub-tree
 */
-static int dfs_range_init(node_t *v, edge_t *par, int low) {
+static int dfs_range_init(node_t **node_at, node_t *v, edge_t *par, int low) {
     int i, lim;
 
     lim = low;
@@ -1110,18 +1343,19 @@ static int dfs_range_init(node_t *v, edge_t *par, int low) {
     for (i = 0; ND_tree_out(v).list[i]; i++) {
         edge_t *e = ND_tree_out(v).list[i];
         if (e != par) {
-            lim = dfs_range_init(aghead(e), e, lim);
+            lim = dfs_range_init(node_at, aghead(e), e, lim);
         }
     }
 
     for (i = 0; ND_tree_in(v).list[i]; i++) {
         edge_t *e = ND_tree_in(v).list[i];
         if (e != par) {
-            lim = dfs_range_init(agtail(e), e, lim);
+            lim = dfs_range_init(node_at, agtail(e), e, lim);
         }
     }
 
     ND_lim(v) = lim;
+    node_at[lim] = v;
 
     return lim + 1;
 }
@@ -1129,7 +1363,7 @@ static int dfs_range_init(node_t *v, edge_t *par, int low) {
 /*
  * Incrementally updates DFS range attributes
  */
-static int dfs_range(node_t * v, edge_t * par, int low)
+static int dfs_range(node_t **node_at, node_t * v, edge_t * par, int low)
 {
     edge_t *e;
     int i, lim;
@@ -1143,11 +1377,12 @@ static int dfs_range(node_t * v, edge_t * par, int low)
     ND_low(v) = low;
     for (i = 0; (e = ND_tree_out(v).list[i]); i++)
 	if (e != par)
-	    lim = dfs_range(aghead(e), e, lim);
+	    lim = dfs_range(node_at, aghead(e), e, lim);
     for (i = 0; (e = ND_tree_in(v).list[i]); i++)
 	if (e != par)
-	    lim = dfs_range(agtail(e), e, lim);
+	    lim = dfs_range(node_at, agtail(e), e, lim);
     ND_lim(v) = lim;
+    node_at[lim] = v;
     return lim + 1;
 }
 
@@ -17,11 +17,12 @@
 #include <util/agxbuf.h>
 #include <util/alloc.h>
 #include <util/prisize_t.h>
+#include <util/tls.h>
 #include <util/unreachable.h>
 
-static int Rankdir;
-static bool Flip;
-static pointf Offset;
+static TLS int Rankdir;
+static TLS bool Flip;
+static TLS pointf Offset;
 
 static void place_flip_graph_label(graph_t * g);
 
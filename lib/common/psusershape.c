@@ -17,10 +17,14 @@
 #include <stdio.h>
 #include <util/alloc.h>
 #include <util/gv_fopen.h>
+#include <util/lock.h>
 #include <util/strcasecmp.h>
+#include <util/tls.h>
 
+/* EPSF files read so far, shared by all threads */
 static int N_EPSF_files;
 static Dict_t *EPSF_contents;
+static gv_lock_t EPSF_lock = GV_LOCK_INIT;
 
 static void ps_image_free(void *shape) {
     usershape_t *p = shape;
@@ -33,7 +37,7 @@ static Dtdisc_t ImageDictDisc = {
     .freef = ps_image_free,
 };
 
-static usershape_t *user_init(const char *str)
+static usershape_t *user_load(const char *str)
 {
     char line[BUFSIZ];
     FILE *fp;
@@ -94,6 +98,14 @@ static usershape_t *user_init(const char *str)
     return us;
 }
 
+static usershape_t *user_init(const char *str)
+{
+    gv_lock(&EPSF_lock);
+    usershape_t *us = user_load(str);
+    gv_unlock(&EPSF_lock);
+    return us;
+}
+
 void epsf_init(node_t * n)
 {
     epsf_t *desc;
@@ -207,17 +219,19 @@ void epsf_emit_body(GVJ_t *job, usershape_t *us)
 
 void epsf_define(GVJ_t *job)
 {
-    if (!EPSF_contents)
-	return;
-    for (usershape_t *us = dtfirst(EPSF_contents); us; us = dtnext(EPSF_contents, us)) {
-	if (us->must_inline)
-	    continue;
-	gvprintf(job, "/user_shape_%d {\n", us->macro_id);
-	gvputs(job, "%%BeginDocument:\n");
-	epsf_emit_body(job, us);
-	gvputs(job, "%%EndDocument\n");
-	gvputs(job, "} bind def\n");
+    gv_lock(&EPSF_lock);
+    if (EPSF_contents) {
+	for (usershape_t *us = dtfirst(EPSF_contents); us; us = dtnext(EPSF_contents, us)) {
+	    if (us->must_inline)
+		continue;
+	    gvprintf(job, "/user_shape_%d {\n", us->macro_id);
+	    gvputs(job, "%%BeginDocument:\n");
+	    epsf_emit_body(job, us);
+	    gvputs(job, "%%EndDocument\n");
+	    gvputs(job, "} bind def\n");
+	}
     }
+    gv_unlock(&EPSF_lock);
 }
 
 enum {ASCII, LATIN1, NONLATIN};
@@ -254,8 +268,8 @@ charsetOf (char* s)
 char *ps_string(char *ins, int chset)
 {
     char *base;
-    static agxbuf  xb;
-    static int warned;
+    static TLS agxbuf  xb;
+    static TLS int warned;
 
     switch (chset) {
     case CHAR_UTF8 :
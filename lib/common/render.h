@@ -95,6 +95,7 @@ extern "C" {
     RENDER_API void emit_label(GVJ_t * job, emit_state_t emit_state, textlabel_t *);
     RENDER_API bool emit_once(char *message);
     RENDER_API void emit_once_reset(void);
+    RENDER_API void emit_index_reset(GVC_t *gvc);
     RENDER_API void emit_map_rect(GVJ_t *job, boxf b);
     RENDER_API void endpath(path *, Agedge_t *, int, pathend_t *, bool);
     RENDER_API void epsf_init(node_t * n);
@@ -142,6 +143,8 @@ extern "C" {
                               int rotate);
     RENDER_API stroke_t taper (bezier*, double (*radfunc_t)(double,double,double), double initwid);
     RENDER_API pointf textspan_size(GVC_t * gvc, textspan_t * span);
+    RENDER_API void textspan_size_batch(GVC_t *gvc, textspan_t **spans,
+                                        size_t n);
     RENDER_API void textfont_dict_open(GVC_t *gvc);
     RENDER_API void textfont_dict_close(GVC_t *gvc);
     RENDER_API void translate_bb(Agraph_t *, int);
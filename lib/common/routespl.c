@@ -27,11 +27,12 @@
 #include <util/alloc.h>
 #include <util/gv_math.h>
 #include <util/prisize_t.h>
+#include <util/tls.h>
 
-static int nedges; ///< total no. of edges used in routing
-static size_t nboxes; ///< total no. of boxes used in routing
+static TLS int nedges; ///< total no. of edges used in routing
+static TLS size_t nboxes; ///< total no. of boxes used in routing
 
-static int routeinit;
+static TLS int routeinit;
 
 static int checkpath(size_t, boxf *, path *);
 static void printpath(path * pp);
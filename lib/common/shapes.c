@@ -22,7 +22,9 @@
 #include <string.h>
 #include <util/alloc.h>
 #include <util/gv_math.h>
+#include <util/lock.h>
 #include <util/streq.h>
+#include <util/tls.h>
 #include <util/unreachable.h>
 
 #define RBCONST 12
@@ -3352,7 +3354,7 @@ static bool ISCTRL(int c) {
   return c == '{' || c == '}' || c == '|' || c == '<' || c == '>';
 }
 
-static char *reclblp;
+static TLS char *reclblp;
 
 static void free_field(field_t * f)
 {
@@ -3956,10 +3958,12 @@ static void record_gencode(GVJ_t * job, node_t * n)
     }
 }
 
+/* user shapes are shared by all threads, and are never freed */
 static shape_desc **UserShape;
 static size_t N_UserShape;
+static gv_lock_t UserShapeLock = GV_LOCK_INIT;
 
-shape_desc *find_user_shape(const char *name)
+static shape_desc *find_user_shape_locked(const char *name)
 {
     if (UserShape) {
 	for (size_t i = 0; i < N_UserShape; i++) {
@@ -3970,12 +3974,23 @@ shape_desc *find_user_shape(const char *name)
     return NULL;
 }
 
+shape_desc *find_user_shape(const char *name)
+{
+    gv_lock(&UserShapeLock);
+    shape_desc *p = find_user_shape_locked(name);
+    gv_unlock(&UserShapeLock);
+    return p;
+}
+
 static shape_desc *user_shape(char *name)
 {
     shape_desc *p;
 
-    if ((p = find_user_shape(name)))
+    gv_lock(&UserShapeLock);
+    if ((p = find_user_shape_locked(name))) {
+	gv_unlock(&UserShapeLock);
 	return p;
+    }
     size_t i = N_UserShape++;
     UserShape = gv_recalloc(UserShape, N_UserShape - 1, N_UserShape, sizeof(shape_desc *));
     p = UserShape[i] = gv_alloc(sizeof(shape_desc));
@@ -3988,6 +4003,7 @@ static shape_desc *user_shape(char *name)
     } else {
 	p->usershape = true;
     }
+    gv_unlock(&UserShapeLock);
     return p;
 }
 
@@ -14,6 +14,7 @@
  * Contributors: Details at https://graphviz.org
  *************************************************************************/
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -21,7 +22,9 @@
 #include <common/render.h>
 #include <common/textspan_lut.h>
 #include <util/alloc.h>
+#include <util/prisize_t.h>
 #include <util/strcasecmp.h>
+#include <util/tls.h>
 
 /* estimate_textspan_size:
  * Estimate size of textspan, for given face and size, in points.
@@ -63,8 +66,8 @@ static int fontcmpf(const void *a, const void *b)
 
 static PostscriptAlias* translate_postscript_fontname(char* fontname)
 {
-    static char *key;
-    static PostscriptAlias *result;
+    static TLS char *key;
+    static TLS PostscriptAlias *result;
 
     if (key == NULL || strcasecmp(key, fontname)) {
         free(key);
@@ -76,10 +79,214 @@ static PostscriptAlias* translate_postscript_fontname(char* fontname)
     return result;
 }
 
-pointf textspan_size(GVC_t *gvc, textspan_t * span)
-/// Estimates size of a textspan, in points.
+/* Labels repeat: many nodes share a handful of names of types, and records
+ * and HTML tables split into the same fields. So the measurements of spans
+ * are kept per GVC_t, by font name, size and flags and the text, in an open
+ * addressing hash table with linear probing. A span found there gets the size
+ * and offsets measured before, but no layout; renderers that draw with the
+ * layout of a span make one when it has none.
+ *
+ * A context can live for as long as a process, laying out graph after graph,
+ * so once the table holds MAX_METRICS spans it is emptied and filled afresh.
+ */
+
+/* the measurements of a span */
+typedef struct {
+    double fontsize;
+    unsigned flags;
+    pointf size;
+    double yoffset_layout, yoffset_centerline;
+    size_t str;		/* where the text starts in <key> */
+    char key[];		/* font name and text, each NUL terminated */
+} metrics_t;
+
+typedef struct {
+    uint64_t hash;
+    metrics_t *m;	/* NULL if free */
+} metrics_slot_t;
+
+struct textspan_cache_s {
+    metrics_slot_t *slots;
+    size_t capacity;	/* number of slots, a power of 2 */
+    size_t size;	/* slots in use, at most half of them */
+    const void *engine;	/* textlayout engine the spans were measured with */
+    size_t hits, misses;
+};
+
+typedef struct textspan_cache_s textspan_cache_t;
+
+enum { MIN_METRICS_SLOTS = 64, MAX_METRICS = 1 << 16 };
+
+static void textspan_cache_clear(textspan_cache_t *cache)
+{
+    for (size_t i = 0; i < cache->capacity; i++)
+	free(cache->slots[i].m);
+    free(cache->slots);
+    cache->capacity = MIN_METRICS_SLOTS;
+    cache->slots = gv_calloc(cache->capacity, sizeof(metrics_slot_t));
+    cache->size = 0;
+}
+
+/* the cache of gvc, emptied if the textlayout engine changed */
+static textspan_cache_t *textspan_cache(GVC_t *gvc)
+{
+    textspan_cache_t *cache = gvc->textspan_cache;
+    if (cache == NULL) {
+	cache = gv_alloc(sizeof(textspan_cache_t));
+	textspan_cache_clear(cache);
+	cache->engine = gvc->textlayout.engine;
+	gvc->textspan_cache = cache;
+    } else if (cache->engine != gvc->textlayout.engine) {
+	textspan_cache_clear(cache);
+	cache->engine = gvc->textlayout.engine;
+    }
+    return cache;
+}
+
+static uint64_t mix(uint64_t h, uint64_t w)
+{
+    h = (h ^ w) * 0xff51afd7ed558ccdull;
+    return h ^ (h >> 32);
+}
+
+/* hash the bytes of a string into h */
+static uint64_t mix_str(uint64_t h, const char *s)
+{
+    const size_t n = strlen(s);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= n; i += sizeof(uint64_t)) {
+	uint64_t w;
+	memcpy(&w, s + i, sizeof(w));
+	h = mix(h, w);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, s + i, n - i);
+    return mix(h, tail ^ ((uint64_t)n << 56));
+}
+
+static uint64_t span_hash(const textspan_t *span)
+{
+    uint64_t size;
+    memcpy(&size, &span->font->size, sizeof(size));
+    uint64_t h = mix(size * 0x9e3779b97f4a7c15ull, span->font->flags);
+    h = mix_str(h, span->font->name);
+    return mix_str(h, span->str);
+}
+
+static bool metrics_match(const metrics_t *m, const textspan_t *span)
+{
+    return m->fontsize == span->font->size && m->flags == span->font->flags
+        && strcmp(m->key, span->font->name) == 0
+        && strcmp(m->key + m->str, span->str) == 0;
+}
+
+/* index of the slot holding the measurements of span, or of the free slot
+ * where they would go
+ */
+static size_t metrics_lookup(const textspan_cache_t *cache,
+                             const textspan_t *span, uint64_t hash)
+{
+    const size_t mask = cache->capacity - 1;
+    size_t i = (size_t)hash & mask;
+    for (; cache->slots[i].m; i = (i + 1) & mask) {
+	const metrics_slot_t *slot = &cache->slots[i];
+	if (slot->hash == hash && metrics_match(slot->m, span))
+	    break;
+    }
+    return i;
+}
+
+static void metrics_grow(textspan_cache_t *cache)
+{
+    metrics_slot_t *old = cache->slots;
+    const size_t old_capacity = cache->capacity;
+    cache->capacity *= 2;
+    cache->slots = gv_calloc(cache->capacity, sizeof(metrics_slot_t));
+    const size_t mask = cache->capacity - 1;
+    for (size_t i = 0; i < old_capacity; i++) {
+	if (old[i].m) {
+	    size_t j = (size_t)old[i].hash & mask;
+	    while (cache->slots[j].m)
+		j = (j + 1) & mask;
+	    cache->slots[j] = old[i];
+	}
+    }
+    free(old);
+}
+
+/* remember the measurements of a span that were not found in slot i */
+static void metrics_add(textspan_cache_t *cache, const textspan_t *span,
+                        uint64_t hash, size_t i)
+{
+    if (cache->size >= MAX_METRICS) {
+	textspan_cache_clear(cache);
+	i = metrics_lookup(cache, span, hash);
+    } else if ((cache->size + 1) * 2 > cache->capacity) {
+	metrics_grow(cache);
+	i = metrics_lookup(cache, span, hash);
+    }
+    const size_t name_len = strlen(span->font->name);
+    const size_t str_len = strlen(span->str);
+    metrics_t *m = gv_alloc(sizeof(metrics_t) + name_len + str_len + 2);
+    m->fontsize = span->font->size;
+    m->flags = span->font->flags;
+    m->size = span->size;
+    m->yoffset_layout = span->yoffset_layout;
+    m->yoffset_centerline = span->yoffset_centerline;
+    m->str = name_len + 1;
+    memcpy(m->key, span->font->name, name_len + 1);
+    memcpy(m->key + m->str, span->str, str_len + 1);
+    cache->slots[i] = (metrics_slot_t){.hash = hash, .m = m};
+    cache->size++;
+}
+
+static void textspan_cache_close(GVC_t *gvc)
+{
+    textspan_cache_t *cache = gvc->textspan_cache;
+    if (cache == NULL)
+	return;
+    if (Verbose)
+	fprintf(stderr, "text metrics cache: %" PRISIZE_T " hits, %" PRISIZE_T
+	        " misses, %" PRISIZE_T " spans\n", cache->hits, cache->misses,
+	        cache->size);
+    for (size_t i = 0; i < cache->capacity; i++)
+	free(cache->slots[i].m);
+    free(cache->slots);
+    free(cache);
+    gvc->textspan_cache = NULL;
+}
+
+/* fill in the measurements of span from the cache, if they are there */
+static bool metrics_get(textspan_cache_t *cache, textspan_t *span)
+{
+    const metrics_t *m =
+        cache->slots[metrics_lookup(cache, span, span_hash(span))].m;
+    if (!m)
+	return false;
+    cache->hits++;
+    span->size = m->size;
+    span->yoffset_layout = m->yoffset_layout;
+    span->yoffset_centerline = m->yoffset_centerline;
+    span->layout = NULL;
+    span->free_layout = NULL;
+    return true;
+}
+
+/* remember the measurements of a span that was just measured */
+static void metrics_put(textspan_cache_t *cache, const textspan_t *span)
+{
+    cache->misses++;
+    const uint64_t hash = span_hash(span);
+    const size_t i = metrics_lookup(cache, span, hash);
+    if (!cache->slots[i].m)
+	metrics_add(cache, span, hash, i);
+}
+
+/* resolve the PostScript alias of the font of span, returning whether where
+ * the font comes from should be reported
+ */
+static bool textspan_font(textspan_t *span)
 {
-    char **fpp = NULL, *fontpath = NULL;
     textfont_t *font;
 
     assert(span->font);
@@ -91,23 +298,76 @@ pointf textspan_size(GVC_t *gvc, textspan_t * span)
     if (! font->postscript_alias) 
         font->postscript_alias = translate_postscript_fontname(font->name);
 
-    if (Verbose && emit_once(font->name))
+    return Verbose && emit_once(font->name);
+}
+
+/* measure a span that is not in the cache, or whose font is to be reported */
+static void textspan_measure(GVC_t *gvc, textspan_cache_t *cache,
+                             textspan_t *span, bool report)
+{
+    char **fpp = NULL, *fontpath = NULL;
+
+    if (report)
 	fpp = &fontpath;
 
     if (! gvtextlayout(gvc, span, fpp))
 	estimate_textspan_size(span, fpp);
 
+    metrics_put(cache, span);
+
     if (fpp) {
 	if (fontpath)
 	    fprintf(stderr, "fontname: \"%s\" resolved to: %s\n",
-		    font->name, fontpath);
+		    span->font->name, fontpath);
 	else
-	    fprintf(stderr, "fontname: unable to resolve \"%s\"\n", font->name);
+	    fprintf(stderr, "fontname: unable to resolve \"%s\"\n",
+		    span->font->name);
     }
+}
+
+pointf textspan_size(GVC_t *gvc, textspan_t * span)
+/// Estimates size of a textspan, in points.
+{
+    const bool report = textspan_font(span);
+    textspan_cache_t *cache = textspan_cache(gvc);
+
+    /* the first span of a font is measured to report where the font is from */
+    if (report || !metrics_get(cache, span))
+	textspan_measure(gvc, cache, span, report);
 
     return span->size;
 }
 
+void textspan_size_batch(GVC_t *gvc, textspan_t **spans, size_t n)
+/// Estimates sizes of textspans, in points, passing those not measured
+/// before to the textlayout engine together.
+{
+    textspan_cache_t *cache = textspan_cache(gvc);
+    textspan_t **pending = gv_calloc(n, sizeof(textspan_t *));
+    size_t npending = 0;
+
+    for (size_t i = 0; i < n; i++) {
+	textspan_t *span = spans[i];
+	const bool report = textspan_font(span);
+	if (report)
+	    textspan_measure(gvc, cache, span, report);
+	else if (!metrics_get(cache, span))
+	    pending[npending++] = span;
+    }
+
+    if (npending > 0) {
+	bool *laid_out = gv_calloc(npending, sizeof(bool));
+	gvtextlayout_spans(gvc, pending, npending, laid_out);
+	for (size_t i = 0; i < npending; i++) {
+	    if (!laid_out[i])
+		estimate_textspan_size(pending[i], NULL);
+	    metrics_put(cache, pending[i]);
+	}
+	free(laid_out);
+    }
+    free(pending);
+}
+
 static void *textfont_makef(void *obj, Dtdisc_t *disc) {
     (void)disc;
 
@@ -164,5 +424,6 @@ void textfont_dict_open(GVC_t *gvc) {
 
 void textfont_dict_close(GVC_t *gvc)
 {
+    textspan_cache_close(gvc);
     dtclose(gvc->textfont_dt);
 }
@@ -12,6 +12,7 @@
 #include <string.h>
 #include <util/agxbuf.h>
 #include <util/gv_ctype.h>
+#include <util/tls.h>
 
 // Currently we just store the width of every ASCII character, which seems to
 // produce good enough results. We could also store kerning metrics and line
@@ -801,7 +802,7 @@ static unsigned short
 estimate_character_width_canonical(const short variant_metrics[128],
                                    unsigned character) {
   if (character >= 128) {
-    static bool warning_already_reported = false;
+    static TLS bool warning_already_reported = false;
     if (!warning_already_reported) { // stderr spam prevention
       warning_already_reported = true;
       agwarningf(
@@ -813,7 +814,7 @@ estimate_character_width_canonical(const short variant_metrics[128],
   }
   short width = variant_metrics[character];
   if (width == -1) {
-    static bool warning_already_reported = false;
+    static TLS bool warning_already_reported = false;
     if (!warning_already_reported) { // stderr spam prevention
       warning_already_reported = true;
       agwarningf(
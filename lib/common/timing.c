@@ -37,8 +37,9 @@ typedef clock_t mytime_t;
 
 #include <common/types.h>
 #include <common/utils.h>
+#include <util/tls.h>
 
-static mytime_t T;
+static TLS mytime_t T;
 
 void start_timer(void)
 {
@@ -293,6 +293,7 @@ typedef enum {NATIVEFONTS,PSFONTS,SVGFONTS} fontname_kind;
 	void *alg;
 	GVC_t *gvc;	/* context for "globals" over multiple graphs */
 	void (*cleanup) (graph_t * g);   /* function to deallocate layout-specific data */
+	struct gv_layout_state_s *layout_state; /* state the layout set up, for rendering */
 
 #ifndef DOT_ONLY
 	/* to place nodes */
@@ -354,6 +355,7 @@ typedef enum {NATIVEFONTS,PSFONTS,SVGFONTS} fontname_kind;
 #define GD_bb(g) (((Agraphinfo_t*)AGDATA(g))->bb)
 #define GD_gvc(g) (((Agraphinfo_t*)AGDATA(g))->gvc)
 #define GD_cleanup(g) (((Agraphinfo_t*)AGDATA(g))->cleanup)
+#define GD_layout_state(g) (((Agraphinfo_t*)AGDATA(g))->layout_state)
 #define GD_dist(g) (((Agraphinfo_t*)AGDATA(g))->dist)
 #define GD_alg(g) (((Agraphinfo_t*)AGDATA(g))->alg)
 #define GD_border(g) (((Agraphinfo_t*)AGDATA(g))->border)
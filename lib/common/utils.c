@@ -29,16 +29,13 @@
 #include <util/strcasecmp.h>
 #include <util/streq.h>
 #include <util/strview.h>
+#include <util/tls.h>
 
 int late_int(void *obj, attrsym_t *attr, int defaultValue, int minimum) {
     if (attr == NULL)
         return defaultValue;
-    char *p = ag_xget(obj, attr);
-    if (!p || p[0] == '\0')
-        return defaultValue;
-    char *endp;
-    long rv = strtol(p, &endp, 10);
-    if (p == endp || rv > INT_MAX)
+    long rv;
+    if (!agxgetint(obj, attr, &rv) || rv > INT_MAX)
         return defaultValue; /* invalid int format */
     if (rv < minimum)
         return minimum;
@@ -49,12 +46,8 @@ double late_double(void *obj, attrsym_t *attr, double defaultValue,
                    double minimum) {
     if (!attr || !obj)
         return defaultValue;
-    char *p = ag_xget(obj, attr);
-    if (!p || p[0] == '\0')
-        return defaultValue;
-    char *endp;
-    double rv = strtod(p, &endp);
-    if (p == endp)
+    double rv;
+    if (!agxgetdouble(obj, attr, &rv))
         return defaultValue; /* invalid double format */
     if (rv < minimum)
         return minimum;
@@ -92,7 +85,8 @@ bool late_bool(void *obj, attrsym_t *attr, bool defaultValue) {
     if (attr == NULL)
         return defaultValue;
 
-    return mapbool(agxget(obj, attr));
+    bool rv;
+    return agxgetbool(obj, attr, &rv) && rv;
 }
 
 node_t *UF_find(node_t * n)
@@ -244,7 +238,7 @@ static strview_t *mkDirlist(const char *list) {
 }
 
 static char *findPath(const strview_t *dirs, const char *str) {
-    static agxbuf safefilename;
+    static TLS agxbuf safefilename;
 
     for (const strview_t *dp = dirs; dp != NULL && dp->data != NULL; dp++) {
 	agxbprint(&safefilename, "%.*s%s%s", (int)dp->size, dp->data, DIRSEP, str);
@@ -257,9 +251,9 @@ static char *findPath(const strview_t *dirs, const char *str) {
 
 const char *safefile(const char *filename)
 {
-    static bool onetime = true;
-    static char *pathlist = NULL;
-    static strview_t *dirs;
+    static TLS bool onetime = true;
+    static TLS char *pathlist = NULL;
+    static TLS strview_t *dirs;
 
     if (!filename || !filename[0])
 	return NULL;
@@ -397,7 +391,7 @@ pointf dotneato_closest(splines * spl, pointf pt)
     return pt2;
 }
 
-static int Tflag;
+static TLS int Tflag;
 void gvToggle(int s)
 {
     (void)s;
@@ -725,7 +719,7 @@ static node_t *clustNode(node_t * n, graph_t * cg, agxbuf * xb,
 			 graph_t * clg)
 {
     node_t *cn;
-    static int idx = 0;
+    static TLS int idx = 0;
 
     agxbprint(xb, "__%d:%s", idx++, agnameof(cg));
 
@@ -1191,8 +1185,8 @@ cvtAndAppend (unsigned char c, agxbuf* xb)
  */
 char* htmlEntityUTF8 (char* s, graph_t* g)
 {
-    static graph_t* lastg;
-    static bool warned;
+    static TLS graph_t* lastg;
+    static TLS bool warned;
     unsigned char c;
     unsigned int v;
 
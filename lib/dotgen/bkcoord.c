@@ -0,0 +1,381 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+/*
+ * Linear time x coordinate assignment after
+ *   U. Brandes, B. Köpf, Fast and Simple Horizontal Coordinate Assignment,
+ *   Graph Drawing 2001, LNCS 2265, pp. 31-44.
+ *
+ * Used in place of network simplex on the auxiliary graph when xcoord=bk.
+ * Each of the four combinations of aligning nodes with the medians of their
+ * neighbours above or below, and of resolving conflicts from the left or the
+ * right, packs the resulting vertical blocks as tightly as the node
+ * separations allow. The layouts are aligned to the narrowest of them and each
+ * node gets the average of its two median positions. Edges between two
+ * virtual nodes are kept straight in preference to edges they cross.
+ *
+ * Only the separation of neighbours on a rank is enforced, which is all the
+ * constraints of a graph without clusters or labelled flat edges, except that
+ * flat edges between nodes that are not neighbours do not get their minlen.
+ */
+
+#include <dotgen/dot.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <util/alloc.h>
+
+typedef struct {
+    int nranks;
+    int *first;		/* ids of rank r's nodes are [first[r], first[r + 1]) */
+    int *rank;		/* of each node, from 0 */
+    int *pos;		/* of each node within its rank */
+    int *gap;		/* least distance from each node to its right neighbour */
+    /* neighbours on the rank above and below, ordered by position, and whether
+     * the edge to them loses a type 1 conflict
+     */
+    int *up_start, *up;
+    bool *up_conflict;
+    int *down_start, *down;
+    bool *down_conflict;
+} layers_t;
+
+static int node_id(const layers_t *L, graph_t *g, node_t *v) {
+    return L->first[ND_rank(v) - GD_minrank(g)] + ND_order(v);
+}
+
+/* An inner segment is an edge between two virtual nodes. Mark the edges that
+ * cross one, so that alignment leaves long edges straight.
+ */
+static void mark_conflicts(layers_t *L, graph_t *g) {
+    for (int r = 1; r < L->nranks; r++) {
+	const int lo = L->first[r], hi = L->first[r + 1];
+	const int above = L->first[r] - L->first[r - 1];
+	int k0 = 0;
+	int l = lo;
+	for (int l1 = lo; l1 < hi; l1++) {
+	    node_t *v = GD_rank(g)[r + GD_minrank(g)].v[l1 - lo];
+	    int inner = -1;
+	    if (ND_node_type(v) == VIRTUAL) {
+		for (int j = L->up_start[l1]; j < L->up_start[l1 + 1]; j++) {
+		    node_t *u = GD_rank(g)[r - 1 + GD_minrank(g)].v[L->pos[L->up[j]]];
+		    if (ND_node_type(u) == VIRTUAL)
+			inner = L->pos[L->up[j]];
+		}
+	    }
+	    if (l1 == hi - 1 || inner >= 0) {
+		const int k1 = inner >= 0 ? inner : above - 1;
+		for (; l <= l1; l++) {
+		    for (int j = L->up_start[l]; j < L->up_start[l + 1]; j++) {
+			const int k = L->pos[L->up[j]];
+			if (k < k0 || k > k1)
+			    L->up_conflict[j] = true;
+		    }
+		}
+		k0 = k1;
+	    }
+	}
+    }
+}
+
+static bool build_layers(layers_t *L, graph_t *g) {
+    const int nranks = GD_maxrank(g) - GD_minrank(g) + 1;
+    rank_t *rank = GD_rank(g) + GD_minrank(g);
+    int sep[2];
+
+    if (GD_has_labels(g->root) & EDGE_LABEL) {
+	sep[0] = GD_nodesep(g);
+	sep[1] = 5;
+    } else {
+	sep[1] = sep[0] = GD_nodesep(g);
+    }
+
+    L->nranks = nranks;
+    L->first = gv_calloc((size_t)nranks + 1, sizeof(int));
+    for (int r = 0; r < nranks; r++)
+	L->first[r + 1] = L->first[r] + rank[r].n;
+    const size_t n = (size_t)L->first[nranks];
+    L->rank = gv_calloc(n, sizeof(int));
+    L->pos = gv_calloc(n, sizeof(int));
+    L->gap = gv_calloc(n, sizeof(int));
+    L->up_start = gv_calloc(n + 1, sizeof(int));
+    L->down_start = gv_calloc(n + 1, sizeof(int));
+
+    for (int r = 0; r < nranks; r++) {
+	for (int j = 0; j < rank[r].n; j++) {
+	    node_t *u = rank[r].v[j];
+	    const int id = L->first[r] + j;
+	    L->rank[id] = r;
+	    L->pos[id] = j;
+	    node_t *v = rank[r].v[j + 1];
+	    if (v == NULL)
+		continue;
+	    double width = ND_rw(u) + ND_lw(v);
+	    int gap = ROUND(width + sep[(r + GD_minrank(g)) & 1]);
+	    /* a flat edge between neighbours can ask for more room */
+	    for (int k = 0; k < 2; k++) {
+		const elist flat = k == 0 ? ND_flat_out(u) : ND_flat_in(u);
+		for (size_t i = 0; i < flat.size; i++) {
+		    edge_t *e = flat.list[i];
+		    if (agtail(e) != v && aghead(e) != v)
+			continue;
+		    if (ED_label(e))
+			return false;
+		    int m0 = ED_minlen(e) * GD_nodesep(g) + ROUND(width);
+		    m0 = MAX(m0, ROUND(width) + GD_nodesep(g) + ROUND(ED_dist(e)));
+		    gap = MAX(gap, m0);
+		}
+	    }
+	    L->gap[id] = gap;
+	}
+    }
+
+    /* neighbours above, in order of position since the ranks are scanned in
+     * order, and from them those below
+     */
+    for (int r = 0; r < nranks; r++) {
+	for (int j = 0; j < rank[r].n; j++) {
+	    node_t *v = rank[r].v[j];
+	    edge_t *e;
+	    for (size_t i = 0; (e = ND_in(v).list[i]); i++) {
+		if (ND_rank(agtail(e)) != ND_rank(v) - 1)
+		    return false;
+		L->up_start[L->first[r] + j + 1]++;
+		L->down_start[node_id(L, g, agtail(e)) + 1]++;
+	    }
+	}
+    }
+    for (size_t i = 0; i < n; i++) {
+	L->up_start[i + 1] += L->up_start[i];
+	L->down_start[i + 1] += L->down_start[i];
+    }
+    const size_t m = (size_t)L->up_start[n];
+    L->up = gv_calloc(m, sizeof(int));
+    L->up_conflict = gv_calloc(m, sizeof(bool));
+    L->down = gv_calloc(m, sizeof(int));
+    L->down_conflict = gv_calloc(m, sizeof(bool));
+    int *fill = gv_calloc(n, sizeof(int));
+    for (size_t id = 0; id < n; id++) {
+	int *list = L->up + L->up_start[id];
+	const int d = L->up_start[id + 1] - L->up_start[id];
+	node_t *v = rank[L->rank[id]].v[L->pos[id]];
+	for (int i = 0; i < d; i++)
+	    list[i] = node_id(L, g, agtail(ND_in(v).list[i]));
+	/* insertion sort, as most nodes have few neighbours */
+	for (int i = 1; i < d; i++) {
+	    const int t = list[i];
+	    int k = i;
+	    for (; k > 0 && list[k - 1] > t; k--)
+		list[k] = list[k - 1];
+	    list[k] = t;
+	}
+    }
+    mark_conflicts(L, g);
+    for (size_t id = 0; id < n; id++) {
+	for (int j = L->up_start[id]; j < L->up_start[id + 1]; j++) {
+	    const int u = L->up[j];
+	    const int k = L->down_start[u] + fill[u]++;
+	    L->down[k] = (int)id;
+	    L->down_conflict[k] = L->up_conflict[j];
+	}
+    }
+    free(fill);
+    return true;
+}
+
+static void free_layers(layers_t *L) {
+    free(L->first);
+    free(L->rank);
+    free(L->pos);
+    free(L->gap);
+    free(L->up_start);
+    free(L->up);
+    free(L->up_conflict);
+    free(L->down_start);
+    free(L->down);
+    free(L->down_conflict);
+}
+
+/* Lay out the nodes aligned with their neighbours below if from_bottom, else
+ * above, resolving conflicts from the right if from_right, else the left.
+ * Returns false if the blocks could not be ordered, which should not happen.
+ */
+static bool layout(const layers_t *L, bool from_bottom, bool from_right,
+		   int *x) {
+    const int n = L->first[L->nranks];
+    const int *start = from_bottom ? L->down_start : L->up_start;
+    const int *nbr = from_bottom ? L->down : L->up;
+    const bool *conflict = from_bottom ? L->down_conflict : L->up_conflict;
+    int *root = gv_calloc((size_t)n, sizeof(int));
+    int *align = gv_calloc((size_t)n, sizeof(int));
+
+#define WIDTH(r) (L->first[(r) + 1] - L->first[r])
+    /* position of a node when looking from the right */
+#define VIEWPOS(v) (from_right ? WIDTH(L->rank[v]) - 1 - L->pos[v] : L->pos[v])
+
+    /* vertical alignment */
+    for (int v = 0; v < n; v++)
+	root[v] = align[v] = v;
+    for (int i = 0; i < L->nranks; i++) {
+	const int r = from_bottom ? L->nranks - 1 - i : i;
+	int prev = -1;
+	for (int k = 0; k < WIDTH(r); k++) {
+	    const int v = L->first[r] + (from_right ? WIDTH(r) - 1 - k : k);
+	    const int d = start[v + 1] - start[v];
+	    for (int m = (d - 1) / 2; m <= d / 2 && d > 0; m++) {
+		if (align[v] != v)
+		    break;
+		const int j = start[v] + (from_right ? d - 1 - m : m);
+		const int u = nbr[j];
+		if (conflict[j] || prev >= VIEWPOS(u))
+		    continue;
+		align[u] = v;
+		root[v] = root[u];
+		align[v] = root[v];
+		prev = VIEWPOS(u);
+	    }
+	}
+    }
+
+    /* Horizontal compaction: each block goes as far left as the blocks left of
+     * it allow, a longest path through the DAG of blocks in topological order.
+     * Edges point from a block to those of its nodes' right neighbours.
+     */
+    int *out_start = gv_calloc((size_t)n + 1, sizeof(int));
+    int *indeg = gv_calloc((size_t)n, sizeof(int));
+    for (int v = 0; v < n; v++) {
+	if (VIEWPOS(v) > 0) {
+	    const int p = v + (from_right ? 1 : -1);
+	    out_start[root[p] + 1]++;
+	    indeg[root[v]]++;
+	}
+    }
+    for (int v = 0; v < n; v++)
+	out_start[v + 1] += out_start[v];
+    int *out = gv_calloc((size_t)out_start[n], sizeof(int));
+    int *out_gap = gv_calloc((size_t)out_start[n], sizeof(int));
+    int *fill = gv_calloc((size_t)n, sizeof(int));
+    for (int v = 0; v < n; v++) {
+	if (VIEWPOS(v) > 0) {
+	    const int p = v + (from_right ? 1 : -1);
+	    const int k = out_start[root[p]] + fill[root[p]]++;
+	    out[k] = root[v];
+	    out_gap[k] = from_right ? L->gap[v] : L->gap[p];
+	}
+    }
+#undef VIEWPOS
+#undef WIDTH
+
+    /* reuse align as the queue of blocks ready to be placed */
+    int *queue = align;
+    int head = 0, tail = 0;
+    for (int v = 0; v < n; v++) {
+	x[v] = 0;
+	if (root[v] == v && indeg[v] == 0)
+	    queue[tail++] = v;
+    }
+    while (head < tail) {
+	const int b = queue[head++];
+	for (int k = out_start[b]; k < out_start[b + 1]; k++) {
+	    const int c = out[k];
+	    x[c] = MAX(x[c], x[b] + out_gap[k]);
+	    if (--indeg[c] == 0)
+		queue[tail++] = c;
+	}
+    }
+    int blocks = 0;
+    for (int v = 0; v < n; v++) {
+	if (root[v] == v)
+	    blocks++;
+    }
+    const bool ok = tail == blocks;
+    for (int v = 0; v < n; v++)
+	x[v] = x[root[v]];
+    if (from_right) {
+	for (int v = 0; v < n; v++)
+	    x[v] = -x[v];
+    }
+
+    free(root);
+    free(align);
+    free(out_start);
+    free(indeg);
+    free(out);
+    free(out_gap);
+    free(fill);
+    return ok;
+}
+
+static int intcmp(const void *x, const void *y) {
+    const int a = *(const int *)x;
+    const int b = *(const int *)y;
+    return (a > b) - (a < b);
+}
+
+bool dot_bk_position(graph_t *g) {
+    layers_t L = {0};
+    bool ok = build_layers(&L, g);
+    const int n = L.first != NULL ? L.first[L.nranks] : 0;
+    int *xs[4] = {0};
+    int lo[4], hi[4];
+
+    for (int k = 0; k < 4 && ok; k++) {
+	xs[k] = gv_calloc((size_t)n, sizeof(int));
+	ok = layout(&L, k & 1, (k & 2) != 0, xs[k]);
+	lo[k] = INT_MAX;
+	hi[k] = INT_MIN;
+	for (int v = 0; v < n; v++) {
+	    lo[k] = MIN(lo[k], xs[k][v]);
+	    hi[k] = MAX(hi[k], xs[k][v]);
+	}
+    }
+
+    if (ok && n > 0) {
+	/* align the left-packed layouts to the left of the narrowest one and the
+	 * right-packed ones to its right
+	 */
+	int narrowest = 0;
+	for (int k = 1; k < 4; k++) {
+	    if (hi[k] - lo[k] < hi[narrowest] - lo[narrowest])
+		narrowest = k;
+	}
+	int least = INT_MAX;
+	for (int k = 0; k < 4; k++) {
+	    const int shift = (k & 2) ? hi[narrowest] - hi[k] : lo[narrowest] - lo[k];
+	    for (int v = 0; v < n; v++)
+		xs[k][v] += shift;
+	    least = MIN(least, lo[k] + shift);
+	}
+	/* start at 0, so that halving below rounds the same way everywhere */
+	for (int k = 0; k < 4; k++) {
+	    for (int v = 0; v < n; v++)
+		xs[k][v] -= least;
+	}
+
+	/* The i-th smallest of a node's positions is at least the i-th smallest of
+	 * its left neighbour's plus their gap, so the rounded down average of the
+	 * two middle ones still keeps them apart.
+	 */
+	for (int r = 0; r < L.nranks; r++) {
+	    for (int j = 0; j < L.first[r + 1] - L.first[r]; j++) {
+		const int v = L.first[r] + j;
+		int p[4] = {xs[0][v], xs[1][v], xs[2][v], xs[3][v]};
+		qsort(p, 4, sizeof(int), intcmp);
+		node_t *u = GD_rank(g)[r + GD_minrank(g)].v[j];
+		ND_coord(u).x = (p[1] + p[2]) / 2;
+	    }
+	}
+    }
+
+    for (int k = 0; k < 4; k++)
+	free(xs[k]);
+    free_layers(&L);
+    return ok;
+}
@@ -294,9 +294,9 @@ void expand_cluster(graph_t * subg)
     GD_comp(subg).size = 1;
     GD_comp(subg).list[0] = GD_nlist(subg);
     allocate_ranks(subg);
-    ints_t scratch = {0};
+    int64s_t scratch = {0};
     build_ranks(subg, 0, &scratch);
-    ints_free(&scratch);
+    int64s_free(&scratch);
     merge_ranks(subg);
 
     /* build external structure of the cluster */
@@ -22,9 +22,10 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 
-static node_t *Last_node;
-static size_t Cmark;
+static TLS node_t *Last_node;
+static TLS size_t Cmark;
 
 static void 
 begin_component(graph_t* g)
@@ -17,13 +17,14 @@ extern "C" {
 #include <cgraph/list.h>
 #include <dotgen/aspect.h>
 #include <stdbool.h>
+#include <stdint.h>
 
-DEFINE_LIST(ints, int)
+DEFINE_LIST(int64s, int64_t)
 DEFINE_LIST(node_queue, Agnode_t *)
 
     extern void acyclic(Agraph_t *);
     extern void allocate_ranks(Agraph_t *);
-    extern void build_ranks(Agraph_t *, int, ints_t *);
+    extern void build_ranks(Agraph_t *, int, int64s_t *);
     extern void build_skeleton(Agraph_t *, Agraph_t *);
     extern void checkLabelOrder (graph_t* g);
     extern void class1(Agraph_t *);
@@ -71,6 +72,7 @@ DEFINE_LIST(node_queue, Agnode_t *)
     extern void zapinlist(elist *, Agedge_t *);
 
     extern Agraph_t* dot_root(void *);
+    extern bool dot_bk_position(Agraph_t *);
     extern void dot_concentrate(Agraph_t *);
     extern void dot_mincross(Agraph_t *);
     extern void dot_position(Agraph_t *);
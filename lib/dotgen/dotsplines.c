@@ -23,6 +23,7 @@
 #include <string.h>
 #include <util/agxbuf.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 
 #ifdef ORTHO
 #include <ortho/ortho.h>
@@ -1202,7 +1203,7 @@ static void make_flat_adj_edges(graph_t *g, edge_t **edges, unsigned ind,
   double midx, midy, leftx, rightx;
   pointf del;
   edge_t *hvye = NULL;
-  static bool warned = false;
+  static TLS bool warned = false;
 
   tn = agtail(e0), hn = aghead(e0);
   if (shapeOf(tn) == SH_RECORD || shapeOf(hn) == SH_RECORD) {
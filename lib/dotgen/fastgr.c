@@ -12,6 +12,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 #include <util/unused.h>
 
 /*
@@ -233,7 +234,7 @@ void delete_flat_edge(edge_t * e)
 #ifdef DEBUG
 static char *NAME(node_t * n)
 {
-    static char buf[20];
+    static TLS char buf[20];
     if (ND_node_type(n) == NORMAL)
 	return agnameof(n);
     snprintf(buf, sizeof(buf), "V%p", n);
@@ -30,7 +30,9 @@
 #include <util/alloc.h>
 #include <util/exit.h>
 #include <util/gv_math.h>
+#include <util/parallel.h>
 #include <util/streq.h>
+#include <util/tls.h>
 
 struct adjmatrix_t {
   size_t nrows;
@@ -54,16 +56,21 @@ static void init_mincross(graph_t * g);
 static void merge2(graph_t * g);
 static void init_mccomp(graph_t *g, size_t c);
 static void cleanup2(graph_t *g, int64_t nc);
-static int64_t mincross_clust(graph_t *g, ints_t *scratch);
-static int64_t mincross(graph_t *g, int startpass, ints_t *scratch);
+static int64_t mincross_clust(graph_t *g, int64s_t *scratch);
+static int64_t mincross(graph_t *g, int startpass, int64s_t *scratch);
 static void mincross_step(graph_t * g, int pass);
 static void mincross_options(graph_t * g);
+static bool time_up(void);
 static void save_best(graph_t * g);
 static void restore_best(graph_t * g);
 static adjmatrix_t *new_matrix(size_t i, size_t j);
 static void free_matrix(adjmatrix_t * p);
 static int ordercmpf(const void *, const void *);
-static int64_t ncross(ints_t *scratch);
+static int64_t ncross(int64s_t *scratch);
+#ifndef GVDLL
+static bool independent_components(graph_t *g);
+static int64_t mincross_components(graph_t *g, int threads);
+#endif
 #ifdef DEBUG
 #if DEBUG > 1
 static int gd_minrank(Agraph_t *g) {return GD_minrank(g);}
@@ -79,14 +86,16 @@ void node_in_root_vlist(node_t * n);
 
 
 	/* mincross parameters */
-static int MinQuit;
+static TLS int MinQuit;
 static const double Convergence = .995;
 
-static graph_t *Root;
-static int GlobalMinRank, GlobalMaxRank;
-static edge_t **TE_list;
-static int *TI_list;
-static bool ReMincross;
+static TLS double Deadline;	/* gv_wtime() to stop at, or 0 for no limit */
+
+static TLS graph_t *Root;
+static TLS int GlobalMinRank, GlobalMaxRank;
+static TLS edge_t **TE_list;
+static TLS int *TI_list;
+static TLS bool ReMincross;
 
 #if defined(DEBUG) && DEBUG > 1
 static void indent(graph_t* g)
@@ -99,7 +108,7 @@ static void indent(graph_t* g)
 
 static char* nname(node_t* v)
 {
-        static char buf[1000];
+        static TLS char buf[1000];
 	if (ND_node_type(v)) {
 		if (ND_ranktype(v) == CLUSTER)
 			snprintf(buf, sizeof(buf), "v%s_%p", agnameof(ND_clust(v)), v);
@@ -371,12 +380,21 @@ void dot_mincross(graph_t *g) {
 
     init_mincross(g);
 
-    ints_t scratch = {0};
+    int64s_t scratch = {0};
 
-    size_t comp;
-    for (nc = 0, comp = 0; comp < GD_comp(g).size; comp++) {
-	init_mccomp(g, comp);
-	nc += mincross(g, 0, &scratch);
+#ifndef GVDLL
+    const int threads =
+	gv_threads_attr(late_int(g, agfindgraphattr(g, "threads"), 1, 0));
+    if (threads != 1 && GD_comp(g).size > 1 && independent_components(g)) {
+	nc = mincross_components(g, threads);
+    } else
+#endif
+    {
+	size_t comp;
+	for (nc = 0, comp = 0; comp < GD_comp(g).size; comp++) {
+	    init_mccomp(g, comp);
+	    nc += mincross(g, 0, &scratch);
+	}
     }
 
     merge2(g);
@@ -399,7 +417,7 @@ void dot_mincross(graph_t *g) {
 	    check_vlists(GD_clust(g)[c]);
 #endif
     }
-    ints_free(&scratch);
+    int64s_free(&scratch);
     cleanup2(g, nc);
 }
 
@@ -433,6 +451,100 @@ static void init_mccomp(graph_t *g, size_t c) {
     }
 }
 
+#ifndef GVDLL
+/* Components only share the root's rank arrays, whose slices init_mccomp
+ * hands out one after another, and the per rank flat edge matrices. Without
+ * clusters or flat edges there are none of the latter.
+ */
+static bool independent_components(graph_t *g) {
+    if (GD_n_cluster(g) > 0)
+	return false;
+    for (size_t c = 0; c < GD_comp(g).size; c++) {
+	for (node_t *n = GD_comp(g).list[c]; n; n = ND_next(n)) {
+	    if (ND_flat_out(n).size > 0)
+		return false;
+	}
+    }
+    return true;
+}
+
+/* Order the components concurrently. Each is given a copy of the root graph
+ * with its own rank arrays pointing at the slices it would have had in turn,
+ * so the result is the same as ordering them one after another.
+ */
+static int64_t mincross_components(graph_t *g, int threads) {
+    const int ncomp = (int)GD_comp(g).size;
+    const size_t nranks = (size_t)GD_maxrank(g) + 2; // as in allocate_ranks
+    const size_t ti_size = (size_t)agnedges(dot_root(g)) + 1;
+    rank_t *ranks = gv_calloc((size_t)ncomp * nranks, sizeof(rank_t));
+    int *start = gv_calloc(nranks, sizeof(int));
+
+    for (int c = 0; c < ncomp; c++) {
+	rank_t *rk = &ranks[(size_t)c * nranks];
+	memcpy(rk, GD_rank(g), nranks * sizeof(rank_t));
+	for (int r = GD_minrank(g); r <= GD_maxrank(g); r++) {
+	    rk[r].v = rk[r].av + start[r];
+	    rk[r].n = 0;
+	}
+	for (node_t *n = GD_comp(g).list[c]; n; n = ND_next(n))
+	    start[ND_rank(n)]++;
+    }
+    free(start);
+
+    // each thread ordering components has its own view of the root graph, and
+    // otherwise starts from the state of this one
+    gv_layout_state_t *const state = gv_layout_state_save();
+    const int min_quit = MinQuit;
+    const double deadline = Deadline;
+    const int min_rank = GlobalMinRank, max_rank = GlobalMaxRank;
+    edge_t **const te_list = TE_list;
+    const bool remincross = ReMincross;
+
+    int64_t nc = 0;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(gv_threads(threads)) reduction(+:nc)
+#endif
+    {
+	gv_layout_state_load(state);
+	MinQuit = min_quit;
+	Deadline = deadline;
+	GlobalMinRank = min_rank;
+	GlobalMaxRank = max_rank;
+	TE_list = te_list;
+	ReMincross = remincross;
+	graph_t *const root = Root;
+	int *const ti_list = TI_list;
+	TI_list = gv_calloc(ti_size, sizeof(int));
+	int64s_t scratch = {0};
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+	for (int c = 0; c < ncomp; c++) {
+	    Agraph_t view = *g;
+	    Agraphinfo_t info = *(Agraphinfo_t *)AGDATA(g);
+	    view.base.data = (Agrec_t *)&info;
+	    view.root = &view;
+	    info.dotroot = &view;
+	    info.nlist = GD_comp(g).list[c];
+	    info.rank = &ranks[(size_t)c * nranks];
+	    Root = &view;
+	    nc += mincross(&view, 0, &scratch);
+	}
+	int64s_free(&scratch);
+	free(TI_list);
+	TI_list = ti_list;
+	Root = root;
+    }
+    free(state);
+
+    // leave the root's ranks as the last component left them
+    memcpy(GD_rank(g), &ranks[(size_t)(ncomp - 1) * nranks],
+           nranks * sizeof(rank_t));
+    free(ranks);
+    return nc;
+}
+#endif
+
 static int betweenclust(edge_t * e)
 {
     while (ED_to_orig(e))
@@ -541,7 +653,7 @@ static void ordered_edges(graph_t * g)
     }
 }
 
-static int64_t mincross_clust(graph_t *g, ints_t *scratch) {
+static int64_t mincross_clust(graph_t *g, int64s_t *scratch) {
     int c;
 
     expand_cluster(g);
@@ -691,10 +803,10 @@ static void transpose(graph_t * g, bool reverse)
 		delta += transpose_step(g, r, reverse);
 	    }
 	}
-    } while (delta >= 1);
+    } while (delta >= 1 && !time_up());
 }
 
-static int64_t mincross(graph_t *g, int startpass, ints_t *scratch) {
+static int64_t mincross(graph_t *g, int startpass, int64s_t *scratch) {
     const int endpass = 2;
     int maxthispass = 0, iter, trying, pass;
     int64_t cur_cross, best_cross;
@@ -730,7 +842,7 @@ static int64_t mincross(graph_t *g, int startpass, ints_t *scratch) {
 			"mincross: pass %d iter %d trying %d cur_cross %" PRId64 " best_cross %"
 			PRId64 "\n",
 			pass, iter, trying, cur_cross, best_cross);
-	    if (trying++ >= MinQuit)
+	    if (trying++ >= MinQuit || time_up())
 		break;
 	    if (cur_cross == 0)
 		break;
@@ -742,7 +854,7 @@ static int64_t mincross(graph_t *g, int startpass, ints_t *scratch) {
 		best_cross = cur_cross;
 	    }
 	}
-	if (cur_cross == 0)
+	if (cur_cross == 0 || time_up())
 	    break;
     }
     if (cur_cross > best_cross)
@@ -871,9 +983,12 @@ static void cleanup2(graph_t *g, int64_t nc) {
 	}
 	free_matrix(GD_rank(g)[r].flat);
     }
-    if (Verbose)
+    if (Verbose) {
+	if (time_up())
+	    fprintf(stderr, "mincross %s: stopped by mctimeout\n", agnameof(g));
 	fprintf(stderr, "mincross %s: %" PRId64 " crossings, %.2f secs.\n",
 		agnameof(g), nc, elapsed_sec());
+    }
 }
 
 static node_t *neighbor(node_t * v, int dir)
@@ -1228,7 +1343,7 @@ void install_in_rank(graph_t * g, node_t * n)
  *	graphs such as trees are drawn with no crossings.  it tries searching
  *	in- and out-edges and takes the better of the two initial orderings.
  */
-void build_ranks(graph_t *g, int pass, ints_t *scratch) {
+void build_ranks(graph_t *g, int pass, int64s_t *scratch) {
     int i, j;
     node_t *n, *ns;
     edge_t **otheredges;
@@ -1522,36 +1637,45 @@ static int local_cross(elist l, int dir)
     return cross;
 }
 
-static int64_t rcross(graph_t *g, int r, ints_t *Count) {
-    int top, bot, max, i, k;
+/* Crossings between ranks r and r + 1, counting the edges out of rank r from
+ * left to right. Count is used as a Fenwick tree over the positions in rank
+ * r + 1 of the xpenalty of the edges counted so far, so the penalty of those
+ * ending to the right of an edge is the total less one prefix sum and the
+ * whole count takes O(E log n) instead of O(E n).
+ */
+static int64_t rcross(graph_t *g, int r, int64s_t *Count) {
+    int top, bot, i;
     node_t **rtop, *v;
+    edge_t *e;
 
     int64_t cross = 0;
-    max = 0;
     rtop = GD_rank(g)[r].v;
 
+    size_t size = 0;
+    for (top = 0; top < GD_rank(g)[r].n; top++) {
+	for (i = 0; (e = ND_out(rtop[top]).list[i]); i++)
+	    size = MAX(size, (size_t)ND_order(aghead(e)) + 1);
+    }
+
     // discard any data from previous runs
-    ints_clear(Count);
+    int64s_clear(Count);
+    int64s_resize(Count, size + 1, 0);
+    int64_t *tree = int64s_front(Count);
 
+    int64_t total = 0;
     for (top = 0; top < GD_rank(g)[r].n; top++) {
-	edge_t *e;
-	if (max > 0) {
+	if (total > 0) {
 	    for (i = 0; (e = ND_out(rtop[top]).list[i]); i++) {
-		for (k = ND_order(aghead(e)) + 1; k <= max; k++)
-		    cross += ints_size(Count) <= (size_t)k
-		             ? 0
-		             : ints_get(Count, (size_t)k) * ED_xpenalty(e);
+		int64_t left = 0;
+		for (size_t k = (size_t)ND_order(aghead(e)) + 1; k > 0; k -= k & -k)
+		    left += tree[k];
+		cross += (total - left) * ED_xpenalty(e);
 	    }
 	}
 	for (i = 0; (e = ND_out(rtop[top]).list[i]); i++) {
-	    int inv = ND_order(aghead(e));
-	    if (inv > max)
-		max = inv;
-	    const size_t inv_z = (size_t)inv;
-	    if (ints_size(Count) <= inv_z) {
-		ints_resize(Count, inv_z + 1, 0);
-	    }
-	    ints_set(Count, inv_z, ints_get(Count, inv_z) + ED_xpenalty(e));
+	    for (size_t k = (size_t)ND_order(aghead(e)) + 1; k <= size; k += k & -k)
+		tree[k] += ED_xpenalty(e);
+	    total += ED_xpenalty(e);
 	}
     }
     for (top = 0; top < GD_rank(g)[r].n; top++) {
@@ -1567,7 +1691,7 @@ static int64_t rcross(graph_t *g, int r, ints_t *Count) {
     return cross;
 }
 
-static int64_t ncross(ints_t *scratch) {
+static int64_t ncross(int64s_t *scratch) {
     assert(scratch != NULL);
     int r;
 
@@ -1833,12 +1957,22 @@ static void mincross_options(graph_t * g)
     /* set default values */
     MinQuit = 8;
     MaxIter = 24;
+    Deadline = 0;
 
     p = agget(g, "mclimit");
     if (p && (f = atof(p)) > 0.0) {
 	MinQuit = MAX(1, MinQuit * f);
 	MaxIter = MAX(1, MaxIter * f);
     }
+
+    p = agget(g, "mctimeout");
+    if (p && (f = atof(p)) > 0.0)
+	Deadline = gv_wtime() + f;
+}
+
+/* has the time given by mctimeout run out? */
+static bool time_up(void) {
+    return Deadline > 0 && gv_wtime() > Deadline;
 }
 
 #ifdef DEBUG
@@ -22,7 +22,9 @@
 #include <dotgen/aspect.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <util/alloc.h>
 #include <util/gv_math.h>
 
@@ -32,6 +34,9 @@ static void remove_aux_edges(graph_t * g);
 static void set_xcoords(graph_t * g);
 static void set_ycoords(graph_t * g);
 static void set_aspect(graph_t *g);
+static bool use_bk(graph_t *g);
+static bool bk_xcoords(graph_t *g);
+static void reserve_self_space(node_t *u);
 static void expand_leaves(graph_t * g);
 static void make_lrvn(graph_t * g);
 static void contain_nodes(graph_t * g);
@@ -132,6 +137,10 @@ void dot_position(graph_t *g) {
     expand_leaves(g);
     if (flat_edges(g))
 	set_ycoords(g);
+    if (use_bk(g) && bk_xcoords(g)) {
+	set_aspect(g);
+	return;
+    }
     create_aux_edges(g);
     if (rank(g, 2, nsiter2(g))) { /* LR balance == 2 */
 	connectGraph (g);
@@ -146,6 +155,42 @@ void dot_position(graph_t *g) {
 				 */
 }
 
+/* Whether to place nodes with dot_bk_position instead of network simplex.
+ * That only knows about the separation of nodes on a rank, so is not used
+ * when clusters, flat edge labels or ratio=compress add other constraints.
+ */
+static bool use_bk(graph_t *g) {
+    const char *s = agget(g, "xcoord");
+    if (s == NULL || strcmp(s, "bk") != 0)
+	return false;
+    if (GD_n_cluster(g) > 0 || GD_drawing(g)->ratio_kind == R_COMPRESS)
+	return false;
+    for (node_t *n = GD_nlist(g); n; n = ND_next(n)) {
+	if (ND_alg(n))
+	    return false;
+    }
+    return true;
+}
+
+static bool bk_xcoords(graph_t *g) {
+    for (int i = GD_minrank(g); i <= GD_maxrank(g); i++) {
+	for (int j = 0; j < GD_rank(g)[i].n; j++)
+	    reserve_self_space(GD_rank(g)[i].v[j]);
+    }
+    if (Verbose)
+	start_timer();
+    const bool ok = dot_bk_position(g);
+    if (Verbose)
+	fprintf(stderr, "xcoord=bk %s: %.2f sec\n",
+		ok ? "done" : "failed, using network simplex", elapsed_sec());
+    if (!ok) {
+	/* undo the widening, network simplex does it again */
+	for (node_t *n = GD_nlist(g); n; n = ND_next(n))
+	    ND_rw(n) = ND_mval(n);
+    }
+    return ok;
+}
+
 static int nsiter2(graph_t * g)
 {
     int maxiter = INT_MAX;
@@ -210,6 +255,29 @@ static void allocate_aux_edges(graph_t * g)
     }
 }
 
+/// widen a node on the right to make room for its self loops
+static void reserve_self_space(node_t *u) {
+    ND_mval(u) = ND_rw(u);	/* keep it somewhere safe */
+    if (ND_other(u).size > 0) {	/* compute self size */
+	/* FIX: dot assumes all self-edges go to the right. This
+	 * is no longer true, though makeSelfEdge still attempts to
+	 * put as many as reasonable on the right. The dot code
+	 * should be modified to allow a box reflecting the placement
+	 * of all self-edges, and use that to reposition the nodes.
+	 * Note that this would not only affect left and right
+	 * positioning but may also affect interrank spacing.
+	 */
+	double sw = 0; // self width
+	edge_t *e;
+	for (size_t k = 0; (e = ND_other(u).list[k]); k++) {
+	    if (agtail(e) == aghead(e)) {
+		sw += selfRightSpace (e);
+	    }
+	}
+	ND_rw(u) += sw;	/* increment to include self edges */
+    }
+}
+
 static void 
 make_LR_constraints(graph_t * g)
 {
@@ -237,24 +305,7 @@ make_LR_constraints(graph_t * g)
 	nodesep = sep[i & 1];
 	for (j = 0; j < rank[i].n; j++) {
 	    u = rank[i].v[j];
-	    ND_mval(u) = ND_rw(u);	/* keep it somewhere safe */
-	    if (ND_other(u).size > 0) {	/* compute self size */
-		/* FIX: dot assumes all self-edges go to the right. This
-                 * is no longer true, though makeSelfEdge still attempts to
-                 * put as many as reasonable on the right. The dot code
-                 * should be modified to allow a box reflecting the placement
-                 * of all self-edges, and use that to reposition the nodes.
-                 * Note that this would not only affect left and right
-                 * positioning but may also affect interrank spacing.
-                 */
-		double sw = 0; // self width
-		for (size_t k = 0; (e = ND_other(u).list[k]); k++) {
-		    if (agtail(e) == aghead(e)) {
-			sw += selfRightSpace (e);
-		    }
-		}
-		ND_rw(u) += sw;	/* increment to include self edges */
-	    }
+	    reserve_self_space(u);
 	    v = rank[i].v[j + 1];
 	    if (v) {
 		width = ND_rw(u) + ND_lw(v) + nodesep;
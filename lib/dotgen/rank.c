@@ -30,6 +30,7 @@
 #include	<stdint.h>
 #include	<util/alloc.h>
 #include	<util/gv_math.h>
+#include <util/tls.h>
 
 static void dot1_rank(graph_t *g);
 static void dot2_rank(graph_t *g);
@@ -655,7 +656,7 @@ static bool is_internal_to_cluster(edge_t * e)
     return false;
 }
 
-static node_t* Last_node;
+static TLS node_t* Last_node;
 static node_t* makeXnode (graph_t* G, char* name)
 {
     node_t *n = agnode(G, name, 1);
@@ -711,7 +712,7 @@ static void weak(graph_t * g, node_t * t, node_t * h, edge_t * orig)
 {
     node_t *v;
     edge_t *e, *f;
-    static int id;
+    static TLS int id;
     char buf[100];
 
     for (e = agfstin(g, t); e; e = agnxtin(g, e)) {
@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <util/alloc.h>
+#include <util/random.h>
 
 static void node_distinct_coloring_internal2(int scheme, QuadTree qt,
                                              bool weightedQ, SparseMatrix A,
@@ -92,7 +93,7 @@ static void node_distinct_coloring_internal2(int scheme, QuadTree qt,
   width = cspace_size*0.5;
 
   /* randomly assign colors first */
-  srand(seed);
+  gv_srand(seed);
   for (i = 0; i < n*cdim; i++) colors[i] = cspace_size*drand();
 
   double *x = gv_calloc(cdim * n, sizeof(double));
@@ -161,7 +162,7 @@ static void node_distinct_coloring_internal(int scheme, QuadTree qt,
     /* do multiple iterations and pick the best */
     int iter, seed_max = -1;
     double color_diff_max = -1;
-    srand(123);
+    gv_srand(123);
     iter = -seed;
     for (i = 0; i < iter; i++){
       seed = irand(100000);
@@ -99,7 +99,6 @@ struct fdpParms_s {
         int unscaled;           /* % of iterations used in pass 1 */
         double C;               /* Repulsion factor in xLayout */
         double Tfact;           /* scale temp from default expression */
-        double K;               /* spring constant; ideal distance */
         double T0;              /* initial temperature */
 };
 typedef struct fdpParms_s fdpParms_t;
@@ -27,6 +27,7 @@
 #include <stddef.h>
 #include <string.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 
   /* structure for maintaining a free list of cells */
 typedef struct _block {
@@ -110,7 +111,7 @@ static int ijcmpf(void *point1, void *point2) {
     return 0;
 }
 
-static Grid _grid; // hack because can't attach info. to Dt_t
+static TLS Grid _grid; // hack because can't attach info. to Dt_t
 
 /* newCell:
  * Allocate a new cell from free store and initialize its indices
@@ -48,6 +48,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 
 typedef struct {
     graph_t*  rootg;  /* logical root; graph passed in to fdp_layout */
@@ -288,7 +289,7 @@ static char *portName(graph_t * g, bport_t * p)
     edge_t *e = p->e;
     node_t *h = aghead(e);
     node_t *t = agtail(e);
-    static char buf[BSZ + 1];
+    static TLS char buf[BSZ + 1];
 
 	snprintf(buf, sizeof(buf), "_port_%s_(%d)_(%d)_%u",agnameof(g),
 		ND_id(t), ND_id(h), AGSEQ(e));
@@ -39,12 +39,11 @@
 #include <fdpgen/grid.h>
 #include <neatogen/neato.h>
 
-#ifndef HAVE_SRAND48
-#define srand48 srand
-#endif
 
 #include <fdpgen/tlayout.h>
 #include <common/globals.h>
+#include <util/random.h>
+#include <util/tls.h>
 
 #define D_useGrid   (fdp_parms->useGrid)
 #define D_useNew    (fdp_parms->useNew)
@@ -52,7 +51,6 @@
 #define D_unscaled  (fdp_parms->unscaled)
 #define D_C         (fdp_parms->C)
 #define D_Tfact     (fdp_parms->Tfact)
-#define D_K         (fdp_parms->K)
 #define D_T0        (fdp_parms->T0)
 
   /* Actual parameters used; initialized using fdp_parms, then possibly
@@ -77,7 +75,9 @@ typedef struct {
     int loopcnt;        /* actual iterations in this pass */
 } parms_t;
 
-static parms_t parms;
+static TLS parms_t parms;
+
+TLS double fdp_K;
 
 #define T_useGrid   (parms.useGrid)
 #define T_useNew    (parms.useNew)
@@ -173,7 +173,7 @@ void fdp_initParams(graph_t * g)
     T_C = D_C;
     T_Tfact = D_Tfact;
     T_maxIters = late_int(g, agattr(g,AGRAPH, "maxiter", NULL), DFLT_maxIters, 0);
-    D_K = T_K = late_double(g, agattr(g,AGRAPH, "K", NULL), DFLT_K, 0.0);
+    fdp_K = T_K = late_double(g, agattr(g,AGRAPH, "K", NULL), DFLT_K, 0.0);
     if (D_T0 == -1.0) {
 	T_T0 = late_double(g, agattr(g,AGRAPH, "T0", NULL), -1.0, 0.0);
     } else
@@ -209,8 +209,8 @@ doRep(node_t * p, node_t * q, double xdelta, double ydelta, double dist2)
     double dist;
 
     while (dist2 == 0.0) {
-	xdelta = 5 - rand() % 10;
-	ydelta = 5 - rand() % 10;
+	xdelta = 5 - gv_rand() % 10;
+	ydelta = 5 - gv_rand() % 10;
 	dist2 = xdelta * xdelta + ydelta * ydelta;
     }
     if (T_useNew) {
@@ -317,8 +317,8 @@ static void applyAttr(Agnode_t * p, Agnode_t * q, Agedge_t * e)
     ydelta = ND_pos(q)[1] - ND_pos(p)[1];
     dist2 = xdelta * xdelta + ydelta * ydelta;
     while (dist2 == 0.0) {
-	xdelta = 5 - rand() % 10;
-	ydelta = 5 - rand() % 10;
+	xdelta = 5 - gv_rand() % 10;
+	ydelta = 5 - gv_rand() % 10;
 	dist2 = xdelta * xdelta + ydelta * ydelta;
     }
     dist = sqrt(dist2);
@@ -522,7 +522,7 @@ static pointf initPositions(graph_t * g, bport_t * pp)
 	local_seed = getpid() ^ time(NULL);
 #endif
     }
-    srand48(local_seed);
+    gv_srand48(local_seed);
 
     /* If ports, place ports on and nodes within an ellipse centered at origin
      * with halfwidth Wd and halfheight Ht.
@@ -574,8 +574,8 @@ static pointf initPositions(graph_t * g, bport_t * pp)
 		    ND_pos(np)[0] = 0.98 * p.x + 0.1 * ctr.x;
 		    ND_pos(np)[1] = 0.9 * p.y + 0.1 * ctr.y;
 		} else {
-		    double angle = PItimes2 * drand48();
-		    double radius = 0.9 * drand48();
+		    double angle = PItimes2 * gv_drand48();
+		    double radius = 0.9 * gv_drand48();
 		    ND_pos(np)[0] = radius * T_Wd * cos(angle);
 		    ND_pos(np)[1] = radius * T_Ht * sin(angle);
 		}
@@ -589,14 +589,14 @@ static pointf initPositions(graph_t * g, bport_t * pp)
 		    ND_pos(np)[0] -= ctr.x;
 		    ND_pos(np)[1] -= ctr.y;
 		} else {
-		    ND_pos(np)[0] = T_Wd * (2.0 * drand48() - 1.0);
-		    ND_pos(np)[1] = T_Ht * (2.0 * drand48() - 1.0);
+		    ND_pos(np)[0] = T_Wd * (2.0 * gv_drand48() - 1.0);
+		    ND_pos(np)[1] = T_Ht * (2.0 * gv_drand48() - 1.0);
 		}
 	    }
 	} else {		/* No ports or positions; place randomly */
 	    for (np = agfstnode(g); np; np = agnxtnode(g, np)) {
-		ND_pos(np)[0] = T_Wd * (2.0 * drand48() - 1.0);
-		ND_pos(np)[1] = T_Ht * (2.0 * drand48() - 1.0);
+		ND_pos(np)[0] = T_Wd * (2.0 * gv_drand48() - 1.0);
+		ND_pos(np)[1] = T_Ht * (2.0 * gv_drand48() - 1.0);
 	    }
 	}
     }
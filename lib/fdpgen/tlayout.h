@@ -16,6 +16,10 @@ extern "C" {
 
 #include <fdpgen/fdp.h>
 #include <fdpgen/xlayout.h>
+#include <util/tls.h>
+
+    /// spring constant of the graph being laid out, set by fdp_initParams
+    extern TLS double fdp_K;
 
     extern void fdp_initParams(graph_t *);
     extern void fdp_tLayout(graph_t *, xparams *);
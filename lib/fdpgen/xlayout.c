@@ -28,17 +28,19 @@ Increase less between tries
 #include <fdpgen/dbg.h>
 #include <math.h>
 #include <util/gv_ctype.h>
+#include <util/random.h>
+#include <util/tls.h>
 
 #define DFLT_overlap   "9:prism"    /* default overlap value */
 
-static xparams xParams = {
+static TLS xparams xParams = {
     60,				/* numIters */
     0.0,			/* T0 */
     0.3,			/* K */
     1.5,			/* C */
     0				/* loopcnt */
 };
-static expand_t X_marg;
+static TLS expand_t X_marg;
 
 static double WD2(Agnode_t *n) {
   return X_marg.doAdd ? (ND_width(n) / 2.0 + X_marg.x) : (ND_width(n) * X_marg.x / 2.0);
@@ -136,8 +138,8 @@ static int doRep(node_t *p, node_t *q, double xdelta, double ydelta,
     double force;
 
     while (dist2 == 0.0) {
-	xdelta = 5 - rand() % 10;
-	ydelta = 5 - rand() % 10;
+	xdelta = 5 - gv_rand() % 10;
+	ydelta = 5 - gv_rand() % 10;
 	dist2 = xdelta * xdelta + ydelta * ydelta;
     }
     if ((ov = overlap(p, q)))
@@ -1,8 +1,12 @@
 #include <cassert>
 #include <cstddef>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <ostream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include "GVContext.h"
@@ -65,4 +69,47 @@ GVRenderData GVLayout::render(const std::string &format) const {
   return GVRenderData(result, length);
 }
 
+namespace {
+/// state of a `render` call that passes its output to a writer
+struct render_writer_t {
+  const std::function<void(std::string_view)> &writer;
+  std::exception_ptr exception = nullptr; ///< what the writer threw, if anything
+};
+} // namespace
+
+/// a `gvrender_sink_t` forwarding to a C++ writer, which must not let
+/// exceptions escape into C
+static size_t render_to_writer(void *context, const char *s, size_t len) {
+  auto *const state = static_cast<render_writer_t *>(context);
+  try {
+    state->writer(std::string_view(s, len));
+  } catch (...) {
+    state->exception = std::current_exception();
+    return 0;
+  }
+  return len;
+}
+
+void GVLayout::render(
+    const std::string &format,
+    const std::function<void(std::string_view)> &writer) const {
+  render_writer_t state{writer};
+  const auto rc = gvRenderSink(m_gvc->c_struct(), m_g->c_struct(),
+                               format.c_str(), render_to_writer, &state);
+  if (state.exception) {
+    std::rethrow_exception(state.exception);
+  }
+  if (rc) {
+    throw std::runtime_error("Rendering failed");
+  }
+}
+
+void GVLayout::render(const std::string &format, std::ostream &os) const {
+  render(format, [&os](std::string_view chunk) {
+    if (!os.write(chunk.data(), static_cast<std::streamsize>(chunk.size()))) {
+      throw std::runtime_error("Writing rendered output failed");
+    }
+  });
+}
+
 } // namespace GVC
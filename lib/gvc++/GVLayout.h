@@ -1,7 +1,10 @@
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <ostream>
 #include <string>
+#include <string_view>
 
 #include "AGraph.h"
 #include "GVContext.h"
@@ -49,6 +52,17 @@ public:
   // render the layout in the specified format
   GVLAYOUT_API GVRenderData render(const std::string &format) const;
 
+  // render the layout in the specified format, passing the output to a writer
+  // in chunks as it is produced instead of collecting it in memory. An
+  // exception thrown by the writer stops it being given further output and is
+  // rethrown once rendering is done.
+  GVLAYOUT_API void
+  render(const std::string &format,
+         const std::function<void(std::string_view)> &writer) const;
+
+  // render the layout in the specified format to a stream
+  GVLAYOUT_API void render(const std::string &format, std::ostream &os) const;
+
 private:
   std::shared_ptr<GVContext> m_gvc;
   std::shared_ptr<CGraph::AGraph> m_g;
@@ -20,6 +20,7 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <util/alloc.h>
 
 GVC_t *gvContext(void)
 {
@@ -216,6 +217,54 @@ int gvRenderData(GVC_t *gvc, graph_t *g, const char *format, char **result,
     return rc;
 }
 
+int gvRenderSink(GVC_t *gvc, graph_t *g, const char *format,
+                 gvrender_sink_t sink, void *context) {
+    int rc;
+    GVJ_t *job;
+
+    if (!sink) {
+	agerrorf("no sink given for rendered output\n");
+	return -1;
+    }
+
+    /* create a job for the required format */
+    bool r = gvjobs_output_langname(gvc, format);
+    job = gvc->job;
+    if (!r) {
+	agerrorf("Format: \"%s\" not recognized. Use one of:%s\n",
+                format, gvplugin_list(gvc, API_device, format));
+	return -1;
+    }
+
+    job->output_lang = gvrender_select(job, job->output_langname);
+    if (!LAYOUT_DONE(g) && !(job->flags & LAYOUT_NOT_REQUIRED)) {
+	agerrorf( "Layout was not done\n");
+	return -1;
+    }
+
+/* size of the chunks the output is passed to the sink in */
+#define OUTPUT_SINK_CHUNK 65536
+
+    // output is staged in a fixed size chunk, rather than collected in full
+    job->output_sink = sink;
+    job->output_sink_context = context;
+    job->output_data = gv_alloc(OUTPUT_SINK_CHUNK);
+    job->output_data_allocated = OUTPUT_SINK_CHUNK;
+    job->output_data_position = 0;
+
+    rc = gvRenderJobs(gvc, g);
+    gvrender_end_job(job);
+    if (gvflush(job) != 0 || job->output_sink_failed) {
+	rc = -1;
+    }
+
+    free(job->output_data);
+    job->output_data = NULL;
+    gvjobs_delete(gvc);
+
+    return rc;
+}
+
 /* gvFreeRenderData:
  * Utility routine to free memory allocated in gvRenderData, as the application code may use
  * a different runtime library.
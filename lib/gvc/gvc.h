@@ -98,6 +98,13 @@ GVC_API int gvRenderContext(GVC_t *gvc, graph_t *g, const char *format, void *co
 GVC_API int gvRenderData(GVC_t *gvc, graph_t *g, const char *format,
                          char **result, size_t *length);
 
+/* Render layout in a specified format, passing the output to a sink in chunks
+ * as it is produced. Returns non-zero if rendering failed or the sink did not
+ * take all of the output, after which it is given no more.
+ */
+GVC_API int gvRenderSink(GVC_t *gvc, graph_t *g, const char *format,
+                         gvrender_sink_t sink, void *context);
+
 /* Free memory allocated and pointed to by *result in gvRenderData */
 GVC_API void gvFreeRenderData (char* data);
 
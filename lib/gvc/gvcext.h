@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -43,6 +45,14 @@ extern "C" {
 
     typedef struct gvplugin_available_s gvplugin_available_t;
 
+    /// receiver of rendered output, for `gvRenderSink`
+    ///
+    /// @param context The pointer given to `gvRenderSink`
+    /// @param s Next chunk of output
+    /// @param len Length of the chunk in bytes
+    /// @return Number of bytes taken, which is `len` unless it failed
+    typedef size_t (*gvrender_sink_t)(void *context, const char *s, size_t len);
+
 #if !defined(LTDL_H)
 extern lt_symlist_t lt_preloaded_symbols[];
 #endif
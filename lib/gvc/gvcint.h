@@ -105,6 +105,7 @@ extern "C" {
 	/* fonts and textlayout */
 	Dtdisc_t textfont_disc;
 	Dt_t *textfont_dt;
+	struct textspan_cache_s *textspan_cache; /* measured spans, see textspan.c */
 	gvplugin_active_textlayout_t textlayout; /* always use best avail for all jobs */
 //	void (*free_layout) (void *layout);   /* function for freeing layouts (mostly used by pango) */
 	
@@ -152,6 +153,9 @@ extern "C" {
 
 	/* whether to mangle font names (at least in SVG), usually false */
 	int fontrenaming;
+
+	/* emit_graph() */
+	struct emit_index_s *emit_index; /* nodes and edges by position, or NULL */
     };
 
 GVCINT_API GVC_t* gvCloneGVC (GVC_t *);
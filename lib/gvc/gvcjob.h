@@ -18,6 +18,7 @@
 extern "C" {
 #endif
 
+#include "gvcext.h"
 #include "gvcommon.h"
 #include "color.h"
 #include <stdbool.h>
@@ -74,6 +75,7 @@ extern "C" {
  GVRENDER_DOES_TARGETS		can represent target info (open link in a new tab or window) 
  GVRENDER_DOES_Z		render support 2.5D representation -Tvrml 
  GVRENDER_NO_WHITE_BG		don't paint white background, assumes white paper -Tps 
+ GVRENDER_DOES_CONCURRENT_PAGES	keeps no state from one page to the next, so pages can be emitted by several threads -Tps
  LAYOUT_NOT_REQUIRED 		don't perform layout -Tcanon 		
  OUTPUT_NOT_REQUIRED		don't use gvdevice for output (basically when agwrite() used instead) -Tcanon, -Txdot 
  */
@@ -106,6 +108,7 @@ extern "C" {
 #define GVRENDER_NO_WHITE_BG (1<<25)
 #define LAYOUT_NOT_REQUIRED (1<<26)
 #define OUTPUT_NOT_REQUIRED (1<<27)
+#define GVRENDER_DOES_CONCURRENT_PAGES (1<<28)
 
     typedef struct {
 	int flags;
@@ -278,6 +281,10 @@ extern "C" {
 	char *output_data;
 	size_t output_data_allocated;
 	size_t output_data_position;
+	gvrender_sink_t output_sink; ///< receiver of the output, from gvRenderSink
+	void *output_sink_context;   ///< first argument to output_sink
+	bool output_sink_failed;     ///< has output_sink refused output?
+	struct gvdeflate_s *deflate; ///< compressor state, for compressed formats
 
 	const char *output_langname;
 	int output_lang;
@@ -28,6 +28,7 @@
 #include <util/gv_ctype.h>
 #include <util/gv_fopen.h>
 #include <util/startswith.h>
+#include <util/tls.h>
 
 #ifdef ENABLE_LTDL
 #ifdef HAVE_DL_ITERATE_PHDR
@@ -289,9 +290,9 @@ static int line_callback(struct dl_phdr_info *info, size_t size, void *line)
 
 char * gvconfig_libdir(GVC_t * gvc)
 {
-    static char line[BSZ];
-    static char *libdir;
-    static bool dirShown = false;
+    static TLS char line[BSZ];
+    static TLS char *libdir;
+    static TLS bool dirShown = false;
 
     if (!libdir) {
         libdir=getenv("GVBINDIR");
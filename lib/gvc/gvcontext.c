@@ -68,6 +68,7 @@ int gvFreeContext(GVC_t * gvc)
     gvplugin_available_t *api, *api_next;
 
     emit_once_reset();
+    emit_index_reset(gvc);
     gvg_next = gvc->gvgs;
     while ((gvg = gvg_next)) {
 	gvg_next = gvg->next;
@@ -109,6 +110,7 @@ GVC_t* gvCloneGVC (GVC_t * gvc0)
 
 void gvFreeCloneGVC (GVC_t * gvc)
 {
+    emit_index_reset(gvc);
     gvjobs_delete(gvc);
     free(gvc);
 }
@@ -55,6 +55,8 @@ gvplugin_available_t *gvplugin_load(GVC_t *gvc, api_t api, const char *type,
 
     int gvtextlayout_select(GVC_t * gvc);
     bool gvtextlayout(GVC_t *gvc, textspan_t *span, char **fontpath);
+    void gvtextlayout_spans(GVC_t *gvc, textspan_t **spans, size_t n,
+                            bool *laid_out);
 
 /* loadimage */
     void gvloadimage(GVJ_t *job, usershape_t *us, boxf b, bool filled, const char *target);
@@ -63,6 +65,8 @@ gvplugin_available_t *gvplugin_load(GVC_t *gvc, api_t api, const char *type,
     point gvusershape_size_dpi(usershape_t *us, pointf dpi);
     point gvusershape_size(graph_t *g, char *name);
     usershape_t *gvusershape_find(const char *name);
+    void gvusershape_lock(void);
+    void gvusershape_unlock(void);
 
 /* device */
     int gvdevice_initialize(GVJ_t * job);
@@ -40,10 +40,42 @@
 static const unsigned char z_file_header[] =
    {0x1f, 0x8b, /*magic*/ Z_DEFLATED, 0 /*flags*/, 0,0,0,0 /*time*/, 0 /*xflags*/, OS_CODE};
 
-static z_stream z_strm;
-static unsigned char *df;
-static unsigned int dfallocated;
-static uint64_t crc;
+/* Compressed output is written as one deflate stream when the graph's
+ * `threads` attribute is 1. Otherwise, like pigz, the input is cut into
+ * blocks that are compressed independently, each primed with the end of the
+ * block before it, and a batch of blocks is compressed at once. All but the
+ * last block end in a sync flush, so their concatenation is a single valid
+ * deflate stream. Block boundaries do not depend on the number of threads, so
+ * neither does the output.
+ */
+enum {
+    DEFLATE_BLOCK = 128 * 1024, ///< input size of a block
+    DEFLATE_DICT = 32 * 1024,   ///< how much of the preceding block primes one
+};
+
+/// compressed output of a block
+typedef struct {
+    unsigned char *data;
+    size_t size, allocated;
+    uLong crc;  ///< CRC of the input of the block
+    int status; ///< zlib error, or Z_OK
+} deflate_block_t;
+
+struct gvdeflate_s {
+    z_stream z;           ///< the stream, if compressing serially
+    unsigned char *df;    ///< output buffer of the serial stream
+    unsigned dfallocated;
+    uLong crc;            ///< CRC of everything compressed so far
+    uint64_t total_in;    ///< size of everything compressed so far
+
+    int batch;            ///< blocks per batch, 0 if compressing serially
+    unsigned char *in;    ///< input of the current batch
+    size_t in_len;
+    unsigned char *dict;  ///< end of the input before `in`, DEFLATE_DICT long
+    size_t dict_len;
+    z_stream *streams;    ///< one per block of a batch
+    deflate_block_t *blocks;
+};
 #endif /* HAVE_LIBZ */
 
 #include <assert.h>
@@ -55,12 +87,55 @@ static uint64_t crc;
 #include <common/utils.h>
 #include <gvc/gvio.h>
 #include <util/agxbuf.h>
+#include <util/alloc.h>
 #include <util/exit.h>
+#include <util/fmt_fixed.h>
+#include <util/parallel.h>
+#include <util/prisize_t.h>
 #include <util/startswith.h>
+#include <util/tls.h>
+
+/// pass the output collected in `job->output_data` on to `job->output_sink`
+///
+/// After the sink fails, output is dropped rather than reported as a write
+/// error, so the caller's failure does not exit the process.
+///
+/// @return 0 on success, EOF if the sink has failed
+static int flush_sink(GVJ_t *job) {
+    if (job->output_data_position > 0 && !job->output_sink_failed) {
+	const size_t len = job->output_data_position;
+	if (job->output_sink(job->output_sink_context, job->output_data, len) !=
+	    len) {
+	    job->output_sink_failed = true;
+	}
+    }
+    job->output_data_position = 0;
+    return job->output_sink_failed ? EOF : 0;
+}
+
+/// write to `job->output_sink`, by way of the chunk in `job->output_data`
+static size_t write_sink(GVJ_t *job, const void *s, size_t len) {
+    if (len > job->output_data_allocated - job->output_data_position) {
+	(void)flush_sink(job);
+	// pass on writes larger than a chunk directly
+	if (len >= job->output_data_allocated) {
+	    if (!job->output_sink_failed &&
+	        job->output_sink(job->output_sink_context, s, len) != len) {
+		job->output_sink_failed = true;
+	    }
+	    return len;
+	}
+    }
+    memcpy(job->output_data + job->output_data_position, s, len);
+    job->output_data_position += len;
+    return len;
+}
 
 static size_t gvwrite_no_z(GVJ_t * job, const void *s, size_t len) {
     if (job->gvc->write_fn)   /* externally provided write discipline */
 	return job->gvc->write_fn(job, s, len);
+    if (job->output_sink)
+	return write_sink(job, s, len);
     if (job->output_data) {
 	if (len > job->output_data_allocated - (job->output_data_position + 1)) {
 	    /* ensure enough allocation for string = null terminator */
@@ -80,9 +155,109 @@ static size_t gvwrite_no_z(GVJ_t * job, const void *s, size_t len) {
     return fwrite(s, sizeof(char), len, job->output_file);
 }
 
+#ifdef HAVE_LIBZ
+/// compress block `k` of the current batch
+static void deflate_block(struct gvdeflate_s *d, int k, int nblocks,
+                          bool finish) {
+    const size_t start = (size_t)k * DEFLATE_BLOCK;
+    const size_t len = d->in_len - start < DEFLATE_BLOCK ? d->in_len - start
+                                                         : DEFLATE_BLOCK;
+    deflate_block_t *b = &d->blocks[k];
+    z_stream *z = &d->streams[k];
+
+    b->size = 0;
+    b->crc = crc32(0L, d->in + start, (uInt)len);
+    b->status = deflateReset(z);
+    if (b->status != Z_OK)
+	return;
+    if (k > 0) {
+	b->status = deflateSetDictionary(z, d->in + start - DEFLATE_DICT,
+	                                 DEFLATE_DICT);
+    } else if (d->dict_len > 0) {
+	b->status = deflateSetDictionary(z, d->dict, (uInt)d->dict_len);
+    }
+    if (b->status != Z_OK)
+	return;
+
+    // room for the worst case, and the few bytes of a sync flush
+    const size_t bound = deflateBound(z, (uLong)len) + 16;
+    if (b->allocated < bound) {
+	b->data = gv_recalloc(b->data, b->allocated, bound, 1);
+	b->allocated = bound;
+    }
+    z->next_in = d->in + start;
+    z->avail_in = (uInt)len;
+    z->next_out = b->data;
+    z->avail_out = (uInt)b->allocated;
+    const int flush = finish && k == nblocks - 1 ? Z_FINISH : Z_SYNC_FLUSH;
+    const int r = deflate(z, flush);
+    if ((flush == Z_FINISH && r != Z_STREAM_END) ||
+        (flush != Z_FINISH && r != Z_OK) || z->avail_in != 0) {
+	b->status = r == Z_OK ? Z_BUF_ERROR : r;
+	return;
+    }
+    b->size = (size_t)(z->next_out - b->data);
+}
+
+/// compress the blocks of the current batch, and write them in order
+static void deflate_batch(GVJ_t *job, bool finish) {
+    struct gvdeflate_s *d = job->deflate;
+    int nblocks = (int)((d->in_len + DEFLATE_BLOCK - 1) / DEFLATE_BLOCK);
+    if (nblocks == 0) {
+	if (!finish)
+	    return;
+	nblocks = 1; // an empty final block ends the stream
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(d->batch) \
+    if (nblocks > 1)
+#endif
+    for (int k = 0; k < nblocks; k++) {
+	deflate_block(d, k, nblocks, finish);
+    }
+
+    for (int k = 0; k < nblocks; k++) {
+	const deflate_block_t *b = &d->blocks[k];
+	if (b->status != Z_OK) {
+	    job->common->errorfn("deflation problem %d\n", b->status);
+	    graphviz_exit(1);
+	}
+	const size_t start = (size_t)k * DEFLATE_BLOCK;
+	const size_t len = d->in_len - start < DEFLATE_BLOCK ? d->in_len - start
+	                                                     : DEFLATE_BLOCK;
+	d->crc = crc32_combine(d->crc, b->crc, (z_off_t)len);
+	if (b->size > 0 && gvwrite_no_z(job, b->data, b->size) != b->size) {
+	    job->common->errorfn("gvwrite_no_z problem %" PRISIZE_T "\n",
+	                         b->size);
+	    graphviz_exit(1);
+	}
+    }
+    d->total_in += d->in_len;
+
+    // keep the end of this batch, to prime the first block of the next
+    d->dict_len = d->in_len < DEFLATE_DICT ? d->in_len : DEFLATE_DICT;
+    memcpy(d->dict, d->in + d->in_len - d->dict_len, d->dict_len);
+    d->in_len = 0;
+}
+
+static void deflate_free(struct gvdeflate_s *d) {
+    for (int k = 0; k < d->batch; k++) {
+	deflateEnd(&d->streams[k]);
+	free(d->blocks[k].data);
+    }
+    free(d->streams);
+    free(d->blocks);
+    free(d->in);
+    free(d->dict);
+    free(d->df);
+    free(d);
+}
+#endif /* HAVE_LIBZ */
+
 static void auto_output_filename(GVJ_t *job)
 {
-    static agxbuf buf;
+    static TLS agxbuf buf;
     char *fn;
 
     if (!(fn = job->input_filename))
@@ -153,20 +328,40 @@ int gvdevice_initialize(GVJ_t * job)
 
     if (job->flags & GVDEVICE_COMPRESSED_FORMAT) {
 #ifdef HAVE_LIBZ
-	z_stream *z = &z_strm;
-
-	z->zalloc = 0;
-	z->zfree = 0;
-	z->opaque = 0;
-	z->next_in = NULL;
-	z->next_out = NULL;
-	z->avail_in = 0;
-
-	crc = crc32(0L, Z_NULL, 0);
-
-	if (deflateInit2(z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
-	    job->common->errorfn("Error initializing for deflation\n");
-	    return 1;
+	graph_t *g = gvc->g;
+	const int threads =
+	    g ? gv_threads_attr(late_int(g, agfindgraphattr(g, "threads"), 1, 0))
+	      : 1;
+	struct gvdeflate_s *d = gv_alloc(sizeof(struct gvdeflate_s));
+	job->deflate = d;
+	d->crc = crc32(0L, Z_NULL, 0);
+
+	if (threads == 1) {
+	    if (deflateInit2(&d->z, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+	                     -MAX_WBITS, MAX_MEM_LEVEL,
+	                     Z_DEFAULT_STRATEGY) != Z_OK) {
+		job->common->errorfn("Error initializing for deflation\n");
+		deflate_free(d);
+		job->deflate = NULL;
+		return 1;
+	    }
+	} else {
+	    d->batch = gv_threads(threads);
+	    d->in = gv_calloc((size_t)d->batch, DEFLATE_BLOCK);
+	    d->dict = gv_alloc(DEFLATE_DICT);
+	    d->streams = gv_calloc((size_t)d->batch, sizeof(z_stream));
+	    d->blocks = gv_calloc((size_t)d->batch, sizeof(deflate_block_t));
+	    for (int k = 0; k < d->batch; k++) {
+		if (deflateInit2(&d->streams[k], Z_DEFAULT_COMPRESSION,
+		                 Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL,
+		                 Z_DEFAULT_STRATEGY) != Z_OK) {
+		    job->common->errorfn("Error initializing for deflation\n");
+		    d->batch = k; // only end the streams that were initialized
+		    deflate_free(d);
+		    job->deflate = NULL;
+		    return 1;
+		}
+	    }
 	}
 	gvwrite_no_z(job, z_file_header, sizeof(z_file_header));
 #else
@@ -186,22 +381,38 @@ size_t gvwrite (GVJ_t * job, const char *s, size_t len)
 
     if (job->flags & GVDEVICE_COMPRESSED_FORMAT) {
 #ifdef HAVE_LIBZ
-	z_streamp z = &z_strm;
+	struct gvdeflate_s *d = job->deflate;
+
+	if (d->batch > 0) {
+	    const size_t capacity = (size_t)d->batch * DEFLATE_BLOCK;
+	    for (size_t offset = 0; offset < len; ) {
+		const size_t n = len - offset < capacity - d->in_len
+		               ? len - offset : capacity - d->in_len;
+		memcpy(d->in + d->in_len, s + offset, n);
+		d->in_len += n;
+		offset += n;
+		if (d->in_len == capacity)
+		    deflate_batch(job, false);
+	    }
+	    return len;
+	}
+
+	z_streamp z = &d->z;
 
 	size_t dflen = deflateBound(z, len);
-	if (dfallocated < dflen) {
-	    dfallocated = dflen > UINT_MAX - 1 ? UINT_MAX : (unsigned)dflen + 1;
-	    df = realloc(df, dfallocated);
-	    if (! df) {
+	if (d->dfallocated < dflen) {
+	    d->dfallocated = dflen > UINT_MAX - 1 ? UINT_MAX : (unsigned)dflen + 1;
+	    d->df = realloc(d->df, d->dfallocated);
+	    if (! d->df) {
                 job->common->errorfn("memory allocation failure\n");
 		graphviz_exit(1);
 	    }
 	}
 
 #if ZLIB_VERNUM >= 0x1290
-	crc = crc32_z(crc, (const unsigned char*)s, len);
+	d->crc = crc32_z(d->crc, (const unsigned char*)s, len);
 #else
-	crc = crc32(crc, (const unsigned char*)s, len);
+	d->crc = crc32(d->crc, (const unsigned char*)s, len);
 #endif
 
 	for (size_t offset = 0; offset < len; ) {
@@ -217,16 +428,16 @@ size_t gvwrite (GVJ_t * job, const char *s, size_t len)
 	    const unsigned chunk = len - offset > UINT_MAX
 	                         ? UINT_MAX : (unsigned)(len - offset);
 	    z->avail_in = chunk;
-	    z->next_out = df;
-	    z->avail_out = dfallocated;
+	    z->next_out = d->df;
+	    z->avail_out = d->dfallocated;
 	    int r = deflate(z, Z_NO_FLUSH);
 	    if (r != Z_OK) {
                 job->common->errorfn("deflation problem %d\n", r);
 	        graphviz_exit(1);
 	    }
 
-	    if ((olen = (size_t)(z->next_out - df))) {
-		ret = gvwrite_no_z(job, df, olen);
+	    if ((olen = (size_t)(z->next_out - d->df))) {
+		ret = gvwrite_no_z(job, d->df, olen);
 	        if (ret != olen) {
                     job->common->errorfn("gvwrite_no_z problem %d\n", ret);
 	            graphviz_exit(1);
@@ -255,6 +466,8 @@ int gvferror (FILE* stream)
 {
     GVJ_t *job = (GVJ_t*)stream;
 
+    if (!job->gvc->write_fn && job->output_sink)
+	return job->output_sink_failed;
     if (!job->gvc->write_fn && !job->output_data)
 	return ferror(job->output_file);
 
@@ -300,6 +513,8 @@ int gvputc(GVJ_t * job, int c)
 
 int gvflush (GVJ_t * job)
 {
+    if (job->output_sink && ! job->gvc->write_fn)
+	return flush_sink(job);
     if (job->output_file
       && ! job->external_context
       && ! job->gvc->write_fn) {
@@ -338,39 +553,56 @@ void gvdevice_finalize(GVJ_t * job)
 
     if (job->flags & GVDEVICE_COMPRESSED_FORMAT) {
 #ifdef HAVE_LIBZ
-	z_streamp z = &z_strm;
+	struct gvdeflate_s *d = job->deflate;
 	unsigned char out[8] = "";
-	int ret;
-	int cnt = 0;
-
-	z->next_in = out;
-	z->avail_in = 0;
-	z->next_out = df;
-	z->avail_out = dfallocated;
-	while ((ret = deflate (z, Z_FINISH)) == Z_OK && (cnt++ <= 100)) {
-	    gvwrite_no_z(job, df, (size_t)(z->next_out - df));
-	    z->next_out = df;
-	    z->avail_out = dfallocated;
-	}
-	if (ret != Z_STREAM_END) {
-            job->common->errorfn("deflation finish problem %d cnt=%d\n", ret, cnt);
-	    graphviz_exit(1);
-	}
-	gvwrite_no_z(job, df, (size_t)(z->next_out - df));
+	uint64_t total_in;
+
+	if (d->batch > 0) {
+	    deflate_batch(job, true);
+	    total_in = d->total_in;
+	} else {
+	    z_streamp z = &d->z;
+	    int ret;
+	    int cnt = 0;
+
+	    if (d->df == NULL) { // nothing was written
+		d->dfallocated = BUFSIZ;
+		d->df = gv_alloc(d->dfallocated);
+	    }
+	    z->next_in = out;
+	    z->avail_in = 0;
+	    z->next_out = d->df;
+	    z->avail_out = d->dfallocated;
+	    while ((ret = deflate (z, Z_FINISH)) == Z_OK && (cnt++ <= 100)) {
+		gvwrite_no_z(job, d->df, (size_t)(z->next_out - d->df));
+		z->next_out = d->df;
+		z->avail_out = d->dfallocated;
+	    }
+	    if (ret != Z_STREAM_END) {
+		job->common->errorfn("deflation finish problem %d cnt=%d\n", ret, cnt);
+		graphviz_exit(1);
+	    }
+	    gvwrite_no_z(job, d->df, (size_t)(z->next_out - d->df));
 
-	ret = deflateEnd(z);
-	if (ret != Z_OK) {
-	    job->common->errorfn("deflation end problem %d\n", ret);
-	    graphviz_exit(1);
+	    total_in = z->total_in;
+	    ret = deflateEnd(z);
+	    if (ret != Z_OK) {
+		job->common->errorfn("deflation end problem %d\n", ret);
+		graphviz_exit(1);
+	    }
 	}
+	const uLong crc = d->crc;
+	deflate_free(d);
+	job->deflate = NULL;
+
 	out[0] = (unsigned char)crc;
 	out[1] = (unsigned char)(crc >> 8);
 	out[2] = (unsigned char)(crc >> 16);
 	out[3] = (unsigned char)(crc >> 24);
-	out[4] = (unsigned char)z->total_in;
-	out[5] = (unsigned char)(z->total_in >> 8);
-	out[6] = (unsigned char)(z->total_in >> 16);
-	out[7] = (unsigned char)(z->total_in >> 24);
+	out[4] = (unsigned char)total_in;
+	out[5] = (unsigned char)(total_in >> 8);
+	out[6] = (unsigned char)(total_in >> 16);
+	out[7] = (unsigned char)(total_in >> 24);
 	gvwrite_no_z(job, out, sizeof(out));
 #else
 	job->common->errorfn("No libz support\n");
@@ -419,43 +651,43 @@ void gvprintf(GVJ_t * job, const char *format, ...)
 #define val_str(n, x) static double n = x; static char n##str[] = #x;
 val_str(maxnegnum, -999999999999999.99)
 
-static void gvprintnum(agxbuf *xb, double number) {
-    /*
-        number limited to a working range: maxnegnum >= n >= -maxnegnum
-	suppressing trailing "0" and "."
-     */
-
+/// format a number for output
+///
+/// The number is limited to a working range, maxnegnum >= n >= -maxnegnum,
+/// and given to 3 decimal places, suppressing trailing "0" and "." and a
+/// leading "0".
+///
+/// @param buf Destination, with room for `GV_FMT_FIXED_SIZE` characters
+/// @param number Value to format
+/// @return Length of the NUL-terminated result
+static size_t gvprintnum(char *buf, double number) {
     if (number < maxnegnum) {		/* -ve limit */
-	agxbput(xb, maxnegnumstr);
-	return;
+	strcpy(buf, maxnegnumstr);
+	return sizeof(maxnegnumstr) - 1;
     }
     if (number > -maxnegnum) {		/* +ve limit */
-	agxbput(xb, maxnegnumstr + 1); // +1 to skip the '-' sign
-	return;
+	strcpy(buf, maxnegnumstr + 1); // +1 to skip the '-' sign
+	return sizeof(maxnegnumstr) - 2;
     }
 
-    agxbprint(xb, "%.03f", number);
-    agxbuf_trim_zeros(xb);
+    size_t len = gv_fmt_fixed_trim(buf, number, 3);
 
     // strip off unnecessary leading '0'
-    {
-        char *staging = agxbdisown(xb);
-        if (startswith(staging, "0.")) {
-            memmove(staging, &staging[1], strlen(staging));
-        } else if (startswith(staging, "-0.")) {
-            memmove(&staging[1], &staging[2], strlen(&staging[1]));
-        }
-        agxbput(xb, staging);
-        free(staging);
+    if (startswith(buf, "0.")) {
+	memmove(buf, &buf[1], len);
+	--len;
+    } else if (startswith(buf, "-0.")) {
+	memmove(&buf[1], &buf[2], len - 1);
+	--len;
     }
+    return len;
 }
 
 
 #ifdef GVPRINTNUM_TEST
 int main (int argc, char *argv[])
 {
-    agxbuf xb = {0};
-    char *buf;
+    char buf[GV_FMT_FIXED_SIZE];
     size_t len;
 
     double test[] = {
@@ -470,40 +702,14 @@ int main (int argc, char *argv[])
     int i = sizeof(test) / sizeof(test[0]);
 
     while (i--) {
-	gvprintnum(&xb, test[i]);
-	buf = agxbuse(&xb);;
-        fprintf (stdout, "%g = %s %d\n", test[i], buf, len);
+	len = gvprintnum(buf, test[i]);
+        fprintf (stdout, "%g = %s %zu\n", test[i], buf, len);
     }
 
-    agxbfree(&xb);
     graphviz_exit(0);
 }
 #endif
 
-/* gv_trim_zeros
-* Identify Trailing zeros and decimal point, if possible.
-* Assumes the input is the result of %.02f printing.
-*/
-static size_t gv_trim_zeros(const char *buf) {
-  char *dotp = strchr(buf, '.');
-  if (dotp == NULL) {
-    return strlen(buf);
-  }
-
-  // check this really is the result of %.02f printing
-  assert(isdigit((int)dotp[1]) && isdigit((int)dotp[2]) && dotp[3] == '\0');
-
-  if (dotp[2] == '0') {
-    if (dotp[1] == '0') {
-      return (size_t)(dotp - buf);
-    } else {
-      return (size_t)(dotp - buf) + 2;
-    }
-  }
-
-  return strlen(buf);
-}
-
 void gvprintdouble(GVJ_t * job, double num)
 {
     // Prevents values like -0
@@ -513,33 +719,44 @@ void gvprintdouble(GVJ_t * job, double num)
         return;
     }
 
-    char buf[50];
-
-    snprintf(buf, 50, "%.02f", num);
-    size_t len = gv_trim_zeros(buf);
+    char buf[GV_FMT_FIXED_SIZE];
+    const size_t len = gv_fmt_fixed_trim(buf, num, 2);
 
     gvwrite(job, buf, len);
 }
 
 void gvprintpointf(GVJ_t * job, pointf p)
 {
-    agxbuf xb = {0};
-
-    gvprintnum(&xb, p.x);
-    const char *buf = agxbuse(&xb);
-    gvwrite(job, buf, strlen(buf));
-    gvwrite(job, " ", 1);
-    gvprintnum(&xb, p.y);
-    buf = agxbuse(&xb);
-    gvwrite(job, buf, strlen(buf));
-    agxbfree(&xb);
+    char buf[2 * GV_FMT_FIXED_SIZE];
+
+    size_t len = gvprintnum(buf, p.x);
+    buf[len++] = ' ';
+    len += gvprintnum(&buf[len], p.y);
+    gvwrite(job, buf, len);
 } 
 
 void gvprintpointflist(GVJ_t *job, pointf *p, size_t n) {
-  const char *separator = "";
+  // format the points into a local buffer, writing it out whenever it may not
+  // have room for another number
+  char buf[BUFSIZ + GV_FMT_FIXED_SIZE + 1];
+  size_t len = 0;
   for (size_t i = 0; i < n; ++i) {
-    gvputs(job, separator);
-    gvprintpointf(job, p[i]);
-    separator = " ";
+    if (i > 0) {
+      buf[len++] = ' ';
+    }
+    len += gvprintnum(&buf[len], p[i].x);
+    buf[len++] = ' ';
+    if (len > BUFSIZ) {
+      gvwrite(job, buf, len);
+      len = 0;
+    }
+    len += gvprintnum(&buf[len], p[i].y);
+    if (len > BUFSIZ) {
+      gvwrite(job, buf, len);
+      len = 0;
+    }
+  }
+  if (len > 0) {
+    gvwrite(job, buf, len);
   }
 } 
@@ -18,9 +18,10 @@
 #include        <stdbool.h>
 #include        <stddef.h>
 #include        <util/alloc.h>
+#include <util/tls.h>
 
-static GVJ_t *output_filename_job;
-static GVJ_t *output_langname_job;
+static TLS GVJ_t *output_filename_job;
+static TLS GVJ_t *output_langname_job;
 
 /*
  * -T and -o can be specified in any order relative to the other, e.g.
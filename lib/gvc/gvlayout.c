@@ -19,14 +19,17 @@
 #include <gvc/gvplugin_layout.h>
 #include <gvc/gvcint.h>
 #include <cgraph/cgraph.h>
+#include <common/globals.h>
 #include <gvc/gvcproc.h>
 #include <gvc/gvc.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdlib.h>
 
 extern void graph_init(Agraph_t *g, bool use_rankdir);
 extern void graph_cleanup(Agraph_t *g);
 extern void gv_fixLocale (int set);
+extern void emit_index_reset(GVC_t *gvc);
 
 int gvlayout_select(GVC_t * gvc, const char *layout)
 {
@@ -45,12 +48,14 @@ int gvlayout_select(GVC_t * gvc, const char *layout)
     return NO_SUPPORT;
 }
 
-/* gvLayoutJobs:
+/* layout_jobs:
  * Layout input graph g based on layout engine attached to gvc.
  * Check that the root graph has been initialized. If not, initialize it.
+ * Keep the state the layout set up with the graph, for rendering it later,
+ * possibly in another thread.
  * Return 0 on success.
  */
-int gvLayoutJobs(GVC_t * gvc, Agraph_t * g)
+static int layout_jobs(GVC_t * gvc, Agraph_t * g)
 {
     gvlayout_engine_t *gvle;
     char *p;
@@ -58,6 +63,7 @@ int gvLayoutJobs(GVC_t * gvc, Agraph_t * g)
 
     agbindrec(g, "Agraphinfo_t", sizeof(Agraphinfo_t), true);
     GD_gvc(g) = gvc;
+    emit_index_reset(gvc);
     if (g != agroot(g)) {
         agbindrec(agroot(g), "Agraphinfo_t", sizeof(Agraphinfo_t), true);
         GD_gvc(agroot(g)) = gvc;
@@ -82,7 +88,8 @@ int gvLayoutJobs(GVC_t * gvc, Agraph_t * g)
     GD_drawing(agroot(g)) = GD_drawing(g);
     if (gvle && gvle->layout) {
 	gvle->layout(g);
-
+	free(GD_layout_state(g));
+	GD_layout_state(g) = gv_layout_state_save();
 
 	if (gvle->cleanup)
 	    GD_cleanup(g) = gvle->cleanup;
@@ -91,6 +98,14 @@ int gvLayoutJobs(GVC_t * gvc, Agraph_t * g)
     return 0;
 }
 
+int gvLayoutJobs(GVC_t * gvc, Agraph_t * g)
+{
+    gv_layout_lock();
+    const int rc = layout_jobs(gvc, g);
+    gv_layout_unlock();
+    return rc;
+}
+
 bool gvLayoutDone(Agraph_t * g)
 {
     return LAYOUT_DONE(g);
@@ -98,23 +113,35 @@ bool gvLayoutDone(Agraph_t * g)
 
 /* gvFreeLayout:
  * Free layout resources.
- * First, if the graph has a layout-specific cleanup function attached,
+ * First, load the state the layout kept with the graph, as the layout may
+ * have been done in another thread.
+ * Then, drop the index of node and edge positions kept for rendering.
+ * Then, if the graph has a layout-specific cleanup function attached,
  * use it and reset.
- * Then do the general graph cleanup.
+ * Finally, do the general graph cleanup.
  */
 int gvFreeLayout(GVC_t * gvc, Agraph_t * g)
 {
-    (void)gvc;
-
     /* skip if no Agraphinfo_t yet */
     if (! agbindrec(g, "Agraphinfo_t", 0, true))
 	    return 0;
 
+    gv_layout_lock();
+    if (GD_layout_state(g)) {
+	gv_layout_state_load(GD_layout_state(g));
+	free(GD_layout_state(g));
+	GD_layout_state(g) = NULL;
+    }
+
+    if (gvc)
+	emit_index_reset(gvc);
+
     if (GD_cleanup(g)) {
 	(GD_cleanup(g))(g);
 	GD_cleanup(g) = NULL;
     }
     
     graph_cleanup(g);
+    gv_layout_unlock();
     return 0;
 }
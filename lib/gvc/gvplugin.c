@@ -35,6 +35,7 @@
 #include <util/startswith.h>
 #include <util/strcasecmp.h>
 #include <util/strview.h>
+#include <util/tls.h>
 
 /*
  * Define an apis array of name strings using an enumerated api_t as index.
@@ -358,7 +359,7 @@ char *gvplugin_list(GVC_t * gvc, api_t api, const char *str)
     const gvplugin_available_t *pnext, *plugin;
     char *bp;
     bool new = true;
-    static agxbuf xb;
+    static TLS agxbuf xb;
 
     /* check for valid str */
     if (!str)
@@ -17,6 +17,7 @@
 #include "gvcjob.h"
 #include "gvcommon.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,6 +26,13 @@ extern "C" {
     /// @ingroup plugin_api
     struct gvtextlayout_engine_s {
 	bool (*textlayout) (textspan_t *span, char** fontpath);
+	/// optional: lay out `n` spans at once, setting `laid_out[i]` to what
+	/// `textlayout` would have returned for `spans[i]`
+	///
+	/// An engine that renderers draw spans with keeps a layout with each
+	/// span, as `textlayout` does. Engines without it have `textlayout`
+	/// called for each span in turn.
+	void (*textlayout_spans) (textspan_t **spans, size_t n, bool *laid_out);
     };
 
 #ifdef __cplusplus
@@ -663,12 +663,12 @@ static imagepos_t get_imagepos(char *s)
     return IMAGEPOS_MIDDLE_CENTER;
 }
 
-/* gvrender_usershape:
+/* render_usershape:
  * Scale image to fill polygon bounding box according to "imagescale",
  * positioned at "imagepos"
  */
-void gvrender_usershape(GVJ_t *job, char *name, pointf *a, size_t n,
-                        bool filled, char *imagescale, char *imagepos) {
+static void render_usershape(GVJ_t *job, char *name, pointf *a, size_t n,
+                             bool filled, char *imagescale, char *imagepos) {
     gvrender_engine_t *gvre = job->render.engine;
     usershape_t *us;
     double iw, ih, pw, ph;
@@ -795,6 +795,17 @@ void gvrender_usershape(GVJ_t *job, char *name, pointf *a, size_t n,
     }
 }
 
+/* gvrender_usershape:
+ * Render the image with the image cache locked, as other threads may be
+ * adding to it, and the loadimage plugins open its files
+ */
+void gvrender_usershape(GVJ_t *job, char *name, pointf *a, size_t n,
+                        bool filled, char *imagescale, char *imagepos) {
+    gvusershape_lock();
+    render_usershape(job, name, a, n, filled, imagescale, imagepos);
+    gvusershape_unlock();
+}
+
 void gvrender_set_penwidth(GVJ_t * job, double penwidth)
 {
     gvrender_engine_t *gvre = job->render.engine;
@@ -19,6 +19,7 @@
 #include <gvc/gvcint.h>
 #include <gvc/gvcproc.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 
 int gvtextlayout_select(GVC_t * gvc)
@@ -43,3 +44,17 @@ bool gvtextlayout(GVC_t *gvc, textspan_t *span, char **fontpath)
 	return gvte->textlayout(span, fontpath);
     return false;
 }
+
+void gvtextlayout_spans(GVC_t *gvc, textspan_t **spans, size_t n,
+                        bool *laid_out)
+{
+    gvtextlayout_engine_t *gvte = gvc->textlayout.engine;
+
+    if (gvte && gvte->textlayout_spans) {
+	gvte->textlayout_spans(spans, n, laid_out);
+	return;
+    }
+    for (size_t i = 0; i < n; i++)
+	laid_out[i] = gvte && gvte->textlayout
+	              && gvte->textlayout(spans[i], NULL);
+}
@@ -28,6 +28,7 @@
 #endif
 
 #include <common/types.h>
+#include <common/globals.h>
 #include <common/usershape.h>
 #include <common/utils.h>
 #include <gvc/gvplugin_loadimage.h>
@@ -37,13 +38,19 @@
 #include <util/agxbuf.h>
 #include <util/alloc.h>
 #include <util/gv_ctype.h>
+#include <util/lock.h>
+#include <util/streq.h>
 #include <util/strview.h>
 
-extern char *Gvimagepath;
-extern char *HTTPServerEnVar;
 extern shape_desc *find_user_shape(const char *);
 
+/* images read so far, shared by all threads under ImageLock */
 static Dict_t *ImageDict;
+static gv_lock_t ImageLock = GV_LOCK_INIT;
+
+void gvusershape_lock(void) { gv_lock(&ImageLock); }
+
+void gvusershape_unlock(void) { gv_unlock(&ImageLock); }
 
 typedef struct {
     char *template;
@@ -606,6 +613,10 @@ static Dtdisc_t ImageDictDisc = {
     .freef = usershape_close,
 };
 
+/* gvusershape_find:
+ * Return the image already read from the named file, if any.
+ * The caller holds gvusershape_lock.
+ */
 usershape_t *gvusershape_find(const char *name)
 {
     usershape_t *us;
@@ -772,8 +783,14 @@ point gvusershape_size(graph_t * g, char *name)
 	return rv;
     }
 
-    if (!HTTPServerEnVar && (oldpath != Gvimagepath)) {
-	oldpath = Gvimagepath;
+    gvusershape_lock();
+    /* Gvimagepath is per thread, so compare paths rather than pointers, lest
+     * threads laying out graphs with the same path drop each other's images
+     */
+    const char *imagepath = Gvimagepath ? Gvimagepath : "";
+    if (!HTTPServerEnVar && (!oldpath || !streq(oldpath, imagepath))) {
+	free(oldpath);
+	oldpath = gv_strdup(imagepath);
 	if (ImageDict) {
 	    dtclose(ImageDict);
 	    ImageDict = NULL;
@@ -787,5 +804,6 @@ point gvusershape_size(graph_t * g, char *name)
 
     us = gvusershape_open (name);
     rv = gvusershape_size_dpi (us, dpi);
+    gvusershape_unlock();
     return rv;
 }
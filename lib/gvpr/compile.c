@@ -65,9 +65,9 @@ static int ioflush(void *chan) { return fflush(chan); }
 static Agiodisc_t gprIoDisc = {iofread, ioputstr, ioflush};
 
 #ifdef GVDLL
-static Agdisc_t gprDisc = {0, &gprIoDisc};
+static Agdisc_t gprDisc = {.io = &gprIoDisc};
 #else
-static Agdisc_t gprDisc = {&AgIdDisc, &gprIoDisc};
+static Agdisc_t gprDisc = {.id = &AgIdDisc, .io = &gprIoDisc};
 #endif
 
 /* nameOf:
@@ -170,6 +170,29 @@ LeafList_t *RTreeSearch(RTree_t * rtp, Node_t * n, Rect_t * r)
     return llp;
 }
 
+/* RTreeSearchEach calls <visit> with the data of each data rectangle in an
+** index tree or subtree that overlaps the argument rectangle, and <arg>.
+** Unlike RTreeSearch, it allocates no list of results, so searching is
+** linear in their number.
+*/
+void RTreeSearchEach(Node_t *n, const Rect_t *r,
+                     void (*visit)(void *data, void *arg), void *arg)
+{
+    assert(n);
+    assert(n->level >= 0);
+    assert(r);
+    assert(visit);
+
+    for (size_t i = 0; i < NODECARD; i++) {
+	if (n->branch[i].child && Overlap(r, &n->branch[i].rect)) {
+	    if (n->level > 0)	/* this is an internal node in the tree */
+		RTreeSearchEach(n->branch[i].child, r, visit, arg);
+	    else		/* this is a leaf node */
+		visit(((Leaf_t *)&n->branch[i])->data, arg);
+	}
+    }
+}
+
 /* Insert a data rectangle into an index structure.
 ** RTreeInsert provides for splitting the root;
 ** returns 1 if root was split, 0 if it was not.
@@ -21,9 +21,6 @@ int solveCircuit(int nG, double **Gm, double **Gm_inv)
     double sum;
     int i, j;
 
-    if (Verbose)
-	fprintf(stderr, "Calculating circuit model");
-
     /* set diagonal entries to sum of conductances but ignore nth node */
     for (i = 0; i < nG; i++) {
 	sum = 0.0;
@@ -59,6 +56,8 @@ int circuit_model(graph_t * g, int nG)
 	}
     }
 
+    if (Verbose)
+	fprintf(stderr, "Calculating circuit model");
     rv = solveCircuit(nG, Gm, Gm_inv);
 
     if (rv)
@@ -17,6 +17,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <util/alloc.h>
+#include <util/random.h>
 #include <util/sort.h>
 
 /*****************************************
@@ -80,7 +81,7 @@ typedef struct {
 #define parent(i) ((i)/2)
 #define insideHeap(h,i) ((i)<h->heapSize)
 #define greaterPriority(h,i,j) \
-  (LT(h->data[i],h->data[j]) || ((EQ(h->data[i],h->data[j])) && (rand()%2)))
+  (LT(h->data[i],h->data[j]) || ((EQ(h->data[i],h->data[j])) && (gv_rand()%2)))
 
 #define exchange(h,i,j) {Pair temp; \
         temp=h->data[i]; \
@@ -37,7 +37,8 @@ int stress_majorization_with_hierarchy(vtx_data * graph,	/* Input graph in spars
 				       int opts,	/* options */
 				       int model,	/* difference model */
 				       int maxi,	/* max iterations */
-				       double levels_gap)
+				       double levels_gap,
+				       int nthreads)	/* threads for the distances */
 {
     int iterations = 0;		/* Output: number of iteration of the process */
 
@@ -90,7 +91,7 @@ int stress_majorization_with_hierarchy(vtx_data * graph,	/* Input graph in spars
     if (!directionalityExist) {
 	return stress_majorization_kD_mkernel(graph, n,
 					      d_coords, nodes, dim, opts,
-					      model, maxi);
+					      model, maxi, nthreads);
     }
 
 	/******************************************************************
@@ -104,7 +105,7 @@ int stress_majorization_with_hierarchy(vtx_data * graph,	/* Input graph in spars
 	    /* the dim==2 case is handled below                      */
 	    if (stress_majorization_kD_mkernel(graph, n,
 					   d_coords + 1, nodes, dim - 1,
-					   opts, model, 15) < 0)
+					   opts, model, 15, nthreads) < 0)
 		return -1;
 	    /* now copy the y-axis into the (dim-1)-axis */
 	    for (i = 0; i < n; i++) {
@@ -128,7 +129,7 @@ int stress_majorization_with_hierarchy(vtx_data * graph,	/* Input graph in spars
 	    free(levels);
 	    return stress_majorization_kD_mkernel(graph, n,
 						  d_coords, nodes, dim,
-						  opts, model, maxi);
+						  opts, model, maxi, nthreads);
 	}
 
 	if (levels_gap > 0) {
@@ -178,13 +179,14 @@ int stress_majorization_with_hierarchy(vtx_data * graph,	/* Input graph in spars
     if (Verbose)
 	start_timer();
 
+    const char *computed = NULL; // what the Dij matrix was computed from
     if (model == MODEL_SUBSET) {
 	/* weight graph to separate high-degree nodes */
 	/* and perform slower Dijkstra-based computation */
-	if (Verbose)
-	    fprintf(stderr, "Calculating subset model");
-	Dij = compute_apsp_artificial_weights_packed(graph, n);
+	computed = "subset model";
+	Dij = compute_apsp_artificial_weights_packed(graph, n, nthreads);
     } else if (model == MODEL_CIRCUIT) {
+	computed = "circuit model";
 	Dij = circuitModel(graph, n);
 	if (!Dij) {
 	    agwarningf(
@@ -193,17 +195,15 @@ int stress_majorization_with_hierarchy(vtx_data * graph,	/* Input graph in spars
 		  "is undefined. Reverting to the shortest path model.\n");
 	}
     } else if (model == MODEL_MDS) {
-	if (Verbose)
-	    fprintf(stderr, "Calculating MDS model");
-	Dij = mdsModel(graph, n);
+	computed = "MDS model";
+	Dij = mdsModel(graph, n, nthreads);
     }
     if (!Dij) {
-	if (Verbose)
-	    fprintf(stderr, "Calculating shortest paths");
-	Dij = compute_apsp_packed(graph, n);
+	computed = "shortest paths";
+	Dij = compute_apsp_packed(graph, n, nthreads);
     }
     if (Verbose) {
-	fprintf(stderr, ": %.2f sec\n", elapsed_sec());
+	fprintf(stderr, "Calculating %s: %.2f sec\n", computed, elapsed_sec());
 	fprintf(stderr, "Setting initial positions");
 	start_timer();
     }
@@ -60,7 +60,8 @@ int stress_majorization_cola(vtx_data * graph,	/* Input graph in sparse represen
 			     int dim,	/* Dimemsionality of layout */
 			     int model,	/* difference model */
 			     int maxi,	/* max iterations */
-			     ipsep_options * opt)
+			     ipsep_options * opt,
+			     int nthreads)	/* threads for the distances */
 {
     int iterations = 0;		/* Output: number of iteration of the process */
 
@@ -120,13 +121,14 @@ int stress_majorization_cola(vtx_data * graph,	/* Input graph in sparse represen
     if (Verbose)
 	start_timer();
 
+    const char *computed = NULL; // what the Dij matrix was computed from
     if (model == MODEL_SUBSET) {
 	/* weight graph to separate high-degree nodes */
 	/* and perform slower Dijkstra-based computation */
-	if (Verbose)
-	    fprintf(stderr, "Calculating subset model");
-	Dij = compute_apsp_artificial_weights_packed(graph, n);
+	computed = "subset model";
+	Dij = compute_apsp_artificial_weights_packed(graph, n, nthreads);
     } else if (model == MODEL_CIRCUIT) {
+	computed = "circuit model";
 	Dij = circuitModel(graph, n);
 	if (!Dij) {
 	    agwarningf(
@@ -135,17 +137,15 @@ int stress_majorization_cola(vtx_data * graph,	/* Input graph in sparse represen
 		  "is undefined. Reverting to the shortest path model.\n");
 	}
     } else if (model == MODEL_MDS) {
-	if (Verbose)
-	    fprintf(stderr, "Calculating MDS model");
-	Dij = mdsModel(graph, n);
+	computed = "MDS model";
+	Dij = mdsModel(graph, n, nthreads);
     }
     if (!Dij) {
-	if (Verbose)
-	    fprintf(stderr, "Calculating shortest paths");
-	Dij = compute_apsp_packed(graph, n);
+	computed = "shortest paths";
+	Dij = compute_apsp_packed(graph, n, nthreads);
     }
     if (Verbose) {
-	fprintf(stderr, ": %.2f sec\n", elapsed_sec());
+	fprintf(stderr, "Calculating %s: %.2f sec\n", computed, elapsed_sec());
 	fprintf(stderr, "Setting initial positions");
 	start_timer();
     }
@@ -13,11 +13,12 @@
 #include <neatogen/info.h>
 #include <neatogen/edges.h>
 #include <math.h>
+#include <util/tls.h>
 
 
-double pxmin, pxmax, pymin, pymax;	/* clipping window */
+TLS double pxmin, pxmax, pymin, pymax;	/* clipping window */
 
-static Freelist efl;
+static TLS Freelist efl;
 
 void edgeinit(void)
 {
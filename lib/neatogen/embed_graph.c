@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <util/alloc.h>
+#include <util/random.h>
 
 void embed_graph(vtx_data * graph, int n, int dim, DistType *** Coords,
 		 int reweight_graph)
@@ -54,7 +55,7 @@ void embed_graph(vtx_data * graph, int n, int dim, DistType *** Coords,
     }
 
     /* select the first pivot */
-    node = rand() % n;
+    node = gv_rand() % n;
 
     if (reweight_graph) {
 	dijkstra(node, graph, n, coords[0]);
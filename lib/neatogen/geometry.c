@@ -12,11 +12,11 @@
 #include <math.h>
 #include <stddef.h>
 
-double xmin, xmax, ymin, ymax;	/* min and max x and y values of sites */
-double deltax; // xmax - xmin
+TLS double xmin, xmax, ymin, ymax;	/* min and max x and y values of sites */
+TLS double deltax; // xmax - xmin
 
-size_t nsites;
-int sqrt_nsites;
+TLS size_t nsites;
+TLS int sqrt_nsites;
 
 void geominit(void)
 {
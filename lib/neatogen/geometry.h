@@ -11,6 +11,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <util/tls.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,11 +25,11 @@ extern "C" {
     } Point;
 #endif
 
-    extern double xmin, xmax, ymin, ymax;	/* extreme x,y values of sites */
-    extern double deltax;	// xmax - xmin
+    extern TLS double xmin, xmax, ymin, ymax;	/* extreme x,y values of sites */
+    extern TLS double deltax;	// xmax - xmin
 
-    extern size_t nsites; // Number of sites
-    extern int sqrt_nsites;
+    extern TLS size_t nsites; // Number of sites
+    extern TLS int sqrt_nsites;
 
     extern void geominit(void);
     extern double dist_2(Point, Point); ///< distance squared between two points
@@ -13,14 +13,15 @@
 #include <common/render.h>
 #include <stdbool.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 
 #define DELETED -2
 
-Halfedge *ELleftend, *ELrightend;
+TLS Halfedge *ELleftend, *ELrightend;
 
-static Freelist hfl;
-static int ELhashsize;
-static Halfedge **ELhash;
+static TLS Freelist hfl;
+static TLS int ELhashsize;
+static TLS Halfedge **ELhash;
 
 void ELcleanup(void)
 {
@@ -14,7 +14,7 @@
 #include <stddef.h>
 #include <util/alloc.h>
 
-Info_t *nodeInfo;		/* Array of node info */
+TLS Info_t *nodeInfo;		/* Array of node info */
 
 /* compare:
  * returns -1 if p < q.p
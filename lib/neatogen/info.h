@@ -12,6 +12,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <util/tls.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,7 +32,7 @@ typedef struct {
 } Info_t;
 
 /// array of node info
-extern Info_t *nodeInfo;
+extern TLS Info_t *nodeInfo;
 
 /// insert vertex into sorted list
 void addVertex(Site *, double, double);
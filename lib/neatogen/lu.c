@@ -45,10 +45,11 @@
 #include <math.h>
 #include <neatogen/neato.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 
-static double *scales;
-static double **lu;
-static int *ps;
+static TLS double *scales;
+static TLS double **lu;
+static TLS int *ps;
 
 /* lu_decompose() decomposes the coefficient matrix A into upper and lower
  * triangular matrices, the composite being the LU matrix.
@@ -41,17 +41,17 @@
 #include <util/alloc.h>
 #include <util/bitarray.h>
 #include <util/gv_ctype.h>
+#include <util/parallel.h>
 #include <util/prisize_t.h>
+#include <util/random.h>
 #include <util/startswith.h>
 #include <util/strcasecmp.h>
 #include <util/streq.h>
+#include <util/tls.h>
 
-#ifndef HAVE_SRAND48
-#define srand48 srand
-#endif
 
-static attrsym_t *N_pos;
-static int Pack;		/* If >= 0, layout components separately and pack together
+static TLS attrsym_t *N_pos;
+static TLS int Pack;		/* If >= 0, layout components separately and pack together
 				 * The value of Pack gives margins around graphs.
 				 */
 static char *cc_pfx = "_neato_cc";
@@ -272,7 +272,7 @@ static int user_spline(attrsym_t * E_pos, edge_t * e)
     pointf sp = { 0, 0 }, ep = { 0, 0};
     bezier *newspl;
     int more = 1;
-    static bool warned;
+    static TLS bool warned;
 
     pos = agxget(e, E_pos);
     if (*pos == '\0')
@@ -670,6 +670,8 @@ static int neatoMode(graph_t * g)
 	    mode = MODE_MAJOR;
 	else if (streq(str, "sgd"))
 		mode = MODE_SGD;
+	else if (streq(str, "sparse"))
+	    mode = MODE_SPARSE;
 #ifdef DIGCOLA
 	else if (streq(str, "hier"))
 	    mode = MODE_HIER;
@@ -1030,7 +1032,7 @@ int checkStart(graph_t * G, int nG, int dflt)
 	agwarningf("node positions are ignored unless start=random\n");
     }
     if (init == INIT_REGULAR) initRegular(G, nG);
-    srand48(seed);
+    gv_srand48(seed);
     return init;
 }
 
@@ -1117,7 +1119,7 @@ void dumpOpts (ipsep_options* opp, int nv)
  * Solve stress using majorization.
  * Old neato attributes to incorporate:
  *  weight
- * mode will be MODE_MAJOR, MODE_HIER or MODE_IPSEP
+ * mode will be MODE_MAJOR, MODE_SPARSE, MODE_HIER or MODE_IPSEP
  */
 static void
 majorization(graph_t *mg, graph_t * g, int nv, int mode, int model, int dim, adjust_data* am)
@@ -1134,6 +1136,8 @@ majorization(graph_t *mg, graph_t * g, int nv, int mode, int model, int dim, adj
 #endif
     int init = checkStart(g, nv, mode == MODE_HIER ? INIT_SELF : INIT_RANDOM);
     int opts = checkExp (g);
+    const int threads =
+	gv_threads_attr(late_int(mg, agfindgraphattr(mg, "threads"), 1, 0));
 
     if (init == INIT_SELF)
 	opts |= opt_smart_init;
@@ -1156,12 +1160,15 @@ majorization(graph_t *mg, graph_t * g, int nv, int mode, int model, int dim, adj
 	fprintf(stderr, "%d nodes %.2f sec\n", nv, elapsed_sec());
     }
 
+    if (mode == MODE_SPARSE)
+	rv = sparse_stress_majorization_kD(gp, nv, coords, nodes, Ndim, opts, model, MaxIter);
+    else
 #ifdef DIGCOLA
     if (mode != MODE_MAJOR) {
         double lgap = late_double(g, agfindgraphattr(g, "levelsgap"), 0.0, -DBL_MAX);
         if (mode == MODE_HIER) {
             rv = stress_majorization_with_hierarchy(gp, nv, coords, nodes, Ndim,
-                       opts, model, MaxIter, lgap);
+                       opts, model, MaxIter, lgap, threads);
         }
 #ifdef IPSEPCOLA
 	else {
@@ -1221,7 +1228,8 @@ majorization(graph_t *mg, graph_t * g, int nv, int mode, int model, int dim, adj
 	    fprintf (stderr, "\n");
 	    dumpOpts (&opt, nv);
 #endif
-            rv = stress_majorization_cola(gp, nv, coords, nodes, Ndim, model, MaxIter, &opt);
+            rv = stress_majorization_cola(gp, nv, coords, nodes, Ndim, model, MaxIter, &opt,
+                                          threads);
 	    freeClusterData(cs);
 	    free (nsize);
         }
@@ -1229,7 +1237,8 @@ majorization(graph_t *mg, graph_t * g, int nv, int mode, int model, int dim, adj
     }
     else
 #endif
-	rv = stress_majorization_kD_mkernel(gp, nv, coords, nodes, Ndim, opts, model, MaxIter);
+	rv = stress_majorization_kD_mkernel(gp, nv, coords, nodes, Ndim, opts, model, MaxIter,
+	                                    threads);
 
     if (rv < 0) {
 	agerr(AGPREV, "layout aborted\n");
@@ -1330,7 +1339,7 @@ neatoLayout(Agraph_t * mg, Agraph_t * g, int layoutMode, int layoutModel,
 
     if ((str = agget(g, "maxiter")))
 	MaxIter = atoi(str);
-    else if (layoutMode == MODE_MAJOR)
+    else if (layoutMode == MODE_MAJOR || layoutMode == MODE_SPARSE)
 	MaxIter = DFLT_ITERATIONS;
     else if (layoutMode == MODE_SGD)
 	MaxIter = 30;
@@ -11,6 +11,7 @@
 #include "config.h"
 #include <neatogen/overlap.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 
 #if ((defined(HAVE_GTS) || defined(HAVE_TRIANGLE)) && defined(SFDP))
 
@@ -584,7 +585,7 @@ void remove_overlap(int dim, SparseMatrix A, double *x, double *label_sizes, int
 void remove_overlap(int dim, SparseMatrix A, double *x, double *label_sizes, int ntry, double initial_scaling,
 		    int edge_labeling_scheme, int n_constr_nodes, int *constr_nodes, SparseMatrix A_constr, bool do_shrinking)
 {
-    static int once;
+    static TLS int once;
 
     (void)dim;
     (void)A;
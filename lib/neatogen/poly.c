@@ -18,6 +18,7 @@
 #include <stdbool.h>
 #include <util/alloc.h>
 #include <util/streq.h>
+#include <util/tls.h>
 
 static const int BOX = 1;
 static const int CIRCLE = 2;
@@ -25,10 +26,10 @@ static const int CIRCLE = 2;
 static bool ISBOX(const Poly *p) { return p->kind & BOX; }
 static bool ISCIRCLE(const Poly *p) { return p->kind & CIRCLE; }
 
-static size_t maxcnt = 0;
-static Point *tp1 = NULL;
-static Point *tp2 = NULL;
-static Point *tp3 = NULL;
+static TLS size_t maxcnt = 0;
+static TLS Point *tp1 = NULL;
+static TLS Point *tp2 = NULL;
+static TLS Point *tp3 = NULL;
 
 void polyFree(void)
 {
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <float.h>
 #include <limits.h>
 #include <neatogen/neato.h>
 #include <neatogen/sgd.h>
@@ -9,6 +10,7 @@
 #include <stdlib.h>
 #include <util/alloc.h>
 #include <util/bitarray.h>
+#include <util/parallel.h>
 
 static float calculate_stress(float *pos, term_sgd *terms, int n_terms) {
     float stress = 0;
@@ -140,6 +142,204 @@ static void free_adjacency(graph_sgd *graph) {
 }
 
 
+// index of the pair i < j in a packed upper triangular n×n matrix without diagonal
+static size_t packed_index(size_t n, size_t i, size_t j) {
+    return i * n - i * (i + 1) / 2 + (j - i - 1);
+}
+
+static float calculate_stress_packed(float *pos, const float *dists, int n) {
+    float stress = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            float d = dists[packed_index((size_t)n, (size_t)i, (size_t)j)];
+            if (d > 0) {
+                float dx = pos[2*i] - pos[2*j];
+                float dy = pos[2*i+1] - pos[2*j+1];
+                float r = hypotf(dx, dy) - d;
+                stress += (r * r) / (d * d);
+            }
+        }
+    }
+    return stress;
+}
+
+static void shuffle_ints(int *xs, int n, rk_state *rstate) {
+    for (int i = n - 1; i >= 1; i--) {
+        int j = rk_interval(i, rstate);
+        int temp = xs[i];
+        xs[i] = xs[j];
+        xs[j] = temp;
+    }
+}
+
+// the multithreaded schedule: instead of a global shuffle of the terms, each
+// iteration visits all pairs of nodes as a sequence of rounds, each round a
+// perfect matching from the circle method for round-robin tournaments. Node
+// labels and the order of rounds are shuffled every iteration. No node is in
+// two pairs of the same round, so a round's updates are carried out in
+// parallel without any locking, and the result does not depend on the number
+// of threads.
+static void sgd_parallel(graph_t *G, int model, int nthreads) {
+    const int n = agnnodes(G);
+    const int nthr = gv_threads(nthreads);
+
+    if (Verbose) {
+        fprintf(stderr, "calculating shortest paths and setting up stress terms on %d threads:", nthr);
+        start_timer();
+    }
+    double start = gv_wtime();
+    // distances between every pair of nodes with a term, 0 otherwise
+    float *dists = gv_calloc((size_t)n * (size_t)(n - 1) / 2, sizeof(float));
+    graph_sgd *graph = extract_adjacency(G, model);
+    // each unordered pair is the term of exactly one source, so sources can
+    // write their terms into dists concurrently
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthr)
+#endif
+    {
+        term_sgd *terms = gv_calloc(n, sizeof(term_sgd));
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (int i = 0; i < n; i++) {
+            if (bitarray_get(graph->pinneds, i)) {
+                continue;
+            }
+            int n_terms = dijkstra_sgd(graph, i, terms);
+            for (int k = 0; k < n_terms; k++) {
+                size_t a = (size_t)terms[k].i, b = (size_t)terms[k].j;
+                dists[a < b ? packed_index(n, a, b) : packed_index(n, b, a)] = terms[k].d;
+            }
+        }
+        free(terms);
+    }
+
+    // initialise annealing schedule
+    float d_min = FLT_MAX, d_max = 0;
+    for (size_t ij = 0; ij < (size_t)n * (size_t)(n - 1) / 2; ij++) {
+        if (dists[ij] > 0) {
+            d_min = fminf(d_min, dists[ij]);
+            d_max = fmaxf(d_max, dists[ij]);
+        }
+    }
+    if (Verbose) {
+        fprintf(stderr, " %.2f sec\n", gv_wtime() - start);
+    }
+    if (d_max == 0) { // no terms, so nothing to optimise
+        free(dists);
+        free_adjacency(graph);
+        initial_positions(G, n);
+        return;
+    }
+    float w_min = 1 / (d_max * d_max), w_max = 1 / (d_min * d_min);
+    float eta_max = 1 / w_min;
+    float eta_min = Epsilon / w_max;
+    float lambda = log(eta_max/eta_min) / (MaxIter-1);
+
+    // initialise starting positions (from neatoprocs)
+    initial_positions(G, n);
+    float *pos = gv_calloc(2 * n, sizeof(float));
+    for (int i = 0; i < n; i++) {
+        node_t *node = GD_neato_nlist(G)[i];
+        pos[2*i] = ND_pos(node)[0];
+        pos[2*i+1] = ND_pos(node)[1];
+    }
+
+    // an odd number of nodes gets a dummy node, whose pairs are skipped
+    const int m = n % 2 == 0 ? n : n + 1;
+    int *perm = gv_calloc(m, sizeof(int));
+    int *rounds = gv_calloc(m - 1, sizeof(int));
+    for (int i = 0; i < m; i++) {
+        perm[i] = i;
+    }
+    for (int c = 0; c < m - 1; c++) {
+        rounds[c] = c;
+    }
+
+    if (Verbose) {
+        fprintf(stderr, "solving model:");
+        start = gv_wtime();
+    }
+    // the seed of start=random, as checkStart saw it, otherwise the serial
+    // schedule's fixed seed of 0
+    long seed = 0;
+    (void)setSeed(G, INIT_SELF, &seed);
+    rk_state rstate;
+    rk_seed((unsigned long)seed, &rstate);
+    for (int t = 0; t < MaxIter; t++) {
+        shuffle_ints(perm, m, &rstate);
+        shuffle_ints(rounds, m - 1, &rstate);
+        float eta = eta_max * exp(-lambda * t);
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthr)
+#endif
+        for (int rr = 0; rr < m - 1; rr++) {
+            const int c = rounds[rr];
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+            for (int k = 0; k < m / 2; k++) {
+                // the k-th pair of round r: node m-1 stays put while the
+                // others rotate around it
+                int a = k == 0 ? m - 1 : (c + k) % (m - 1);
+                int b = (c - k + m - 1) % (m - 1);
+                int i = perm[a], j = perm[b];
+                if (i >= n || j >= n) {
+                    continue;
+                }
+                if (i > j) {
+                    int temp = i;
+                    i = j;
+                    j = temp;
+                }
+                float d = dists[packed_index(n, i, j)];
+                if (d == 0) {
+                    continue;
+                }
+                // cap step size
+                float mu = eta / (d * d);
+                if (mu > 1)
+                    mu = 1;
+
+                float dx = pos[2*i] - pos[2*j];
+                float dy = pos[2*i+1] - pos[2*j+1];
+                float mag = hypotf(dx, dy);
+
+                float r = (mu * (mag-d)) / (2*mag);
+                float r_x = r * dx;
+                float r_y = r * dy;
+
+                if (!bitarray_get(graph->pinneds, i)) {
+                    pos[2*i] -= r_x;
+                    pos[2*i+1] -= r_y;
+                }
+                if (!bitarray_get(graph->pinneds, j)) {
+                    pos[2*j] += r_x;
+                    pos[2*j+1] += r_y;
+                }
+            }
+        }
+        if (Verbose) {
+            fprintf(stderr, " %.3f", calculate_stress_packed(pos, dists, n));
+        }
+    }
+    if (Verbose) {
+        fprintf(stderr, "\nfinished in %.2f sec\n", gv_wtime() - start);
+    }
+    free(perm);
+    free(rounds);
+    free(dists);
+    free_adjacency(graph);
+
+    // copy temporary positions back into graph_t
+    for (int i = 0; i < n; i++) {
+        node_t *node = GD_neato_nlist(G)[i];
+        ND_pos(node)[0] = pos[2*i];
+        ND_pos(node)[1] = pos[2*i+1];
+    }
+    free(pos);
+}
+
 void sgd(graph_t *G, /* input graph */
         int model /* distance model */)
 {
@@ -151,6 +351,12 @@ void sgd(graph_t *G, /* input graph */
         agwarningf("mds model not yet supported in Gmode=sgd, reverting to shortpath model\n");
         model = MODEL_SHORTPATH;
     }
+    const int threads =
+        gv_threads_attr(late_int(G, agfindgraphattr(G, "threads"), 1, 0));
+    if (threads != 1) {
+        sgd_parallel(G, model, threads);
+        return;
+    }
     int n = agnnodes(G);
 
     if (Verbose) {
@@ -11,13 +11,14 @@
 #include <neatogen/mem.h>
 #include <neatogen/site.h>
 #include <math.h>
+#include <util/tls.h>
 
 
-int siteidx;
-Site *bottomsite;
+TLS int siteidx;
+TLS Site *bottomsite;
 
-static Freelist sfl;
-static size_t nvertices;
+static TLS Freelist sfl;
+static TLS size_t nvertices;
 
 void siteinit(void)
 {
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <util/tls.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,8 +26,8 @@ extern "C" {
 	unsigned refcnt;
     } Site;
 
-    extern int siteidx;
-    extern Site *bottomsite;
+    extern TLS int siteidx;
+    extern TLS Site *bottomsite;
 
     extern void siteinit(void);
     extern Site *getsite(void);
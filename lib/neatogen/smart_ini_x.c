@@ -12,6 +12,7 @@
 #include <math.h>
 #include <neatogen/digcola.h>
 #include <util/alloc.h>
+#include <util/random.h>
 #ifdef DIGCOLA
 #include <neatogen/kkutils.h>
 #include <neatogen/matrix_ops.h>
@@ -90,7 +91,7 @@ power_iteration_orthog(float** square_mat, int n, int neigs,
 		/* guess the i-th eigen vector */
 choose:
 		for (j=0; j<n; j++) {
-			curr_vector[j] = rand()%100;
+			curr_vector[j] = gv_rand()%100;
 		}
 
 		assert(orthog != NULL);
@@ -143,7 +144,7 @@ exit:
 		curr_vector = eigs[i];
 		/* guess the i-th eigen vector */
 		for (j=0; j<n; j++)
-			curr_vector[j] = rand()%100;
+			curr_vector[j] = gv_rand()%100;
 		/* orthogonalize against higher eigenvectors */
 		for (j=0; j<i; j++) {
 			alpha = -vectors_inner_product(n, eigs[j], curr_vector);
@@ -21,8 +21,11 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <util/alloc.h>
+#include <util/parallel.h>
+#include <util/random.h>
 
 // the terms in the stress energy are normalized by dᵢⱼ¯²
 
@@ -150,11 +153,11 @@ int initLayout(int n, int dim, double **coords, node_t **nodes) {
 	    if (isFixed(np))
 		pinned = 1;
 	} else {
-	    *xp++ = drand48();
-	    *yp++ = drand48();
+	    *xp++ = gv_drand48();
+	    *yp++ = gv_drand48();
 	    if (dim > 2) {
 		for (d = 2; d < dim; d++)
-		    coords[d][i] = drand48();
+		    coords[d][i] = gv_drand48();
 	    }
 	}
     }
@@ -344,7 +347,7 @@ static int sparse_stress_subspace_majorization_kD(vtx_data * graph,	/* Input gra
     /* select 'num_centers' pivots that are uniformaly spread over the graph */
 
     /* the first pivots is selected randomly */
-    node = rand() % n;
+    node = gv_rand() % n;
     CenterIndex[node] = 0;
     invCenterIndex[0] = node;
 
@@ -376,7 +379,7 @@ static int sparse_stress_subspace_majorization_kD(vtx_data * graph,	/* Input gra
 	for (int j = 0; j < n; j++) {
 	    dist[j] = MIN(dist[j], Dij[i][j]);
 	    if (dist[j] > max_dist
-		|| (dist[j] == max_dist && rand() % (j + 1) == 0)) {
+		|| (dist[j] == max_dist && gv_rand() % (j + 1) == 0)) {
 		node = j;
 		max_dist = dist[j];
 	    }
@@ -531,7 +534,7 @@ static int sparse_stress_subspace_majorization_kD(vtx_data * graph,	/* Input gra
 	/* random initialization */
 	for (k = 0; k < dim; k++) {
 	    for (i = 0; i < subspace_dim; i++) {
-		directions[k][i] = (double) rand() / RAND_MAX;
+		directions[k][i] = (double) gv_rand() / GV_RAND_MAX;
 	    }
 	}
     }
@@ -639,24 +642,78 @@ finish0:
     return iterations;
 }
 
+/* apsp_row:
+ * Offset of row i of a packed upper triangular n×n matrix
+ */
+static size_t apsp_row(int i, int n)
+{
+    return (size_t)i * (size_t)n - (size_t)i * (size_t)(i - 1) / 2;
+}
+
+/* apsp_progress:
+ * Count one more completed single source search out of n. Safe to call from
+ * the worker threads.
+ */
+static void apsp_progress(int *done, int n)
+{
+    if (Verbose < 2)
+	return;
+#ifdef _OPENMP
+#pragma omp critical(apsp_progress)
+#endif
+    {
+	++*done;
+	if (*done % 1000 == 0 || *done == n)
+	    fprintf(stderr, "\r%d of %d sources", *done, n);
+    }
+}
+
+/* apsp_report:
+ * End the progress line of an APSP phase started at start, and report its
+ * wall clock time on a line of its own (the phase timers elsewhere measure CPU
+ * time, which adds up over the threads).
+ */
+static void apsp_report(int n, int nthreads, double start)
+{
+    if (Verbose > 1 && n > 0)
+	fputs("\n", stderr);
+    if (Verbose)
+	fprintf(stderr, "All-pairs shortest paths on %d threads: %.2f sec\n",
+		nthreads, gv_wtime() - start);
+}
+
 /* compute_weighted_apsp_packed:
  * Edge lengths can be any float > 0
+ * The searches from each source run on nthreads threads, as for gv_threads,
+ * each one filling its own row.
  */
-static float *compute_weighted_apsp_packed(vtx_data * graph, int n)
+static float *compute_weighted_apsp_packed(vtx_data * graph, int n,
+					   int nthreads)
 {
-    int i, j, count;
-    float *Dij = gv_calloc(n * (n + 1) / 2, sizeof(float));
-
-    float *Di = gv_calloc(n, sizeof(float));
+    float *Dij = gv_calloc((size_t)n * (size_t)(n + 1) / 2, sizeof(float));
+    double start = gv_wtime();
+    int done = 0;
+    nthreads = gv_threads(nthreads);
 
-    count = 0;
-    for (i = 0; i < n; i++) {
-	dijkstra_f(i, graph, n, Di);
-	for (j = i; j < n; j++) {
-	    Dij[count++] = Di[j];
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+    {
+	float *Di = gv_calloc(n, sizeof(float));
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+	for (int i = 0; i < n; i++) {
+	    float *row = Dij + apsp_row(i, n);
+	    dijkstra_f(i, graph, n, Di);
+	    for (int j = i; j < n; j++) {
+		row[j - i] = Di[j];
+	    }
+	    apsp_progress(&done, n);
 	}
+	free(Di);
     }
-    free(Di);
+    apsp_report(n, nthreads, start);
     return Dij;
 }
 
@@ -664,7 +721,7 @@ static float *compute_weighted_apsp_packed(vtx_data * graph, int n)
 /* mdsModel:
  * Update matrix with actual edge lengths
  */
-float *mdsModel(vtx_data * graph, int nG)
+float *mdsModel(vtx_data * graph, int nG, int nthreads)
 {
     int i, j;
     float *Dij;
@@ -675,7 +732,7 @@ float *mdsModel(vtx_data * graph, int nG)
 	return 0;
 
     /* first, compute shortest paths to fill in non-edges */
-    Dij = compute_weighted_apsp_packed(graph, nG);
+    Dij = compute_weighted_apsp_packed(graph, nG, nthreads);
 
     /* then, replace edge entries will user-supplied len */
     for (i = 0; i < nG; i++) {
@@ -696,26 +753,40 @@ float *mdsModel(vtx_data * graph, int nG)
 
 /* compute_apsp_packed:
  * Assumes integral weights > 0.
+ * The searches from each source run on nthreads threads, as for gv_threads,
+ * each one filling its own row.
  */
-float *compute_apsp_packed(vtx_data * graph, int n)
+float *compute_apsp_packed(vtx_data * graph, int n, int nthreads)
 {
-    int i, j, count;
-    float *Dij = gv_calloc(n * (n + 1) / 2, sizeof(float));
-
-    DistType *Di = gv_calloc(n, sizeof(DistType));
+    float *Dij = gv_calloc((size_t)n * (size_t)(n + 1) / 2, sizeof(float));
+    double start = gv_wtime();
+    int done = 0;
+    nthreads = gv_threads(nthreads);
 
-    count = 0;
-    for (i = 0; i < n; i++) {
-	bfs(i, graph, n, Di);
-	for (j = i; j < n; j++) {
-	    Dij[count++] = (float)Di[j];
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+    {
+	DistType *Di = gv_calloc(n, sizeof(DistType));
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+	for (int i = 0; i < n; i++) {
+	    float *row = Dij + apsp_row(i, n);
+	    bfs(i, graph, n, Di);
+	    for (int j = i; j < n; j++) {
+		row[j - i] = (float)Di[j];
+	    }
+	    apsp_progress(&done, n);
 	}
+	free(Di);
     }
-    free(Di);
+    apsp_report(n, nthreads, start);
     return Dij;
 }
 
-float *compute_apsp_artificial_weights_packed(vtx_data *graph, int n) {
+float *compute_apsp_artificial_weights_packed(vtx_data *graph, int n,
+					      int nthreads) {
     /* compute all-pairs-shortest-path-length while weighting the graph */
     /* so high-degree nodes are distantly located */
 
@@ -747,7 +818,7 @@ float *compute_apsp_artificial_weights_packed(vtx_data *graph, int n) {
 	    graph[i].ewgts = weights;
 	    weights += graph[i].nedges;
 	}
-	Dij = compute_weighted_apsp_packed(graph, n);
+	Dij = compute_weighted_apsp_packed(graph, n, nthreads);
     } else {
 	for (i = 0; i < n; i++) {
 	    graph[i].ewgts = weights;
@@ -762,7 +833,7 @@ float *compute_apsp_artificial_weights_packed(vtx_data *graph, int n) {
 	    empty_neighbors_vec(graph, i, vtx_vec);
 	    weights += graph[i].nedges;
 	}
-	Dij = compute_apsp_packed(graph, n);
+	Dij = compute_apsp_packed(graph, n, nthreads);
     }
 
     free(vtx_vec);
@@ -805,7 +876,8 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 				   int dim,	/* dimemsionality of layout */
 				   int opts,    /* options */
 				   int model,	/* model */
-				   int maxi	/* max iterations */
+				   int maxi,	/* max iterations */
+				   int nthreads	/* threads for the distances, as for gv_threads */
     )
 {
     int iterations;		/* output: number of iteration of the process */
@@ -849,13 +921,14 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
     if (Verbose)
 	start_timer();
 
+    const char *computed = NULL; // what the Dij matrix was computed from
     if (model == MODEL_SUBSET) {
 	/* weight graph to separate high-degree nodes */
 	/* and perform slower Dijkstra-based computation */
-	if (Verbose)
-	    fprintf(stderr, "Calculating subset model");
-	Dij = compute_apsp_artificial_weights_packed(graph, n);
+	computed = "subset model";
+	Dij = compute_apsp_artificial_weights_packed(graph, n, nthreads);
     } else if (model == MODEL_CIRCUIT) {
+	computed = "circuit model";
 	Dij = circuitModel(graph, n);
 	if (!Dij) {
 	    agwarningf(
@@ -864,21 +937,19 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 		  "is undefined. Reverting to the shortest path model.\n");
 	}
     } else if (model == MODEL_MDS) {
-	if (Verbose)
-	    fprintf(stderr, "Calculating MDS model");
-	Dij = mdsModel(graph, n);
+	computed = "MDS model";
+	Dij = mdsModel(graph, n, nthreads);
     }
     if (!Dij) {
-	if (Verbose)
-	    fprintf(stderr, "Calculating shortest paths");
+	computed = "shortest paths";
 	if (graph->ewgts)
-	    Dij = compute_weighted_apsp_packed(graph, n);
+	    Dij = compute_weighted_apsp_packed(graph, n, nthreads);
 	else
-	    Dij = compute_apsp_packed(graph, n);
+	    Dij = compute_apsp_packed(graph, n, nthreads);
     }
 
     if (Verbose) {
-	fprintf(stderr, ": %.2f sec\n", elapsed_sec());
+	fprintf(stderr, "Calculating %s: %.2f sec\n", computed, elapsed_sec());
 	fprintf(stderr, "Setting initial positions");
 	start_timer();
     }
@@ -913,7 +984,7 @@ int stress_majorization_kD_mkernel(vtx_data * graph,	/* Input graph in sparse re
 	    }
 	    /* add small random noise */
 	    for (j = 0; j < n; j++) {
-		d_coords[i][j] += 1e-6 * (drand48() - 0.5);
+		d_coords[i][j] += 1e-6 * (gv_drand48() - 0.5);
 	    }
 	    orthog1(n, d_coords[i]);
 	}
@@ -1133,3 +1204,465 @@ finish1:
     free(lap1);
     return iterations;
 }
+
+/* pivot_sssp:
+ * Single source shortest path lengths from source, as floats.
+ * As in bfs, nodes unreachable from source are placed 10 beyond the
+ * farthest reachable one.
+ */
+static void pivot_sssp(vtx_data * graph, int n, int source, float *dist,
+		       DistType * scratch)
+{
+    if (graph->ewgts) {
+	float far = 0;
+	dijkstra_f(source, graph, n, dist);
+	for (int i = 0; i < n; i++) {
+	    if (dist[i] < FLT_MAX)
+		far = fmaxf(far, dist[i]);
+	}
+	for (int i = 0; i < n; i++) {
+	    if (dist[i] == FLT_MAX)
+		dist[i] = far + 10;
+	}
+    } else {
+	bfs(source, graph, n, scratch);
+	for (int i = 0; i < n; i++)
+	    dist[i] = (float)scratch[i];
+    }
+}
+
+/* symmetrize_weights:
+ * Give both directions of each edge, and any duplicates of it, the largest
+ * of their weights. The sparse model takes a pair's distance from whichever of
+ * its nodes it meets first, so it must be the same from either end.
+ * Artificial subset weights can differ between the two ends when a node lists
+ * a neighbor more than once.
+ */
+static void symmetrize_weights(vtx_data * graph, int n)
+{
+    for (int i = 0; i < n; i++) {
+	for (size_t e = 1; e < graph[i].nedges; e++) {
+	    int j = graph[i].edges[e];
+	    if (j <= i)
+		continue;
+	    float w = graph[i].ewgts[e];
+	    for (size_t f = 1; f < graph[i].nedges; f++) {
+		if (graph[i].edges[f] == j)
+		    w = fmaxf(w, graph[i].ewgts[f]);
+	    }
+	    for (size_t f = 1; f < graph[j].nedges; f++) {
+		if (graph[j].edges[f] == i)
+		    w = fmaxf(w, graph[j].ewgts[f]);
+	    }
+	    for (size_t f = 1; f < graph[i].nedges; f++) {
+		if (graph[i].edges[f] == j)
+		    graph[i].ewgts[f] = w;
+	    }
+	    for (size_t f = 1; f < graph[j].nedges; f++) {
+		if (graph[j].edges[f] == i)
+		    graph[j].ewgts[f] = w;
+	    }
+	}
+    }
+}
+
+static int cmpf(const void *x, const void *y)
+{
+    const float *a = x;
+    const float *b = y;
+    if (*a < *b)
+	return -1;
+    if (*a > *b)
+	return 1;
+    return 0;
+}
+
+/* region_count:
+ * Number of entries of the sorted array dists[0..len-1] that are <= d.
+ */
+static int region_count(const float *dists, int len, float d)
+{
+    int lo = 0, hi = len;
+    while (lo < hi) {
+	int mid = lo + (hi - lo) / 2;
+	if (dists[mid] <= d)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    return lo;
+}
+
+/* stress term between two nodes: the desired distance and its weight */
+typedef struct {
+    int *edges;
+    float *wgts;
+    float *dists;
+    size_t size;
+    size_t capacity;
+} sparse_terms;
+
+static void add_term(sparse_terms * t, int j, float w, float d)
+{
+    if (t->size == t->capacity) {
+	size_t c = t->capacity == 0 ? 1024 : 2 * t->capacity;
+	t->edges = gv_recalloc(t->edges, t->capacity, c, sizeof(int));
+	t->wgts = gv_recalloc(t->wgts, t->capacity, c, sizeof(float));
+	t->dists = gv_recalloc(t->dists, t->capacity, c, sizeof(float));
+	t->capacity = c;
+    }
+    t->edges[t->size] = j;
+    t->wgts[t->size] = w;
+    t->dists[t->size] = d;
+    t->size++;
+}
+
+static float term_weight(float d, int exp)
+{
+    return exp == 2 ? 1.0f / (d * d) : 1.0f / d;
+}
+
+/* sparse_stress_majorization_kD:
+ * Stress majorization on a sparse model of the stress function (Ortmann,
+ * Klimenta, Brandes, "A Sparse Stress Model"). Each node keeps its exact
+ * terms with its graph neighbors, plus a term with each of k pivots chosen
+ * by max-min distance. A pivot stands in for the nodes of its region (those
+ * closer to it than to any other pivot), so the weight of its term with a
+ * node is scaled by the number of region nodes lying within half the
+ * node-pivot distance of the pivot.
+ *
+ * Only the k×n pivot distances are computed, and the weighted Laplacian has
+ * O(kn + |E|) entries, so unlike stress_majorization_kD_mkernel this needs
+ * memory linear in the size of the graph. The Laplacian is stored as a
+ * vtx_data graph and each step is solved with the sparse conjugate_gradient.
+ */
+int sparse_stress_majorization_kD(vtx_data * graph,	/* Input graph in sparse representation */
+				  int n,	/* Number of nodes */
+				  double **coords,	/* coordinates of nodes (output layout) */
+				  node_t ** nodes,	/* original nodes */
+				  int dim,	/* dimemsionality of layout */
+				  int opts,	/* options */
+				  int model,	/* model */
+				  int maxi	/* max iterations */
+    )
+{
+    const double conj_tol = tolerance_cg;	/* tolerance of Conjugate Gradient */
+    const int smart_ini = opts & opt_smart_init;
+    const int exp = opts & opt_exp_flag;
+    const int k = n < num_pivots_sparse_stress ? n : num_pivots_sparse_stress;
+    int iterations = 0;
+    int havePinned;
+    bool converged;
+    double old_stress;
+
+    if (maxi < 0)
+	return 0;
+
+    if (model == MODEL_CIRCUIT) {
+	agwarningf("model circuit is not supported by mode=sparse; "
+		   "using shortpath\n");
+    }
+
+    /* The subset model is shortest paths over a graph weighted so
+     * high-degree nodes are distantly located. Edge lengths that are
+     * longer than the artificial weights are kept.
+     */
+    float *old_weights = NULL;
+    if (model == MODEL_SUBSET) {
+	old_weights = graph[0].ewgts;
+	compute_new_weights(graph, n);
+	if (old_weights) {
+	    size_t nedges = 0;
+	    for (int i = 0; i < n; i++)
+		nedges += graph[i].nedges;
+	    for (size_t e = 0; e < nedges; e++)
+		graph[0].ewgts[e] = fmaxf(graph[0].ewgts[e], old_weights[e]);
+	}
+    }
+    if (graph->ewgts)
+	symmetrize_weights(graph, n);
+
+    if (Verbose) {
+	fprintf(stderr, "Calculating %d pivots", k);
+	start_timer();
+    }
+
+	/**********************************************
+	** Pivots by max-min, and their regions      **
+	**********************************************/
+
+    int *pivots = gv_calloc(k, sizeof(int));
+    int *pivot_of = gv_calloc(n, sizeof(int));	/* index of node as pivot, or -1 */
+    int *owner = gv_calloc(n, sizeof(int));	/* pivot whose region a node is in */
+    float *pdist = gv_calloc((size_t)k * (size_t)n, sizeof(float));
+    float *mindist = gv_calloc(n, sizeof(float));
+    DistType *scratch = gv_calloc(n, sizeof(DistType));
+
+    for (int i = 0; i < n; i++) {
+	pivot_of[i] = -1;
+	mindist[i] = FLT_MAX;
+    }
+    int p = (int)(gv_drand48() * n) % n;
+    for (int t = 0; t < k; t++) {
+	float *row = pdist + (size_t)t * (size_t)n;
+	pivots[t] = p;
+	pivot_of[p] = t;
+	pivot_sssp(graph, n, p, row, scratch);
+	for (int i = 0; i < n; i++) {
+	    if (row[i] < mindist[i]) {
+		mindist[i] = row[i];
+		owner[i] = t;
+	    }
+	}
+	/* next pivot: the node farthest from all chosen ones */
+	for (int i = 0; i < n; i++) {
+	    if (pivot_of[i] < 0 && (pivot_of[p] >= 0 || mindist[i] > mindist[p]))
+		p = i;
+	}
+    }
+    free(scratch);
+
+    /* distances from each pivot to the nodes in its region, sorted */
+    int *region_start = gv_calloc(k + 1, sizeof(int));
+    float *region_dists = gv_calloc(n, sizeof(float));
+    for (int i = 0; i < n; i++)
+	region_start[owner[i] + 1]++;
+    for (int t = 0; t < k; t++)
+	region_start[t + 1] += region_start[t];
+    {
+	int *fill = gv_calloc(k, sizeof(int));
+	for (int i = 0; i < n; i++) {
+	    int t = owner[i];
+	    region_dists[region_start[t] + fill[t]++] = mindist[i];
+	}
+	free(fill);
+    }
+    for (int t = 0; t < k; t++) {
+	qsort(region_dists + region_start[t],
+	      region_start[t + 1] - region_start[t], sizeof(float), cmpf);
+    }
+    free(owner);
+    free(mindist);
+
+    if (Verbose) {
+	fprintf(stderr, ": %.2f sec\n", elapsed_sec());
+	fprintf(stderr, "Setting up stress function");
+	start_timer();
+    }
+
+	/*********************************************
+	** Terms, and the weighted Laplacian        **
+	*********************************************/
+
+    sparse_terms terms = {0};
+    size_t *row_start = gv_calloc(n + 1, sizeof(size_t));
+    int *pos = gv_calloc(n, sizeof(int));	/* position of a node in the current row */
+    for (int i = 0; i < n; i++)
+	pos[i] = -1;
+
+    for (int i = 0; i < n; i++) {
+	size_t start = terms.size;
+	const int nneighbors = (int)graph[i].nedges;
+	row_start[i] = start;
+	add_term(&terms, i, 0, 0);	/* diagonal */
+	pos[i] = 0;
+
+	/* exact terms with neighbors */
+	for (int e = 1; e < nneighbors; e++) {
+	    int j = graph[i].edges[e];
+	    float d = graph->ewgts ? graph[i].ewgts[e] : 1;
+	    if (pos[j] >= 0 || d <= 0) {
+		add_term(&terms, j, 0, 0);	/* keep rows aligned with graph */
+		continue;
+	    }
+	    pos[j] = (int)(terms.size - start);
+	    add_term(&terms, j, term_weight(d, exp), d);
+	}
+
+	/* terms with the pivots, standing in for their regions */
+	for (int t = 0; t < k; t++) {
+	    int q = pivots[t];
+	    float d = pdist[(size_t)t * (size_t)n + (size_t)i];
+	    if (pos[q] >= 0 || d <= 0)
+		continue;
+	    int s = region_count(region_dists + region_start[t],
+				 region_start[t + 1] - region_start[t], d / 2);
+	    pos[q] = (int)(terms.size - start);
+	    add_term(&terms, q, (float)s * term_weight(d, exp), d);
+	}
+
+	/* as a pivot, the terms every other node has with this one */
+	if (pivot_of[i] >= 0) {
+	    int t = pivot_of[i];
+	    const float *row = pdist + (size_t)t * (size_t)n;
+	    for (int j = 0; j < n; j++) {
+		float d = row[j];
+		if (j == i || (pos[j] >= 0 && pos[j] < nneighbors) || d <= 0)
+		    continue;
+		int s = region_count(region_dists + region_start[t],
+				     region_start[t + 1] - region_start[t],
+				     d / 2);
+		float w = (float)s * term_weight(d, exp);
+		if (pos[j] >= 0) {
+		    terms.wgts[start + (size_t)pos[j]] += w;
+		} else {
+		    pos[j] = (int)(terms.size - start);
+		    add_term(&terms, j, w, d);
+		}
+	    }
+	}
+
+	for (size_t e = start; e < terms.size; e++)
+	    pos[terms.edges[e]] = -1;
+    }
+    row_start[n] = terms.size;
+    free(pos);
+    free(pivots);
+    free(pivot_of);
+    free(pdist);
+    free(region_start);
+    free(region_dists);
+
+    /* Laplacian of the weights, in the form conjugate_gradient expects */
+    vtx_data *lap = gv_calloc(n, sizeof(vtx_data));
+    float *lap_vals = gv_calloc(terms.size, sizeof(float));
+    for (int i = 0; i < n; i++) {
+	double degree = 0;
+	lap[i].nedges = row_start[i + 1] - row_start[i];
+	lap[i].edges = terms.edges + row_start[i];
+	lap[i].ewgts = lap_vals + row_start[i];
+	for (size_t e = 1; e < lap[i].nedges; e++) {
+	    lap[i].ewgts[e] = -terms.wgts[row_start[i] + e];
+	    degree += terms.wgts[row_start[i] + e];
+	}
+	lap[i].ewgts[0] = (float)degree;
+    }
+
+    if (Verbose) {
+	fprintf(stderr, ": %zu terms %.2f sec\n", terms.size - (size_t)n,
+		elapsed_sec());
+	fprintf(stderr, "Setting initial positions");
+	start_timer();
+    }
+
+	/**************************
+	** Layout initialization **
+	**************************/
+
+    if (smart_ini && n > 1) {
+	havePinned = 0;
+	if (sparse_stress_subspace_majorization_kD(graph, n, coords, dim,
+						   smart_ini, exp, 0, 50,
+						   num_pivots_stress) < 0) {
+	    iterations = -1;
+	    goto finish;
+	}
+	for (int d = 0; d < dim; d++) {
+	    for (int i = 0; i < n; i++)
+		coords[d][i] += 1e-6 * (gv_drand48() - 0.5);
+	    orthog1(n, coords[d]);
+	}
+    } else {
+	havePinned = initLayout(n, dim, coords, nodes);
+    }
+    if (n == 1 || maxi == 0)
+	goto finish;
+
+    if (Verbose) {
+	fprintf(stderr, ": %.2f sec\n", elapsed_sec());
+	fprintf(stderr, "Solving model: ");
+	start_timer();
+    }
+
+	/*************************
+	** Layout optimization  **
+	*************************/
+
+    double **b = gv_calloc(dim, sizeof(double *));
+    b[0] = gv_calloc((size_t)dim * (size_t)n, sizeof(double));
+    for (int d = 1; d < dim; d++)
+	b[d] = b[0] + d * n;
+    double *tmp_coords = gv_calloc(n, sizeof(double));
+    double *diff = gv_calloc(dim, sizeof(double));
+
+    old_stress = DBL_MAX;	// at least one iteration
+    for (converged = false; iterations < maxi && !converged; iterations++) {
+	/* b := L_Z(x) x, where L_Z has the off-diagonal entries
+	 * -w_ij d_ij / |x_i - x_j|, and the stress of x
+	 */
+	double new_stress = 0;
+	memset(b[0], 0, (size_t)dim * (size_t)n * sizeof(double));
+	for (int i = 0; i < n; i++) {
+	    for (size_t e = 1; e < lap[i].nedges; e++) {
+		size_t te = row_start[i] + e;
+		int j = terms.edges[te];
+		double w = terms.wgts[te];
+		double dist = 0;
+		if (w <= 0)
+		    continue;
+		for (int d = 0; d < dim; d++) {
+		    diff[d] = coords[d][i] - coords[d][j];
+		    dist += diff[d] * diff[d];
+		}
+		dist = sqrt(dist);
+		if (i < j)
+		    new_stress += w * (dist - terms.dists[te]) * (dist - terms.dists[te]);
+		if (dist > 0) {
+		    double f = w * terms.dists[te] / dist;
+		    for (int d = 0; d < dim; d++)
+			b[d][i] += f * diff[d];
+		}
+	    }
+	}
+
+	/* In theory, old_stress >= new_stress
+	 * but we use fabs in case of numerical error.
+	 */
+	converged = fabs(old_stress - new_stress) / old_stress < Epsilon
+	    || new_stress < Epsilon;
+	old_stress = new_stress;
+
+	for (int d = 0; d < dim; d++) {
+	    if (havePinned) {
+		copy_vector(n, coords[d], tmp_coords);
+		if (conjugate_gradient(lap, tmp_coords, b[d], n, conj_tol, n)) {
+		    iterations = -1;
+		    break;
+		}
+		for (int i = 0; i < n; i++) {
+		    if (!isFixed(nodes[i]))
+			coords[d][i] = tmp_coords[i];
+		}
+	    } else if (conjugate_gradient(lap, coords[d], b[d], n, conj_tol, n)) {
+		iterations = -1;
+		break;
+	    }
+	}
+	if (iterations < 0)
+	    break;
+	if (Verbose && iterations % 5 == 0) {
+	    fprintf(stderr, "%.3f ", new_stress);
+	    if ((iterations + 5) % 50 == 0)
+		fprintf(stderr, "\n");
+	}
+    }
+    if (Verbose && iterations >= 0) {
+	fprintf(stderr, "\nfinal e = %f %d iterations %.2f sec\n", old_stress,
+		iterations, elapsed_sec());
+    }
+
+    free(b[0]);
+    free(b);
+    free(tmp_coords);
+    free(diff);
+finish:
+    free(lap_vals);
+    free(lap);
+    free(row_start);
+    free(terms.edges);
+    free(terms.wgts);
+    free(terms.dists);
+    if (model == MODEL_SUBSET)
+	restore_old_weights(graph, n, old_weights);
+    return iterations;
+}
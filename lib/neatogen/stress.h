@@ -25,6 +25,9 @@ extern "C" {
     /* some possible values for 'num_pivots_stress' */
 #define num_pivots_stress 40
 
+    /* number of pivots in the sparse stress model (mode=sparse) */
+#define num_pivots_sparse_stress 100
+
 #define opt_smart_init 0x4
 #define opt_exp_flag   0x3
 
@@ -37,13 +40,26 @@ extern "C" {
 					      int dim,	/* dimemsionality of layout */
 					      int opts,	/* option flags */
 					      int model,	/* model */
-					      int maxi	/* max iterations */
+					      int maxi,	/* max iterations */
+					      int nthreads	/* threads for the distances, as for gv_threads */
+	);
+
+    /* Pivot-based sparse approximation of the above, in linear memory */
+    extern int sparse_stress_majorization_kD(vtx_data * graph,	/* Input graph in sparse representation */
+					     int n,	/* Number of nodes */
+					     double **coords,	/* coordinates of nodes (output layout)  */
+					     node_t **nodes,	/* original nodes  */
+					     int dim,	/* dimemsionality of layout */
+					     int opts,	/* option flags */
+					     int model,	/* model */
+					     int maxi	/* max iterations */
 	);
 
-extern float *compute_apsp_packed(vtx_data * graph, int n);
-extern float *compute_apsp_artificial_weights_packed(vtx_data *graph, int n);
+extern float *compute_apsp_packed(vtx_data * graph, int n, int nthreads);
+extern float *compute_apsp_artificial_weights_packed(vtx_data *graph, int n,
+                                                     int nthreads);
 extern float* circuitModel(vtx_data * graph, int nG);
-extern float* mdsModel (vtx_data * graph, int nG);
+extern float* mdsModel (vtx_data * graph, int nG, int nthreads);
 extern int initLayout(int n, int dim, double **coords, node_t **nodes);
 
 #ifdef __cplusplus
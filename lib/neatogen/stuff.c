@@ -16,11 +16,13 @@
 #include	<stdlib.h>
 #include	<time.h>
 #include	<util/alloc.h>
+#include <util/random.h>
+#include <util/tls.h>
 #ifndef _WIN32
 #include	<unistd.h>
 #endif
 
-static double Epsilon2;
+static TLS double Epsilon2;
 static Agnode_t *choose_node(graph_t *, int);
 static void make_spring(graph_t *, Agnode_t *, Agnode_t *, double);
 static void move_node(graph_t *, int, Agnode_t *);
@@ -314,7 +316,7 @@ void jitter_d(node_t * np, int nG, int n)
 {
     int k;
     for (k = n; k < Ndim; k++)
-	ND_pos(np)[k] = nG * drand48();
+	ND_pos(np)[k] = nG * gv_drand48();
 }
 
 void jitter3d(node_t * np, int nG)
@@ -324,8 +326,8 @@ void jitter3d(node_t * np, int nG)
 
 void randompos(node_t * np, int nG)
 {
-    ND_pos(np)[0] = nG * drand48();
-    ND_pos(np)[1] = nG * drand48();
+    ND_pos(np)[0] = nG * gv_drand48();
+    ND_pos(np)[1] = nG * gv_drand48();
     if (Ndim > 2)
 	jitter3d(np, nG);
 }
@@ -334,7 +336,7 @@ void initial_positions(graph_t * G, int nG)
 {
     int init, i;
     node_t *np;
-    static int once = 0;
+    static TLS int once = 0;
 
     if (Verbose)
 	fprintf(stderr, "Setting initial positions\n");
@@ -516,7 +518,7 @@ node_t *choose_node(graph_t * G, int nG)
     int i, k;
     double m, max;
     node_t *choice, *np;
-    static int cnt = 0;
+    static TLS int cnt = 0;
 
     cnt++;
     if (GD_move(G) >= MaxIter)
@@ -560,7 +562,7 @@ void move_node(graph_t * G, int nG, node_t * n)
 	c[i] = -GD_sum_t(G)[m][i];
     solve(a, b, c, Ndim);
     for (i = 0; i < Ndim; i++) {
-	b[i] = (Damping + 2 * (1 - Damping) * drand48()) * b[i];
+	b[i] = (Damping + 2 * (1 - Damping) * gv_drand48()) * b[i];
 	ND_pos(n)[i] += b[i];
     }
     GD_move(G)++;
@@ -576,9 +578,9 @@ void move_node(graph_t * G, int nG, node_t * n)
     free(a);
 }
 
-static node_t **Heap;
-static int Heapsize;
-static node_t *Src;
+static TLS node_t **Heap;
+static TLS int Heapsize;
+static TLS node_t *Src;
 
 static void heapup(node_t * v)
 {
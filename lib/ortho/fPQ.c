@@ -13,13 +13,14 @@
 #include "config.h"
 #include <assert.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 
 #include <ortho/fPQ.h>
 
-static snode**  pq;
-static int     PQcnt;
-static snode    guard;
-static int     PQsize;
+static TLS snode**  pq;
+static TLS int     PQcnt;
+static TLS snode    guard;
+static TLS int     PQsize;
 
 void
 PQgen(int sz)
@@ -19,6 +19,8 @@
 #include <util/alloc.h>
 #include <util/bitarray.h>
 #include <util/prisize_t.h>
+#include <util/random.h>
+#include <util/tls.h>
 
 #ifndef DEBUG
   #define DEBUG 0
@@ -42,12 +44,6 @@
 #define CROSS_SINE(v0, v1) ((v0).x * (v1).y - (v1).x * (v0).y)
 #define LENGTH(v0) hypot((v0).x, (v0).y)
 
-#ifndef HAVE_SRAND48
-#define srand48 srand
-#endif
-#ifdef _WIN32
-extern double drand48(void);
-#endif
 
 typedef struct {
   int vnum;
@@ -63,21 +59,21 @@ typedef struct {
   int nextfree;
 } vertexchain_t;
 
-static int chain_idx, mon_idx;
+static TLS int chain_idx, mon_idx;
 	/* Table to hold all the monotone */
 	/* polygons . Each monotone polygon */
 	/* is a circularly linked list */
-static monchain_t* mchain;
+static TLS monchain_t* mchain;
 	/* chain init. information. This */
 	/* is used to decide which */
 	/* monotone polygon to split if */
 	/* there are several other */
 	/* polygons touching at the same */
 	/* vertex  */
-static vertexchain_t* vert;
+static TLS vertexchain_t* vert;
 	/* contains position of any vertex in */
 	/* the monotone chain for the polygon */
-static int* mon;
+static TLS int* mon;
 
 /* return a new mon structure from the table */
 #define newmon() (++mon_idx)
@@ -158,7 +154,7 @@ generateRandomOrdering(int n, int* permute)
     for (i = 0; i <= n; i++) permute[i] = i;
 
     for (i = 1; i <= n; i++) {
-	j = i + drand48() * (n + 1 - i);
+	j = i + gv_drand48() * (n + 1 - i);
 	if (j != i) {
 	    tmp = permute[i];
 	    permute [i] = permute[j];
@@ -699,7 +695,7 @@ boxf *partition(cell *cells, int ncells, size_t *nrects, boxf bb) {
 	    if (i%4 == 0) fprintf(stderr, "\n");
 	}
     }
-    srand48(173);
+    gv_srand48(173);
     generateRandomOrdering (nsegs, permute);
     traps_t hor_traps = construct_trapezoids(nsegs, segs, permute);
     if (DEBUG) {
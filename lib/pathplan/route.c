@@ -15,6 +15,7 @@
 #include <math.h>
 #include <pathplan/pathutil.h>
 #include <pathplan/solvers.h>
+#include <util/tls.h>
 
 #define EPSILON1 1E-3
 #define EPSILON2 1E-6
@@ -30,8 +31,8 @@ typedef struct tna_t {
 
 #define POINTSIZE sizeof (Ppoint_t)
 
-static Ppoint_t *ops;
-static size_t opn, opl;
+static TLS Ppoint_t *ops;
+static TLS size_t opn, opl;
 
 static int reallyroutespline(Pedge_t *, size_t,
 			     Ppoint_t *, int, Ppoint_t, Ppoint_t);
@@ -100,8 +101,8 @@ static int reallyroutespline(Pedge_t *edges, size_t edgen, Ppoint_t *inps,
     double maxd, d, t;
     int maxi, i, spliti;
 
-    static tna_t *tnas;
-    static int tnan;
+    static TLS tna_t *tnas;
+    static TLS int tnan;
 
     if (tnan < inpn) {
 	tna_t *new_tnas = realloc(tnas, sizeof(tna_t) * (size_t)inpn);
@@ -17,6 +17,7 @@
 #include <pathplan/pathutil.h>
 #include <pathplan/tri.h>
 #include <util/prisize_t.h>
+#include <util/tls.h>
 
 #define DQ_FRONT 1
 #define DQ_BACK  2
@@ -52,10 +53,10 @@ typedef struct deque_t {
     size_t pnlpn, fpnlpi, lpnlpi, apex;
 } deque_t;
 
-static triangles_t tris;
+static TLS triangles_t tris;
 
-static Ppoint_t *ops;
-static size_t opn;
+static TLS Ppoint_t *ops;
+static TLS size_t opn;
 
 static int triangulate(pointnlink_t **, size_t);
 static int loadtriangle(pointnlink_t *, pointnlink_t *, pointnlink_t *);
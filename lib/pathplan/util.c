@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <pathplan/pathutil.h>
 #include <util/alloc.h>
+#include <util/tls.h>
 
 void freePath(Ppolyline_t* p)
 {
@@ -58,8 +59,8 @@ int Ppolybarriers(Ppoly_t ** polys, int npolys, Pedge_t ** barriers,
 void
 make_polyline(Ppolyline_t line, Ppolyline_t* sline)
 {
-    static size_t isz = 0;
-    static Ppoint_t* ispline = 0;
+    static TLS size_t isz = 0;
+    static TLS Ppoint_t* ispline = 0;
     const size_t npts = 4 + 3 * (line.pn - 2);
 
     if (npts > isz) {
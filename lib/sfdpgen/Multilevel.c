@@ -11,9 +11,12 @@
 #include <sfdpgen/Multilevel.h>
 #include <assert.h>
 #include <common/arith.h>
+#include <limits.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <util/alloc.h>
+#include <util/parallel.h>
 
 static const int minsize = 4;
 static const double min_coarsen_factor = 0.75;
@@ -50,14 +53,43 @@ void Multilevel_delete(Multilevel grid){
   free(grid);
 }
 
+/* Group nodes with the same neighbors (supervariables) into clusters of up to
+ * MAX_CLUSTER_SIZE, appending them to cluster/clusterp and marking them in
+ * matched. Returns the number of entries of cluster used.
+ */
+static int cluster_supernodes(SparseMatrix A, int *matched, int mark,
+                              int *cluster, int *clusterp, int *ncluster) {
+  int i, j, nz = clusterp[*ncluster], nz0;
+  int nsuper, *super = NULL, *superp = NULL;
+
+  SparseMatrix_decompose_to_supervariables(A, &nsuper, &super, &superp);
+
+  for (i = 0; i < nsuper; i++){
+    if (superp[i+1] - superp[i] <= 1) continue;
+    nz0 = clusterp[*ncluster];
+    for (j = superp[i]; j < superp[i+1]; j++){
+      matched[super[j]] = mark;
+      cluster[nz++] = super[j];
+      if (nz - nz0 >= MAX_CLUSTER_SIZE){
+	clusterp[++(*ncluster)] = nz;
+	nz0 = nz;
+      }
+    }
+    if (nz > nz0) clusterp[++(*ncluster)] = nz;
+  }
+
+  free(super);
+  free(superp);
+  return nz;
+}
+
 static void maximal_independent_edge_set_heavest_edge_pernode_supernodes_first(SparseMatrix A, int **cluster, int **clusterp, int *ncluster){
   int i, ii, j, *ia, *ja, m, n, *p = NULL;
   (void)n;
   double *a, amax = 0;
   int jamax = 0;
-  int *matched, nz, nz0;
+  int *matched, nz;
   enum {MATCHED = -1};
-  int  nsuper, *super = NULL, *superp = NULL;
 
   assert(A);
   assert(A->is_pattern_symmetric);
@@ -75,27 +107,11 @@ static void maximal_independent_edge_set_heavest_edge_pernode_supernodes_first(S
   assert(SparseMatrix_is_symmetric(A, false));
   assert(A->type == MATRIX_TYPE_REAL);
 
-  SparseMatrix_decompose_to_supervariables(A, &nsuper, &super, &superp);
-
   *ncluster = 0;
   (*clusterp)[0] = 0;
-  nz = 0;
+  nz = cluster_supernodes(A, matched, MATCHED, *cluster, *clusterp, ncluster);
   a = A->a;
 
-  for (i = 0; i < nsuper; i++){
-    if (superp[i+1] - superp[i] <= 1) continue;
-    nz0 = (*clusterp)[*ncluster];
-    for (j = superp[i]; j < superp[i+1]; j++){
-      matched[super[j]] = MATCHED;
-      (*cluster)[nz++] = super[j];
-      if (nz - nz0 >= MAX_CLUSTER_SIZE){
-	(*clusterp)[++(*ncluster)] = nz;
-	nz0 = nz;
-      }
-    }
-    if (nz > nz0) (*clusterp)[++(*ncluster)] = nz;
-  }
-
   p = random_permutation(m);
   for (ii = 0; ii < m; ii++){
     i = p[ii];
@@ -133,10 +149,6 @@ static void maximal_independent_edge_set_heavest_edge_pernode_supernodes_first(S
   }
   free(p);
 
-  free(super);
-
-  free(superp);
-
   free(matched);
 }
 
@@ -198,8 +210,272 @@ static void Multilevel_coarsen_internal(SparseMatrix A, SparseMatrix *cA,
   free(clusterp);
 }
 
+/* a hash of the edge {i, j}, used to break ties between edges of equal weight
+ * the same way from both of its ends
+ */
+static uint32_t edge_hash(int i, int j, uint32_t seed) {
+  uint64_t lo = (uint64_t)(i < j ? i : j), hi = (uint64_t)(i < j ? j : i);
+  uint64_t h = (lo << 32 | hi) ^ seed;
+  h ^= h >> 33;
+  h *= UINT64_C(0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
+
+/* is edge {i, j} of weight a heavier than edge {i, k} of weight b? A strict
+ * total order, so both ends of an edge agree on it
+ */
+static bool edge_heavier(int i, int j, double a, int k, double b,
+                         uint32_t seed) {
+  if (a != b) return a > b;
+  const uint32_t hj = edge_hash(i, j, seed), hk = edge_hash(i, k, seed);
+  if (hj != hk) return hj > hk;
+  return j > k;
+}
+
+/* A parallel alternative to
+ * maximal_independent_edge_set_heavest_edge_pernode_supernodes_first, giving
+ * clusters of the same form. After clustering supervariables, nodes are
+ * matched in rounds of handshakes: every unmatched node points at its
+ * heaviest unmatched neighbor, and pairs pointing at each other are matched.
+ * The heaviest remaining edge is always such a pair, so each round makes
+ * progress, and the result is a maximal matching that is locally dominant
+ * (each matched edge is the heaviest of its ends at the time). The rounds
+ * only depend on the previous one, not on the order nodes are visited in, so
+ * the matching is the same for any number of threads.
+ */
+static void locally_dominant_matching(SparseMatrix A, int nthreads,
+                                      int **cluster, int **clusterp,
+                                      int *ncluster) {
+  int i, *ia = A->ia, *ja = A->ja, m = A->m, nz;
+  double *a = A->a;
+  enum {SUPERNODE = -2}; // UNMATCHED being -1
+
+  assert(A->is_pattern_symmetric);
+  assert(A->m == A->n);
+  assert(A->type == MATRIX_TYPE_REAL);
+  *cluster = gv_calloc(m, sizeof(int));
+  *clusterp = gv_calloc(m + 1, sizeof(int));
+  int *mate = gv_calloc(m, sizeof(int));
+  int *cand = gv_calloc(m, sizeof(int));
+  int *active = gv_calloc(m, sizeof(int));
+
+  for (i = 0; i < m; i++) mate[i] = UNMATCHED;
+
+  *ncluster = 0;
+  (*clusterp)[0] = 0;
+  nz = cluster_supernodes(A, mate, SUPERNODE, *cluster, *clusterp, ncluster);
+
+  /* ties are broken differently on every call, as the serial matching visits
+   * nodes in a different random order every time
+   */
+  const uint32_t seed = (uint32_t)irand(INT_MAX);
+  int nactive = 0;
+  for (i = 0; i < m; i++) {
+    if (mate[i] == UNMATCHED) active[nactive++] = i;
+  }
+
+  while (nactive > 0) {
+    int k;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 256) num_threads(nthreads)
+#endif
+    for (k = 0; k < nactive; k++) {
+      const int v = active[k];
+      int best = -1;
+      double abest = 0;
+      for (int j = ia[v]; j < ia[v+1]; j++) {
+        const int u = ja[j];
+        if (u == v || mate[u] != UNMATCHED) continue;
+        if (best < 0 || edge_heavier(v, u, a[j], best, abest, seed)) {
+          best = u;
+          abest = a[j];
+        }
+      }
+      cand[v] = best;
+    }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+#endif
+    for (k = 0; k < nactive; k++) {
+      const int v = active[k];
+      if (cand[v] >= 0 && cand[cand[v]] == v) mate[v] = cand[v];
+    }
+    /* nodes with no unmatched neighbor now will never have one */
+    int still = 0;
+    for (k = 0; k < nactive; k++) {
+      const int v = active[k];
+      if (mate[v] == UNMATCHED && cand[v] >= 0) active[still++] = v;
+    }
+    nactive = still;
+  }
+
+  for (i = 0; i < m; i++) {
+    if (mate[i] > i) {
+      (*cluster)[nz++] = i;
+      (*cluster)[nz++] = mate[i];
+      (*clusterp)[++(*ncluster)] = nz;
+    }
+  }
+  for (i = 0; i < m; i++) {
+    if (mate[i] == UNMATCHED) {
+      (*cluster)[nz++] = i;
+      (*clusterp)[++(*ncluster)] = nz;
+    }
+  }
+  assert(nz == m);
+
+  free(active);
+  free(cand);
+  free(mate);
+}
+
+/* The Galerkin product R A P without its diagonal, for the aggregation P that
+ * maps fine node i to the coarse node cmap[i] and R = Pᵀ. Entry (c, d) is the
+ * sum of A over the members of clusters c and d, accumulated straight into the
+ * coarse matrix a row at a time rather than through SparseMatrix_multiply3 and
+ * its intermediate product.
+ */
+static SparseMatrix galerkin_product(SparseMatrix A, int nc, const int *cluster,
+                                     const int *clusterp, const int *cmap,
+                                     int nthreads) {
+  const int *ia = A->ia, *ja = A->ja;
+  const double *a = A->a;
+  int *cia = gv_calloc((size_t)nc + 1, sizeof(int));
+
+  /* count the distinct off-diagonal coarse columns of each coarse row */
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+  {
+    int *mark = gv_calloc((size_t)nc, sizeof(int));
+    for (int d = 0; d < nc; d++) mark[d] = -1;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 256)
+#endif
+    for (int c = 0; c < nc; c++) {
+      int count = 0;
+      for (int k = clusterp[c]; k < clusterp[c+1]; k++) {
+        const int i = cluster[k];
+        for (int j = ia[i]; j < ia[i+1]; j++) {
+          const int d = cmap[ja[j]];
+          if (d != c && mark[d] != c) {
+            mark[d] = c;
+            count++;
+          }
+        }
+      }
+      cia[c + 1] = count;
+    }
+    free(mark);
+  }
+  for (int c = 0; c < nc; c++) cia[c + 1] += cia[c];
+
+  SparseMatrix cA = SparseMatrix_new(nc, nc, cia[nc], MATRIX_TYPE_REAL,
+                                     FORMAT_CSR);
+  free(cA->ia);
+  cA->ia = cia;
+  cA->nz = cia[nc];
+  int *cja = cA->ja;
+  double *ca = cA->a;
+
+  /* fill them in, in order of first appearance */
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+  {
+    int *pos = gv_calloc((size_t)nc, sizeof(int));
+    for (int d = 0; d < nc; d++) pos[d] = -1;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 256)
+#endif
+    for (int c = 0; c < nc; c++) {
+      int next = cia[c];
+      for (int k = clusterp[c]; k < clusterp[c+1]; k++) {
+        const int i = cluster[k];
+        for (int j = ia[i]; j < ia[i+1]; j++) {
+          const int d = cmap[ja[j]];
+          if (d == c) continue;
+          if (pos[d] < 0) {
+            pos[d] = next;
+            cja[next] = d;
+            ca[next++] = a[j];
+          } else {
+            ca[pos[d]] += a[j];
+          }
+        }
+      }
+      assert(next == cia[c + 1]);
+      for (int j = cia[c]; j < next; j++) pos[cja[j]] = -1;
+    }
+    free(pos);
+  }
+
+  cA->is_symmetric = true;
+  cA->is_pattern_symmetric = true;
+  return cA;
+}
+
+/* Multilevel_coarsen_internal for threads other than 1 */
+static void Multilevel_coarsen_internal_parallel(SparseMatrix A,
+                                                 SparseMatrix *cA,
+                                                 SparseMatrix *P,
+                                                 SparseMatrix *R,
+                                                 int threads) {
+  int n = A->m, nc, i, c;
+  int *cluster = NULL, *clusterp = NULL;
+  const int nthreads = gv_threads(threads);
+
+  assert(A->m == A->n);
+  *cA = NULL;
+  *P = NULL;
+  *R = NULL;
+
+  locally_dominant_matching(A, nthreads, &cluster, &clusterp, &nc);
+  assert(nc <= n);
+  if (nc == n || nc < minsize) goto RETURN;
+
+  int *cmap = gv_calloc(n, sizeof(int));
+  for (c = 0; c < nc; c++) {
+    for (i = clusterp[c]; i < clusterp[c+1]; i++) cmap[cluster[i]] = c;
+  }
+
+  /* P maps each node to its cluster, and R averages over a cluster */
+  *P = SparseMatrix_new(n, nc, n, MATRIX_TYPE_REAL, FORMAT_CSR);
+  double *pa = (*P)->a;
+  for (i = 0; i < n; i++) {
+    (*P)->ia[i] = i;
+    (*P)->ja[i] = cmap[i];
+    pa[i] = 1.;
+  }
+  (*P)->ia[n] = n;
+  (*P)->nz = n;
+
+  *R = SparseMatrix_new(nc, n, n, MATRIX_TYPE_REAL, FORMAT_CSR);
+  double *ra = (*R)->a;
+  for (c = 0; c < nc; c++) {
+    const int size = clusterp[c+1] - clusterp[c];
+    (*R)->ia[c] = clusterp[c];
+    for (i = clusterp[c]; i < clusterp[c+1]; i++) {
+      (*R)->ja[i] = cluster[i];
+      ra[i] = 1. / size;
+    }
+  }
+  (*R)->ia[nc] = n;
+  (*R)->nz = n;
+
+  *cA = galerkin_product(A, nc, cluster, clusterp, cmap, nthreads);
+  free(cmap);
+
+ RETURN:
+  free(cluster);
+  free(clusterp);
+}
+
 static void Multilevel_coarsen(SparseMatrix A, SparseMatrix *cA,
-                               SparseMatrix *P, SparseMatrix *R) {
+                               SparseMatrix *P, SparseMatrix *R, int threads) {
   SparseMatrix cA0 = A, P0 = NULL, R0 = NULL, M;
   int nc = 0, n;
   
@@ -208,7 +484,11 @@ static void Multilevel_coarsen(SparseMatrix A, SparseMatrix *cA,
   n = A->n;
 
   do {/* this loop force a sufficient reduction */
-    Multilevel_coarsen_internal(A, &cA0, &P0, &R0);
+    if (threads == 1) {
+      Multilevel_coarsen_internal(A, &cA0, &P0, &R0);
+    } else {
+      Multilevel_coarsen_internal_parallel(A, &cA0, &P0, &R0, threads);
+    }
     if (!cA0) return;
     nc = cA0->n;
 #ifdef DEBUG_PRINT
@@ -263,7 +543,7 @@ static Multilevel Multilevel_establish(Multilevel grid,
 #endif
     return grid;
   }
-  Multilevel_coarsen(A, &cA, &P, &R);
+  Multilevel_coarsen(A, &cA, &P, &R, ctrl.threads);
   if (!cA) return grid;
 
   cgrid = Multilevel_init(cA);
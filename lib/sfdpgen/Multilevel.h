@@ -30,6 +30,9 @@ enum { MAX_CLUSTER_SIZE = 4 };
 
 typedef struct {
   int maxlevel;
+  int threads; /* 1: serial greedy matching. Otherwise a parallel locally dominant
+                  matching on this many threads (0: all available), whose result
+                  does not depend on the number of threads */
 } Multilevel_control;
 
 void Multilevel_delete(Multilevel grid);
@@ -25,6 +25,7 @@
 #include <stddef.h>
 #include <util/alloc.h>
 #include <util/gv_ctype.h>
+#include <util/parallel.h>
 #include <util/strcasecmp.h>
 
 static void sfdp_init_edge(edge_t * e)
@@ -223,6 +224,8 @@ tuneControl (graph_t* g, spring_electrical_control ctrl)
 	agwarningf("label_scheme = %d > 4 : ignoring\n", ctrl->edge_labeling_scheme);
 	ctrl->edge_labeling_scheme = 0;
     }
+    ctrl->threads =
+	gv_threads_attr(late_int(g, agfindgraphattr(g, "threads"), 1, 0));
 }
 
 void sfdp_layout(graph_t * g)
@@ -11,6 +11,7 @@
 #include <assert.h>
 #include <string.h>
 #include <sfdpgen/sparse_solve.h>
+#include <sparse/kernels.h>
 #include <sfdpgen/sfdp.h>
 #include <math.h>
 #include <common/arith.h>
@@ -66,7 +67,7 @@ static double conjugate_gradient(SparseMatrix A, const double *precon, int n,
   SparseMatrix_multiply_vector(A, x, &r);
   r = vector_subtract_to(n, rhs, r);
 
-  res0 = res = sqrt(vector_product(n, r, r))/n;
+  res0 = res = sqrt(kernel_dot(n, r, r))/n;
 #ifdef DEBUG_PRINT
     if (Verbose){
       fprintf(stderr,
@@ -77,23 +78,23 @@ static double conjugate_gradient(SparseMatrix A, const double *precon, int n,
 
   while ((iter++) < maxit && res > tol*res0){
     z = diag_precon(precon, r, z);
-    rho = vector_product(n, r, z);
+    rho = kernel_dot(n, r, z);
 
     if (iter > 1){
       beta = rho/rho_old;
-      p = vector_saxpy(n, z, p, beta);
+      kernel_xpby(n, z, beta, p);
     } else {
       memcpy(p, z, sizeof(double)*n);
     }
 
     SparseMatrix_multiply_vector(A, p, &q);
 
-    alpha = rho/vector_product(n, p, q);
+    alpha = rho/kernel_dot(n, p, q);
 
-    x = vector_saxpy2(n, x, p, alpha);
-    r = vector_saxpy2(n, r, q, -alpha);
-    
-    res = sqrt(vector_product(n, r, r))/n;
+    kernel_axpy(n, alpha, p, x);
+    kernel_axpy(n, -alpha, q, r);
+
+    res = sqrt(kernel_dot(n, r, r))/n;
 
     rho_old = rho;
   }
@@ -27,6 +27,8 @@
 #include <util/agxbuf.h>
 #include <util/alloc.h>
 #include <util/bitarray.h>
+#include <util/parallel.h>
+#include <util/random.h>
 
 /// another parameter
 /// fₐ(i, j) = C × dist(i , j)² ÷ K × dᵢⱼ, fᵣ(i, j) = K³⁻ᵖ ÷ dist(i, j)⁻ᵖ
@@ -66,6 +68,7 @@ spring_electrical_control spring_electrical_control_new(void){
   ctrl->initial_scaling = -4;
   ctrl->rotation = 0.;
   ctrl->edge_labeling_scheme = 0;
+  ctrl->threads = 1;
   return ctrl;
 }
 
@@ -98,6 +101,7 @@ void spring_electrical_control_print(spring_electrical_control ctrl){
     smoothings[ctrl->smoothing], ctrl->overlap, ctrl->initial_scaling, (int)ctrl->do_shrinking);
   fprintf (stderr, "  octree scheme %s\n", tschemes[ctrl->tscheme]);
   fprintf (stderr, "  edge_labeling_scheme %d\n", ctrl->edge_labeling_scheme);
+  fprintf (stderr, "  threads %d\n", ctrl->threads);
 }
 
 enum { MAX_I = 20, OPT_UP = 1, OPT_DOWN = -1, OPT_INIT = 0 };
@@ -280,7 +284,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
   ja = A->ja;
 
   if (ctrl->random_start){
-    srand(ctrl->random_seed);
+    gv_srand(ctrl->random_seed);
     for (i = 0; i < dim*n; i++) x[i] = drand();
   }
   if (K < 0){
@@ -302,7 +306,13 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 #ifdef TIME
     start = clock();
 #endif
-    QuadTree qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x);
+    QuadTree qt;
+    if (ctrl->threads == 1) {
+      qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x);
+    } else {
+      qt = QuadTree_new_from_point_list_bulk(dim, n, max_qtree_level, x,
+                                             ctrl->threads);
+    }
 
 #ifdef TIME
     qtree_new_cpu += ((double) (clock() - start))/CLOCKS_PER_SEC;
@@ -313,7 +323,12 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
     start = clock();
 #endif
 
-    QuadTree_get_repulsive_force(qt, force, x, bh, p, KP, counts);
+    if (ctrl->threads == 1) {
+      QuadTree_get_repulsive_force(qt, force, x, bh, p, KP, counts);
+    } else {
+      QuadTree_get_repulsive_force_parallel(qt, force, x, bh, p, KP, counts,
+                                            ctrl->threads);
+    }
 
 #ifdef TIME
     end = clock();
@@ -321,6 +336,10 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0, spring_electrica
 #endif
 
     /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
+#ifdef _OPENMP
+#pragma omp parallel for private(f, j, k, dist) if (ctrl->threads != 1) \
+    num_threads(gv_threads(ctrl->threads))
+#endif
     for (i = 0; i < n; i++){
       f = &(force[i*dim]);
       for (j = ia[i]; j < ia[i+1]; j++){
@@ -424,7 +443,7 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0, spring_el
   ja = A->ja;
 
   if (ctrl->random_start){
-    srand(ctrl->random_seed);
+    gv_srand(ctrl->random_seed);
     for (i = 0; i < dim*n; i++) x[i] = drand();
   }
   if (K < 0){
@@ -561,7 +580,7 @@ void spring_electrical_embedding(int dim, SparseMatrix A0, spring_electrical_con
   ja = A->ja;
 
   if (ctrl->random_start){
-    srand(ctrl->random_seed);
+    gv_srand(ctrl->random_seed);
     for (i = 0; i < dim*n; i++) x[i] = drand();
   }
   if (K < 0){
@@ -727,7 +746,7 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
   d = D->a;
 
   if (ctrl->random_start){
-    srand(ctrl->random_seed);
+    gv_srand(ctrl->random_seed);
     for (i = 0; i < dim*n; i++) x[i] = drand();
   }
   if (K < 0){
@@ -1130,7 +1149,8 @@ void multilevel_spring_electrical_embedding(int dim, SparseMatrix A0,
     return;
   }
 
-  Multilevel_control mctrl = {.maxlevel = ctrl->multilevels};
+  Multilevel_control mctrl = {.maxlevel = ctrl->multilevels,
+                              .threads = ctrl->threads};
   grid0 = Multilevel_new(A, mctrl);
 
   grid = Multilevel_get_coarsest(grid0);
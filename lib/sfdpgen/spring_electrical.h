@@ -48,6 +48,8 @@ struct spring_electrical_control_struct {
 			       0 (no action, default), 1 (penalty based method to make that kind of node close to the center of its neighbor), 
 			       1 (penalty based method to make that kind of node close to the old center of its neighbor),
 			       3 (two step process of overlap removal and straightening) */
+  int threads; ///< worker threads for the fast quadtree scheme; 1 keeps the
+               ///< serial algorithm, ≤ 0 means as many as available
 };
 
 typedef struct  spring_electrical_control_struct  *spring_electrical_control; 
@@ -5,6 +5,7 @@
 #include <sfdpgen/stress_model.h>
 #include <stdbool.h>
 #include <util/alloc.h>
+#include <util/random.h>
 
 void stress_model(int dim, SparseMatrix B, double **x, int maxit_sm, int *flag) {
   int m;
@@ -25,7 +26,7 @@ void stress_model(int dim, SparseMatrix B, double **x, int maxit_sm, int *flag)
   m = A->m;
   if (!x) {
     *x = gv_calloc(m * dim, sizeof(double));
-    srand(123);
+    gv_srand(123);
     for (i = 0; i < dim*m; i++) (*x)[i] = drand();
   }
 
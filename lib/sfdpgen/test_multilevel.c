@@ -0,0 +1,217 @@
+// basic unit tester for Multilevel.c
+
+#ifdef NDEBUG
+#error this is not intended to be compiled with assertions off
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// include the implementation itself, to reach its internals
+#include "Multilevel.c"
+#include "../sparse/SparseMatrix.c"
+#include "../sparse/general.c"
+#include "../sparse/kernels.c"
+#include "../util/random.c"
+
+unsigned char Verbose;
+
+// a random symmetric weighted graph of n nodes, with integer weights so sums
+// do not depend on the order they are taken in. Some nodes hang off a common
+// hub, to give the matching supervariables to cluster.
+static SparseMatrix random_graph(int n, int nedges) {
+  const int leaves = n / 10;
+  const int nz = 2 * (nedges + leaves);
+  int *irn = calloc(nz, sizeof(int));
+  int *jcn = calloc(nz, sizeof(int));
+  double *val = calloc(nz, sizeof(double));
+  assert(irn != NULL && jcn != NULL && val != NULL);
+
+  int k = 0;
+  for (int e = 0; e < nedges; e++) {
+    const int i = leaves + 1 + rand() % (n - leaves - 1);
+    const int j = leaves + 1 + rand() % (n - leaves - 1);
+    const double w = 1 + rand() % 9;
+    irn[k] = i, jcn[k] = j, val[k++] = w;
+    irn[k] = j, jcn[k] = i, val[k++] = w;
+  }
+  for (int i = 1; i <= leaves; i++) {
+    irn[k] = 0, jcn[k] = i, val[k++] = 1;
+    irn[k] = i, jcn[k] = 0, val[k++] = 1;
+  }
+  assert(k == nz);
+
+  SparseMatrix A = SparseMatrix_from_coordinate_arrays(
+      nz, n, n, irn, jcn, val, MATRIX_TYPE_REAL, sizeof(double));
+  free(val);
+  free(jcn);
+  free(irn);
+
+  assert(SparseMatrix_is_symmetric(A, false));
+  return A;
+}
+
+static bool adjacent(SparseMatrix A, int i, int j) {
+  for (int k = A->ia[i]; k < A->ia[i + 1]; k++) {
+    if (A->ja[k] == j) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// the clusters must cover every node once, pair up only neighbors, and leave
+// no two neighbors both unmatched
+static void check_matching(SparseMatrix A, int nc, const int *cluster,
+                           const int *clusterp) {
+  const int n = A->m;
+
+  // nodes the supervariable clustering may group regardless of adjacency
+  int nsuper, *super, *superp;
+  SparseMatrix_decompose_to_supervariables(A, &nsuper, &super, &superp);
+  bool *is_super = calloc(n, sizeof(bool));
+  assert(is_super != NULL);
+  for (int s = 0; s < nsuper; s++) {
+    for (int k = superp[s]; superp[s + 1] - superp[s] > 1 && k < superp[s + 1];
+         k++) {
+      is_super[super[k]] = true;
+    }
+  }
+  free(super);
+  free(superp);
+
+  int *seen = calloc(n, sizeof(int));
+  bool *single = calloc(n, sizeof(bool));
+  assert(seen != NULL && single != NULL);
+  assert(clusterp[0] == 0);
+  assert(clusterp[nc] == n);
+  for (int c = 0; c < nc; c++) {
+    const int size = clusterp[c + 1] - clusterp[c];
+    assert(size >= 1);
+    for (int k = clusterp[c]; k < clusterp[c + 1]; k++) {
+      assert(cluster[k] >= 0 && cluster[k] < n);
+      ++seen[cluster[k]];
+    }
+    const int first = cluster[clusterp[c]];
+    if (is_super[first]) {
+      assert(size <= MAX_CLUSTER_SIZE);
+      for (int k = clusterp[c]; k < clusterp[c + 1]; k++) {
+        assert(is_super[cluster[k]]);
+      }
+    } else if (size == 2) {
+      const int second = cluster[clusterp[c] + 1];
+      assert(!is_super[second]);
+      assert(first != second);
+      assert(adjacent(A, first, second));
+    } else {
+      assert(size == 1);
+      single[first] = true;
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    assert(seen[i] == 1 && "node not matched exactly once");
+  }
+  for (int i = 0; i < n; i++) {
+    for (int k = A->ia[i]; single[i] && k < A->ia[i + 1]; k++) {
+      const int j = A->ja[k];
+      assert((i == j || !single[j]) && "matching is not maximal");
+    }
+  }
+
+  free(single);
+  free(seen);
+  free(is_super);
+}
+
+// dense copy of a real CSR matrix
+static double *dense(SparseMatrix A) {
+  double *d = calloc((size_t)A->m * A->n, sizeof(double));
+  assert(d != NULL);
+  const double *a = A->a;
+  for (int i = 0; i < A->m; i++) {
+    for (int k = A->ia[i]; k < A->ia[i + 1]; k++) {
+      d[(size_t)i * A->n + A->ja[k]] += a[k];
+    }
+  }
+  return d;
+}
+
+static void test_matching(int n, int nedges) {
+  SparseMatrix A = random_graph(n, nedges);
+
+  // the matching must not depend on the number of threads
+  int *cluster[2], *clusterp[2], nc[2];
+  for (int t = 0; t < 2; t++) {
+    gv_srand(42);
+    locally_dominant_matching(A, t == 0 ? 1 : 4, &cluster[t], &clusterp[t],
+                              &nc[t]);
+    check_matching(A, nc[t], cluster[t], clusterp[t]);
+  }
+  assert(nc[0] == nc[1]);
+  assert(memcmp(clusterp[0], clusterp[1], (nc[0] + 1) * sizeof(int)) == 0);
+  assert(memcmp(cluster[0], cluster[1], n * sizeof(int)) == 0);
+
+  for (int t = 0; t < 2; t++) {
+    free(cluster[t]);
+    free(clusterp[t]);
+  }
+  SparseMatrix_delete(A);
+}
+
+static void test_galerkin(int n, int nedges, int nthreads) {
+  SparseMatrix A = random_graph(n, nedges);
+
+  SparseMatrix cA, P, R;
+  Multilevel_coarsen_internal_parallel(A, &cA, &P, &R, nthreads);
+  assert(cA != NULL && P != NULL && R != NULL);
+  const int nc = cA->m;
+  assert(cA->n == nc && P->m == n && P->n == nc && R->m == nc && R->n == n);
+
+  // Rᵀ A P the way the serial coarsening computes it
+  SparseMatrix Pt = SparseMatrix_transpose(P);
+  SparseMatrix expected = SparseMatrix_multiply3(Pt, A, P);
+  assert(expected != NULL);
+  expected = SparseMatrix_remove_diagonal(expected);
+
+  double *e = dense(expected), *actual = dense(cA);
+  for (size_t k = 0; k < (size_t)nc * nc; k++) {
+    assert(actual[k] == e[k]);
+  }
+  // no entry is stored twice or explicitly zero
+  assert(cA->nz == expected->nz);
+  free(actual);
+  free(e);
+
+  // R averages over each cluster
+  for (int c = 0; c < nc; c++) {
+    const int size = Pt->ia[c + 1] - Pt->ia[c];
+    assert(R->ia[c + 1] - R->ia[c] == size);
+    for (int k = R->ia[c]; k < R->ia[c + 1]; k++) {
+      assert(adjacent(Pt, c, R->ja[k]));
+      assert(((double *)R->a)[k] == 1.0 / size);
+    }
+  }
+
+  SparseMatrix_delete(expected);
+  SparseMatrix_delete(Pt);
+  SparseMatrix_delete(R);
+  SparseMatrix_delete(P);
+  SparseMatrix_delete(cA);
+  SparseMatrix_delete(A);
+}
+
+int main(void) {
+  for (int n = 20; n <= 2000; n *= 10) {
+    test_matching(n, 2 * n);
+    test_matching(n, 5 * n);
+    for (int nthreads = 1; nthreads <= 4; nthreads += 3) {
+      test_galerkin(n, 2 * n, nthreads);
+      test_galerkin(n, 5 * n, nthreads);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -15,7 +15,10 @@
 #include <sparse/QuadTree.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <util/alloc.h>
+#include <util/parallel.h>
 
 extern double distance_cropped(double *x, int dim, int i, int j);
 
@@ -306,6 +309,109 @@ void QuadTree_get_repulsive_force(QuadTree qt, double *force, double *x, double
   for (i = 0; i < 4; i++) counts[i] /= n;
 
 }
+static void QuadTree_gather_weights(QuadTree qt, double *wgts, double *ncells) {
+  // record the weight of every node in wgts[id] and count the cells
+  if (!qt) return;
+  (*ncells)++;
+  for (node_data l = qt->l; l; l = l->next) wgts[l->id] = l->node_weight;
+  if (qt->qts) {
+    for (int i = 0; i < 1 << qt->dim; i++) {
+      QuadTree_gather_weights(qt->qts[i], wgts, ncells);
+    }
+  }
+}
+
+static void QuadTree_node_repulsive_force(QuadTree qt, int nodeid, double wgt,
+                                          double *f, double *x, double bh,
+                                          double p, double KP, double *counts) {
+  // accumulate into f the repulsive force exerted on node nodeid by the nodes
+  // in qt, treating well separated cells as supernodes. Only reads the tree.
+  double *pt, dist, w;
+  int dim, k;
+
+  if (!qt) return;
+  dim = qt->dim;
+  pt = &x[nodeid * dim];
+
+  for (node_data l = qt->l; l; l = l->next) {
+    if (l->id == nodeid) continue;
+    counts[1]++;
+    dist = distance_cropped(x, dim, nodeid, l->id);
+    w = wgt * l->node_weight * KP;
+    for (k = 0; k < dim; k++) {
+      if (p == -1) {
+        f[k] += w * (pt[k] - l->coord[k]) / (dist * dist);
+      } else {
+        f[k] += w * (pt[k] - l->coord[k]) / pow(dist, 1. - p);
+      }
+    }
+  }
+
+  if (!qt->qts) return;
+
+  counts[0]++;
+  if (qt->width < bh * point_distance(qt->center, pt, dim)) {
+    dist = fmax(point_distance(qt->average, pt, dim), MINDIST);
+    w = wgt * qt->total_weight * KP;
+    for (k = 0; k < dim; k++) {
+      if (p == -1) {
+        f[k] += w * (pt[k] - qt->average[k]) / (dist * dist);
+      } else {
+        f[k] += w * (pt[k] - qt->average[k]) / pow(dist, 1. - p);
+      }
+    }
+    return;
+  }
+  for (int i = 0; i < 1 << dim; i++) {
+    QuadTree_node_repulsive_force(qt->qts[i], nodeid, wgt, f, x, bh, p, KP,
+                                  counts);
+  }
+}
+
+void QuadTree_get_repulsive_force_parallel(QuadTree qt, double *force,
+                                           double *x, double bh, double p,
+                                           double KP, double *counts,
+                                           int nthreads) {
+  // Same contract as QuadTree_get_repulsive_force, but computed node by node:
+  // each node walks the (read-only) quadtree on its own and only writes its
+  // own slot in force, so nodes can be distributed across threads. The result
+  // for a node does not depend on how nodes were distributed, hence layouts
+  // are reproducible regardless of nthreads.
+  //   nthreads: number of worker threads, ≤ 0 for the OpenMP default
+  //   counts:
+  //   .  counts[0]: number of cells opened or used as supernodes
+  //   .  counts[1]: number of node-node interactions
+  //   .  counts[2]: number of total cells in the quadtree
+  //   . Al normalized by dividing by number of nodes
+  int n = qt->n, dim = qt->dim, i;
+  double ncells = 0, cell_work = 0, node_work = 0;
+  double *wgts = gv_calloc(n, sizeof(double));
+
+  QuadTree_gather_weights(qt, wgts, &ncells);
+
+#ifdef _OPENMP
+  nthreads = gv_threads(nthreads);
+#pragma omp parallel for schedule(dynamic, 64) num_threads(nthreads) \
+    reduction(+ : cell_work, node_work)
+#else
+  (void)nthreads;
+#endif
+  for (i = 0; i < n; i++) {
+    double c[2] = {0};
+    double *f = &force[i * dim];
+    for (int k = 0; k < dim; k++) f[k] = 0;
+    QuadTree_node_repulsive_force(qt, i, wgts[i], f, x, bh, p, KP, c);
+    cell_work += c[0];
+    node_work += c[1];
+  }
+
+  counts[0] = cell_work / n;
+  counts[1] = node_work / n;
+  counts[2] = ncells / n;
+  counts[3] = 0;
+  free(wgts);
+}
+
 QuadTree QuadTree_new_from_point_list(int dim, int n, int max_level, double *coord){
   /* form a new QuadTree data structure from a list of coordinates of n points
      coord: of length n*dim, point i sits at [i*dim, i*dim+dim - 1]
@@ -369,12 +475,19 @@ QuadTree QuadTree_new(int dim, double *center, double width, int max_level){
   q->l = NULL;
   q->max_level = max_level;
   q->data = NULL;
+  q->storage = NULL;
   return q;
 }
 
+static void QuadTree_storage_delete(struct QuadTree_storage *st);
+
 void QuadTree_delete(QuadTree q){
   int i, dim;
   if (!q) return;
+  if (q->storage) {
+    QuadTree_storage_delete(q->storage);
+    return;
+  }
   dim = q->dim;
   free(q->center);
   free(q->average);
@@ -511,9 +624,372 @@ static QuadTree QuadTree_add_internal(QuadTree q, double *coord, double weight,
   return q;
 }
 
+/* storage of a tree built by QuadTree_new_from_point_list_bulk. Cells are laid
+   out in depth-first (Z-order) order, and each leaf's nodes are consecutive
+   entries of nodes, so traversals mostly walk memory sequentially. */
+struct QuadTree_storage {
+  struct QuadTree_struct *cells;
+  int ncells;
+  QuadTree *children;/* child tables of internal cells, 2^dim entries each */
+  double *vectors;/* center and average of each cell, dim entries each */
+  struct node_data_struct *nodes;/* one per point, in Z-order */
+  double *coords;/* coordinates of nodes, dim entries each */
+};
+
+static void QuadTree_storage_delete(struct QuadTree_storage *st) {
+  for (int i = 0; i < st->ncells; i++) free(st->cells[i].data);
+  free(st->cells);
+  free(st->children);
+  free(st->vectors);
+  free(st->nodes);
+  free(st->coords);
+  free(st);
+}
+
+typedef struct {
+  int dim;
+  int max_level;
+  const double *coord;
+  const uint64_t *keys;/* Z-order key of each point, sorted */
+  const int *ids;/* point id for each key */
+  struct QuadTree_storage *st;
+} bulk_builder;
+
+/* a subtree built as one unit of parallel work */
+typedef struct {
+  int lo, hi;/* range of sorted points */
+  double *center;
+  double width;
+  int ncells, ninternal;/* cells and internal cells in the subtree */
+  int cell, child;/* where the subtree's cells and child tables start */
+  QuadTree root;
+} bulk_task;
+
+/* the quadrant point i falls into at the given level */
+static int bulk_digit(const bulk_builder *b, int i, int level) {
+  int shift = b->dim * (b->max_level - 1 - level);
+  return (int)((b->keys[i] >> shift) & ((UINT64_C(1) << b->dim) - 1));
+}
+
+static bool bulk_is_leaf(const bulk_builder *b, int lo, int hi, int level) {
+  return hi - lo == 1 || level == b->max_level;
+}
+
+/* end of the run of points from lo that share a quadrant at the given level */
+static int bulk_run_end(const bulk_builder *b, int lo, int hi, int level) {
+  int d = bulk_digit(b, lo, level), i;
+  for (i = lo + 1; i < hi && bulk_digit(b, i, level) == d; i++);
+  return i;
+}
+
+static void bulk_child_center(int dim, const double *center, double width,
+                              int d, double *child) {
+  /* as QuadTree_new_in_quadrant */
+  for (int k = 0; k < dim; k++) {
+    child[k] = d & 1 ? center[k] + width / 2 : center[k] - width / 2;
+    d >>= 1;
+  }
+}
+
+static void bulk_count(const bulk_builder *b, int lo, int hi, int level,
+                       int *ncells, int *ninternal) {
+  (*ncells)++;
+  if (bulk_is_leaf(b, lo, hi, level)) return;
+  (*ninternal)++;
+  for (int i = lo, j; i < hi; i = j) {
+    j = bulk_run_end(b, i, hi, level);
+    bulk_count(b, i, j, level + 1, ncells, ninternal);
+  }
+}
+
+/* take the next cell from the cursors and initialize everything but its
+   children and average */
+static QuadTree bulk_cell(const bulk_builder *b, int lo, int hi,
+                          const double *center, double width, int *cell) {
+  int dim = b->dim;
+  QuadTree q = &b->st->cells[*cell];
+  q->dim = dim;
+  q->n = hi - lo;
+  q->total_weight = hi - lo;
+  q->center = &b->st->vectors[2 * dim * *cell];
+  q->average = q->center + dim;
+  memcpy(q->center, center, dim * sizeof(double));
+  q->width = width;
+  q->qts = NULL;
+  q->l = NULL;
+  q->max_level = b->max_level;
+  q->data = NULL;
+  q->storage = b->st;
+  (*cell)++;
+  return q;
+}
+
+static void bulk_leaf(const bulk_builder *b, QuadTree q, int lo, int hi) {
+  int dim = b->dim;
+  for (int k = 0; k < dim; k++) q->average[k] = 0;
+  for (int i = hi - 1; i >= lo; i--) {
+    node_data nd = &b->st->nodes[i];
+    nd->node_weight = 1;
+    nd->coord = &b->st->coords[i * dim];
+    memcpy(nd->coord, &b->coord[b->ids[i] * dim], dim * sizeof(double));
+    nd->id = b->ids[i];
+    nd->data = NULL;
+    nd->next = q->l;
+    q->l = nd;
+    for (int k = 0; k < dim; k++) q->average[k] += nd->coord[k];
+  }
+  for (int k = 0; k < dim; k++) q->average[k] /= hi - lo;
+}
+
+static void bulk_average(QuadTree q) {
+  int dim = q->dim;
+  for (int k = 0; k < dim; k++) q->average[k] = 0;
+  for (int i = 0; i < 1 << dim; i++) {
+    QuadTree c = q->qts[i];
+    if (!c) continue;
+    for (int k = 0; k < dim; k++) q->average[k] += c->average[k] * c->n;
+  }
+  for (int k = 0; k < dim; k++) q->average[k] /= q->n;
+}
+
+/* scratch has room for the centers of the cells below level, dim entries for
+   each level down to max_level */
+static QuadTree bulk_fill(const bulk_builder *b, int lo, int hi, int level,
+                          const double *center, double width, int *cell,
+                          int *child, double *scratch) {
+  int dim = b->dim;
+  QuadTree q = bulk_cell(b, lo, hi, center, width, cell);
+
+  if (bulk_is_leaf(b, lo, hi, level)) {
+    bulk_leaf(b, q, lo, hi);
+    return q;
+  }
+
+  q->qts = &b->st->children[*child];
+  *child += 1 << dim;
+  double *c = scratch;
+  for (int i = lo, j; i < hi; i = j) {
+    j = bulk_run_end(b, i, hi, level);
+    int d = bulk_digit(b, i, level);
+    bulk_child_center(dim, center, width, d, c);
+    q->qts[d] = bulk_fill(b, i, j, level + 1, c, width / 2, cell, child,
+                          scratch + dim);
+  }
+  bulk_average(q);
+  return q;
+}
+
+/* walk the cells above split_level, either collecting the subtrees at
+   split_level into tasks or, once those are built, filling the cells above
+   them. tasks has room for every cell at split_level, and scratch is as for
+   bulk_fill. */
+static QuadTree bulk_top(const bulk_builder *b, int lo, int hi, int level,
+                         int split_level, const double *center, double width,
+                         bulk_task *tasks, int *ntasks, int *cell,
+                         int *child, bool fill, double *scratch) {
+  int dim = b->dim;
+
+  if (level == split_level) {
+    bulk_task *t = &tasks[(*ntasks)++];
+    if (fill) return t->root;
+    t->lo = lo;
+    t->hi = hi;
+    memcpy(t->center, center, dim * sizeof(double));
+    t->width = width;
+    return NULL;
+  }
+
+  QuadTree q = NULL;
+  if (fill) {
+    q = bulk_cell(b, lo, hi, center, width, cell);
+  } else {
+    (*cell)++;
+  }
+  if (bulk_is_leaf(b, lo, hi, level)) {
+    if (fill) bulk_leaf(b, q, lo, hi);
+    return q;
+  }
+
+  if (fill) {
+    q->qts = &b->st->children[*child];
+  }
+  *child += 1 << dim;
+  double *c = scratch;
+  for (int i = lo, j; i < hi; i = j) {
+    j = bulk_run_end(b, i, hi, level);
+    int d = bulk_digit(b, i, level);
+    bulk_child_center(dim, center, width, d, c);
+    QuadTree sub = bulk_top(b, i, j, level + 1, split_level, c, width / 2,
+                            tasks, ntasks, cell, child, fill, scratch + dim);
+    if (fill) q->qts[d] = sub;
+  }
+  if (fill) bulk_average(q);
+  return q;
+}
+
+/* stable LSD radix sort of (key, id) pairs on the low nbits bits of the keys */
+static void bulk_sort(int n, int nbits, uint64_t **keys, int **ids) {
+  enum { RADIX_BITS = 8, RADIX = 1 << RADIX_BITS };
+  uint64_t *k2 = gv_calloc(n, sizeof(uint64_t));
+  int *i2 = gv_calloc(n, sizeof(int));
+
+  for (int shift = 0; shift < nbits; shift += RADIX_BITS) {
+    int count[RADIX + 1] = {0};
+    for (int i = 0; i < n; i++) count[(((*keys)[i] >> shift) & (RADIX - 1)) + 1]++;
+    for (int r = 0; r < RADIX; r++) count[r + 1] += count[r];
+    for (int i = 0; i < n; i++) {
+      int to = count[((*keys)[i] >> shift) & (RADIX - 1)]++;
+      k2[to] = (*keys)[i];
+      i2[to] = (*ids)[i];
+    }
+    uint64_t *kt = *keys;
+    *keys = k2;
+    k2 = kt;
+    int *it = *ids;
+    *ids = i2;
+    i2 = it;
+  }
+  free(k2);
+  free(i2);
+}
+
+QuadTree QuadTree_new_from_point_list_bulk(int dim, int n, int max_level, double *coord, int nthreads){
+  double *xmin, *xmax, *center, width;
+  int i, k;
+
+  /* keys have to fit dim bits per level */
+  if (n <= 0 || dim <= 0 || dim > 64 || max_level < 0 || dim * max_level > 64) {
+    return QuadTree_new_from_point_list(dim, n, max_level, coord);
+  }
+
+  nthreads = gv_threads(nthreads);
+
+  xmin = gv_calloc(dim, sizeof(double));
+  xmax = gv_calloc(dim, sizeof(double));
+  center = gv_calloc(dim, sizeof(double));
+
+  /* the same bounding box as QuadTree_new_from_point_list */
+  for (i = 0; i < dim; i++) xmin[i] = coord[i];
+  for (i = 0; i < dim; i++) xmax[i] = coord[i];
+
+  for (i = 1; i < n; i++){
+    for (k = 0; k < dim; k++){
+      xmin[k] = fmin(xmin[k], coord[i*dim+k]);
+      xmax[k] = fmax(xmax[k], coord[i*dim+k]);
+    }
+  }
+
+  width = xmax[0] - xmin[0];
+  for (i = 0; i < dim; i++) {
+    center[i] = (xmin[i] + xmax[i])*0.5;
+    width = fmax(width, xmax[i] - xmin[i]);
+  }
+  width = fmax(width, 0.00001);/* if we only have one point, width = 0! */
+  width *= 0.52;
+
+  /* Z-order key: the quadrant a point descends into at each level, replaying
+     the center arithmetic of QuadTree_add so the cells come out the same */
+  uint64_t *keys = gv_calloc(n, sizeof(uint64_t));
+  int *ids = gv_calloc(n, sizeof(int));
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(nthreads)
+#endif
+  for (i = 0; i < n; i++) {
+    double c[64];
+    double w = width;
+    uint64_t key = 0;
+    memcpy(c, center, dim * sizeof(double));
+    for (int level = 0; level < max_level; level++) {
+      int d = QuadTree_get_quadrant(dim, c, &coord[i * dim]);
+      key = key << dim | (uint64_t)d;
+      bulk_child_center(dim, c, w, d, c);
+      w /= 2;
+    }
+    keys[i] = key;
+    ids[i] = i;
+  }
+  bulk_sort(n, dim * max_level, &keys, &ids);
+
+  struct QuadTree_storage *st = gv_alloc(sizeof(struct QuadTree_storage));
+  bulk_builder b = {.dim = dim, .max_level = max_level, .coord = coord,
+                    .keys = keys, .ids = ids, .st = st};
+
+  /* split off enough subtrees to keep every thread busy */
+  int split_level = 0;
+  while (split_level < max_level && nthreads > 1 &&
+         (split_level + 1) * dim < 31 &&
+         1 << (split_level * dim) < 4 * nthreads) {
+    split_level++;
+  }
+
+  /* all the working space the recursion needs: a task and its center for
+     each cell there can be at split_level, and for the top cells and each
+     task the centers of the cells on the way down to max_level */
+  int maxtasks = split_level == 0 ? 1 : 1 << (split_level * dim);
+  if (maxtasks > n) maxtasks = n;
+  bulk_task *tasks = gv_calloc(maxtasks, sizeof(bulk_task));
+  double *task_centers = gv_calloc((size_t)maxtasks * dim, sizeof(double));
+  size_t scratch_size = (size_t)max_level * dim;
+  double *scratch = gv_calloc((maxtasks + 1) * scratch_size, sizeof(double));
+  for (i = 0; i < maxtasks; i++) tasks[i].center = &task_centers[i * dim];
+
+  int ntasks = 0, ntop = 0, ntopchildren = 0;
+  bulk_top(&b, 0, n, 0, split_level, center, width, tasks, &ntasks, &ntop,
+           &ntopchildren, false, scratch);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+  for (i = 0; i < ntasks; i++) {
+    tasks[i].ncells = tasks[i].ninternal = 0;
+    bulk_count(&b, tasks[i].lo, tasks[i].hi, split_level, &tasks[i].ncells,
+               &tasks[i].ninternal);
+  }
+
+  int ncells = ntop, nchildren = ntopchildren;
+  for (i = 0; i < ntasks; i++) {
+    tasks[i].cell = ncells;
+    tasks[i].child = nchildren;
+    ncells += tasks[i].ncells;
+    nchildren += tasks[i].ninternal << dim;
+  }
+  st->ncells = ncells;
+  st->cells = gv_calloc(ncells, sizeof(struct QuadTree_struct));
+  st->children = gv_calloc(nchildren, sizeof(QuadTree));
+  st->vectors = gv_calloc((size_t)ncells * 2 * dim, sizeof(double));
+  st->nodes = gv_calloc(n, sizeof(struct node_data_struct));
+  st->coords = gv_calloc((size_t)n * dim, sizeof(double));
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+  for (i = 0; i < ntasks; i++) {
+    int cell = tasks[i].cell, child = tasks[i].child;
+    tasks[i].root = bulk_fill(&b, tasks[i].lo, tasks[i].hi, split_level,
+                              tasks[i].center, tasks[i].width, &cell, &child,
+                              &scratch[(i + 1) * scratch_size]);
+  }
+
+  int cell = 0, child = 0;
+  ntasks = 0;
+  QuadTree qt = bulk_top(&b, 0, n, 0, split_level, center, width, tasks,
+                         &ntasks, &cell, &child, true, scratch);
+
+  free(tasks);
+  free(task_centers);
+  free(scratch);
+  free(keys);
+  free(ids);
+  free(xmin);
+  free(xmax);
+  free(center);
+  return qt;
+}
+
 
 QuadTree QuadTree_add(QuadTree q, double *coord, double weight, int id){
   if (!q) return q;
+  assert(!q->storage && "bulk built quadtrees cannot be added to");
   return QuadTree_add_internal(q, coord, weight, id, 0);
   
 }
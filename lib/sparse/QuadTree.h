@@ -28,6 +28,8 @@ struct node_data_struct {
 
 typedef struct QuadTree_struct *QuadTree;
 
+struct QuadTree_storage;
+
 struct QuadTree_struct {
   /* a data structure containing coordinates of n items, their average is in "average".
      The current level is a square or cube of width "width", which is subdivided into 
@@ -44,6 +46,8 @@ struct QuadTree_struct {
   node_data l;
   int max_level;
   void *data;
+  struct QuadTree_storage *storage;/* for a tree made by QuadTree_new_from_point_list_bulk, the
+                                      arrays all its cells live in. NULL otherwise */
 };
 
 
@@ -57,6 +61,13 @@ void QuadTree_print(FILE *fp, QuadTree q);
 
 QuadTree QuadTree_new_from_point_list(int dim, int n, int max_level, double *coord);
 
+/* same as QuadTree_new_from_point_list, but sorts the points by Z-order and builds
+   the whole tree at once into a few contiguous arrays, using nthreads threads
+   (≤ 0 for the OpenMP default). The cells are the same as QuadTree_new_from_point_list
+   would make, but averages are computed directly rather than incrementally, so they
+   may differ slightly. The result cannot be grown with QuadTree_add. */
+QuadTree QuadTree_new_from_point_list_bulk(int dim, int n, int max_level, double *coord, int nthreads);
+
 double point_distance(double *p1, double *p2, int dim);
 
 void QuadTree_get_supernodes(QuadTree qt, double bh, double *pt, int nodeid, int *nsuper, 
@@ -64,6 +75,11 @@ void QuadTree_get_supernodes(QuadTree qt, double bh, double *pt, int nodeid, int
 
 void QuadTree_get_repulsive_force(QuadTree qt, double *force, double *x, double bh, double p, double KP, double *counts);
 
+/* a variant of QuadTree_get_repulsive_force that computes the force on each node
+   independently against the read-only tree, across nthreads threads (≤ 0 for
+   the OpenMP default). The result does not depend on nthreads. */
+void QuadTree_get_repulsive_force_parallel(QuadTree qt, double *force, double *x, double bh, double p, double KP, double *counts, int nthreads);
+
 /* find the nearest point and put in ymin, index in imin and distance in min */
 void QuadTree_get_nearest(QuadTree qt, double *x, double *ymin, int *imin, double *min);
 
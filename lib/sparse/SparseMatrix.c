@@ -15,6 +15,7 @@
 #include <common/arith.h>
 #include <limits.h>
 #include <sparse/SparseMatrix.h>
+#include <sparse/kernels.h>
 #include <stddef.h>
 #include <stdbool.h>
 #include <util/alloc.h>
@@ -833,23 +834,10 @@ void SparseMatrix_multiply_dense(SparseMatrix A, const double *v, double *res,
                                  int dim) {
   // A × V, with A dimension m × n, with V a dense matrix of dimension n × dim.
   // v[i×dim×j] gives V[i,j]. Result of dimension m × dim. Real only for now.
-  int i, j, k, *ia, *ja, m;
-  double *a;
-
   assert(A->format == FORMAT_CSR);
   assert(A->type == MATRIX_TYPE_REAL);
 
-  a = A->a;
-  ia = A->ia;
-  ja = A->ja;
-  m = A->m;
-
-  for (i = 0; i < m; i++){
-    for (k = 0; k < dim; k++) res[i * dim + k] = 0;
-    for (j = ia[i]; j < ia[i+1]; j++){
-      for (k = 0; k < dim; k++) res[i * dim + k] += a[j] * v[ja[j] *dim + k];
-    }
-  }
+  kernel_csr_mm(A->m, A->ia, A->ja, A->a, v, res, dim);
 }
 
 void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res) {
@@ -870,12 +858,7 @@ void SparseMatrix_multiply_vector(SparseMatrix A, double *v, double **res) {
     a = A->a;
     if (v){
       if (!u) u = gv_calloc((size_t)m, sizeof(double));
-      for (i = 0; i < m; i++){
-	u[i] = 0.;
-	for (j = ia[i]; j < ia[i+1]; j++){
-	  u[i] += a[j]*v[ja[j]];
-	}
-      }
+      kernel_csr_mv(m, ia, ja, a, v, u);
     } else {
       /* v is assumed to be all 1's */
       if (!u) u = gv_calloc((size_t)m, sizeof(double));
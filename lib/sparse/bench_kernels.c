@@ -0,0 +1,210 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+/* Micro-benchmark of the kernels in kernels.c.
+ *
+ * For each graph given on the command line, builds its Laplacian as a CSR
+ * matrix, the shape of matrix stress majorization and smoothing solve with,
+ * and reports the GFLOP/s of the kernels on it next to the straightforward
+ * scalar loops they replace:
+ *
+ *   bench_kernels [-r repetitions] file.gv ...
+ */
+
+#include <cgraph/cgraph.h>
+#include <sparse/kernels.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/parallel.h>
+
+typedef struct {
+  int m;
+  int *ia, *ja;
+  double *a;
+} laplacian_t;
+
+typedef struct {
+  Agrec_t h;
+  int id;
+} nodeinfo_t;
+
+#define ID(n) (((nodeinfo_t *)AGDATA(n))->id)
+
+static laplacian_t make_laplacian(Agraph_t *g) {
+  laplacian_t L = {.m = agnnodes(g)};
+  int i = 0;
+  aginit(g, AGNODE, "nodeinfo", sizeof(nodeinfo_t), true);
+  for (Agnode_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+    ID(n) = i++;
+  }
+  const size_t nz = (size_t)L.m + 2 * (size_t)agnedges(g);
+  L.ia = gv_calloc((size_t)L.m + 1, sizeof(int));
+  L.ja = gv_calloc(nz, sizeof(int));
+  L.a = gv_calloc(nz, sizeof(double));
+  int nnz = 0;
+  for (Agnode_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+    const int row = nnz;
+    L.ja[nnz++] = ID(n);
+    for (Agedge_t *e = agfstedge(g, n); e; e = agnxtedge(g, e, n)) {
+      Agnode_t *other = aghead(e) == n ? agtail(e) : aghead(e);
+      if (other == n) {
+        continue;
+      }
+      L.ja[nnz] = ID(other);
+      L.a[nnz++] = -1;
+    }
+    L.a[row] = nnz - row - 1;
+    L.ia[ID(n) + 1] = nnz;
+  }
+  return L;
+}
+
+static double *make_vector(int n) {
+  double *v = gv_calloc((size_t)n, sizeof(double));
+  for (int i = 0; i < n; i++) {
+    v[i] = (double)rand() / RAND_MAX;
+  }
+  return v;
+}
+
+// the loops the kernels replaced, for comparison
+static void scalar_csr_mv(const laplacian_t *L, const double *x, double *y) {
+  for (int i = 0; i < L->m; i++) {
+    y[i] = 0;
+    for (int j = L->ia[i]; j < L->ia[i + 1]; j++) {
+      y[i] += L->a[j] * x[L->ja[j]];
+    }
+  }
+}
+
+static void scalar_csr_mm(const laplacian_t *L, const double *v, double *res) {
+  for (int i = 0; i < L->m; i++) {
+    for (int k = 0; k < 2; k++) {
+      res[i * 2 + k] = 0;
+    }
+    for (int j = L->ia[i]; j < L->ia[i + 1]; j++) {
+      for (int k = 0; k < 2; k++) {
+        res[i * 2 + k] += L->a[j] * v[L->ja[j] * 2 + k];
+      }
+    }
+  }
+}
+
+static double scalar_dot(int n, const double *x, const double *y) {
+  double s = 0;
+  for (int i = 0; i < n; i++) {
+    s += x[i] * y[i];
+  }
+  return s;
+}
+
+static void scalar_axpy(int n, double alpha, const double *x, double *y) {
+  for (int i = 0; i < n; i++) {
+    y[i] = y[i] + alpha * x[i];
+  }
+}
+
+static void report(const char *name, double flops, double scalar,
+                   double kernel) {
+  printf("  %-10s %8.3f GFLOP/s scalar %8.3f GFLOP/s kernel  (%.2fx)\n", name,
+         flops / scalar * 1e-9, flops / kernel * 1e-9, scalar / kernel);
+}
+
+static void bench(const char *name, Agraph_t *g, int reps) {
+  laplacian_t L = make_laplacian(g);
+  const int m = L.m;
+  const double nnz = L.ia[m];
+  double *x = make_vector(2 * m);
+  double *y = make_vector(2 * m);
+  volatile double sink = 0;
+  double start, scalar, kernel;
+
+  printf("%s: %d rows, %.0f nonzeros, %s\n", name, m, nnz, kernel_isa());
+
+  start = gv_wtime();
+  for (int r = 0; r < reps; r++)
+    scalar_csr_mv(&L, x, y);
+  scalar = gv_wtime() - start;
+  start = gv_wtime();
+  for (int r = 0; r < reps; r++)
+    kernel_csr_mv(m, L.ia, L.ja, L.a, x, y);
+  kernel = gv_wtime() - start;
+  report("spmv", 2 * nnz * reps, scalar, kernel);
+
+  start = gv_wtime();
+  for (int r = 0; r < reps; r++)
+    scalar_csr_mm(&L, x, y);
+  scalar = gv_wtime() - start;
+  start = gv_wtime();
+  for (int r = 0; r < reps; r++)
+    kernel_csr_mm(m, L.ia, L.ja, L.a, x, y, 2);
+  kernel = gv_wtime() - start;
+  report("spmm dim=2", 4 * nnz * reps, scalar, kernel);
+
+  start = gv_wtime();
+  for (int r = 0; r < reps; r++)
+    sink += scalar_dot(m, x, y);
+  scalar = gv_wtime() - start;
+  start = gv_wtime();
+  for (int r = 0; r < reps; r++)
+    sink += kernel_dot(m, x, y);
+  kernel = gv_wtime() - start;
+  report("dot", 2.0 * m * reps, scalar, kernel);
+
+  start = gv_wtime();
+  for (int r = 0; r < reps; r++)
+    scalar_axpy(m, 1e-9, x, y);
+  scalar = gv_wtime() - start;
+  start = gv_wtime();
+  for (int r = 0; r < reps; r++)
+    kernel_axpy(m, 1e-9, x, y);
+  kernel = gv_wtime() - start;
+  report("axpy", 2.0 * m * reps, scalar, kernel);
+
+  (void)sink;
+  free(x);
+  free(y);
+  free(L.ia);
+  free(L.ja);
+  free(L.a);
+}
+
+int main(int argc, char **argv) {
+  int reps = 100;
+  int i = 1;
+  if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+    reps = atoi(argv[2]);
+    i = 3;
+  }
+  if (i >= argc) {
+    fprintf(stderr, "usage: %s [-r repetitions] file.gv ...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  for (; i < argc; i++) {
+    FILE *f = fopen(argv[i], "r");
+    if (f == NULL) {
+      fprintf(stderr, "could not open %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+    Agraph_t *g = agread(f, NULL);
+    fclose(f);
+    if (g == NULL) {
+      fprintf(stderr, "could not read a graph from %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+    bench(argv[i], g, reps);
+    agclose(g);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,296 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include <sparse/kernels.h>
+#include <stdbool.h>
+#include <util/unused.h>
+
+/* a multiply contracted into an FMA is rounded differently, so keep the
+ * compiler from doing so where the target has FMA instructions
+ */
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+/* AVX2 versions are compiled with function level target attributes and only
+ * called after checking the CPU supports them, so the rest of Graphviz does
+ * not need to be built for AVX2.
+ */
+#if defined(KERNELS_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define KERNELS_AVX2
+#include <immintrin.h>
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+/*********************************************
+** portable                                 **
+*********************************************/
+
+static void csr_mv_generic(int m, const int *ia, const int *ja,
+                           const double *a, const double *x, double *y) {
+  for (int i = 0; i < m; i++) {
+    double s = 0;
+    for (int j = ia[i]; j < ia[i + 1]; j++) {
+      s += a[j] * x[ja[j]];
+    }
+    y[i] = s;
+  }
+}
+
+static void csr_mm_generic(int m, const int *ia, const int *ja,
+                           const double *a, const double *v, double *res,
+                           int dim) {
+  for (int i = 0; i < m; i++) {
+    double *r = &res[i * dim];
+    for (int k = 0; k < dim; k++) {
+      r[k] = 0;
+    }
+    for (int j = ia[i]; j < ia[i + 1]; j++) {
+      const double *vj = &v[ja[j] * dim];
+      for (int k = 0; k < dim; k++) {
+        r[k] += a[j] * vj[k];
+      }
+    }
+  }
+}
+
+// only called without SSE2, but the unit tests compare the others against it
+static UNUSED double dot_generic(int n, const double *x, const double *y) {
+  double s[8] = {0};
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    for (int k = 0; k < 8; k++) {
+      s[k] += x[i + k] * y[i + k];
+    }
+  }
+  double sum = ((s[0] + s[4]) + (s[2] + s[6])) + ((s[1] + s[5]) + (s[3] + s[7]));
+  for (; i < n; i++) {
+    sum += x[i] * y[i];
+  }
+  return sum;
+}
+
+static void axpy_generic(int n, double alpha, const double *x, double *y) {
+  for (int i = 0; i < n; i++) {
+    y[i] = y[i] + alpha * x[i];
+  }
+}
+
+static void xpby_generic(int n, const double *x, double beta, double *y) {
+  for (int i = 0; i < n; i++) {
+    y[i] = x[i] + beta * y[i];
+  }
+}
+
+/*********************************************
+** SSE2                                     **
+*********************************************/
+
+#ifdef KERNELS_SSE2
+
+static void csr_mm_sse2(int m, const int *ia, const int *ja, const double *a,
+                        const double *v, double *res, int dim) {
+  if (dim != 2) {
+    csr_mm_generic(m, ia, ja, a, v, res, dim);
+    return;
+  }
+  for (int i = 0; i < m; i++) {
+    __m128d acc = _mm_setzero_pd();
+    for (int j = ia[i]; j < ia[i + 1]; j++) {
+      __m128d vj = _mm_loadu_pd(&v[ja[j] * 2]);
+      acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(a[j]), vj));
+    }
+    _mm_storeu_pd(&res[i * 2], acc);
+  }
+}
+
+static double dot_sse2(int n, const double *x, const double *y) {
+  __m128d s01 = _mm_setzero_pd(), s23 = _mm_setzero_pd();
+  __m128d s45 = _mm_setzero_pd(), s67 = _mm_setzero_pd();
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    s01 = _mm_add_pd(s01, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    s23 = _mm_add_pd(s23, _mm_mul_pd(_mm_loadu_pd(x + i + 2),
+                                     _mm_loadu_pd(y + i + 2)));
+    s45 = _mm_add_pd(s45, _mm_mul_pd(_mm_loadu_pd(x + i + 4),
+                                     _mm_loadu_pd(y + i + 4)));
+    s67 = _mm_add_pd(s67, _mm_mul_pd(_mm_loadu_pd(x + i + 6),
+                                     _mm_loadu_pd(y + i + 6)));
+  }
+  // [s0 + s4, s1 + s5] + [s2 + s6, s3 + s7]
+  __m128d d = _mm_add_pd(_mm_add_pd(s01, s45), _mm_add_pd(s23, s67));
+  double s[2];
+  _mm_storeu_pd(s, d);
+  double sum = s[0] + s[1];
+  for (; i < n; i++) {
+    sum += x[i] * y[i];
+  }
+  return sum;
+}
+
+static void axpy_sse2(int n, double alpha, const double *x, double *y) {
+  const __m128d av = _mm_set1_pd(alpha);
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d yv = _mm_loadu_pd(y + i);
+    _mm_storeu_pd(y + i, _mm_add_pd(yv, _mm_mul_pd(av, _mm_loadu_pd(x + i))));
+  }
+  axpy_generic(n - i, alpha, x + i, y + i);
+}
+
+static void xpby_sse2(int n, const double *x, double beta, double *y) {
+  const __m128d bv = _mm_set1_pd(beta);
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d yv = _mm_loadu_pd(y + i);
+    _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_mul_pd(bv, yv)));
+  }
+  xpby_generic(n - i, x + i, beta, y + i);
+}
+
+#endif
+
+/*********************************************
+** AVX2                                     **
+*********************************************/
+
+#ifdef KERNELS_AVX2
+
+static bool have_avx2(void) {
+  return __builtin_cpu_supports("avx2");
+}
+
+AVX2 static double dot_avx2(int n, const double *x, const double *y) {
+  __m256d s0123 = _mm256_setzero_pd(), s4567 = _mm256_setzero_pd();
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    s0123 = _mm256_add_pd(s0123, _mm256_mul_pd(_mm256_loadu_pd(x + i),
+                                               _mm256_loadu_pd(y + i)));
+    s4567 = _mm256_add_pd(s4567, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4),
+                                               _mm256_loadu_pd(y + i + 4)));
+  }
+  // [s0 + s4, s1 + s5, s2 + s6, s3 + s7], then its halves added
+  __m256d c = _mm256_add_pd(s0123, s4567);
+  __m128d d = _mm_add_pd(_mm256_castpd256_pd128(c), _mm256_extractf128_pd(c, 1));
+  double s[2];
+  _mm_storeu_pd(s, d);
+  double sum = s[0] + s[1];
+  for (; i < n; i++) {
+    sum += x[i] * y[i];
+  }
+  return sum;
+}
+
+AVX2 static void axpy_avx2(int n, double alpha, const double *x, double *y) {
+  const __m256d av = _mm256_set1_pd(alpha);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d yv = _mm256_loadu_pd(y + i);
+    _mm256_storeu_pd(y + i,
+                     _mm256_add_pd(yv, _mm256_mul_pd(av, _mm256_loadu_pd(x + i))));
+  }
+  axpy_generic(n - i, alpha, x + i, y + i);
+}
+
+AVX2 static void xpby_avx2(int n, const double *x, double beta, double *y) {
+  const __m256d bv = _mm256_set1_pd(beta);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d yv = _mm256_loadu_pd(y + i);
+    _mm256_storeu_pd(y + i,
+                     _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_mul_pd(bv, yv)));
+  }
+  xpby_generic(n - i, x + i, beta, y + i);
+}
+
+#endif
+
+/*********************************************
+** dispatch                                 **
+*********************************************/
+
+/* Rows of graph matrices are short and irregular, so SIMD versions working on
+ * several rows at once spend more on gathering their entries than they save,
+ * and the scalar loop is the fastest we have.
+ */
+void kernel_csr_mv(int m, const int *ia, const int *ja, const double *a,
+                   const double *x, double *y) {
+  csr_mv_generic(m, ia, ja, a, x, y);
+}
+
+void kernel_csr_mm(int m, const int *ia, const int *ja, const double *a,
+                   const double *v, double *res, int dim) {
+#ifdef KERNELS_SSE2
+  csr_mm_sse2(m, ia, ja, a, v, res, dim);
+#else
+  csr_mm_generic(m, ia, ja, a, v, res, dim);
+#endif
+}
+
+double kernel_dot(int n, const double *x, const double *y) {
+#ifdef KERNELS_AVX2
+  if (have_avx2()) {
+    return dot_avx2(n, x, y);
+  }
+#endif
+#ifdef KERNELS_SSE2
+  return dot_sse2(n, x, y);
+#else
+  return dot_generic(n, x, y);
+#endif
+}
+
+void kernel_axpy(int n, double alpha, const double *x, double *y) {
+#ifdef KERNELS_AVX2
+  if (have_avx2()) {
+    axpy_avx2(n, alpha, x, y);
+    return;
+  }
+#endif
+#ifdef KERNELS_SSE2
+  axpy_sse2(n, alpha, x, y);
+#else
+  axpy_generic(n, alpha, x, y);
+#endif
+}
+
+void kernel_xpby(int n, const double *x, double beta, double *y) {
+#ifdef KERNELS_AVX2
+  if (have_avx2()) {
+    xpby_avx2(n, x, beta, y);
+    return;
+  }
+#endif
+#ifdef KERNELS_SSE2
+  xpby_sse2(n, x, beta, y);
+#else
+  xpby_generic(n, x, beta, y);
+#endif
+}
+
+const char *kernel_isa(void) {
+#ifdef KERNELS_AVX2
+  if (have_avx2()) {
+    return "avx2";
+  }
+#endif
+#ifdef KERNELS_SSE2
+  return "sse2";
+#else
+  return "generic";
+#endif
+}
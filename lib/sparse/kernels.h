@@ -0,0 +1,55 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+/* Real-valued kernels for CSR sparse matrices and dense vectors.
+ *
+ * Each kernel has a portable implementation and, where it pays off on x86,
+ * SSE2 and AVX2 ones chosen at run time by what the CPU supports. All
+ * implementations of a
+ * kernel perform the same floating point operations in the same order, so
+ * results do not depend on the machine a layout is computed on:
+ *
+ *   - a CSR row is summed from its first entry to its last, as in the
+ *     straightforward loop
+ *   - a dot product accumulates x[i]*y[i] into one of 8 partial sums by
+ *     i mod 8, adds them as ((s0 + s4) + (s2 + s6)) + ((s1 + s5) + (s3 + s7))
+ *     and then the leftover n mod 8 products in order
+ *   - no fused multiply-adds are used
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* y = A x, for the m×n CSR matrix A given by ia, ja and a */
+void kernel_csr_mv(int m, const int *ia, const int *ja, const double *a,
+                   const double *x, double *y);
+
+/* res = A V, with V an n×dim row major dense matrix, res m×dim */
+void kernel_csr_mm(int m, const int *ia, const int *ja, const double *a,
+                   const double *v, double *res, int dim);
+
+/* x · y */
+double kernel_dot(int n, const double *x, const double *y);
+
+/* y = y + alpha x */
+void kernel_axpy(int n, double alpha, const double *x, double *y);
+
+/* y = x + beta y */
+void kernel_xpby(int n, const double *x, double beta, double *y);
+
+/* name of the instruction set the kernels use on this machine */
+const char *kernel_isa(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,192 @@
+// basic unit tester for kernels.c
+
+#ifdef NDEBUG
+#error this is not intended to be compiled with assertions off
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// include the implementation itself, to reach every instruction set variant
+#include "kernels.c"
+
+// a random CSR matrix with rows of varied length, some empty
+typedef struct {
+  int m, n;
+  int *ia, *ja;
+  double *a;
+} csr_t;
+
+static double rnd(void) { return (double)rand() / RAND_MAX * 2 - 1; }
+
+static csr_t make_matrix(int m, int n) {
+  csr_t A = {.m = m, .n = n};
+  A.ia = calloc((size_t)m + 1, sizeof(int));
+  assert(A.ia != NULL);
+  for (int i = 0; i < m; i++) {
+    A.ia[i + 1] = A.ia[i] + rand() % 13 * (i % 7 != 3);
+  }
+  A.ja = calloc((size_t)A.ia[m] + 1, sizeof(int));
+  A.a = calloc((size_t)A.ia[m] + 1, sizeof(double));
+  assert(A.ja != NULL && A.a != NULL);
+  for (int j = 0; j < A.ia[m]; j++) {
+    A.ja[j] = rand() % n;
+    A.a[j] = rnd();
+  }
+  return A;
+}
+
+static void free_matrix(csr_t A) {
+  free(A.ia);
+  free(A.ja);
+  free(A.a);
+}
+
+static double *make_vector(int n) {
+  double *v = calloc((size_t)n + 1, sizeof(double));
+  assert(v != NULL);
+  for (int i = 0; i < n; i++) {
+    v[i] = rnd();
+  }
+  return v;
+}
+
+// the row sums must match the straightforward loop bit for bit
+static void test_csr_mv(int m, int n) {
+  csr_t A = make_matrix(m, n);
+  double *x = make_vector(n);
+  double *expected = make_vector(m);
+  double *y = make_vector(m);
+
+  for (int i = 0; i < m; i++) {
+    double s = 0;
+    for (int j = A.ia[i]; j < A.ia[i + 1]; j++) {
+      s += A.a[j] * x[A.ja[j]];
+    }
+    expected[i] = s;
+  }
+
+  csr_mv_generic(m, A.ia, A.ja, A.a, x, y);
+  assert(memcmp(y, expected, (size_t)m * sizeof(double)) == 0);
+  memset(y, 0, (size_t)m * sizeof(double));
+  kernel_csr_mv(m, A.ia, A.ja, A.a, x, y);
+  assert(memcmp(y, expected, (size_t)m * sizeof(double)) == 0);
+
+  free(y);
+  free(expected);
+  free(x);
+  free_matrix(A);
+}
+
+static void test_csr_mm(int m, int n, int dim) {
+  csr_t A = make_matrix(m, n);
+  double *v = make_vector(n * dim);
+  double *expected = make_vector(m * dim);
+  double *res = make_vector(m * dim);
+
+  for (int i = 0; i < m; i++) {
+    for (int k = 0; k < dim; k++) {
+      expected[i * dim + k] = 0;
+    }
+    for (int j = A.ia[i]; j < A.ia[i + 1]; j++) {
+      for (int k = 0; k < dim; k++) {
+        expected[i * dim + k] += A.a[j] * v[A.ja[j] * dim + k];
+      }
+    }
+  }
+
+  kernel_csr_mm(m, A.ia, A.ja, A.a, v, res, dim);
+  assert(memcmp(res, expected, (size_t)(m * dim) * sizeof(double)) == 0);
+  csr_mm_generic(m, A.ia, A.ja, A.a, v, res, dim);
+  assert(memcmp(res, expected, (size_t)(m * dim) * sizeof(double)) == 0);
+
+  free(res);
+  free(expected);
+  free(v);
+  free_matrix(A);
+}
+
+// every variant of the dot product must agree with the portable one
+static void test_dot(int n) {
+  double *x = make_vector(n);
+  double *y = make_vector(n);
+
+  const double expected = dot_generic(n, x, y);
+  assert(kernel_dot(n, x, y) == expected);
+#ifdef KERNELS_SSE2
+  assert(dot_sse2(n, x, y) == expected);
+#endif
+#ifdef KERNELS_AVX2
+  if (have_avx2()) {
+    assert(dot_avx2(n, x, y) == expected);
+  }
+#endif
+
+  // and be close to the sequential sum
+  double s = 0;
+  for (int i = 0; i < n; i++) {
+    s += x[i] * y[i];
+  }
+  assert(s - expected < 1e-9 && expected - s < 1e-9);
+
+  free(y);
+  free(x);
+}
+
+static void test_axpy_xpby(int n) {
+  double *x = make_vector(n);
+  double *y = make_vector(n);
+  double *expected = make_vector(n);
+  double *z = make_vector(n);
+  const double alpha = rnd();
+
+  memcpy(expected, y, (size_t)n * sizeof(double));
+  for (int i = 0; i < n; i++) {
+    expected[i] = expected[i] + alpha * x[i];
+  }
+  memcpy(z, y, (size_t)n * sizeof(double));
+  kernel_axpy(n, alpha, x, z);
+  assert(memcmp(z, expected, (size_t)n * sizeof(double)) == 0);
+#ifdef KERNELS_SSE2
+  memcpy(z, y, (size_t)n * sizeof(double));
+  axpy_sse2(n, alpha, x, z);
+  assert(memcmp(z, expected, (size_t)n * sizeof(double)) == 0);
+#endif
+
+  for (int i = 0; i < n; i++) {
+    expected[i] = x[i] + alpha * y[i];
+  }
+  memcpy(z, y, (size_t)n * sizeof(double));
+  kernel_xpby(n, x, alpha, z);
+  assert(memcmp(z, expected, (size_t)n * sizeof(double)) == 0);
+#ifdef KERNELS_SSE2
+  memcpy(z, y, (size_t)n * sizeof(double));
+  xpby_sse2(n, x, alpha, z);
+  assert(memcmp(z, expected, (size_t)n * sizeof(double)) == 0);
+#endif
+
+  free(z);
+  free(expected);
+  free(y);
+  free(x);
+}
+
+int main(void) {
+  for (int size = 0; size < 40; size++) {
+    test_csr_mv(size, size + 1);
+    test_csr_mm(size, size + 1, 1);
+    test_csr_mm(size, size + 1, 2);
+    test_csr_mm(size, size + 1, 3);
+    test_dot(size);
+    test_axpy_xpby(size);
+  }
+  test_csr_mv(10007, 5000);
+  test_csr_mm(10007, 5000, 2);
+  test_dot(10007);
+  test_axpy_xpby(10007);
+
+  printf("kernels use %s\n", kernel_isa());
+  return EXIT_SUCCESS;
+}
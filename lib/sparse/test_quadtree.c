@@ -0,0 +1,108 @@
+// basic unit tester for QuadTree.c
+
+#ifdef NDEBUG
+#error this is not intended to be compiled with assertions off
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// include the implementation itself, to reach its internals
+#include "QuadTree.c"
+#include "general.c"
+#include "../util/random.c"
+
+// sum of the ids of the points in and below a cell
+static long id_sum(QuadTree q) {
+  long sum = 0;
+  for (node_data l = q->l; l; l = l->next) {
+    sum += l->id;
+  }
+  if (q->qts) {
+    for (int i = 0; i < 1 << q->dim; i++) {
+      if (q->qts[i]) {
+        sum += id_sum(q->qts[i]);
+      }
+    }
+  }
+  return sum;
+}
+
+// a cell of the bulk built tree must match the incrementally built one
+static void compare(QuadTree expected, QuadTree actual) {
+  assert((expected == NULL) == (actual == NULL));
+  if (expected == NULL) {
+    return;
+  }
+
+  const int dim = expected->dim;
+  assert(actual->dim == dim);
+  assert(actual->n == expected->n);
+  assert(actual->total_weight == expected->total_weight);
+  assert(actual->width == expected->width);
+  // QuadTree_add weighs the points of a leaf at max_level unevenly, so only
+  // the averages of other cells are comparable
+  const bool full_leaf = expected->qts == NULL && expected->n > 1;
+  for (int k = 0; k < dim; k++) {
+    assert(actual->center[k] == expected->center[k]);
+    // averages are summed in a different order
+    assert(full_leaf || fabs(actual->average[k] - expected->average[k]) <=
+                            1e-9 * fmax(1, fabs(expected->average[k])));
+  }
+
+  assert((expected->qts == NULL) == (actual->qts == NULL));
+  if (expected->qts == NULL) {
+    // a leaf holds the same points, but possibly listed in another order
+    int count = 0;
+    for (node_data l = actual->l; l; l = l->next) {
+      ++count;
+    }
+    assert(count == actual->n);
+    assert(id_sum(actual) == id_sum(expected));
+    return;
+  }
+  assert(actual->l == NULL);
+  for (int i = 0; i < 1 << dim; i++) {
+    compare(expected->qts[i], actual->qts[i]);
+  }
+}
+
+static void test_bulk(int dim, int n, int max_level, int nthreads,
+                      bool clustered) {
+  double *coord = calloc((size_t)n * dim, sizeof(double));
+  assert(coord != NULL);
+  for (int i = 0; i < n * dim; i++) {
+    coord[i] = (double)rand() / RAND_MAX * 100;
+    // pile some points on top of each other, down to max_level
+    if (clustered && i % 3 == 0) {
+      coord[i] = 42;
+    }
+  }
+
+  QuadTree expected = QuadTree_new_from_point_list(dim, n, max_level, coord);
+  QuadTree actual =
+      QuadTree_new_from_point_list_bulk(dim, n, max_level, coord, nthreads);
+  compare(expected, actual);
+  assert(id_sum(actual) == (long)n * (n - 1) / 2);
+
+  QuadTree_delete(actual);
+  QuadTree_delete(expected);
+  free(coord);
+}
+
+int main(void) {
+  for (int n = 1; n < 50; n++) {
+    test_bulk(2, n, 10, 1, false);
+  }
+  for (int dim = 1; dim <= 3; dim++) {
+    for (int nthreads = 1; nthreads <= 4; nthreads += 3) {
+      test_bulk(dim, 5000, 10, nthreads, false);
+      test_bulk(dim, 5000, 10, nthreads, true);
+      test_bulk(dim, 5000, 3, nthreads, false);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
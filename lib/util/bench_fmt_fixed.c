@@ -0,0 +1,113 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+/* Micro-benchmark of fmt_fixed.h.
+ *
+ * Formats a generated set of coordinates, spread like those of a large
+ * layout, the way the renderers did before, through agxbprint, and with
+ * gv_fmt_fixed_trim, checking both give the same text, and reports the
+ * throughput of each:
+ *
+ *   bench_fmt_fixed [-r repetitions] [-n numbers]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/agxbuf.h>
+#include <util/alloc.h>
+#include <util/fmt_fixed.h>
+#include <util/parallel.h>
+
+/// format numbers as xdot and SVG output did through `agxbprint`
+static size_t format_printf(agxbuf *xb, const double *values, size_t n,
+                            int precision) {
+  size_t total = 0;
+  for (size_t i = 0; i < n; i++) {
+    agxbprint(xb, "%.*f", precision, values[i]);
+    agxbuf_trim_zeros(xb);
+    total += agxblen(xb);
+    agxbclear(xb);
+  }
+  return total;
+}
+
+static size_t format_fixed(const double *values, size_t n, int precision) {
+  char buf[GV_FMT_FIXED_SIZE];
+  size_t total = 0;
+  for (size_t i = 0; i < n; i++) {
+    total += gv_fmt_fixed_trim(buf, values[i], precision);
+  }
+  return total;
+}
+
+int main(int argc, char **argv) {
+  int reps = 10;
+  size_t n = 1000000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-r") == 0) {
+      reps = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-n") == 0) {
+      n = (size_t)atol(argv[i + 1]);
+    } else {
+      fprintf(stderr, "usage: %s [-r repetitions] [-n numbers]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // coordinates in points of a layout some thousands of inches across
+  double *values = gv_calloc(n, sizeof(double));
+  srand(1);
+  for (size_t i = 0; i < n; i++) {
+    values[i] = (rand() - RAND_MAX / 2) / (double)RAND_MAX * 2e5;
+  }
+
+  agxbuf xb = {0};
+  for (int precision = 2; precision <= 3; precision++) {
+    // check the output is the same, number by number
+    for (size_t i = 0; i < n; i++) {
+      char buf[GV_FMT_FIXED_SIZE];
+      gv_fmt_fixed_trim(buf, values[i], precision);
+      agxbprint(&xb, "%.*f", precision, values[i]);
+      agxbuf_trim_zeros(&xb);
+      if (strcmp(buf, agxbuse(&xb)) != 0) {
+        fprintf(stderr, "%.17g formatted differently\n", values[i]);
+        return EXIT_FAILURE;
+      }
+    }
+
+    size_t bytes = 0;
+    double start = gv_wtime();
+    for (int r = 0; r < reps; r++) {
+      bytes += format_printf(&xb, values, n, precision);
+    }
+    const double printf_time = gv_wtime() - start;
+
+    start = gv_wtime();
+    for (int r = 0; r < reps; r++) {
+      bytes -= format_fixed(values, n, precision);
+    }
+    const double fixed_time = gv_wtime() - start;
+    if (bytes != 0) {
+      fprintf(stderr, "output lengths differ\n");
+      return EXIT_FAILURE;
+    }
+
+    const double count = (double)n * reps;
+    printf("%%.%df: %8.2f Mnum/s agxbprint %8.2f Mnum/s gv_fmt_fixed  "
+           "(%.2fx)\n",
+           precision, count / printf_time * 1e-6, count / fixed_time * 1e-6,
+           printf_time / fixed_time);
+  }
+
+  agxbfree(&xb);
+  free(values);
+  return EXIT_SUCCESS;
+}
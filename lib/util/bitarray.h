@@ -27,6 +27,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <util/alloc.h>
 
 /// a compressed array of boolean values
@@ -94,6 +95,19 @@ static inline void bitarray_set(bitarray_t *self, size_t index, bool value) {
   }
 }
 
+/// clear every element, keeping the extent
+static inline void bitarray_clear(bitarray_t *self) {
+  assert(self != NULL);
+
+  // determine if this array is stored inline or not
+  if (self->size_bits <= sizeof(self->u.block) * 8) {
+    memset(self->u.block, 0, sizeof(self->u.block));
+  } else {
+    size_t capacity = self->size_bits / 8 + (self->size_bits % 8 == 0 ? 0 : 1);
+    memset(self->u.base, 0, capacity);
+  }
+}
+
 /// free underlying resources and leave a bit array empty
 static inline void bitarray_reset(bitarray_t *self) {
   assert(self != NULL);
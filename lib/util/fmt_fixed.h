@@ -0,0 +1,118 @@
+/// @file
+/// @brief allocation-free formatting of numbers to a fixed number of decimals
+///
+/// Renderers write every coordinate they emit with a few decimal places, so on
+/// large graphs the cost of going through `printf` adds up. These functions
+/// produce exactly what `printf("%.*f", precision, v)` would, but format the
+/// common case of a moderate value by rounding it to an integer and writing
+/// out its digits. Values whose rounding cannot be decided that way, those
+/// close to halfway between two results or too large, are passed on to
+/// `snprintf`, which does the rounding the slow way.
+///
+/// The fast path always uses “.” for the decimal point. The fallback uses the
+/// current locale, like `printf` itself, which Graphviz has set to “C” while
+/// rendering.
+
+#pragma once
+
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/// largest precision the functions below support
+#define GV_FMT_FIXED_MAX_PRECISION 6
+
+/// size of a buffer with room for any result and its terminating NUL
+///
+/// A sign, the 309 integer digits of `DBL_MAX`, a point, the largest number of
+/// decimals and a NUL.
+#define GV_FMT_FIXED_SIZE 320
+
+/// format a number as `printf("%.*f", precision, v)` would
+///
+/// @param buf Destination, with room for `GV_FMT_FIXED_SIZE` characters
+/// @param v Value to format
+/// @param precision Number of decimal places, at most
+///   `GV_FMT_FIXED_MAX_PRECISION`
+/// @return Length of the NUL-terminated result
+static inline size_t gv_fmt_fixed(char *buf, double v, int precision) {
+  assert(buf != NULL);
+  assert(precision >= 0 && precision <= GV_FMT_FIXED_MAX_PRECISION);
+
+  static const double scales[] = {1, 10, 100, 1e3, 1e4, 1e5, 1e6};
+  static const uint64_t divisors[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+  const double scaled = fabs(v) * scales[precision];
+
+  // Below 2⁴⁰, the scaled value is within 2⁻¹⁴ of the exact product. So unless
+  // its fraction is close to ½, it rounds to the same integer the exact value
+  // would. The comparison is also false for NaN.
+  if (scaled < 0x1p40) {
+    const double whole = floor(scaled);
+    const double fraction = scaled - whole;
+    if (fabs(fraction - 0.5) > 1e-3) {
+      const uint64_t rounded = (uint64_t)whole + (fraction > 0.5);
+      uint64_t integral = rounded / divisors[precision];
+      uint64_t decimals = rounded % divisors[precision];
+
+      char *p = buf;
+      // like `printf`, keep the sign of negative values that round to 0
+      if (signbit(v)) {
+        *p++ = '-';
+      }
+
+      char digits[20];
+      size_t n_digits = 0;
+      do {
+        digits[n_digits++] = (char)('0' + integral % 10);
+        integral /= 10;
+      } while (integral != 0);
+      while (n_digits > 0) {
+        *p++ = digits[--n_digits];
+      }
+
+      if (precision > 0) {
+        *p++ = '.';
+        for (int i = precision - 1; i >= 0; --i) {
+          p[i] = (char)('0' + decimals % 10);
+          decimals /= 10;
+        }
+        p += precision;
+      }
+
+      *p = '\0';
+      return (size_t)(p - buf);
+    }
+  }
+
+  const int len = snprintf(buf, GV_FMT_FIXED_SIZE, "%.*f", precision, v);
+  assert(len >= 0 && len < GV_FMT_FIXED_SIZE);
+  return (size_t)len;
+}
+
+/// format a number as `gv_fmt_fixed` does, without trailing zeros
+///
+/// Zeros after the point are dropped, and then the point if nothing follows
+/// it, as `agxbuf_trim_zeros` does to `printf` output.
+///
+/// @param buf Destination, with room for `GV_FMT_FIXED_SIZE` characters
+/// @param v Value to format
+/// @param precision Most decimal places to give
+/// @return Length of the NUL-terminated result
+static inline size_t gv_fmt_fixed_trim(char *buf, double v, int precision) {
+  size_t len = gv_fmt_fixed(buf, v, precision);
+  if (memchr(buf, '.', len) == NULL) {
+    return len;
+  }
+  while (buf[len - 1] == '0') {
+    --len;
+  }
+  if (buf[len - 1] == '.') {
+    --len;
+  }
+  buf[len] = '\0';
+  return len;
+}
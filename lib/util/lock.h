@@ -0,0 +1,41 @@
+/// @file
+/// @brief a statically initialized mutex
+/// @ingroup cgraph_utils
+///
+/// For state that is shared by all threads and updated rarely, such as caches
+/// of files read from disk:
+///
+///   static gv_lock_t lock = GV_LOCK_INIT;
+///   …
+///   gv_lock(&lock);
+///   … use the shared state …
+///   gv_unlock(&lock);
+///
+/// The lock is not recursive.
+
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+typedef SRWLOCK gv_lock_t;
+#define GV_LOCK_INIT SRWLOCK_INIT
+
+static inline void gv_lock(gv_lock_t *lock) { AcquireSRWLockExclusive(lock); }
+
+static inline void gv_unlock(gv_lock_t *lock) {
+  ReleaseSRWLockExclusive(lock);
+}
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t gv_lock_t;
+#define GV_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+
+static inline void gv_lock(gv_lock_t *lock) { pthread_mutex_lock(lock); }
+
+static inline void gv_unlock(gv_lock_t *lock) { pthread_mutex_unlock(lock); }
+#endif
@@ -0,0 +1,80 @@
+/// \file
+/// \brief helpers for optional OpenMP parallelism
+/// \ingroup cgraph_utils
+///
+/// Graphviz can be built with or without OpenMP support. Code that wants to
+/// spread work across cores uses `#pragma omp` directives, which are ignored
+/// when OpenMP is unavailable, and calls the functions in this header instead
+/// of the OpenMP runtime directly so that it still compiles and runs serially
+/// in a non-OpenMP build.
+
+#pragma once
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#include <time.h>
+#endif
+
+/// resolve a user-requested thread count
+///
+/// \param requested Number of worker threads asked for. 0 or less means “as
+///   many as the OpenMP runtime would use by default.”
+/// \return Number of worker threads to use, always ≥ 1
+static inline int gv_threads(int requested) {
+#ifdef _OPENMP
+  if (requested <= 0) {
+    return omp_get_max_threads();
+  }
+  return requested;
+#else
+  (void)requested;
+  return 1;
+#endif
+}
+
+/// interpret the value of the `threads` graph attribute
+///
+/// Without OpenMP, the attribute is ignored and every layout takes the serial
+/// path, as though `threads=1` had been given.
+///
+/// \param value Value of the attribute, 1 if unset
+/// \return 1 for the serial algorithm, otherwise the argument to pass to
+///   `gv_threads`
+static inline int gv_threads_attr(int value) {
+#ifdef _OPENMP
+  return value;
+#else
+  (void)value;
+  return 1;
+#endif
+}
+
+/// index of the calling thread within the current parallel region
+///
+/// \return A value in [0, number of threads in the team), or 0 outside of a
+///   parallel region
+static inline int gv_thread_id(void) {
+#ifdef _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+/// wall clock time in seconds, relative to some arbitrary fixed point
+///
+/// Unlike CPU time, this does not grow faster than real time while several
+/// threads are running, so it is suitable for timing parallel phases.
+static inline double gv_wtime(void) {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#elif defined(CLOCK_MONOTONIC)
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#else
+  // no POSIX clocks, as on Windows, where `clock` measures elapsed real time
+  return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
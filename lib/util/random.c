@@ -0,0 +1,72 @@
+/// @file
+/// @brief C implementation of the per-thread generators of random.h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <util/random.h>
+#include <util/tls.h>
+
+/// degree and separation of the additive feedback generator `rand` uses
+enum { DEGREE = 31, SEPARATION = 3 };
+
+typedef struct {
+  bool seeded;
+  uint32_t state[DEGREE];
+  size_t front; ///< index of the term to update next
+  size_t rear;  ///< index of the term it is updated by
+} rand_state_t;
+
+static TLS rand_state_t rand_state;
+
+void gv_srand(unsigned seed) {
+  rand_state_t *const r = &rand_state;
+  if (seed == 0) {
+    seed = 1;
+  }
+  // fill the state with a linear congruential sequence, by Schrage's method
+  int64_t word = (int32_t)seed;
+  r->state[0] = seed;
+  for (size_t i = 1; i < DEGREE; ++i) {
+    const int64_t hi = word / 127773;
+    const int64_t lo = word % 127773;
+    word = 16807 * lo - 2836 * hi;
+    if (word < 0) {
+      word += 2147483647;
+    }
+    r->state[i] = (uint32_t)word;
+  }
+  r->front = SEPARATION;
+  r->rear = 0;
+  r->seeded = true;
+  // discard the first outputs, which still show the linear relation
+  for (size_t i = 0; i < 10 * DEGREE; ++i) {
+    (void)gv_rand();
+  }
+}
+
+int gv_rand(void) {
+  rand_state_t *const r = &rand_state;
+  if (!r->seeded) {
+    gv_srand(1);
+  }
+  r->state[r->front] += r->state[r->rear];
+  const int result = (int)(r->state[r->front] >> 1);
+  r->front = (r->front + 1) % DEGREE;
+  r->rear = (r->rear + 1) % DEGREE;
+  return result;
+}
+
+/// state of the 48-bit linear congruential generator `drand48` uses
+static TLS uint64_t drand48_state;
+
+void gv_srand48(long seed) {
+  drand48_state = ((uint64_t)(seed & 0xffffffff) << 16) | 0x330e;
+}
+
+double gv_drand48(void) {
+  const uint64_t a = UINT64_C(0x5deece66d);
+  const uint64_t c = 0xb;
+  drand48_state = (a * drand48_state + c) & ((UINT64_C(1) << 48) - 1);
+  return (double)drand48_state / (double)(UINT64_C(1) << 48);
+}
@@ -0,0 +1,51 @@
+/// @file
+/// @brief pseudo-random numbers with per-thread state
+///
+/// Layouts seed a generator and then draw from it. With the process-wide state
+/// of `rand` and `drand48`, layouts running concurrently in different threads
+/// would draw from each other's sequences, and a layout's result would depend
+/// on what else drew numbers before it. These replacements keep their state
+/// per thread. They produce the same sequences as the glibc implementations of
+/// the functions they replace, so layouts do not change on Linux, and the same
+/// sequences on every other platform.
+
+#pragma once
+
+/// hide the symbols this header declares by default
+///
+/// See the matching comment in gv_fopen.h. Each library linking this keeps its
+/// own generators, so a layout seeds and draws within the same library.
+#ifndef UTIL_API
+#if !defined(__CYGWIN__) && defined(__GNUC__) && !defined(__MINGW32__)
+#define UTIL_API __attribute__((visibility("hidden")))
+#else
+#define UTIL_API /* nothing */
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// largest value `gv_rand` returns
+#define GV_RAND_MAX 2147483647
+
+/// seed the calling thread's `gv_rand` generator, like `srand`
+UTIL_API void gv_srand(unsigned seed);
+
+/// next number in [0, `GV_RAND_MAX`] from the calling thread's generator
+///
+/// A thread that has not called `gv_srand` starts as if seeded with 1.
+UTIL_API int gv_rand(void);
+
+/// seed the calling thread's `gv_drand48` generator, like `srand48`
+UTIL_API void gv_srand48(long seed);
+
+/// next number in [0, 1) from the calling thread's 48-bit generator
+///
+/// A thread that has not called `gv_srand48` starts as `drand48` does.
+UTIL_API double gv_drand48(void);
+
+#ifdef __cplusplus
+}
+#endif
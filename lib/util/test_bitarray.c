@@ -143,6 +143,28 @@ static void double_set(size_t size, bool value) {
   bitarray_reset(&b);
 }
 
+// clearing all bits
+static void clear(size_t size) {
+
+  bitarray_t b = bitarray_new(size);
+
+  for (size_t i = 0; i < size; i += 3)
+    bitarray_set(&b, i, true);
+  bitarray_clear(&b);
+  assert(b.size_bits == size);
+  for (size_t i = 0; i < size; ++i)
+    assert(!bitarray_get(b, i));
+
+  // the array is still usable
+  bitarray_set(&b, size - 1, true);
+  assert(bitarray_get(b, size - 1));
+
+  bitarray_reset(&b);
+}
+
+static void test_clear_small(void) { clear(10); }
+static void test_clear_large(void) { clear(1023); }
+
 // various versions of the above
 static void test_double_set_small(void) { double_set(10, true); }
 static void test_double_set_large(void) { double_set(1023, true); }
@@ -165,6 +187,8 @@ int main(void) {
   RUN(set_unset_large);
   RUN(set_unset_aligned);
   RUN(reuse);
+  RUN(clear_small);
+  RUN(clear_large);
   RUN(double_set_small);
   RUN(double_set_large);
   RUN(double_clear_small);
@@ -0,0 +1,122 @@
+/// @file
+/// @brief unit tests for fmt_fixed.h
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/fmt_fixed.h>
+
+/// check a value formats as `printf` formats it, at every precision
+static void test_value(double v) {
+  for (int precision = 0; precision <= GV_FMT_FIXED_MAX_PRECISION;
+       ++precision) {
+    char expected[GV_FMT_FIXED_SIZE];
+    const int expected_len =
+        snprintf(expected, sizeof(expected), "%.*f", precision, v);
+    assert(expected_len >= 0 && (size_t)expected_len < sizeof(expected));
+
+    char actual[GV_FMT_FIXED_SIZE];
+    const size_t actual_len = gv_fmt_fixed(actual, v, precision);
+    if (actual_len != (size_t)expected_len || strcmp(actual, expected) != 0) {
+      fprintf(stderr, "%.17g to %d places: expected \"%s\", got \"%s\"\n", v,
+              precision, expected, actual);
+      abort();
+    }
+  }
+}
+
+/// check trimming drops trailing zeros and then the point
+static void test_trim(double v, int precision, const char *expected) {
+  char actual[GV_FMT_FIXED_SIZE];
+  const size_t len = gv_fmt_fixed_trim(actual, v, precision);
+  if (len != strlen(expected) || strcmp(actual, expected) != 0) {
+    fprintf(stderr, "%.17g to %d places: expected \"%s\", got \"%s\"\n", v,
+            precision, expected, actual);
+    abort();
+  }
+}
+
+int main(void) {
+  // values that round to 0, including negative ones that keep their sign
+  const double small[] = {0, -0.0, 1e-8, -1e-8, 0.0004, -0.0004, 0.0005,
+                          -0.0005, DBL_MIN, -DBL_MIN, 4.9e-324};
+  for (size_t i = 0; i < sizeof(small) / sizeof(small[0]); ++i) {
+    test_value(small[i]);
+  }
+
+  // values that are exactly halfway, and so round to even
+  const double ties[] = {0.5,    1.5,     2.5,    0.125,  0.375,
+                         0.0625, -0.0625, 1.0625, 12.5e-3};
+  for (size_t i = 0; i < sizeof(ties) / sizeof(ties[0]); ++i) {
+    test_value(ties[i]);
+  }
+
+  // values whose decimal representation looks halfway, but whose binary one
+  // is not
+  const double near_ties[] = {0.005, -0.005, 0.015, 1.005, 2.675, 1.0005,
+                              -10.0005, 123456.0005};
+  for (size_t i = 0; i < sizeof(near_ties) / sizeof(near_ties[0]); ++i) {
+    test_value(near_ties[i]);
+  }
+
+  // values carrying into the integer part
+  const double carries[] = {9.9995, 9.99951, 99.9999999, -999.9999999,
+                            0.9999999};
+  for (size_t i = 0; i < sizeof(carries) / sizeof(carries[0]); ++i) {
+    test_value(carries[i]);
+  }
+
+  // values either side of where formatting leaves the fast path
+  for (int precision = 0; precision <= GV_FMT_FIXED_MAX_PRECISION;
+       ++precision) {
+    const double limit = 0x1p40 / pow(10, precision);
+    test_value(nextafter(limit, 0));
+    test_value(limit);
+    test_value(-nextafter(limit, 0));
+    test_value(-limit);
+  }
+
+  // large and non-finite values
+  const double large[] = {1e15,     -999999999999999.99, 1e22, 1e300,
+                          DBL_MAX,  -DBL_MAX,            INFINITY,
+                          -INFINITY};
+  for (size_t i = 0; i < sizeof(large) / sizeof(large[0]); ++i) {
+    test_value(large[i]);
+  }
+
+  // coordinates like those renderers write, with every 1/1000th fraction
+  for (int i = -100000; i <= 100000; ++i) {
+    test_value(i / 1000.0);
+    test_value(i / 1000.0 + 0.0005);
+    test_value(i * 0.72);
+  }
+
+  // arbitrary bit patterns
+  uint64_t state = 42;
+  for (int i = 0; i < 20000; ++i) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    double v;
+    memcpy(&v, &state, sizeof(v));
+    if (isnan(v)) {
+      continue;
+    }
+    test_value(v);
+    test_value(ldexp(v / pow(2, ilogb(v)), (int)(state >> 58) - 32));
+  }
+
+  test_trim(10.008, 3, "10.008");
+  test_trim(10.5, 3, "10.5");
+  test_trim(10, 3, "10");
+  test_trim(-0.0001, 3, "-0");
+  test_trim(0.004, 2, "0");
+  test_trim(42, 0, "42");
+  test_trim(1e20, 2, "100000000000000000000");
+  test_trim(INFINITY, 2, "inf");
+
+  printf("all tests passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+/// @file
+/// @brief unit tests for random.h
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// include the code under test directly, as it is not exported
+#include "random.c"
+
+/// the first `rand` values glibc gives for a seed
+static void test_rand(unsigned seed, const int *expected, size_t n) {
+  gv_srand(seed);
+  for (size_t i = 0; i < n; ++i) {
+    const int actual = gv_rand();
+    assert(actual >= 0 && actual <= GV_RAND_MAX);
+    assert(actual == expected[i]);
+    (void)actual;
+  }
+}
+
+/// the first `drand48` values glibc gives for a seed
+static void test_drand48(long seed, const double *expected, size_t n) {
+  gv_srand48(seed);
+  for (size_t i = 0; i < n; ++i) {
+    const double actual = gv_drand48();
+    assert(actual >= 0 && actual < 1);
+    assert(actual == expected[i]);
+    (void)actual;
+  }
+}
+
+int main(void) {
+  // unseeded generators start as glibc’s do
+  const int unseeded[] = {1804289383, 846930886, 1681692777};
+  for (size_t i = 0; i < sizeof(unseeded) / sizeof(unseeded[0]); ++i) {
+    assert(gv_rand() == unseeded[i]);
+  }
+  assert(gv_drand48() == 3.907985046680551e-14);
+  assert(gv_drand48() == 0.00098539467465030839);
+
+  test_rand(1, unseeded, sizeof(unseeded) / sizeof(unseeded[0]));
+  test_rand(0, unseeded, sizeof(unseeded) / sizeof(unseeded[0]));
+  const int seeded[] = {128959393, 1692901013, 436085873};
+  test_rand(123, seeded, sizeof(seeded) / sizeof(seeded[0]));
+
+  const double seeded48[] = {0.81962743525309989, 0.64405229463906721};
+  test_drand48(173, seeded48, sizeof(seeded48) / sizeof(seeded48[0]));
+
+#ifdef __GLIBC__
+  // longer sequences match glibc’s, for seeds of every size
+  const unsigned seeds[] = {2, 42, 173, 0x7fffffff, 0x80000000, 4000000000u,
+                            0xffffffff};
+  for (size_t i = 0; i < sizeof(seeds) / sizeof(seeds[0]); ++i) {
+    srand(seeds[i]);
+    gv_srand(seeds[i]);
+    srand48((long)seeds[i]);
+    gv_srand48((long)seeds[i]);
+    for (int j = 0; j < 10000; ++j) {
+      assert(gv_rand() == rand());
+      assert(gv_drand48() == drand48());
+    }
+  }
+#endif
+
+  printf("all tests passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,20 @@
+/// @file
+/// @brief thread-local storage specifier
+/// @ingroup cgraph_utils
+///
+/// State that must be per-thread, but that cannot easily be passed around
+/// explicitly, is declared with `TLS` in front of it:
+///
+///   static TLS int counter;
+
+#pragma once
+
+#ifdef _MSC_VER
+#define TLS __declspec(thread)
+#elif defined(__GNUC__)
+#define TLS __thread
+#else
+// assume this environment does not support threads and fall back to (thread
+// unsafe) globals
+#define TLS /* nothing */
+#endif
@@ -26,6 +26,7 @@
 #include <util/agxbuf.h>
 #include <util/prisize_t.h>
 #include <util/streq.h>
+#include <util/tls.h>
 #include <util/unreachable.h>
 
 /* Number of points to split splines into */
@@ -33,7 +34,7 @@
 
 typedef enum { FORMAT_FIG, } format_type;
 
-static int Depth;
+static TLS int Depth;
 
 static void figptarray(GVJ_t *job, pointf *A, size_t n, int close) {
     for (size_t i = 0; i < n; i++) {
@@ -49,8 +50,8 @@ static int figColorResolve(bool *new, unsigned char r, unsigned char g,
   unsigned char b)
 {
 #define maxColors 512
-    static int top = 0;
-    static short red[maxColors], green[maxColors], blue[maxColors];
+    static TLS int top = 0;
+    static TLS short red[maxColors], green[maxColors], blue[maxColors];
     int c;
     int ct = -1;
     long rd, gd, bd, dist;
@@ -27,8 +27,10 @@
 #include <gvc/gvio.h>
 #include <gvc/gvcint.h>
 #include <util/alloc.h>
+#include <util/fmt_fixed.h>
 #include <util/startswith.h>
 #include <util/streq.h>
+#include <util/tls.h>
 #include <util/unreachable.h>
 
 typedef enum {
@@ -152,16 +154,35 @@ static void set_attrwf(Agraph_t * g, bool toplevel, bool value)
     }
 }
 
+/// write a number with 3 decimal places, as `gvprintf("%.03f")` would
+static void write_num(GVJ_t *job, double v) {
+    char buf[GV_FMT_FIXED_SIZE];
+    gvwrite(job, buf, gv_fmt_fixed(buf, v, 3));
+}
+
 static void write_polyline (GVJ_t * job, xdot_polyline* polyline)
 {
     const size_t cnt = polyline->cnt;
     xdot_point* pts = polyline->pts;
 
     gvprintf(job, "\"points\": [");
+    // format the points into a local buffer, writing it out whenever it may
+    // not have room for another one
+    char buf[BUFSIZ + 2 * GV_FMT_FIXED_SIZE + 4];
+    size_t len = 0;
     for (size_t i = 0; i < cnt; i++) {
-	if (i > 0) gvprintf(job, ",");
-	gvprintf(job, "[%.03f,%.03f]", pts[i].x, pts[i].y);
+	if (i > 0) buf[len++] = ',';
+	buf[len++] = '[';
+	len += gv_fmt_fixed(&buf[len], pts[i].x, 3);
+	buf[len++] = ',';
+	len += gv_fmt_fixed(&buf[len], pts[i].y, 3);
+	buf[len++] = ']';
+	if (len > BUFSIZ) {
+	    gvwrite(job, buf, len);
+	    len = 0;
+	}
     }
+    gvwrite(job, buf, len);
     gvprintf(job, "]\n");
 }
 
@@ -210,8 +231,15 @@ static void write_xdot (xdot_op * op, GVJ_t * job, state_t* sp)
     case xd_unfilled_ellipse :
 	gvprintf(job, "\"op\": \"%c\",\n", op->kind == xd_filled_ellipse ? 'E' : 'e');
  	indent(job, sp->Level);
-	gvprintf(job, "\"rect\": [%.03f,%.03f,%.03f,%.03f]\n", 
-	    op->u.ellipse.x, op->u.ellipse.y, op->u.ellipse.w, op->u.ellipse.h);
+	gvputs(job, "\"rect\": [");
+	write_num(job, op->u.ellipse.x);
+	gvputc(job, ',');
+	write_num(job, op->u.ellipse.y);
+	gvputc(job, ',');
+	write_num(job, op->u.ellipse.w);
+	gvputc(job, ',');
+	write_num(job, op->u.ellipse.h);
+	gvputs(job, "]\n");
 	break;
     case xd_filled_polygon :
     case xd_unfilled_polygon :
@@ -233,13 +261,19 @@ static void write_xdot (xdot_op * op, GVJ_t * job, state_t* sp)
     case xd_text :
 	gvprintf(job, "\"op\": \"T\",\n"); 
  	indent(job, sp->Level);
-	gvprintf(job, "\"pt\": [%.03f,%.03f],\n", op->u.text.x, op->u.text.y); 
+	gvputs(job, "\"pt\": [");
+	write_num(job, op->u.text.x);
+	gvputc(job, ',');
+	write_num(job, op->u.text.y);
+	gvputs(job, "],\n");
  	indent(job, sp->Level);
 	gvprintf(job, "\"align\": \"%c\",\n",
 	    op->u.text.align == xd_left? 'l' :
 	    (op->u.text.align == xd_center ? 'c' : 'r'));
  	indent(job, sp->Level);
-	gvprintf(job, "\"width\": %.03f,\n", op->u.text.width); 
+	gvputs(job, "\"width\": ");
+	write_num(job, op->u.text.width);
+	gvputs(job, ",\n");
  	indent(job, sp->Level);
 	gvputs(job, "\"text\": ");
 	stoj(op->u.text.text, sp, job);
@@ -282,7 +316,9 @@ static void write_xdot (xdot_op * op, GVJ_t * job, state_t* sp)
     case xd_font :
 	gvprintf(job, "\"op\": \"F\",\n");
  	indent(job, sp->Level);
-	gvprintf(job, "\"size\": %.03f,\n", op->u.font.size); 
+	gvputs(job, "\"size\": ");
+	write_num(job, op->u.font.size);
+	gvputs(job, ",\n");
  	indent(job, sp->Level);
 	gvputs(job, "\"face\": ");
 	stoj(op->u.font.name, sp, job);
@@ -713,7 +749,7 @@ static void json_end_graph(GVJ_t *job)
 {
     graph_t *g = job->obj->u.g;
     state_t sp;
-    static Agiodisc_t io;
+    static TLS Agiodisc_t io;
 
     if (io.afread == NULL) {
 	io.afread = AgIoDisc.afread;
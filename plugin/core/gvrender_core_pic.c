@@ -26,14 +26,15 @@
 #include <common/const.h>
 #include <util/agxbuf.h>
 #include <util/strview.h>
+#include <util/tls.h>
 
 /* Number of points to split splines into */
 #define BEZIERSUBDIVISION 6
 
 enum {FORMAT_PIC};
 
-static bool onetime = true;
-static double Fontscale;
+static TLS bool onetime = true;
+static TLS double Fontscale;
 
 /* There are a couple of ways to generate output: 
     1. generate for whatever size is given by the bounding box
@@ -291,8 +292,8 @@ static void pic_end_page(GVJ_t * job)
 
 static void pic_textspan(GVJ_t * job, pointf p, textspan_t * span)
 {
-    static char *lastname;
-    static double lastsize;
+    static TLS char *lastname;
+    static TLS double lastsize;
 
     switch (span->just) {
     case 'l': 
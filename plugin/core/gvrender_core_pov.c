@@ -24,6 +24,7 @@
 #include <errno.h>
 #include <util/agxbuf.h>
 #include <util/prisize_t.h>
+#include <util/tls.h>
 
 #include <common/macros.h>
 #include <common/const.h>
@@ -312,8 +313,8 @@ typedef enum { FORMAT_POV, } format_type;
 
 static char *pov_knowncolors[] = { POV_COLORS };
 
-static int layerz = 0;
-static int z = 0;
+static TLS int layerz = 0;
+static TLS int z = 0;
 
 static char *pov_color_as_str(GVJ_t * job, gvcolor_t color, float transparency)
 {
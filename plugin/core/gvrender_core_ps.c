@@ -18,11 +18,13 @@
 #include <gvc/gvplugin_render.h>
 #include <gvc/gvplugin_device.h>
 #include <gvc/gvio.h>
+#include <gvc/gvcint.h>
 #include <cgraph/cgraph.h>
 #include <common/utils.h>
 #include <util/agxbuf.h>
 #include <util/gv_ctype.h>
 #include <util/prisize_t.h>
+#include <util/tls.h>
 #include "ps.h"
 
 /* for CHAR_LATIN1  */
@@ -37,8 +39,13 @@
 
 typedef enum { FORMAT_PS, FORMAT_PS2, FORMAT_EPS } format_type;
 
-static int isLatin1;
-static bool setupLatin1;
+static TLS bool setupLatin1;
+
+/* the charset to give ps_string for strings of the graph being rendered */
+static int ps_charset(GVJ_t *job)
+{
+    return GD_charset(job->gvc->g) == CHAR_LATIN1 ? CHAR_LATIN1 : -1;
+}
 
 static void psgen_begin_job(GVJ_t * job)
 {
@@ -97,7 +104,6 @@ static void psgen_begin_graph(GVJ_t * job)
             cat_libfile(job, NULL, args);
         }
     }
-    isLatin1 = (GD_charset(obj->u.g) == CHAR_LATIN1 ? CHAR_LATIN1 : -1);
     /* We always setup Latin1. The charset info is always output,
      * and installing it is cheap. With it installed, we can then
      * rely on ps_string to convert UTF-8 characters whose encoding
@@ -111,7 +117,7 @@ static void psgen_begin_graph(GVJ_t * job)
     /*  Set base URL for relative links (for Distiller >= 3.0)  */
     if (obj->url)
 	gvprintf(job, "[ {Catalog} << /URI << /Base %s >> >>\n"
-		"/PUT pdfmark\n", ps_string(obj->url,isLatin1));
+		"/PUT pdfmark\n", ps_string(obj->url, ps_charset(job)));
 }
 
 static void psgen_begin_layer(GVJ_t * job, char *layername, int layerNum, int numLayers)
@@ -220,7 +226,7 @@ static void psgen_begin_anchor(GVJ_t *job, char *url, char *tooltip, char *targe
 		"  /Action << /Subtype /URI /URI %s >>\n"
 		"  /Subtype /Link\n"
 		"/ANN pdfmark\n",
-		ps_string(url, isLatin1));
+		ps_string(url, ps_charset(job)));
     }
 }
 
@@ -320,7 +326,7 @@ static void psgen_textspan(GVJ_t * job, pointf p, textspan_t * span)
     gvprintdouble(job, span->font->size);
     check_fontname(span->font->name);
     gvprintf(job, " /%s set_font\n", span->font->name);
-    str = ps_string(span->str,isLatin1);
+    str = ps_string(span->str, ps_charset(job));
     switch (span->just) {
     case 'r':
         p.x -= span->size.x;
@@ -494,7 +500,8 @@ static gvrender_features_t render_features_ps = {
     GVRENDER_DOES_TRANSFORM
 	| GVRENDER_DOES_MAPS
 	| GVRENDER_NO_WHITE_BG
-	| GVRENDER_DOES_MAP_RECTANGLE,
+	| GVRENDER_DOES_MAP_RECTANGLE
+	| GVRENDER_DOES_CONCURRENT_PAGES,
     4.,                         /* default pad - graph units */
     NULL,			/* knowncolors */
     0,				/* sizeof knowncolors */
@@ -37,6 +37,7 @@
 #include <gvc/gvcint.h>
 #include <util/agxbuf.h>
 #include <util/strcasecmp.h>
+#include <util/tls.h>
 #include <util/unreachable.h>
 
 #define LOCALNAMEPREFIX		'%'
@@ -567,7 +568,7 @@ static void svg_print_stop(GVJ_t * job, double offset, gvcolor_t color)
  */
 static int svg_gradstyle(GVJ_t *job, pointf *A, size_t n) {
     pointf G[2];
-    static int gradId;
+    static TLS int gradId;
     int id = gradId++;
 
     obj_state_t *obj = job->obj;
@@ -604,7 +605,7 @@ static int svg_gradstyle(GVJ_t *job, pointf *A, size_t n) {
 static int svg_rgradstyle(GVJ_t * job)
 {
     double ifx, ify;
-    static int rgradId;
+    static TLS int rgradId;
     int id = rgradId++;
 
     obj_state_t *obj = job->obj;
@@ -21,6 +21,7 @@
 #include <gvc/gvplugin_device.h>
 #include <gvc/gvio.h>
 #include <gvc/gvcint.h>
+#include <util/tls.h>
 #include <util/unreachable.h>
 #include "tcl_context.h"
 
@@ -122,7 +123,7 @@ static void tkgen_begin_job(GVJ_t * job)
            job->common->info[1], job->common->info[2]);
 }
 
-static int first_periphery;
+static TLS int first_periphery;
 
 static void tkgen_begin_graph(GVJ_t * job)
 {
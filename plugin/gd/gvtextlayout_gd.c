@@ -181,6 +181,7 @@ static bool gd_textlayout(textspan_t * span, char **fontpath)
 
 static gvtextlayout_engine_t gd_textlayout_engine = {
     gd_textlayout,
+    0,				/* gd_textlayout_spans */
 };
 #endif
 
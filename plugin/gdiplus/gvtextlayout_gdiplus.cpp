@@ -98,7 +98,8 @@ bool gdiplus_textlayout(textspan_t *span, char **)
 };
 
 static gvtextlayout_engine_t gdiplus_textlayout_engine = {
-    gdiplus_textlayout
+    gdiplus_textlayout,
+    nullptr, // gdiplus_textlayout_spans
 };
 
 gvplugin_installed_t gvtextlayout_gdiplus_types[] = {
@@ -19,6 +19,7 @@
 
 #include <gvc/gvplugin_render.h>
 #include <gvc/gvplugin_device.h>
+#include <gvc/gvplugin_textlayout.h>
 #include <gvc/gvio.h>
 #include <gvc/gvcint.h>
 #include <common/const.h>
@@ -328,8 +329,17 @@ static void lasi_textspan(GVJ_t * job, pointf p, textspan_t * span)
     if (job->obj->pencolor.u.HSVA[3] < .5)
 	return; // skip transparent text
 
-    if (span->layout) {
-	pango_font = pango_layout_get_font_description((PangoLayout*)(span->layout));
+    // spans measured from the text metrics cache carry no layout, so lay them
+    // out again, as the cairo renderer does
+    textspan_t laid_out = *span;
+    if (!laid_out.layout) {
+	gvtextlayout_engine_t *gvte = job->gvc->textlayout.engine;
+	if (gvte && gvte->textlayout)
+	    gvte->textlayout(&laid_out, nullptr);
+    }
+
+    if (laid_out.layout) {
+	pango_font = pango_layout_get_font_description((PangoLayout*)(laid_out.layout));
 	font = pango_font_description_get_family(pango_font);
 	switch (pango_font_description_get_stretch(pango_font)) {
 	    case PANGO_STRETCH_ULTRA_CONDENSED: stretch = ULTRACONDENSED; break;
@@ -391,8 +401,7 @@ static void lasi_textspan(GVJ_t * job, pointf p, textspan_t * span)
 	        UNREACHABLE();
 	}
     }
-    else {
-	pA = span->font->postscript_alias;
+    else if ((pA = span->font->postscript_alias)) {
 	font = pA->svg_font_family;
 	stretch = NORMAL_STRETCH;
 	if (pA->svg_font_style && pA->svg_font_style == std::string{"italic"})
@@ -405,10 +414,19 @@ static void lasi_textspan(GVJ_t * job, pointf p, textspan_t * span)
 	else
 	    weight = NORMAL_WEIGHT;
     }
+    else {
+	font = span->font->name;
+	stretch = NORMAL_STRETCH;
+	style = NORMAL_STYLE;
+	variant = NORMAL_VARIANT;
+	weight = NORMAL_WEIGHT;
+    }
 
     ps_set_color(job, &(job->obj->pencolor));
     Context *ctxt = reinterpret_cast<Context*>(job->context);
     ctxt->doc.osBody() << setFont(font, style, weight, variant, stretch) << setFontSize(span->font->size) << "\n";
+    if (laid_out.layout != span->layout && laid_out.free_layout)
+	laid_out.free_layout(laid_out.layout);
     switch (span->just) {
     case 'r':
         p.x -= span->size.x;
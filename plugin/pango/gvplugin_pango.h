@@ -1 +1,21 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#pragma once
+
+#include <common/textspan.h>
+#include <stdbool.h>
+
 #define FONT_DPI 96.
+
+/* textlayout */
+
+void pango_free_layout(void *layout);
+bool pango_textlayout(textspan_t *span, char **fontpath);
@@ -312,12 +312,27 @@ static void cairogen_textspan(GVJ_t * job, pointf p, textspan_t * span)
     }
     p.y += span->yoffset_centerline + span->yoffset_layout;
 
+    /* spans measured from the text metrics cache carry no layout */
+    PangoLayout *layout;
+    if (span->free_layout == &pango_free_layout) {
+	layout = span->layout;
+    } else {
+	textspan_t laid_out = *span;
+	laid_out.layout = NULL;
+	pango_textlayout(&laid_out, NULL);
+	layout = laid_out.layout;
+    }
+
     cairo_move_to (cr, p.x, -p.y);
     cairo_save(cr);
     cairo_scale(cr, POINTS_PER_INCH / FONT_DPI, POINTS_PER_INCH / FONT_DPI);
-    pango_cairo_show_layout(cr, (PangoLayout*)span->layout);
+    if (layout)
+	pango_cairo_show_layout(cr, layout);
     cairo_restore(cr);
 
+    if (layout && span->free_layout != &pango_free_layout)
+	pango_free_layout(layout);
+
     if (span->font && (span->font->flags & HTML_OL)) {
 	A[0].x = p.x;
 	A[1].x = p.x + span->size.x;
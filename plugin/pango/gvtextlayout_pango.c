@@ -24,11 +24,12 @@
 
 #include <pango/pangocairo.h>
 #include "gvgetfontlist.h"
+#include "gvplugin_pango.h"
 #ifdef HAVE_PANGO_FC_FONT_LOCK_FACE
 #include <pango/pangofc-font.h>
 #endif
 
-static void pango_free_layout (void *layout)
+void pango_free_layout (void *layout)
 {
     g_object_unref(layout);
 }
@@ -49,8 +50,6 @@ static char* pango_psfontResolve (PostscriptAlias* pa)
     return agxbdisown(&buf);
 }
 
-#define FONT_DPI 96.
-
 #define ENABLE_PANGO_MARKUP
 
 // wrapper to handle difference in calling conventions between `agxbput` and
@@ -61,23 +60,20 @@ static int agxbput_int(void *buffer, const char *s) {
   return (int)len;
 }
 
-static bool pango_textlayout(textspan_t * span, char **fontpath)
+// layout state, set up on first use and kept across calls
+static PangoFontMap *fontmap;
+static PangoContext *context;
+static PangoFontDescription *desc;
+static char *fontname;
+static double fontsize;
+static gv_font_map* gv_fmap;
+
+/// select the font of a span into `desc`, unless it is already there
+static bool pango_select_font(textspan_t *span, char **fontpath)
 {
     static agxbuf buf; // returned in fontpath, only good until next call
-    static PangoFontMap *fontmap;
-    static PangoContext *context;
-    static PangoFontDescription *desc;
-    static char *fontname;
-    static double fontsize;
-    static gv_font_map* gv_fmap;
     char *fnt, *psfnt = NULL;
     PangoFont *font;
-#ifdef ENABLE_PANGO_MARKUP
-    PangoAttrList *attrs;
-    GError *error = NULL;
-    int flags;
-#endif
-    char *text;
 
     if (!context) {
 	fontmap = pango_cairo_font_map_new();
@@ -185,6 +181,19 @@ static bool pango_textlayout(textspan_t * span, char **fontpath)
             free(psfnt);
         }
     }
+    return true;
+}
+
+/// lay out the text of a span in `layout` with the selected font, and measure
+/// it
+static bool pango_measure(PangoLayout *layout, textspan_t *span)
+{
+#ifdef ENABLE_PANGO_MARKUP
+    PangoAttrList *attrs;
+    GError *error = NULL;
+    int flags;
+#endif
+    char *text;
 
 #ifdef ENABLE_PANGO_MARKUP
     if (span->font && (flags = span->font->flags)) {
@@ -231,15 +240,11 @@ static bool pango_textlayout(textspan_t * span, char **fontpath)
     text = span->str;
 #endif
 
-    PangoLayout *layout = pango_layout_new (context);
-    span->layout = layout;    /* layout free with textspan - see labels.c */
-    span->free_layout = pango_free_layout;    /* function for freeing pango layout */
-
     pango_layout_set_text (layout, text, -1);
     pango_layout_set_font_description (layout, desc);
 #ifdef ENABLE_PANGO_MARKUP
-    if (attrs)
-	pango_layout_set_attributes (layout, attrs);
+    /* also clears the attributes of any text laid out before */
+    pango_layout_set_attributes (layout, attrs);
 #endif
 
     PangoRectangle logical_rect;
@@ -262,8 +267,32 @@ static bool pango_textlayout(textspan_t * span, char **fontpath)
     return logical_rect.width != 0 || strcmp(text, "") == 0;
 }
 
+bool pango_textlayout(textspan_t * span, char **fontpath)
+{
+    if (!pango_select_font(span, fontpath))
+	return false;
+
+    PangoLayout *layout = pango_layout_new (context);
+    span->layout = layout;    /* layout free with textspan - see labels.c */
+    span->free_layout = pango_free_layout;    /* function for freeing pango layout */
+
+    return pango_measure(layout, span);
+}
+
+/// lay out spans in turn, keeping the layout of each with it, so the cairo
+/// renderer draws it without shaping its text a second time
+static void pango_textlayout_spans(textspan_t **spans, size_t n, bool *laid_out)
+{
+    for (size_t i = 0; i < n; i++) {
+	spans[i]->layout = NULL;
+	spans[i]->free_layout = NULL;
+	laid_out[i] = pango_textlayout(spans[i], NULL);
+    }
+}
+
 static gvtextlayout_engine_t pango_textlayout_engine = {
     pango_textlayout,
+    pango_textlayout_spans,
 };
 
 gvplugin_installed_t gvtextlayout_pango_types[] = {
@@ -113,7 +113,8 @@ static bool quartz_textlayout(textspan_t *para, char **fontpath)
 };
 
 static gvtextlayout_engine_t quartz_textlayout_engine = {
-    quartz_textlayout
+    quartz_textlayout,
+    0,				/* quartz_textlayout_spans */
 };
 
 gvplugin_installed_t gvtextlayout_quartz_types[] = {
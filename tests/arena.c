@@ -0,0 +1,107 @@
+/// \file
+/// \brief a graph allocated from an arena should behave like any other
+///
+/// Builds the same graph, with subgraphs, attributes, records and deletions,
+/// with and without `Agdisc_t.arena` and checks both write the same DOT.
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  Agrec_t h;
+  double data[40]; // big enough to exercise more than one size class
+} rec_t;
+
+static Agraph_t *build(bool arena) {
+  enum { N = 500, M = 3000 };
+  Agdisc_t disc = {.arena = arena};
+  Agraph_t *g = agopen("g", Agdirected, &disc);
+  agattr(g, AGNODE, "color", "black");
+  agattr(g, AGEDGE, "weight", "1");
+
+  Agnode_t *nodes[N];
+  char name[32];
+  for (int i = 0; i < N; ++i) {
+    snprintf(name, sizeof(name), "n%d", i);
+    nodes[i] = agnode(g, name, 1);
+  }
+  for (int i = 0; i < M; ++i) {
+    Agedge_t *e = agedge(g, nodes[i % N], nodes[(i * 7 + 3) % N], NULL, 1);
+    if (i % 5 == 0) {
+      agset(e, "weight", "2");
+    }
+  }
+
+  Agraph_t *sg = agsubg(g, "cluster_a", 1);
+  for (int i = 0; i < N; i += 3) {
+    agsubnode(sg, nodes[i], 1);
+  }
+  for (Agnode_t *n = agfstnode(sg); n; n = agnxtnode(sg, n)) {
+    for (Agedge_t *e = agfstout(g, n); e; e = agnxtout(g, e)) {
+      agsubedge(sg, e, 1);
+    }
+  }
+
+  // records, and attributes declared late so attribute tables grow
+  aginit(g, AGNODE, "rec", sizeof(rec_t), 1);
+  for (int i = 0; i < 12; ++i) {
+    snprintf(name, sizeof(name), "a%d", i);
+    agattr(g, AGNODE, name, "x");
+  }
+  for (int i = 0; i < N; i += 4) {
+    agset(nodes[i], "a11", "y");
+  }
+
+  // deletions, with the freed memory then being reused
+  for (int i = 0; i < N; i += 10) {
+    agdelnode(g, nodes[i]);
+  }
+  agclean(g, AGNODE, "rec");
+  aginit(g, AGNODE, "rec", sizeof(rec_t), 1);
+  for (int i = 0; i < 100; ++i) {
+    snprintf(name, sizeof(name), "m%d", i);
+    agedge(g, agnode(g, name, 1), nodes[i * 4 + 1], NULL, 1);
+  }
+  agclean(g, AGNODE, "rec");
+
+  return g;
+}
+
+static char *to_string(Agraph_t *g) {
+  FILE *f = tmpfile();
+  assert(f != NULL);
+  int r = agwrite(g, f);
+  assert(r == 0);
+  long size = ftell(f);
+  assert(size > 0);
+  rewind(f);
+  char *s = calloc((size_t)size + 1, 1);
+  assert(s != NULL);
+  size_t got = fread(s, 1, (size_t)size, f);
+  assert(got == (size_t)size);
+  fclose(f);
+  (void)r;
+  return s;
+}
+
+int main(void) {
+  Agraph_t *heap = build(false);
+  Agraph_t *arena = build(true);
+
+  char *expected = to_string(heap);
+  char *actual = to_string(arena);
+  if (strcmp(expected, actual) != 0) {
+    fprintf(stderr, "graphs differ:\n%s\n---\n%s\n", expected, actual);
+    return EXIT_FAILURE;
+  }
+
+  free(actual);
+  free(expected);
+  agclose(arena);
+  agclose(heap);
+  return EXIT_SUCCESS;
+}
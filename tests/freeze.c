@@ -0,0 +1,161 @@
+/// \file
+/// \brief traversing a frozen graph should see what traversing it did before
+///
+/// Builds a multigraph with loops and a subgraph, and checks node and edge
+/// traversal and degrees are the same before `agfreeze`, after it, and after
+/// changes that thaw the graph again.
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// a text buffer, growing as needed
+typedef struct {
+  char *data;
+  size_t size, capacity;
+} buf_t;
+
+static void append(buf_t *b, const char *s) {
+  const size_t len = strlen(s);
+  if (b->size + len + 1 > b->capacity) {
+    b->capacity = (b->size + len + 1) * 2;
+    b->data = realloc(b->data, b->capacity);
+    assert(b->data != NULL);
+  }
+  memcpy(b->data + b->size, s, len + 1);
+  b->size += len;
+}
+
+static void append_edge(buf_t *b, const char *what, Agedge_t *e) {
+  char text[128];
+  snprintf(text, sizeof(text), " %s:%s->%s#%llu", what, agnameof(agtail(e)),
+           agnameof(aghead(e)), (unsigned long long)AGSEQ(e));
+  append(b, text);
+}
+
+/// list the nodes of a graph from last to first, which a frozen graph walks
+/// through links of its own
+static void append_backwards(buf_t *b, Agraph_t *g) {
+  append(b, "\nbackwards:");
+  for (Agnode_t *n = aglstnode(g); n; n = agprvnode(g, n)) {
+    append(b, " ");
+    append(b, agnameof(n));
+  }
+}
+
+/// describe the edge sets of every node of a graph
+static char *traverse(Agraph_t *g) {
+  buf_t b = {0};
+  for (Agnode_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+    char text[128];
+    snprintf(text, sizeof(text), "\n%s %d %d %d %d", agnameof(n),
+             agdegree(g, n, 1, 0), agdegree(g, n, 0, 1), agdegree(g, n, 1, 1),
+             agcountuniqedges(g, n, 1, 1));
+    append(&b, text);
+    for (Agedge_t *e = agfstout(g, n); e; e = agnxtout(g, e)) {
+      append_edge(&b, "out", e);
+    }
+    for (Agedge_t *e = agfstin(g, n); e; e = agnxtin(g, e)) {
+      append_edge(&b, "in", e);
+    }
+    for (Agedge_t *e = agfstedge(g, n); e; e = agnxtedge(g, e, n)) {
+      append_edge(&b, "any", e);
+    }
+  }
+  append_backwards(&b, g);
+  char text[64];
+  snprintf(text, sizeof(text), "\n%d nodes, %d edges\n", agnnodes(g),
+           agnedges(g));
+  append(&b, text);
+  return b.data;
+}
+
+static void compare(Agraph_t *g, const char *when, const char *how,
+                    const char *expected, const char *actual) {
+  if (strcmp(expected, actual) != 0) {
+    fprintf(stderr, "%s: %s traversed differently %s:\n%s\n---\n%s\n", when,
+            agnameof(g), how, expected, actual);
+    exit(EXIT_FAILURE);
+  }
+}
+
+/// check traversal of a graph, frozen earlier or not, is the same as that of
+/// the thawed graph and of the graph frozen again
+static void check(Agraph_t *g, const char *when) {
+  char *current = traverse(g);
+  agthaw(g);
+  char *expected = traverse(g);
+  agfreeze(g);
+  char *actual = traverse(g);
+  compare(g, when, "than when thawed", expected, current);
+  compare(g, when, "when frozen", expected, actual);
+  free(actual);
+  free(expected);
+  free(current);
+}
+
+int main(void) {
+  enum { N = 200, M = 1500 };
+  Agraph_t *g = agopen("g", Agdirected, NULL);
+
+  Agnode_t *nodes[N];
+  char name[32];
+  for (int i = 0; i < N; ++i) {
+    snprintf(name, sizeof(name), "n%d", i);
+    nodes[i] = agnode(g, name, 1);
+  }
+  for (int i = 0; i < M; ++i) {
+    // with repeats (multi-edges) and i = 0 mod 17 (loops)
+    Agnode_t *t = nodes[(i * 13) % N];
+    Agnode_t *h = i % 17 == 0 ? t : nodes[(i * i + 5) % N];
+    (void)agedge(g, t, h, NULL, 1);
+  }
+  Agraph_t *sg = agsubg(g, "s", 1);
+  for (int i = 0; i < N; i += 3) {
+    Agnode_t *n = agsubnode(sg, nodes[i], 1);
+    for (Agedge_t *e = agfstout(g, n); e; e = agnxtout(g, e)) {
+      if (AGSEQ(aghead(e)) % 2 == 0) {
+        (void)agsubedge(sg, e, 1);
+      }
+    }
+  }
+
+  check(g, "initially");
+  check(sg, "initially");
+
+  // an isolated node, which must not see edges of its neighbors in storage
+  (void)agnode(g, "lonely", 1);
+  check(g, "after adding a node");
+
+  // adding an edge to the subgraph thaws both it and its parent
+  agfreeze(sg);
+  (void)agedge(sg, nodes[3], nodes[6], "new", 1);
+  check(sg, "after adding a subgraph edge");
+  check(g, "after adding a subgraph edge");
+
+  // deleting an edge from the root thaws both
+  agfreeze(sg);
+  Agedge_t *victim = NULL;
+  for (Agnode_t *n = agfstnode(sg); n && !victim; n = agnxtnode(sg, n)) {
+    victim = agfstout(sg, n);
+  }
+  assert(victim != NULL);
+  (void)agdeledge(g, victim);
+  check(sg, "after deleting an edge");
+  check(g, "after deleting an edge");
+
+  // as does deleting a node
+  agfreeze(sg);
+  (void)agdelnode(g, nodes[9]);
+  check(sg, "after deleting a node");
+  check(g, "after deleting a node");
+
+  agthaw(g);
+  check(g, "after thawing");
+
+  // closing frozen graphs must free what they stored
+  agclose(g);
+  return EXIT_SUCCESS;
+}
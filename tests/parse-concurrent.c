@@ -0,0 +1,171 @@
+/// \file
+/// \brief parse graphs from several threads at once
+///
+/// Every thread reads each file given on the command line a number of times,
+/// both through `agread` (all graphs in the file) and `agmemread` (the first
+/// graph), and checks it sees the same graphs a serial read did. Strings of no
+/// graph are also created in one thread and released in another. Built with
+/// `-fsanitize=thread`, this also checks the parser shares no unsynchronized
+/// state between threads.
+///
+/// Usage: parse-concurrent file.gv ...
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { THREADS = 8, ROUNDS = 10 };
+
+typedef struct {
+  const char *path;
+  char *text;         ///< file contents
+  int graphs;         ///< number of graphs in the file
+  int nodes, edges;   ///< totals over all graphs
+  int nodes0, edges0; ///< sizes of the first graph
+} input_t;
+
+static input_t *inputs;
+static int n_inputs;
+
+/// a string of no graph per thread, created by the main thread
+static char *owned[THREADS];
+
+static char *slurp(const char *path) {
+  FILE *f = fopen(path, "rb");
+  assert(f != NULL);
+  int r = fseek(f, 0, SEEK_END);
+  assert(r == 0);
+  long size = ftell(f);
+  assert(size >= 0);
+  rewind(f);
+  char *text = malloc((size_t)size + 1);
+  assert(text != NULL);
+  size_t got = fread(text, 1, (size_t)size, f);
+  assert(got == (size_t)size);
+  text[got] = '\0';
+  fclose(f);
+  (void)r;
+  return text;
+}
+
+/// read all graphs of a file, totalling their sizes
+static void read_all(const char *path, int *graphs, int *nodes, int *edges) {
+  FILE *f = fopen(path, "r");
+  assert(f != NULL);
+  *graphs = *nodes = *edges = 0;
+  Agraph_t *g;
+  while ((g = agread(f, NULL)) != NULL) {
+    ++*graphs;
+    *nodes += agnnodes(g);
+    *edges += agnedges(g);
+    agclose(g);
+  }
+  fclose(f);
+}
+
+static void *worker(void *arg) {
+  const int id = (int)(size_t)arg;
+
+  // release the string the main thread created for us
+  if (agstrfree(NULL, owned[id]) != 0) {
+    fprintf(stderr, "thread %d: string of no graph not found\n", id);
+    exit(EXIT_FAILURE);
+  }
+
+  for (int round = 0; round < ROUNDS; ++round) {
+    // share a string of no graph with the other threads
+    char *shared = agstrdup(NULL, "shared");
+    assert(shared != NULL);
+
+    for (int k = 0; k < n_inputs; ++k) {
+      // start at a different input in each thread
+      const input_t *in = &inputs[(k + id) % n_inputs];
+
+      int graphs, nodes, edges;
+      read_all(in->path, &graphs, &nodes, &edges);
+      if (graphs != in->graphs || nodes != in->nodes || edges != in->edges) {
+        fprintf(stderr, "thread %d: %s read as %d graphs, %d nodes, %d edges "
+                "instead of %d, %d, %d\n", id, in->path, graphs, nodes, edges,
+                in->graphs, in->nodes, in->edges);
+        exit(EXIT_FAILURE);
+      }
+
+      Agraph_t *g = agmemread(in->text);
+      if (g == NULL || agnnodes(g) != in->nodes0 ||
+          agnedges(g) != in->edges0) {
+        fprintf(stderr, "thread %d: %s read from memory incorrectly\n", id,
+                in->path);
+        exit(EXIT_FAILURE);
+      }
+      agclose(g);
+    }
+    agstrfree(NULL, shared);
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  n_inputs = argc - 1;
+  if (n_inputs < 1) {
+    fprintf(stderr, "usage: %s file.gv ...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // read everything serially, for reference
+  inputs = calloc((size_t)n_inputs, sizeof(inputs[0]));
+  assert(inputs != NULL);
+  for (int i = 0; i < n_inputs; ++i) {
+    input_t *in = &inputs[i];
+    in->path = argv[i + 1];
+    in->text = slurp(in->path);
+    read_all(in->path, &in->graphs, &in->nodes, &in->edges);
+    assert(in->graphs > 0 && "input without any graphs");
+    Agraph_t *g = agmemread(in->text);
+    assert(g != NULL);
+    in->nodes0 = agnnodes(g);
+    in->edges0 = agnedges(g);
+    agclose(g);
+  }
+
+  char name[sizeof("thread ") + 3 * sizeof(int)];
+  for (int i = 0; i < THREADS; ++i) {
+    snprintf(name, sizeof(name), "thread %d", i);
+    owned[i] = agstrdup(NULL, name);
+    assert(owned[i] != NULL);
+  }
+
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; ++i) {
+    int r = pthread_create(&threads[i], NULL, worker, (void *)(size_t)i);
+    assert(r == 0);
+    (void)r;
+  }
+  for (int i = 0; i < THREADS; ++i) {
+    int r = pthread_join(threads[i], NULL);
+    assert(r == 0);
+    (void)r;
+  }
+
+  // every string of no graph should have been released
+  for (int i = 0; i < THREADS; ++i) {
+    snprintf(name, sizeof(name), "thread %d", i);
+    if (agstrbind(NULL, name) != NULL) {
+      fprintf(stderr, "string \"%s\" was not released\n", name);
+      return EXIT_FAILURE;
+    }
+  }
+  if (agstrbind(NULL, "shared") != NULL) {
+    fprintf(stderr, "string \"shared\" was not released\n");
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < n_inputs; ++i) {
+    free(inputs[i].text);
+  }
+  free(inputs);
+
+  printf("parsed %d files in %d threads\n", n_inputs, THREADS);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/// \file
+/// \brief read a shared graph from several threads at once
+///
+/// Builds a graph with attributes, freezes it and calls `agbeginshared`, and
+/// checks that threads reading its nodes, edges and attributes concurrently see
+/// what a serial read did. The typed attribute getters should leave their cache
+/// alone while the graph is shared, and fill it in again after `agendshared`.
+/// Built with `-fsanitize=thread`, this also checks the reads do not modify the
+/// graph.
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { N = 300, THREADS = 8, ROUNDS = 20 };
+
+static Agraph_t *g;
+static Agsym_t *weight;
+
+/// a summary of everything a reader sees
+static unsigned long long digest(void) {
+  unsigned long long h = 0;
+  for (Agnode_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+    for (const char *s = agnameof(n); *s != '\0'; ++s) {
+      h = h * 31 + (unsigned char)*s;
+    }
+    for (const char *s = agget(n, "label"); *s != '\0'; ++s) {
+      h = h * 31 + (unsigned char)*s;
+    }
+    double w = 0;
+    long k = 0;
+    bool b = false;
+    if (agxgetdouble(n, weight, &w)) {
+      h = h * 31 + (unsigned long long)(w * 8);
+    }
+    if (agxgetint(n, agattrsym(n, "rank"), &k)) {
+      h = h * 31 + (unsigned long long)k;
+    }
+    if (agxgetbool(n, agattr(g, AGNODE, "fixed", NULL), &b)) {
+      h = h * 31 + b;
+    }
+    for (Agedge_t *e = agfstout(g, n); e; e = agnxtout(g, e)) {
+      for (const char *s = agnameof(aghead(e)); *s != '\0'; ++s) {
+        h = h * 31 + (unsigned char)*s;
+      }
+    }
+  }
+  return h;
+}
+
+static unsigned long long expected;
+
+static void *reader(void *arg) {
+  (void)arg;
+  for (int i = 0; i < ROUNDS; ++i) {
+    if (digest() != expected) {
+      fprintf(stderr, "a thread read the shared graph differently\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  return NULL;
+}
+
+/// how many parsed values the typed getters have cached for `n`
+static int cached(Agnode_t *n) {
+  // the record cgraph keeps the attributes of an object in
+  const Agattr_t *attr = (Agattr_t *)aggetrec(n, "_AG_strdata", 0);
+  assert(attr != NULL);
+  return attr->nval;
+}
+
+int main(void) {
+  g = agopen("g", Agdirected, NULL);
+  weight = agattr(g, AGNODE, "weight", "1.5");
+  (void)agattr(g, AGNODE, "label", "\\N");
+  (void)agattr(g, AGNODE, "rank", "0");
+  (void)agattr(g, AGNODE, "fixed", "false");
+
+  Agnode_t *nodes[N];
+  char text[32];
+  for (int i = 0; i < N; ++i) {
+    snprintf(text, sizeof(text), "n%d", i);
+    nodes[i] = agnode(g, text, 1);
+    snprintf(text, sizeof(text), "%d.25", i);
+    agxset(nodes[i], weight, text);
+    snprintf(text, sizeof(text), "%d", i % 7);
+    agset(nodes[i], "rank", text);
+    agset(nodes[i], "fixed", i % 2 ? "true" : "false");
+  }
+  for (int i = 0; i < N; ++i) {
+    (void)agedge(g, nodes[i], nodes[(i * 7 + 1) % N], NULL, 1);
+  }
+
+  agfreeze(g);
+  agbeginshared(g);
+  expected = digest();
+  for (int i = 0; i < N; ++i) {
+    if (cached(nodes[i]) != 0) {
+      fprintf(stderr, "reading a shared graph cached a parsed value\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  pthread_t threads[THREADS];
+  for (int i = 0; i < THREADS; ++i) {
+    int r = pthread_create(&threads[i], NULL, reader, NULL);
+    assert(r == 0);
+    (void)r;
+  }
+  for (int i = 0; i < THREADS; ++i) {
+    int r = pthread_join(threads[i], NULL);
+    assert(r == 0);
+    (void)r;
+  }
+  agendshared(g);
+
+  // frozen but no longer shared, reads fill in the cache again
+  if (digest() != expected) {
+    fprintf(stderr, "the graph read differently once no longer shared\n");
+    return EXIT_FAILURE;
+  }
+  if (cached(nodes[0]) == 0) {
+    fprintf(stderr, "reading a graph that is not shared cached nothing\n");
+    return EXIT_FAILURE;
+  }
+
+  agclose(g);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include <cgraph++/AGraph.h>
+#include <gvc++/GVContext.h>
+#include <gvc++/GVLayout.h>
+#include <gvc++/GVRenderData.h>
+#include <gvc/gvplugin.h>
+
+// the plugins whose layouts and renderers keep their state per thread, without
+// the text layout plugins, so the test does not depend on the thread safety of
+// the font libraries
+extern "C" {
+extern gvplugin_library_t gvplugin_dot_layout_LTX_library;
+extern gvplugin_library_t gvplugin_neato_layout_LTX_library;
+extern gvplugin_library_t gvplugin_core_LTX_library;
+}
+
+static const lt_symlist_t builtins[] = {
+    {"gvplugin_dot_layout_LTX_library", &gvplugin_dot_layout_LTX_library},
+    {"gvplugin_neato_layout_LTX_library", &gvplugin_neato_layout_LTX_library},
+    {"gvplugin_core_LTX_library", &gvplugin_core_LTX_library},
+    {nullptr, nullptr},
+};
+
+/// a graph with clusters, records, labels and ports
+static std::string make_dot(int size) {
+  std::string dot = "digraph G { node [shape=box]; edge [label=e];\n";
+  for (int c = 0; c < 3; ++c) {
+    dot += "subgraph cluster_" + std::to_string(c) + " { label=\"cluster " +
+           std::to_string(c) + "\";\n";
+    for (int i = 0; i < size; ++i) {
+      dot += "n" + std::to_string(c) + "_" + std::to_string(i) + ";\n";
+    }
+    dot += "}\n";
+  }
+  for (int c = 0; c < 3; ++c) {
+    for (int i = 0; i < size; ++i) {
+      const std::string from = "n" + std::to_string(c) + "_" + std::to_string(i);
+      dot += from + " -> n" + std::to_string((c + 1) % 3) + "_" +
+             std::to_string((i * 7 + 3) % size) + ";\n";
+      dot += from + " -> n" + std::to_string(c) + "_" +
+             std::to_string((i + 1) % size) + " [label=\"" + from + "\"];\n";
+    }
+  }
+  dot += "r [shape=record, label=\"{<a> a | <b> b} | c\"]; s [shape=ellipse];\n"
+         "r:a -> s; r:b -> s:n [headlabel=h, taillabel=t];\n}\n";
+  return dot;
+}
+
+struct job_t {
+  std::string engine;
+  std::string format;
+};
+
+static std::string run(const std::string &dot, const job_t &job) {
+  auto gvc = std::make_shared<GVC::GVContext>(builtins, false);
+  auto g = std::make_shared<CGraph::AGraph>(dot);
+  const auto layout = GVC::GVLayout(gvc, g, job.engine);
+  const auto result = layout.render(job.format);
+  return std::string(result.string_view());
+}
+
+/// lay out and render in a thread of its own, which starts from the initial
+/// state of the per-thread pseudo-random number generators as all others do
+static std::string run_in_thread(const std::string &dot, const job_t &job) {
+  std::string result;
+  std::thread([&] { result = run(dot, job); }).join();
+  return result;
+}
+
+TEST_CASE("Graphs laid out and rendered concurrently in different threads are "
+          "the same as when laid out one at a time") {
+  // fdp is left out, as it orients the edges of its derived graphs by node
+  // address, so its output depends on where in the heap of a thread the nodes
+  // were allocated
+  const std::vector<job_t> jobs = {
+      {"dot", "svg"},   {"dot", "xdot"},   {"neato", "svg"}, {"neato", "json"},
+      {"circo", "dot"}, {"twopi", "svg"},  {"osage", "xdot"}, {"sfdp", "dot"},
+  };
+  const std::string dot = make_dot(12);
+
+  std::vector<std::string> expected;
+  for (const job_t &job : jobs) {
+    expected.push_back(run_in_thread(dot, job));
+  }
+
+  // Every run gets a fresh thread, as sfdp continues the pseudo-random sequence
+  // of earlier layouts in the same thread. Each thread of a round starts at a
+  // different job, so different layouts and renderers run at the same time.
+  const std::size_t thread_count = 4;
+  const std::size_t rounds = 2 * jobs.size();
+  std::vector<std::vector<std::string>> actual(thread_count);
+  for (std::size_t i = 0; i < rounds; ++i) {
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < thread_count; ++t) {
+      threads.emplace_back([&, t] {
+        actual[t].push_back(run(dot, jobs[(t + i) % jobs.size()]));
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  }
+
+  for (std::size_t t = 0; t < thread_count; ++t) {
+    for (std::size_t i = 0; i < actual[t].size(); ++i) {
+      const std::size_t j = (t + i) % jobs.size();
+      INFO("thread " << t << " running " << jobs[j].engine << " to "
+                     << jobs[j].format);
+      REQUIRE(actual[t][i] == expected[j]);
+    }
+  }
+}
+
+TEST_CASE("A graph laid out in one thread can be rendered and freed in another") {
+  const std::string dot =
+      "digraph { node [style=filled, fillcolor=yellow, color=red];\n"
+      "a -> b [style=dashed, color=blue, label=e]; b -> c [penwidth=2]; }\n";
+
+  for (const job_t job : {job_t{"dot", "svg"}, job_t{"neato", "xdot"}}) {
+    INFO("laying out with " << job.engine << " and rendering to "
+                            << job.format);
+    const std::string expected = run_in_thread(dot, job);
+
+    auto gvc = std::make_shared<GVC::GVContext>(builtins, false);
+    auto g = std::make_shared<CGraph::AGraph>(dot);
+    std::unique_ptr<GVC::GVLayout> layout;
+    std::thread([&] {
+      layout = std::make_unique<GVC::GVLayout>(gvc, g, job.engine);
+    }).join();
+
+    std::string actual;
+    std::thread([&] {
+      actual = std::string(layout->render(job.format).string_view());
+    }).join();
+
+    // the layout is freed in this thread, a third one
+    layout.reset();
+
+    REQUIRE(actual == expected);
+  }
+}
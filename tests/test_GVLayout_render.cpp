@@ -1,4 +1,9 @@
+#include <cstddef>
 #include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
 #include <catch2/catch_all.hpp>
 
@@ -37,3 +42,61 @@ TEST_CASE("Rendering in an unknown format throws an exception") {
 
   REQUIRE_THROWS_AS(layout.render("UNKNOWN_FORMAT"), std::runtime_error);
 }
+
+TEST_CASE("Rendering to a writer gives the same output as rendering to memory") {
+  const auto demand_loading = false;
+  auto gvc =
+      std::make_shared<GVC::GVContext>(lt_preloaded_symbols, demand_loading);
+
+  // enough nodes for the output to be passed on in more than one chunk
+  std::string dot = "digraph {";
+  for (int i = 0; i < 2000; ++i) {
+    dot += "n" + std::to_string(i) + ";";
+  }
+  dot += "}";
+  auto g = std::make_shared<CGraph::AGraph>(dot);
+
+  const auto layout = GVC::GVLayout(gvc, g, "dot");
+
+  const auto format = GENERATE("svg", "dot", "json");
+  const auto expected = layout.render(format);
+
+  std::string actual;
+  std::size_t chunks = 0;
+  layout.render(format, [&](std::string_view chunk) {
+    actual += chunk;
+    ++chunks;
+  });
+  REQUIRE(actual == expected.string_view());
+  REQUIRE(chunks > 1);
+
+  std::ostringstream os;
+  layout.render(format, os);
+  REQUIRE(os.str() == expected.string_view());
+}
+
+TEST_CASE("An exception thrown by the writer is passed on to the caller") {
+  const auto demand_loading = false;
+  auto gvc =
+      std::make_shared<GVC::GVContext>(lt_preloaded_symbols, demand_loading);
+
+  auto dot = "digraph {a}";
+  auto g = std::make_shared<CGraph::AGraph>(dot);
+
+  const auto layout = GVC::GVLayout(gvc, g, "dot");
+
+  std::size_t calls = 0;
+  REQUIRE_THROWS_AS(layout.render("svg",
+                                  [&](std::string_view) {
+                                    ++calls;
+                                    throw std::logic_error("writer failed");
+                                  }),
+                    std::logic_error);
+  // the writer is not called again once it has failed
+  REQUIRE(calls == 1);
+
+  // the layout can still be rendered afterwards
+  std::ostringstream os;
+  layout.render("svg", os);
+  REQUIRE(os.str() == layout.render("svg").string_view());
+}
@@ -48,6 +48,129 @@ def test_bitarray():
     _, _ = run_c(src, cflags=cflags)
 
 
+def test_random():
+    """run random.h’s unit tests"""
+
+    # locate the unit tests
+    src = Path(__file__).parent.resolve() / "../lib/util/test_random.c"
+    assert src.exists()
+
+    # locate lib directory that needs to be in the include path
+    lib = Path(__file__).parent.resolve() / "../lib"
+
+    # extra C flags this compilation needs
+    cflags = ["-I", lib]
+    if platform.system() != "Windows":
+        cflags += ["-std=gnu99", "-Wall", "-Wextra", "-Werror"]
+
+    _, _ = run_c(src, cflags=cflags)
+
+
+def test_fmt_fixed():
+    """run fmt_fixed.h’s unit tests"""
+
+    # locate the unit tests
+    src = Path(__file__).parent.resolve() / "../lib/util/test_fmt_fixed.c"
+    assert src.exists()
+
+    # locate lib directory that needs to be in the include path
+    lib = Path(__file__).parent.resolve() / "../lib"
+
+    # extra C flags this compilation needs
+    cflags = ["-I", lib]
+    if platform.system() != "Windows":
+        cflags += ["-std=gnu99", "-Wall", "-Wextra", "-Werror", "-lm"]
+
+    _, _ = run_c(src, cflags=cflags)
+
+
+def test_sparse_kernels():
+    """run ../lib/sparse/kernels.c’s unit tests"""
+
+    # locate the unit tests
+    src = Path(__file__).parent.resolve() / "../lib/sparse/test_kernels.c"
+    assert src.exists()
+
+    # locate lib directory that needs to be in the include path
+    lib = Path(__file__).parent.resolve() / "../lib"
+
+    # extra C flags this compilation needs
+    cflags = ["-I", lib]
+    if platform.system() != "Windows":
+        cflags += ["-std=gnu99", "-Wall", "-Wextra", "-Werror"]
+
+    _, _ = run_c(src, cflags=cflags)
+
+
+def test_quadtree():
+    """run ../lib/sparse/QuadTree.c’s unit tests"""
+
+    # locate the unit tests
+    src = Path(__file__).parent.resolve() / "../lib/sparse/test_quadtree.c"
+    assert src.exists()
+
+    # locate lib directory that needs to be in the include path
+    lib = Path(__file__).parent.resolve() / "../lib"
+
+    # extra C flags this compilation needs
+    cflags = ["-I", lib]
+    for sub in ("cdt", "cgraph", "common"):
+        cflags += ["-I", lib / sub]
+    if platform.system() != "Windows":
+        cflags += ["-std=gnu99", "-Wall", "-Wextra", "-Werror", "-lm"]
+    # build the subtrees of the bulk builder in parallel where OpenMP is at hand
+    if platform.system() == "Linux":
+        cflags += ["-fopenmp"]
+
+    _, _ = run_c(src, cflags=cflags)
+
+
+def test_multilevel():
+    """run ../lib/sfdpgen/Multilevel.c’s unit tests"""
+
+    # locate the unit tests
+    src = Path(__file__).parent.resolve() / "../lib/sfdpgen/test_multilevel.c"
+    assert src.exists()
+
+    # locate lib directory that needs to be in the include path
+    lib = Path(__file__).parent.resolve() / "../lib"
+
+    # extra C flags this compilation needs
+    cflags = ["-I", lib]
+    for sub in ("cdt", "cgraph", "common"):
+        cflags += ["-I", lib / sub]
+    if platform.system() != "Windows":
+        cflags += ["-std=gnu99", "-Wall", "-Wextra", "-Werror", "-lm"]
+    # match and coarsen on multiple threads where OpenMP is at hand
+    if platform.system() == "Linux":
+        cflags += ["-fopenmp"]
+
+    _, _ = run_c(src, cflags=cflags)
+
+
+def test_refstr(tmp_path: Path):
+    """run ../lib/cgraph/refstr.c’s unit tests"""
+
+    # locate the unit tests
+    src = Path(__file__).parent.resolve() / "../lib/cgraph/test_refstr.c"
+    assert src.exists()
+
+    # locate lib directory that needs to be in the include path
+    lib = Path(__file__).parent.resolve() / "../lib"
+
+    # cghdr.h includes the build’s config.h, of which refstr.c needs nothing
+    (tmp_path / "config.h").write_text("", encoding="utf-8")
+
+    # extra C flags this compilation needs
+    cflags = ["-I", tmp_path, "-I", lib]
+    for sub in ("cdt", "cgraph", "common"):
+        cflags += ["-I", lib / sub]
+    if platform.system() != "Windows":
+        cflags += ["-std=gnu99", "-Wall", "-Wextra", "-Werror", "-pthread"]
+
+    _, _ = run_c(src, cflags=cflags)
+
+
 @pytest.mark.parametrize("builtins", (False, True))
 def test_overflow_h(builtins: bool):
     """test ../lib/util/overflow.h"""
@@ -2,19 +2,30 @@
 Graphviz miscellaneous test cases
 """
 
+import gzip
+import hashlib
 import itertools
 import json
+import math
 import os
 import platform
+import re
 import subprocess
 import sys
 import tempfile
 from pathlib import Path
+from typing import List
 
 import pytest
 
 sys.path.append(os.path.dirname(__file__))
-from gvtest import ROOT, compile_c, dot  # pylint: disable=wrong-import-position
+from gvtest import (  # pylint: disable=wrong-import-position
+    ROOT,
+    compile_c,
+    dot,
+    run_c,
+    which,
+)
 
 
 def test_json_node_order():
@@ -227,3 +238,537 @@ def test_xml_escape():
                     assert escaped == f"character |{expected}|", "bad UTF-8 escaping"
                 else:
                     assert escaped == unescaped, "bad UTF-8 passthrough"
+
+
+@pytest.mark.skipif(which("sfdp") is None, reason="sfdp not available")
+@pytest.mark.parametrize("threads", (0, 2, 3))
+def test_sfdp_threads_deterministic(threads: int):
+    """
+    multithreaded sfdp force computation should not depend on the thread count
+    """
+
+    # a graph large enough to use the quadtree
+    input = Path(__file__).parent / "graphs/b100.gv"
+    assert input.exists(), "unexpectedly missing test case"
+
+    def layout(t: int) -> str:
+        return subprocess.check_output(
+            [
+                which("sfdp"),
+                "-Gquadtree=fast",
+                "-Goverlap=true",
+                f"-Gthreads={t}",
+                "-Tplain",
+                input,
+            ],
+            universal_newlines=True,
+        )
+
+    assert layout(threads) == layout(4), "layout depends on number of threads"
+
+
+@pytest.mark.skipif(which("neato") is None, reason="neato not available")
+@pytest.mark.parametrize("model", ("shortpath", "subset", "mds"))
+def test_neato_apsp_threads(model: str):
+    """
+    computing neato’s all-pairs shortest paths on several threads should not
+    change the layout
+    """
+
+    input = Path(__file__).parent / "graphs/b102.gv"
+    assert input.exists(), "unexpectedly missing test case"
+
+    def layout(t: int) -> str:
+        return subprocess.check_output(
+            [which("neato"), f"-Gmodel={model}", f"-Gthreads={t}", "-Tplain", input],
+            universal_newlines=True,
+        )
+
+    assert layout(1) == layout(4), "layout depends on number of threads"
+
+
+@pytest.mark.skipif(which("neato") is None, reason="neato not available")
+@pytest.mark.parametrize("model", ("shortpath", "subset", "mds"))
+def test_neato_sparse_mode(model: str):
+    """
+    neato’s sparse stress mode should lay out a graph nearly as well as the
+    full stress model
+    """
+
+    input = Path(__file__).parent / "graphs/b124.gv"
+    assert input.exists(), "unexpectedly missing test case"
+
+    def stress(mode: str) -> float:
+        """
+        lay out the graph and return its stress against the distances the model
+        targets, normalized and at the best scale
+        """
+        output = subprocess.check_output(
+            [which("neato"), f"-Gmode={mode}", f"-Gmodel={model}", "-Tjson", input],
+            universal_newlines=True,
+        )
+        graph = json.loads(output)
+        pos = {
+            n["_gvid"]: tuple(float(c) for c in n["pos"].split(","))
+            for n in graph["objects"]
+        }
+        adj = {v: set() for v in pos}
+        for e in graph["edges"]:
+            if e["tail"] != e["head"]:
+                adj[e["tail"]].add(e["head"])
+                adj[e["head"]].add(e["tail"])
+
+        # edge weights the model uses; mds falls back to shortpath without len
+        def weight(u: int, v: int) -> float:
+            if model == "subset":
+                return len(adj[u]) + len(adj[v]) - 2 * len(adj[u] & adj[v])
+            return 1
+
+        # all pairs shortest paths
+        pairs = 0
+        num = den = 0.0
+        for source in pos:
+            dist = {source: 0.0}
+            done = set()
+            while len(done) < len(dist):
+                u = min((v for v in dist if v not in done), key=dist.get)
+                done.add(u)
+                for v in adj[u]:
+                    d = dist[u] + weight(u, v)
+                    if d < dist.get(v, float("inf")):
+                        dist[v] = d
+            for target, d in dist.items():
+                if target <= source:
+                    continue
+                x = math.dist(pos[source], pos[target])
+                pairs += 1
+                num += x * x / (d * d)
+                den += x / d
+        # at the best scale s = den / num, Σ((s·x - d) / d)² = pairs - den² / num
+        return (pairs - den * den / num) / pairs
+
+    full = stress("major")
+    sparse = stress("sparse")
+    assert sparse <= 1.5 * full, "sparse mode layout is much worse than major mode"
+
+
+@pytest.mark.skipif(which("neato") is None, reason="neato not available")
+@pytest.mark.parametrize("threads", (0, 2, 3))
+def test_neato_sgd_threads_deterministic(threads: int):
+    """
+    multithreaded neato SGD should not depend on the thread count
+    """
+
+    input = Path(__file__).parent / "graphs/b100.gv"
+    assert input.exists(), "unexpectedly missing test case"
+
+    def layout(t: int) -> str:
+        return subprocess.check_output(
+            [which("neato"), "-Gmode=sgd", f"-Gthreads={t}", "-Tplain", input],
+            universal_newlines=True,
+        )
+
+    assert layout(threads) == layout(4), "layout depends on number of threads"
+
+
+# SHA-256 digests of dot’s node positions in test graphs, computed with the
+# network simplex pivot rule as it was before its pivots were sped up
+NS_POSITIONS = {
+    "abstract.gv": "5dca3ec24cfa51c4dc9b5117c69a5895db3bf2b45d185fd79704c7f161b67f85",
+    "alf.gv": "fe5d04767a76dfa8b86e7eb365739736d210973c3890c1fbb48d5747e99f24c3",
+    "b102.gv": "10621c44ccc337cba4f89b48ea6e5b900578ac30b6b84bedf4e6af6673217a1b",
+    "b124.gv": "54207b6f87db40aded04b28c3f6745aab059b4da1b473c2bd727fc75bfac1459",
+    "b29.gv": "947786c2b10ef2edb0fe6d6f0ff59c6518d26b9e062fa118572cc5aee82b7098",
+    "clust4.gv": "58a53a4f4fede118fab4037285d5a81ba514bede49f037da7e981f9042447043",
+    "crazy.gv": "e0e0fa324feafd5fa07ce6ea9b42345aa8693f5d87ef473c81e6cc465ebe5188",
+    "jcctree.gv": "cd04917758be8e8344e20cb72e74a600560de5b32ffa8ddcd0af695df14254c0",
+    "mike.gv": "01e3bdc9c71ec6f2c7919095d643994276c2623ea253bcd7b52b4f56313690de",
+    "pgram.gv": "3c7107eb8ccef3f21ad2cc1964cb339a10655eaae9f8c04cc04ea27b0ade9585",
+    "unix.gv": "c109bd22271693bbb6dbe601d473d5cd6ceee2b562428e0e4467ccac91b71641",
+    "world.gv": "4bddc2159a48cbfc0b892d998aa944757c609207d2d3147a7eedf75a17c9c802",
+}
+
+
+@pytest.mark.skipif(
+    which("dot") is None or which("gvpr") is None, reason="dot or gvpr not available"
+)
+@pytest.mark.parametrize("graph", sorted(NS_POSITIONS))
+def test_ns_pivots_unchanged(graph: str):
+    """
+    network simplex should rank nodes and assign their x coordinates as its
+    previous pivot rule did
+    """
+
+    input = Path(__file__).parent / "graphs" / graph
+    assert input.exists(), "unexpectedly missing test case"
+
+    # make every node the same size and drop labels, so positions do not depend
+    # on the fonts at hand
+    uniform = subprocess.check_output(
+        [
+            which("gvpr"),
+            "-c",
+            'BEG_G { graph_t s; label = ""; for (s = fstsubg($G); s; s = nxtsubg(s))'
+            ' s.label = ""; }'
+            ' N { label = ""; xlabel = ""; shape = "box"; fixedsize = "true";'
+            ' width = "0.75"; height = "0.5"; }'
+            ' E { label = ""; xlabel = ""; headlabel = ""; taillabel = ""; }',
+            input,
+        ],
+        universal_newlines=True,
+    )
+    output = subprocess.check_output(
+        [which("dot"), "-Nlabel=", "-Elabel=", "-Tplain"],
+        input=uniform,
+        universal_newlines=True,
+    )
+
+    nodes = "".join(f"{l}\n" for l in output.splitlines() if l.startswith("node "))
+    assert nodes != "", "no nodes in output"
+    digest = hashlib.sha256(nodes.encode("utf-8")).hexdigest()
+    assert digest == NS_POSITIONS[graph], "node positions changed"
+
+
+@pytest.mark.skipif(which("dot") is None, reason="dot not available")
+def test_dot_xcoord_bk():
+    """
+    dot’s Brandes–Köpf coordinate assignment should keep nodes on a rank apart
+    """
+
+    input = Path(__file__).parent / "graphs/b100.gv"
+    assert input.exists(), "unexpectedly missing test case"
+
+    output = subprocess.check_output(
+        [which("dot"), "-Gxcoord=bk", "-Tplain", input],
+        universal_newlines=True,
+    )
+
+    ranks = {}
+    for line in output.splitlines():
+        if line.startswith("node "):
+            _, _, x, y, width, _ = line.split(maxsplit=6)[:6]
+            ranks.setdefault(y, []).append((float(x), float(width)))
+    assert len(ranks) > 1, "all nodes were placed on one rank"
+    for nodes in ranks.values():
+        nodes.sort()
+        for (x0, w0), (x1, w1) in zip(nodes, nodes[1:]):
+            assert x1 - x0 >= (w0 + w1) / 2 - 0.01, "overlapping nodes on a rank"
+
+
+@pytest.mark.skipif(which("dot") is None, reason="dot not available")
+@pytest.mark.parametrize("threads", (0, 2, 3))
+def test_dot_mincross_threads(threads: int):
+    """
+    ordering components concurrently should give the same layout as serially
+    """
+
+    # several components, each with some crossings to remove
+    components = []
+    for c in range(8):
+        edges = [f"c{c}_{i} -> c{c}_{(i * 7 + c) % 12 + 12}" for i in range(12)]
+        edges += [f"c{c}_{i + 12} -> c{c}_{(i * 5) % 12 + 24}" for i in range(12)]
+        components.append("; ".join(edges))
+    input = "digraph { " + "; ".join(components) + " }"
+
+    def layout(t: int) -> str:
+        return subprocess.check_output(
+            [which("dot"), f"-Gthreads={t}", "-Tplain"],
+            input=input,
+            universal_newlines=True,
+        )
+
+    assert layout(threads) == layout(1), "layout depends on number of threads"
+
+
+@pytest.mark.skipif(which("dot") is None, reason="dot not available")
+@pytest.mark.parametrize("threads", (0, 2, 3))
+@pytest.mark.parametrize("layers", (False, True))
+def test_ps_pages_threads(threads: int, layers: bool):
+    """
+    emitting pages concurrently should give the same PostScript as serially
+    """
+
+    # a graph spread over many pages, with clusters, links and Latin-1 text
+    edges = "; ".join(f"n{i} -> n{(i * 7 + 3) % 200}" for i in range(200))
+    clusters = ""
+    for c in range(5):
+        members = " ".join(f"n{c * 20 + i}" for i in range(20))
+        clusters += f"subgraph cluster_{c} {{ label=c{c}; {members} }} "
+    attrs = 'page="4,4"; charset=latin1; node [URL="http://example.com/\\N"]'
+    if layers:
+        attrs += '; layers="a:b:c"; n0 [layer=b]'
+    source = f'digraph {{ {attrs}; n1 [label="café"]; {clusters} {edges} }}'
+
+    def render(t: int) -> bytes:
+        return subprocess.check_output(
+            [which("dot"), f"-Gthreads={t}", "-Tps"], input=source.encode("utf-8")
+        )
+
+    assert render(threads) == render(1), "output depends on number of threads"
+
+
+@pytest.mark.skipif(which("dot") is None, reason="dot not available")
+@pytest.mark.parametrize("order", ("breadthfirst", "nodesfirst", "edgesfirst"))
+def test_ps_pages_nodes(order: str):
+    """
+    every node should be drawn on some page of paginated output, and at most
+    once on each
+    """
+
+    edges = "; ".join(f"n{i} -> n{(i * 7 + 3) % 100}" for i in range(100))
+    source = f'digraph {{ page="2,2"; outputorder={order}; {edges} }}'
+    ps = subprocess.check_output(
+        [which("dot"), "-Tps"], input=source, universal_newlines=True
+    )
+
+    pages = ps.split("%%Page:")[1:]
+    assert len(pages) > 1, "graph did not span several pages"
+    drawn = set()
+    for page in pages:
+        nodes = re.findall(r"^% (n\d+)$", page, flags=re.MULTILINE)
+        assert len(nodes) == len(set(nodes)), "node drawn twice on a page"
+        drawn.update(nodes)
+    assert drawn == {f"n{i}" for i in range(100)}, "nodes missing from pages"
+
+
+@pytest.mark.skipif(which("dot") is None, reason="dot not available")
+@pytest.mark.parametrize("order", ("breadthfirst", "nodesfirst", "edgesfirst"))
+def test_ps_pages_view(order: str):
+    """
+    each page of paginated output should draw the same nodes and edges, in the
+    same order, as a single page viewing the same part of the graph
+    """
+
+    # nodes, edges, edge labels and external labels, spread over many pages
+    nodes = "; ".join(f'n{i} [xlabel="nx{i}"]' for i in range(0, 60, 3))
+    edges = "; ".join(
+        f'n{i} -> n{(i * 7 + 3) % 60} [label="e{i}", xlabel="x{i}"]' for i in range(60)
+    )
+    source = f"digraph {{ margin=0; pad=0; outputorder={order}; {nodes}; {edges} }}"
+
+    def objects(ps: str) -> List[str]:
+        return re.findall(r"^% (n\d+(?:->n\d+)?)$", ps, flags=re.MULTILINE)
+
+    def render(attrs: str) -> str:
+        return subprocess.check_output(
+            [which("dot"), "-Tps"],
+            input=source.replace("{", f"{{ {attrs};", 1),
+            universal_newlines=True,
+        )
+
+    # 1.7in pages, which are rounded to whole points, and whose edges no object
+    # touches, where rounding of the view centre could decide what is drawn
+    page = (122, 122)
+    pages = [objects(p) for p in render('page="1.7,1.7"').split("%%Page:")[1:]]
+
+    layout = json.loads(
+        subprocess.check_output(
+            [which("dot"), "-Tjson0"], input=source, universal_newlines=True
+        )
+    )
+    bb = [float(v) for v in layout["bb"].split(",")]
+    size = [bb[d + 2] - bb[d] for d in (0, 1)]
+    focus = [(bb[d] + bb[d + 2]) / 2 for d in (0, 1)]
+    count = [math.ceil(size[d] / page[d]) for d in (0, 1)]
+    assert len(pages) == count[0] * count[1], "unexpected number of pages"
+    assert any(len(p) > 0 for p in pages[1:]), "graph did not span several pages"
+
+    # pages run left to right, then bottom to top
+    for k, drawn in enumerate(pages):
+        at = (k % count[0], k // count[0])
+        centre = [focus[d] + page[d] * (at[d] - count[d] / 2 + 0.5) for d in (0, 1)]
+        view = f'viewport="{page[0]},{page[1]},1,{centre[0]!r},{centre[1]!r}"'
+        assert drawn == objects(render(view)), f"page {k + 1} differs from its view"
+
+
+@pytest.mark.parametrize(
+    "args,graph,misses,hits,bounded",
+    (
+        pytest.param(
+            ["dot"],
+            "digraph { "
+            + "; ".join(
+                f"n{i} [label={('alpha', 'beta', 'gamma')[i % 3]}]" for i in range(300)
+            )
+            + " }",
+            3,
+            300 - 3,
+            False,
+            id="repeated labels",
+        ),
+        # the empty line is not measured
+        pytest.param(
+            ["dot"],
+            "digraph { "
+            + "; ".join(
+                f'n{i} [label="alpha\\nbeta\\l\\ngamma\\r"]' for i in range(100)
+            )
+            + " }",
+            3,
+            100 * 3 - 3,
+            False,
+            id="lines of labels",
+        ),
+        # more distinct labels than the cache keeps, at given positions so that
+        # laying them out is quick
+        pytest.param(
+            ["neato", "-n2"],
+            "graph { node [shape=plaintext]; "
+            + "; ".join(
+                f'n{i} [pos="{i % 300},{i // 300}"]' for i in range(70000)
+            )
+            + " }",
+            70000,
+            0,
+            True,
+            id="bounded",
+        ),
+    ),
+)
+def test_text_metrics_cache(
+    args: list[str], graph: str, misses: int, hits: int, bounded: bool
+):
+    """
+    each distinct span should be measured once, and later ones looked up in a
+    cache that does not grow without bound
+    """
+
+    if which(args[0]) is None:
+        pytest.skip(f"{args[0]} not available")
+
+    proc = subprocess.run(
+        [which(args[0])] + args[1:] + ["-v", "-Tdot", "-o", os.devnull],
+        input=graph,
+        stderr=subprocess.PIPE,
+        universal_newlines=True,
+        check=True,
+    )
+
+    stats = r"text metrics cache: (\d+) hits, (\d+) misses, (\d+) spans"
+    m = re.search(stats, proc.stderr)
+    assert m is not None, "no text metrics cache statistics with -v"
+    assert int(m.group(2)) == misses, "spans were not measured exactly once"
+    assert int(m.group(1)) == hits, "spans were not looked up in the cache"
+    if bounded:
+        assert int(m.group(3)) < misses, "text metrics cache kept every span"
+
+
+@pytest.mark.skipif(platform.system() == "Windows", reason="uses pthreads")
+def test_parse_concurrent():
+    """
+    graphs should be parseable from several threads at once
+    """
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / "parse-concurrent.c").resolve()
+    assert c_src.exists(), "missing test case"
+
+    # a mix of inputs, including files with several graphs and HTML-like labels
+    graphs = Path(__file__).parent / "graphs"
+    inputs = [graphs / f for f in ("b100.gv", "clust4.gv", "html.gv", "multi.gv")]
+
+    # when the build was instrumented with ThreadSanitizer, $CFLAGS will carry
+    # `-fsanitize=thread` through to this program too
+    stdout, _ = run_c(
+        c_src, [str(i) for i in inputs], cflags=["-pthread"], link=["cgraph"]
+    )
+
+    assert f"parsed {len(inputs)} files" in stdout
+
+
+def test_arena():
+    """
+    a graph allocated from an arena should behave the same as one that is not
+    """
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / "arena.c").resolve()
+    assert c_src.exists(), "missing test case"
+
+    run_c(c_src, link=["cgraph"])
+
+
+def test_freeze():
+    """
+    traversing a frozen graph should be the same as traversing it thawed
+    """
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / "freeze.c").resolve()
+    assert c_src.exists(), "missing test case"
+
+    run_c(c_src, link=["cgraph"])
+
+
+@pytest.mark.skipif(platform.system() == "Windows", reason="uses pthreads")
+def test_shared_reads():
+    """
+    a shared graph should be readable from several threads at once
+    """
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / "shared-reads.c").resolve()
+    assert c_src.exists(), "missing test case"
+
+    # when the build was instrumented with ThreadSanitizer, $CFLAGS will carry
+    # `-fsanitize=thread` through to this program too
+    run_c(c_src, cflags=["-pthread"], link=["cgraph"])
+
+
+@pytest.mark.skipif(which("dot") is None, reason="dot not available")
+def test_svgz_threads():
+    """
+    compressed output should decompress to the same, whether compressed in one
+    stream or in blocks on several threads, and compressing in blocks should
+    give the same bytes for any number of threads
+    """
+
+    # a graph whose SVG spans several compression blocks
+    nodes = "".join(
+        f'n{i} [pos="{i % 50 * 100},{i // 50 * 100}"];\n' for i in range(5000)
+    )
+    source = f"graph {{ node [shape=box]; {nodes} }}".encode("utf-8")
+    args = [which("dot"), "-Kneato", "-n"]
+
+    svg = subprocess.check_output(args + ["-Tsvg"], input=source)
+    svgz = {}
+    for threads in (1, 0, 3):
+        svgz[threads] = subprocess.check_output(
+            args + ["-Tsvgz", f"-Gthreads={threads}"], input=source
+        )
+        assert (
+            gzip.decompress(svgz[threads]) == svg
+        ), f"threads={threads} corrupted output"
+
+    assert svgz[0] == svgz[3], "compressed output depends on number of threads"
+
+
+def test_typed_attributes():
+    """
+    typed attribute reads should see changes to attributes
+    """
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / "typed-attributes.c").resolve()
+    assert c_src.exists(), "missing test case"
+
+    run_c(c_src, link=["cgraph"])
+
+
+@pytest.mark.skipif(which("dot") is None, reason="dot not available")
+def test_ps_layers_nodes():
+    """
+    a node should be drawn once on each layer, however many layers come before
+    """
+
+    layers = ":".join(f"l{i}" for i in range(200))
+    source = f'digraph {{ layers="{layers}"; a -> b; c -> b }}'
+    ps = subprocess.check_output(
+        [which("dot"), "-Tps"], input=source, universal_newlines=True
+    )
+
+    pages = ps.split("%%Page:")[1:]
+    assert len(pages) == 200, "unexpected number of layers"
+    for i, page in enumerate(pages):
+        nodes = re.findall(r"^% (\w+)$", page, flags=re.MULTILINE)
+        assert sorted(nodes) == ["a", "b", "c"], f"wrong nodes on layer {i + 1}"
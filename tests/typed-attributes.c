@@ -0,0 +1,88 @@
+/// \file
+/// \brief typed attribute reads should follow changes to the attributes
+///
+/// Reads attributes with `agxgetdouble`, `agxgetint` and `agxgetbool`, before
+/// and after changing them, and after declaring more attributes than there
+/// were when the first typed read of an object was made.
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static double get_double(void *obj, Agsym_t *sym) {
+  double d = -1;
+  return agxgetdouble(obj, sym, &d) ? d : -1;
+}
+
+static long get_int(void *obj, Agsym_t *sym) {
+  long i = -1;
+  return agxgetint(obj, sym, &i) ? i : -1;
+}
+
+static int get_bool(void *obj, Agsym_t *sym) {
+  bool b = false;
+  return agxgetbool(obj, sym, &b) ? b : -1;
+}
+
+int main(void) {
+  Agraph_t *g = agopen("g", Agdirected, NULL);
+  Agsym_t *width = agattr(g, AGNODE, "width", "0.75");
+  Agsym_t *fixed = agattr(g, AGNODE, "fixedsize", "false");
+  Agnode_t *a = agnode(g, "a", 1);
+  Agnode_t *b = agnode(g, "b", 1);
+
+  // defaults, read repeatedly
+  for (int i = 0; i < 2; ++i) {
+    assert(get_double(a, width) == 0.75);
+    assert(get_int(a, width) == 0);
+    assert(get_double(a, width) == 0.75);
+    assert(get_bool(a, fixed) == 0);
+  }
+
+  // changes are seen, by the changed object only
+  agxset(a, width, "2.5");
+  agxset(a, fixed, "Yes");
+  assert(get_double(a, width) == 2.5);
+  assert(get_int(a, width) == 2);
+  assert(get_bool(a, fixed) == 1);
+  assert(get_double(b, width) == 0.75);
+  assert(get_bool(b, fixed) == 0);
+
+  // values that do not parse
+  agxset(a, width, "");
+  assert(get_double(a, width) == -1);
+  agxset(a, width, "wide");
+  assert(get_double(a, width) == -1);
+  assert(get_int(a, width) == -1);
+  agxset(a, fixed, "shape");
+  assert(get_bool(a, fixed) == -1);
+  agxset(a, fixed, "3");
+  assert(get_bool(a, fixed) == 1);
+
+  // attributes declared after objects were read
+  Agsym_t *syms[20];
+  for (int i = 0; i < 20; ++i) {
+    char name[16], value[16];
+    snprintf(name, sizeof(name), "x%d", i);
+    snprintf(value, sizeof(value), "%d", i);
+    syms[i] = agattr(g, AGNODE, name, value);
+  }
+  for (int i = 0; i < 20; ++i) {
+    assert(get_int(a, syms[i]) == i);
+    assert(get_double(b, syms[i]) == i);
+  }
+  agxset(b, syms[19], "-7.5");
+  assert(get_double(b, syms[19]) == -7.5);
+  assert(get_int(b, syms[19]) == -7);
+
+  // setting a graph attribute
+  Agsym_t *ranksep = agattr(g, AGRAPH, "ranksep", "0.5");
+  assert(get_double(g, ranksep) == 0.5);
+  agset(g, "ranksep", "1.25");
+  assert(get_double(g, ranksep) == 1.25);
+
+  agclose(g);
+  return EXIT_SUCCESS;
+}